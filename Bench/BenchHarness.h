@@ -0,0 +1,53 @@
+#ifndef BenchHarness_h
+#define BenchHarness_h
+
+// Minimal self-registering microbenchmark harness for the portable driver core.
+// Built with the host compiler by `make bench`; results are emitted as JSON.
+
+#include <stdint.h>
+#include <stddef.h>
+
+static constexpr int kMaxBenchCounters = 16;
+
+/// Per-run state handed to a benchmark body.
+class BenchState {
+public:
+    explicit BenchState(uint64_t iterations) : iterations(iterations) {}
+
+    /// Number of outer iterations the body should perform.
+    const uint64_t iterations;
+
+    /// Total number of MIDI events processed by the run (ns/event denominator).
+    void SetEvents(uint64_t n) { events = n; }
+
+    /// Attach an extra named metric (e.g. queue depth) to the JSON record.
+    void SetCounter(const char *name, double value);
+
+    uint64_t events = 0;
+    int      numCounters = 0;
+    const char *counterNames[kMaxBenchCounters] = {};
+    double   counterValues[kMaxBenchCounters] = {};
+};
+
+typedef void (*BenchFunction)(BenchState &state);
+
+struct BenchRegistrar {
+    BenchRegistrar(const char *name, BenchFunction fn, uint64_t iterations);
+};
+
+/// Number of heap allocations made by the process so far.
+uint64_t BenchAllocationCount();
+
+/// Prevent the optimizer from discarding a computed value.
+template <typename T>
+inline void BenchDoNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#define BENCHMARK(name, iterations)                                     \
+    static void name(BenchState &state);                                \
+    static BenchRegistrar name##_registrar(#name, name, iterations);    \
+    static void name(BenchState &state)
+
+#endif /* BenchHarness_h */
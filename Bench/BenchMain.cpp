@@ -0,0 +1,123 @@
+#include "BenchHarness.h"
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------- Allocation counting ----------
+
+static std::atomic<uint64_t> sAllocations{0};
+
+void *operator new(size_t size)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+uint64_t BenchAllocationCount()
+{
+    return sAllocations.load(std::memory_order_relaxed);
+}
+
+// ---------- Registry ----------
+
+struct BenchEntry {
+    const char   *name;
+    BenchFunction fn;
+    uint64_t      iterations;
+};
+
+static constexpr int kMaxBenchmarks = 256;
+static BenchEntry sBenchmarks[kMaxBenchmarks];
+static int sNumBenchmarks = 0;
+
+BenchRegistrar::BenchRegistrar(const char *name, BenchFunction fn, uint64_t iterations)
+{
+    if (sNumBenchmarks < kMaxBenchmarks)
+        sBenchmarks[sNumBenchmarks++] = { name, fn, iterations };
+}
+
+void BenchState::SetCounter(const char *name, double value)
+{
+    for (int i = 0; i < numCounters; i++) {
+        if (strcmp(counterNames[i], name) == 0) {
+            counterValues[i] = value;
+            return;
+        }
+    }
+    if (numCounters < kMaxBenchCounters) {
+        counterNames[numCounters] = name;
+        counterValues[numCounters] = value;
+        numCounters++;
+    }
+}
+
+// ---------- Runner ----------
+
+int main(int argc, char **argv)
+{
+    // Optional argument: only run benchmarks whose name contains this substring.
+    const char *filter = (argc > 1) ? argv[1] : nullptr;
+
+    // BENCH_SCALE multiplies every benchmark's iteration count (e.g. 0.1 for smoke runs).
+    double scale = 1.0;
+    if (const char *env = getenv("BENCH_SCALE")) {
+        double v = atof(env);
+        if (v > 0) scale = v;
+    }
+
+    printf("{\n  \"benchmarks\": [");
+    bool first = true;
+    for (int b = 0; b < sNumBenchmarks; b++) {
+        const BenchEntry &entry = sBenchmarks[b];
+        if (filter && !strstr(entry.name, filter)) continue;
+
+        uint64_t iterations = (uint64_t)(entry.iterations * scale);
+        if (iterations == 0) iterations = 1;
+        BenchState state(iterations);
+
+        uint64_t allocsBefore = BenchAllocationCount();
+        auto t0 = std::chrono::steady_clock::now();
+        entry.fn(state);
+        auto t1 = std::chrono::steady_clock::now();
+        uint64_t allocs = BenchAllocationCount() - allocsBefore;
+
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        uint64_t events = state.events ? state.events : iterations;
+        double nsPerEvent = ns / (double)events;
+        double eventsPerSec = ns > 0 ? (double)events * 1e9 / ns : 0.0;
+
+        printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"events\": %llu, "
+               "\"ns_per_event\": %.3f, \"events_per_sec\": %.0f, "
+               "\"allocations\": %llu, \"allocs_per_event\": %.4f",
+               first ? "" : ",", entry.name,
+               (unsigned long long)iterations, (unsigned long long)events,
+               nsPerEvent, eventsPerSec,
+               (unsigned long long)allocs, (double)allocs / (double)events);
+        if (state.numCounters > 0) {
+            printf(", \"counters\": {");
+            for (int c = 0; c < state.numCounters; c++)
+                printf("%s\"%s\": %.6g", c ? ", " : "",
+                       state.counterNames[c], state.counterValues[c]);
+            printf("}");
+        }
+        printf("}");
+        fflush(stdout);
+        first = false;
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "BenchHarness.h"
+#include "DeviceActivity.h"
+#include "IOScheduler.h"
+#include "MIDITransmitter.h"
+#include "SimulatedUSBDevice.h"
+#include <sys/resource.h>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+namespace {
+
+const int kDevices = 8;
+
+// The portable part of an opened device: its I/O thread and transmitter.
+// USB claim/configure time is not modelled; on a Mac it shows as LastOpenUs
+// in Roland-Activity and in the driver's "Started ... in N us" log line.
+struct OpenedDevice {
+    SimulatedUSBDevice usb;
+    ThreadIOScheduler  io;
+    MIDITransmitter    transmitter{&usb};
+
+    void Start()
+    {
+        io.Start("bench-io", IOThreadPolicy());
+        transmitter.Start();
+    }
+    void Stop()
+    {
+        transmitter.Stop();
+        io.Stop();
+    }
+};
+
+uint64_t ProcessCPUNanos()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ull
+         + ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ull;
+}
+
+// Threads the process has right now, so the count reflects what the devices
+// actually started rather than what they are expected to
+uint64_t ProcessThreadCount()
+{
+#if defined(__APPLE__)
+    thread_act_array_t threads = nullptr;
+    mach_msg_type_number_t count = 0;
+    if (task_threads(mach_task_self(), &threads, &count) != KERN_SUCCESS) return 0;
+    for (mach_msg_type_number_t i = 0; i < count; i++)
+        mach_port_deallocate(mach_task_self(), threads[i]);
+    vm_deallocate(mach_task_self(), (vm_address_t)threads, count * sizeof(thread_act_t));
+    return count;
+#else
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 8, "Threads:") == 0)
+            return std::stoull(line.substr(8));
+    return 0;
+#endif
+}
+
+enum class StartMode { Eager, Lazy, LazyThenSend };
+
+// Start kDevices the given way and measure the start. LazyThenSend then
+// sends one note to every device, which opens it the way a first DrvSend
+// does, and measures until the note has reached the device. Finally the
+// CPU the started devices use over an idle period.
+void StartAndIdle(BenchState &state, StartMode mode)
+{
+    HostClock &clock = DefaultHostClock();
+    double startUs = 0, firstSendUs = 0, firstDeliveryUs = 0, idleCPUUs = 0, threads = 0;
+    const uint64_t idleMs = 200;
+    const uint8_t note[] = { 0x90, 0x3C, 0x64 };
+
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        std::unique_ptr<OpenedDevice> opened[kDevices];
+        DeviceActivity activity[kDevices];
+        uint64_t threads0 = ProcessThreadCount();
+
+        uint64_t t0 = clock.NowNanos();
+        for (int d = 0; d < kDevices; d++) {
+            DeviceActivityConfig config;
+            config.lazy = mode != StartMode::Eager;
+            activity[d].SetConfig(config);
+            if (!config.lazy || activity[d].Wanted()) {
+                opened[d].reset(new OpenedDevice);
+                opened[d]->Start();
+                activity[d].OnOpened(clock.NowNanos(), 0);
+            }
+        }
+        startUs += (double)(clock.NowNanos() - t0) / 1000.0;
+
+        if (mode == StartMode::LazyThenSend) {
+            for (int d = 0; d < kDevices; d++) {
+                uint64_t s0 = clock.NowNanos();
+                activity[d].OnSend(s0);
+                if (activity[d].NeedsOpen()) {
+                    opened[d].reset(new OpenedDevice);
+                    opened[d]->Start();
+                    activity[d].OnOpened(clock.NowNanos(), clock.NowNanos() - s0);
+                }
+                opened[d]->transmitter.Enqueue(0, note, sizeof(note));
+                firstSendUs += (double)(clock.NowNanos() - s0) / 1000.0;
+                while (opened[d]->usb.TransferCount() == 0)
+                    std::this_thread::yield();
+                firstDeliveryUs += (double)(clock.NowNanos() - s0) / 1000.0;
+            }
+        }
+        threads += (double)(ProcessThreadCount() - threads0);
+
+        uint64_t cpu0 = ProcessCPUNanos();
+        std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+        idleCPUUs += (double)(ProcessCPUNanos() - cpu0) / 1000.0;
+
+        for (auto &dev : opened)
+            if (dev) dev->Stop();
+    }
+
+    double n = (double)state.iterations;
+    state.SetEvents(state.iterations * kDevices);
+    state.SetCounter("devices", kDevices);
+    state.SetCounter("startup_us", startUs / n);
+    if (mode == StartMode::LazyThenSend) {
+        state.SetCounter("first_send_us", firstSendUs / (n * kDevices));
+        state.SetCounter("first_delivery_us", firstDeliveryUs / (n * kDevices));
+    }
+    state.SetCounter("idle_cpu_us_per_s", idleCPUUs / n * 1000.0 / (double)idleMs);
+    state.SetCounter("threads", threads / n);
+}
+
+} // namespace
+
+// All devices opened at DrvStart, none in use afterwards
+BENCHMARK(DeviceStartupEager, 10)
+{
+    StartAndIdle(state, StartMode::Eager);
+}
+
+// LazyOpen: devices registered, nothing started until first use
+BENCHMARK(DeviceStartupLazy, 10)
+{
+    StartAndIdle(state, StartMode::Lazy);
+}
+
+// LazyOpen, then a first send to every device: what the deferred open costs
+// the first DrvSend
+BENCHMARK(DeviceFirstSendLazy, 10)
+{
+    StartAndIdle(state, StartMode::LazyThenSend);
+}
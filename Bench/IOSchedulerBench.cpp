@@ -0,0 +1,76 @@
+#include "BenchHarness.h"
+#include "IOScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void Percentiles(BenchState &state, std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : samples) sum += s;
+    state.SetCounter("mean_us", sum / (double)samples.size());
+    state.SetCounter("p50_us", samples[samples.size() / 2]);
+    state.SetCounter("p99_us", samples[samples.size() * 99 / 100]);
+    state.SetCounter("max_us", samples.back());
+}
+
+} // namespace
+
+// Wakeup latency of the I/O thread: from Post() on another thread to the
+// task starting, as a read completion handed to the I/O thread would see.
+BENCHMARK(SchedulerPostLatency, 5000)
+{
+    ThreadIOScheduler io;
+    IOThreadPolicy policy;
+    policy.periodNs = 1000000;
+    policy.computationNs = 500000;
+    policy.constraintNs = 1000000;
+    io.Start("bench-io", policy);
+
+    HostClock &clock = DefaultHostClock();
+    std::vector<double> latencies;
+    latencies.reserve(state.iterations);
+    std::atomic<uint64_t> ranAt{0};
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        ranAt = 0;
+        uint64_t t0 = clock.NowNanos();
+        io.Post([&] { ranAt = clock.NowNanos(); });
+        while (ranAt.load() == 0)
+            std::this_thread::yield();
+        latencies.push_back((double)(ranAt.load() - t0) / 1000.0);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    io.Stop();
+
+    state.SetEvents(state.iterations);
+    state.SetCounter("policy_applied", io.PolicyApplied() ? 1 : 0);
+    Percentiles(state, latencies);
+}
+
+// Lateness of 1 ms one-shot timers (pacing and retry deadlines)
+BENCHMARK(SchedulerTimerLateness, 500)
+{
+    ThreadIOScheduler io;
+    io.Start("bench-io", IOThreadPolicy());
+
+    HostClock &clock = DefaultHostClock();
+    std::vector<double> lateness;
+    lateness.reserve(state.iterations);
+    std::atomic<uint64_t> firedAt{0};
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        firedAt = 0;
+        uint64_t due = clock.NowNanos() + 1000000;
+        io.PostAfter(1000000, [&] { firedAt = clock.NowNanos(); });
+        while (firedAt.load() == 0)
+            std::this_thread::yield();
+        lateness.push_back((double)(firedAt.load() - due) / 1000.0);
+    }
+    io.Stop();
+
+    state.SetEvents(state.iterations);
+    Percentiles(state, lateness);
+}
@@ -0,0 +1,131 @@
+#include "BenchHarness.h"
+#include "EditorSession.h"
+#include "MIDIBroadcast.h"
+#include "SimulatedUSBDevice.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr size_t kRackUnits = 8;
+
+// A patch bank as a librarian sends it: 64 DT1 writes of 128 bytes in one
+// packet, after a GS reset in its own packet
+std::vector<uint8_t> MakeBank()
+{
+    std::vector<uint8_t> bank;
+    std::vector<uint8_t> data(128);
+    for (uint32_t i = 0; i < 64; i++) {
+        for (size_t k = 0; k < data.size(); k++) data[k] = (uint8_t)((i + k) & 0x7F);
+        std::vector<uint8_t> dt1 = MakeEditorDT1((0x19u << 21) + i * 256, data.data(), (uint32_t)data.size());
+        bank.insert(bank.end(), dt1.begin(), dt1.end());
+    }
+    return bank;
+}
+
+const uint8_t kGSReset[] = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7 };
+
+// Identical modules, each with its own pool and transmitter as in the driver.
+// Member i notes when its queue has the bank.
+struct Rack {
+    struct Unit : MIDIBatchTarget {
+        SimulatedUSBDevice device;
+        BufferPool         pool;
+        MIDITransmitter    tx{ &device };
+        uint64_t           queuedAt = 0;
+
+        Unit()
+        {
+            pool.Reserve(BufferPoolConfig());
+            tx.SetBufferPool(&pool);
+        }
+        bool EnqueueBatch(uint8_t cable, const MIDIMessageBatch &batch) override
+        {
+            bool ok = tx.EnqueueBatch(cable, batch);
+            queuedAt = DefaultHostClock().NowNanos();
+            return ok;
+        }
+    };
+
+    Rack()
+    {
+        for (size_t i = 0; i < kRackUnits; i++)
+            units.push_back(std::make_unique<Unit>());
+    }
+
+    std::vector<std::unique_ptr<Unit>> units;
+};
+
+struct SkewResult {
+    std::vector<uint64_t> skew;     // First to last member queued
+    std::vector<uint64_t> fanOut;   // Send called to last member queued
+};
+
+void Report(BenchState &state, SkewResult &r, uint32_t bankBytes)
+{
+    std::sort(r.skew.begin(), r.skew.end());
+    std::sort(r.fanOut.begin(), r.fanOut.end());
+    auto at = [](const std::vector<uint64_t> &v, double q) {
+        return v.empty() ? 0.0 : v[std::min(v.size() - 1, (size_t)(q * (double)v.size()))] / 1000.0;
+    };
+    state.SetEvents(state.iterations * kRackUnits);
+    state.SetCounter("units", (double)kRackUnits);
+    state.SetCounter("bank_bytes", bankBytes);
+    state.SetCounter("skew_p50_us", at(r.skew, 0.50));
+    state.SetCounter("skew_p99_us", at(r.skew, 0.99));
+    state.SetCounter("skew_max_us", r.skew.empty() ? 0.0 : r.skew.back() / 1000.0);
+    state.SetCounter("fan_out_p50_us", at(r.fanOut, 0.50));
+}
+
+} // namespace
+
+// The earlier fallback path: each device splits and copies the packet into
+// its own queue in turn. Skew is from the first module's queue holding the
+// bank to the last one's; each transmitter thread starts writing from there.
+BENCHMARK(BroadcastSkewPerDeviceCopy, 2000)
+{
+    Rack rack;
+    std::vector<uint8_t> bank = MakeBank();
+    SkewResult r;
+    r.skew.reserve(state.iterations);
+    r.fanOut.reserve(state.iterations);
+
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        for (auto &u : rack.units) u->tx.Enqueue(0, kGSReset, sizeof(kGSReset));
+        uint64_t start = DefaultHostClock().NowNanos();
+        for (auto &u : rack.units) {
+            u->tx.Enqueue(0, bank.data(), (uint32_t)bank.size());
+            u->queuedAt = DefaultHostClock().NowNanos();
+        }
+        r.skew.push_back(rack.units.back()->queuedAt - rack.units.front()->queuedAt);
+        r.fanOut.push_back(rack.units.back()->queuedAt - start);
+        for (auto &u : rack.units) u->tx.Discard();
+    }
+    Report(state, r, (uint32_t)bank.size());
+}
+
+// Broadcast destination: split once into the broadcaster's pool, every
+// queue shares the SysEx buffers.
+BENCHMARK(BroadcastSkewShared, 2000)
+{
+    MIDIBroadcast broadcast;   // Outlives the queues holding its buffers
+    Rack rack;
+    MIDIBroadcastGroup all;
+    for (auto &u : rack.units) all.members.push_back({ u.get(), 0 });
+    broadcast.SetGroups({ all });
+    std::vector<uint8_t> bank = MakeBank();
+    SkewResult r;
+    r.skew.reserve(state.iterations);
+    r.fanOut.reserve(state.iterations);
+
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        broadcast.Send(0, kGSReset, sizeof(kGSReset));
+        uint64_t start = DefaultHostClock().NowNanos();
+        broadcast.Send(0, bank.data(), (uint32_t)bank.size());
+        r.skew.push_back(rack.units.back()->queuedAt - rack.units.front()->queuedAt);
+        r.fanOut.push_back(rack.units.back()->queuedAt - start);
+        for (auto &u : rack.units) u->tx.Discard();
+    }
+    Report(state, r, (uint32_t)bank.size());
+}
@@ -0,0 +1,69 @@
+#include "BenchHarness.h"
+#include "MIDIClockGenerator.h"
+#include "SimulatedUSBDevice.h"
+#include <algorithm>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Generator and transmitter on their own threads with the real clock; the
+// simulated device records when each pulse was written to the pipe.
+void MeasureWireJitter(BenchState &state, uint64_t leadNs)
+{
+    const double bpm = 400;                          // 6.25 ms per pulse
+    const double periodNs = 60e9 / (bpm * 24);
+    IOThreadPolicy policy;
+    policy.periodNs = 1000000;
+    policy.computationNs = 500000;
+    policy.constraintNs = 1000000;
+
+    SimulatedUSBDevice dev;
+    MIDITransmitter out(&dev);
+    out.Start(policy);
+
+    MIDIClockGenerator gen;
+    MIDIClockGeneratorConfig config;
+    config.leadNs = leadNs;
+    gen.SetConfig(config);
+    gen.SetTargets({ { &out, 0 } });
+    gen.SetTempo(bpm);
+    gen.StartThread(policy);
+    gen.SetClockEnabled(true);
+    std::this_thread::sleep_for(std::chrono::nanoseconds((uint64_t)(periodNs * (double)state.iterations)));
+    gen.StopThread();
+    out.Stop();
+
+    std::vector<uint64_t> times;
+    for (const auto &e : dev.Events())
+        if (e.bytes[0] == 0xF8) times.push_back(e.hostTime);
+    std::vector<double> deviation;
+    for (size_t i = 1; i < times.size(); i++)
+        deviation.push_back(fabs((double)(times[i] - times[i - 1]) - periodNs) / 1000.0);
+    std::sort(deviation.begin(), deviation.end());
+
+    double sum = 0;
+    for (double d : deviation) sum += d * d;
+    MIDIClockGeneratorStats s = gen.GetStats();
+    state.SetEvents(times.size());
+    state.SetCounter("interval_jitter_rms_us", deviation.empty() ? 0 : sqrt(sum / (double)deviation.size()));
+    state.SetCounter("interval_jitter_p99_us", deviation.empty() ? 0 : deviation[deviation.size() * 99 / 100]);
+    state.SetCounter("interval_jitter_max_us", deviation.empty() ? 0 : deviation.back());
+    state.SetCounter("handoff_lateness_rms_us", (double)s.latenessRmsNs / 1000.0);
+    state.SetCounter("overruns", (double)s.overruns);
+}
+
+} // namespace
+
+// Timer wakeup only
+BENCHMARK(ClockGeneratorTimerOnly, 200)
+{
+    MeasureWireJitter(state, 0);
+}
+
+// Timer 200 us early, spin to the pulse time (the driver default)
+BENCHMARK(ClockGeneratorEarlyWake, 200)
+{
+    MeasureWireJitter(state, 200000);
+}
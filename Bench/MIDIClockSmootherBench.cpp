@@ -0,0 +1,75 @@
+#include "BenchHarness.h"
+#include "MIDIClockSmoother.h"
+#include "MIDIClockCapture.h"
+#include <math.h>
+
+namespace {
+
+// Replays a capture through the smoother; reports interval jitter of the raw
+// callback times and of the re-timestamped pulses against the sent times.
+void ReplayCapture(BenchState &state, const MIDIClockCaptureOptions &options)
+{
+    auto capture = MakeMIDIClockCapture(options);
+    std::vector<uint64_t> out(capture.size());
+
+    MIDIClockSmoother smoother;
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        smoother.Reset();
+        for (size_t i = 0; i < capture.size(); i++)
+            out[i] = smoother.OnPulse(capture[i].receivedNs);
+        BenchDoNotOptimize(out.back());
+    }
+
+    // Skip the first beats while the tracker acquires
+    double rawSum = 0, outSum = 0, rawMax = 0, outMax = 0;
+    size_t n = 0;
+    for (size_t i = 4 * kMIDIClockPPQN; i < capture.size(); i++) {
+        double sent = (double)(capture[i].sentNs - capture[i - 1].sentNs);
+        double r = (double)(capture[i].receivedNs - capture[i - 1].receivedNs) - sent;
+        double o = (double)(out[i] - out[i - 1]) - sent;
+        rawSum += r * r;
+        outSum += o * o;
+        rawMax = fmax(rawMax, fabs(r));
+        outMax = fmax(outMax, fabs(o));
+        n++;
+    }
+
+    state.SetEvents(state.iterations * capture.size());
+    state.SetCounter("raw_jitter_us", sqrt(rawSum / (double)n) / 1000);
+    state.SetCounter("smoothed_jitter_us", sqrt(outSum / (double)n) / 1000);
+    state.SetCounter("raw_max_us", rawMax / 1000);
+    state.SetCounter("smoothed_max_us", outMax / 1000);
+    state.SetCounter("bpm", smoother.GetStats().bpm);
+}
+
+} // namespace
+
+// Steady 120 BPM master behind 1 ms USB frames and callback jitter
+BENCHMARK(ClockSmootherSteady, 20)
+{
+    MIDIClockCaptureOptions options;
+    options.pulses = 24 * 512;
+    ReplayCapture(state, options);
+}
+
+// Same, with a loaded host: 400 us mean callback delay, 1% of pulses 4 ms late
+BENCHMARK(ClockSmootherLoadedHost, 20)
+{
+    MIDIClockCaptureOptions options;
+    options.pulses = 24 * 512;
+    options.callbackDelayNs = 400000;
+    options.lateProbability = 0.01;
+    options.seed = 7;
+    ReplayCapture(state, options);
+}
+
+// Tempo ramp 90 -> 150 BPM over the capture
+BENCHMARK(ClockSmootherTempoRamp, 20)
+{
+    MIDIClockCaptureOptions options;
+    options.pulses = 24 * 512;
+    options.startBPM = 90;
+    options.endBPM = 150;
+    options.seed = 3;
+    ReplayCapture(state, options);
+}
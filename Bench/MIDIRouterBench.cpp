@@ -0,0 +1,108 @@
+#include "BenchHarness.h"
+#include "FakeHostClock.h"
+#include "MIDIRouter.h"
+#include "SimulatedUSBDevice.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct RouteContext {
+    MIDIRouter *router;
+    uint32_t    source;
+};
+
+void RouteEvent(uint8_t cable, const uint8_t *midiBytes, uint8_t byteCount, void *context)
+{
+    auto *ctx = static_cast<RouteContext *>(context);
+    ctx->router->Route(ctx->source, cable, midiBytes, byteCount);
+}
+
+} // namespace
+
+// Cost on the read path: parse a bulk IN transfer and hand each event to the
+// matrix (16-route table, two of which match), including the enqueue.
+BENCHMARK(RouterParseAndForward, 200000)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice module(&clock);
+    MIDITransmitter out(&module, &clock);
+
+    std::vector<MIDIRoute> routes;
+    for (uint32_t dev = 0; dev < 8; dev++) {
+        MIDIRoute r;
+        r.source = dev;
+        r.target = &out;
+        r.targetCable = (uint8_t)dev;
+        routes.push_back(r);
+        r.sourceCable = 1;
+        routes.push_back(r);
+    }
+    MIDIRouter router;
+    router.SetRoutes(routes);
+
+    // 16 packets: notes and CCs on cables 0/1, plus clock that the filter rejects
+    std::vector<uint8_t> transfer;
+    for (uint8_t i = 0; i < 16; i++) {
+        uint8_t cable = i & 1;
+        if (i % 4 == 3)
+            transfer.insert(transfer.end(), { (uint8_t)(cable << 4 | kCIN_SingleByte), 0xF8, 0, 0 });
+        else
+            transfer.insert(transfer.end(), { (uint8_t)(cable << 4 | kCIN_NoteOn), 0x90, (uint8_t)(0x30 + i), 0x40 });
+    }
+
+    RouteContext ctx = { &router, 3 };
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        USBMIDIParseBulkIn(transfer.data(), (uint32_t)transfer.size(), RouteEvent, &ctx);
+        if ((it & 31) == 31) {
+            out.Pump();
+            module.Clear();
+        }
+    }
+    state.SetEvents(state.iterations * 16);
+    state.SetCounter("forwarded", (double)router.GetStats().forwarded);
+    state.SetCounter("filtered", (double)router.GetStats().filtered);
+}
+
+// End-to-end thru latency with real threads: an inbound transfer is parsed
+// and routed, the target's transmitter thread wakes and writes the bulk OUT
+// transfer. Measured from parse start to the write reaching the device.
+BENCHMARK(RouterThruLatency, 2000)
+{
+    SimulatedUSBDevice module;
+    MIDITransmitter out(&module);
+    out.Start();
+
+    MIDIRoute r;
+    r.source = 1;
+    r.target = &out;
+    MIDIRouter router;
+    router.SetRoutes({ r });
+    RouteContext ctx = { &router, 1 };
+
+    std::vector<double> latencies;
+    latencies.reserve(state.iterations);
+    HostClock &clock = DefaultHostClock();
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        uint8_t note = (uint8_t)(it & 0x7F);
+        const uint8_t packet[] = { kCIN_NoteOn, 0x90, note, 0x40 };
+        uint64_t before = module.TransferCount();
+        uint64_t t0 = clock.NowNanos();
+        USBMIDIParseBulkIn(packet, sizeof(packet), RouteEvent, &ctx);
+        while (module.TransferCount() == before)
+            std::this_thread::yield();
+        latencies.push_back((double)(module.LastTransferTime() - t0) / 1000.0);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    out.Stop();
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double l : latencies) sum += l;
+    state.SetEvents(state.iterations);
+    state.SetCounter("mean_us", sum / (double)latencies.size());
+    state.SetCounter("p50_us", latencies[latencies.size() / 2]);
+    state.SetCounter("p99_us", latencies[latencies.size() * 99 / 100]);
+    state.SetCounter("max_us", latencies.back());
+}
@@ -0,0 +1,224 @@
+#include "BenchHarness.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "RolandDeviceTable.h"
+#include "SimulatedUSBDevice.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Automation lanes on a DIN-backed port: every simulated millisecond a
+// pitch bend plus three CCs (12 bytes) against a 3125 B/s link, about four
+// times what the wire can carry. The pitch bend value tags the millisecond
+// it was produced in, so the receiving end can tell how stale it is.
+void RunSaturatedAutomation(BenchState &state, bool coalesce)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    MIDITransmitterConfig config;
+    config.cableBytesPerSecond[0] = kDINBytesPerSecond;
+    if (coalesce) config.coalesceCables = 1;
+    tx.SetConfig(config);
+
+    const uint64_t kStepNs = 1000000;
+    uint64_t steps = state.iterations;
+    std::vector<uint64_t> producedAt(steps);
+    uint64_t start = clock.NowNanos();
+
+    for (uint64_t ms = 0; ms < steps; ms++) {
+        uint16_t tag = (uint16_t)(ms & 0x3FFF);
+        uint8_t v = (uint8_t)(ms & 0x7F);
+        const uint8_t lanes[] = {
+            0xE0, (uint8_t)(tag & 0x7F), (uint8_t)(tag >> 7),
+            0xB0, 0x01, v, 0xB0, 0x07, v, 0xB0, 0x0B, v,
+        };
+        producedAt[ms] = clock.NowNanos();
+        tx.Enqueue(0, lanes, sizeof(lanes));
+        tx.Pump();
+        clock.Advance(kStepNs);
+    }
+    uint64_t lastProduced = producedAt[steps - 1];
+    for (;;) {
+        uint64_t due = tx.Pump();
+        if (due == 0) break;
+        if (due > clock.NowNanos()) clock.Set(due);
+    }
+
+    // Staleness of every pitch bend value the device actually received
+    double staleSum = 0, staleMax = 0;
+    uint64_t received = 0, lastArrival = 0;
+    for (auto &e : device.Events()) {
+        if (e.cable != 0 || e.bytes[0] != 0xE0) continue;
+        uint64_t tag = (uint64_t)e.bytes[1] | (uint64_t)e.bytes[2] << 7;
+        uint64_t ms = (steps - 1) - (((steps - 1) - tag) & 0x3FFF);   // undo the 14-bit wrap
+        double stale = (double)(e.hostTime - producedAt[ms]) / 1e6;
+        staleSum += stale;
+        if (stale > staleMax) staleMax = stale;
+        received++;
+        if (ms == steps - 1) lastArrival = e.hostTime;
+    }
+
+    MIDICableStats cable = tx.GetCableStats(0);
+    MIDITransmitterStats stats = tx.GetStats();
+    state.SetEvents(steps * 4);
+    state.SetCounter("simulated_ms", (double)(clock.NowNanos() - start) / 1e6);
+    state.SetCounter("peak_queue_bytes", cable.peakPendingBytes);
+    state.SetCounter("mean_staleness_ms", received ? staleSum / (double)received : 0);
+    state.SetCounter("max_staleness_ms", staleMax);
+    state.SetCounter("final_value_lag_ms", (double)(lastArrival - lastProduced) / 1e6);
+    state.SetCounter("coalesced", (double)stats.messagesCoalesced);
+    state.SetCounter("bytes_sent", (double)stats.midiBytesSent);
+}
+
+} // namespace
+
+BENCHMARK(SaturatedAutomationNoCoalescing, 2000)
+{
+    RunSaturatedAutomation(state, false);
+}
+
+BENCHMARK(SaturatedAutomationCoalescing, 2000)
+{
+    RunSaturatedAutomation(state, true);
+}
+
+// Flush-to-silence on the real transmitter thread: a device with a 1 ms
+// synchronous write, a 64 KB bulk dump being paced out and notes hanging on
+// another cable. Measures how long after Flush() the last transfer lands,
+// which should stay around one in-flight transfer, far below one SysEx gap.
+BENCHMARK(FlushToSilence, 20)
+{
+    std::vector<uint8_t> sysex(65536, 0x11);
+    sysex.front() = 0xF0;
+    sysex.back() = 0xF7;
+    const uint8_t chord[] = { 0x90, 0x3C, 0x64, 0x90, 0x40, 0x64, 0x90, 0x43, 0x64 };
+
+    double silenceSum = 0, silenceMax = 0, returnSum = 0;
+    uint64_t events = 0;
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        SimulatedUSBDevice device;
+        device.SetWriteLatencyNanos(1000000);
+        MIDITransmitter tx(&device);
+        tx.Start();
+
+        tx.Enqueue(1, chord, sizeof(chord));
+        tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size());
+        for (int i = 0; i < 200; i++) {
+            const uint8_t cc[] = { 0xB1, 0x07, (uint8_t)(i & 0x7F) };
+            tx.Enqueue(1, cc, sizeof(cc));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+        uint64_t flushStart = DefaultHostClock().NowNanos();
+        tx.Flush(-1);
+        uint64_t flushDone = DefaultHostClock().NowNanos();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        tx.Stop();
+
+        double silence = (double)(device.LastTransferTime() - flushStart) / 1e6;
+        silenceSum += silence;
+        if (silence > silenceMax) silenceMax = silence;
+        returnSum += (double)(flushDone - flushStart) / 1e6;
+        events += device.Events().size();
+    }
+
+    state.SetEvents(events);
+    state.SetCounter("mean_flush_to_silence_ms", silenceSum / (double)state.iterations);
+    state.SetCounter("max_flush_to_silence_ms", silenceMax);
+    state.SetCounter("mean_flush_return_ms", returnSum / (double)state.iterations);
+}
+
+namespace {
+
+struct PipelineRun {
+    double   seconds;
+    uint64_t window;
+    uint64_t peakInFlight;
+    uint64_t latencyNs;
+};
+
+// Note traffic on four cables through the asynchronous bulk OUT model of a
+// high-speed device (1024-byte transfers, 40 MB/s bus), optionally behind a
+// receive buffer that drains slowly
+PipelineRun RunPipelined(uint64_t notesPerCable, uint64_t completionNs, uint32_t writesInFlight,
+                         uint32_t drainBytesPerSecond)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+    device.SetAsyncWrites(&tx, completionNs, 40000000);
+    if (drainBytesPerSecond) device.SetReceiveBuffer(4096, drainBytesPerSecond);
+
+    MIDITransmitterConfig config;
+    config.maxTransferSize = 1024;
+    config.maxWritesInFlight = writesInFlight;
+    config.maxQueuedBytes = 64 << 20;
+    tx.SetConfig(config);
+
+    for (uint8_t c = 0; c < 4; c++) {
+        for (uint64_t n = 0; n < notesPerCable; n++) {
+            const uint8_t on[] = { (uint8_t)(0x90 | c), (uint8_t)(n & 0x7F), 0x40 };
+            tx.Enqueue(c, on, sizeof(on));
+        }
+    }
+    uint64_t start = clock.NowNanos();
+    PumpUntilIdle(tx, device, clock);
+
+    MIDITransmitterStats stats = tx.GetStats();
+    PipelineRun run;
+    run.seconds = (double)(device.LastTransferTime() - start) / 1e9;
+    run.window = stats.writeWindow;
+    run.peakInFlight = stats.peakWritesInFlight;
+    run.latencyNs = stats.writeLatencyNs;
+    return run;
+}
+
+void RunPipelinedThroughput(BenchState &state, uint64_t completionNs, uint32_t drainBytesPerSecond = 0)
+{
+    uint64_t notes = state.iterations;
+    PipelineRun one = RunPipelined(notes, completionNs, 1, drainBytesPerSecond);
+    PipelineRun many = RunPipelined(notes, completionNs, kMaxWritesInFlight, drainBytesPerSecond);
+
+    double bytes = (double)notes * 4 * 3;
+    state.SetEvents(notes * 4 * 2);
+    state.SetCounter("completion_us", (double)completionNs / 1e3);
+    state.SetCounter("kb_per_s_one_in_flight", bytes / one.seconds / 1024);
+    state.SetCounter("kb_per_s_windowed", bytes / many.seconds / 1024);
+    state.SetCounter("speedup", one.seconds / many.seconds);
+    state.SetCounter("final_window", (double)many.window);
+    state.SetCounter("peak_in_flight", (double)many.peakInFlight);
+    state.SetCounter("write_latency_us", (double)many.latencyNs / 1e3);
+}
+
+} // namespace
+
+BENCHMARK(PipelinedWritesCompletion125us, 20000)
+{
+    RunPipelinedThroughput(state, 125000);
+}
+
+BENCHMARK(PipelinedWritesCompletion500us, 20000)
+{
+    RunPipelinedThroughput(state, 500000);
+}
+
+BENCHMARK(PipelinedWritesCompletion1ms, 20000)
+{
+    RunPipelinedThroughput(state, 1000000);
+}
+
+BENCHMARK(PipelinedWritesCompletion2ms, 20000)
+{
+    RunPipelinedThroughput(state, 2000000);
+}
+
+// A device that takes 100 KB/s: the bus is not the limit, and more writes
+// in flight would only queue behind NAKs
+BENCHMARK(PipelinedWritesSlowDevice, 20000)
+{
+    RunPipelinedThroughput(state, 1000000, 100000);
+}
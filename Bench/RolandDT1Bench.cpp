@@ -0,0 +1,70 @@
+#include "BenchHarness.h"
+#include "EditorSession.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "SimulatedUSBDevice.h"
+
+namespace {
+
+// Replays an editor session through the transmitter with DT1 merging off
+// (window 0) or on; reports what reached the wire and the bytes and bulk
+// OUT transfers saved against sending every write as queued.
+void ReplaySession(BenchState &state, const EditorSessionOptions &options, uint64_t windowNs)
+{
+    auto session = MakeEditorSession(options);
+    uint64_t sessionBytes = 0, sessionWrites = 0;
+    for (const auto &e : session) {
+        sessionBytes += e.bytes.size();
+        sessionWrites += e.bytes[0] == 0xF0;
+    }
+
+    uint64_t bytes = 0, transfers = 0, merged = 0;
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        FakeHostClock clock;
+        SimulatedUSBDevice device(&clock);
+        MIDITransmitter tx(&device, &clock);
+        MIDITransmitterConfig config;
+        config.mergeDT1Cables = windowNs ? 1u : 0u;
+        config.dt1MergeWindowNs = windowNs;
+        tx.SetConfig(config);
+        ReplayEditorSession(session, 0, tx, clock);
+
+        MIDITransmitterStats stats = tx.GetStats();
+        bytes = stats.midiBytesSent;
+        transfers = device.TransferCount();
+        merged = stats.dt1Merged;
+    }
+
+    state.SetEvents(state.iterations * session.size());
+    state.SetCounter("dt1_writes", (double)sessionWrites);
+    state.SetCounter("dt1_merged", (double)merged);
+    state.SetCounter("midi_bytes", (double)bytes);
+    state.SetCounter("transfers", (double)transfers);
+    state.SetCounter("bytes_saved_pct", 100.0 * (double)(sessionBytes - bytes) / (double)sessionBytes);
+    state.SetCounter("transfers_saved_pct", 100.0 * (double)(session.size() - transfers) / (double)session.size());
+    state.SetCounter("window_ms", (double)windowNs / 1e6);
+}
+
+} // namespace
+
+// Knob drags, renames and librarian tone restores, every write as sent
+BENCHMARK(EditorSessionUnmerged, 5)
+{
+    ReplaySession(state, EditorSessionOptions(), 0);
+}
+
+// Same session with contiguous DT1 writes merged in the default window
+BENCHMARK(EditorSessionMergeDT1, 5)
+{
+    ReplaySession(state, EditorSessionOptions(), kDefaultDT1MergeWindowNs);
+}
+
+// Slow editor: knob events every 10 ms on average, bursts spaced 200 us
+BENCHMARK(EditorSessionMergeDT1SlowEditor, 5)
+{
+    EditorSessionOptions options;
+    options.dragStepNs = 10000000;
+    options.burstGapNs = 200000;
+    options.seed = 5;
+    ReplaySession(state, options, kDefaultDT1MergeWindowNs);
+}
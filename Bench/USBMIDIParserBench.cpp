@@ -0,0 +1,169 @@
+#include "BenchHarness.h"
+#include "USBMIDIParser.h"
+#include <vector>
+
+namespace {
+
+struct ParseSink {
+    uint64_t events = 0;
+    uint32_t checksum = 0;
+};
+
+void CountEvent(uint8_t cable, const uint8_t *midiBytes, uint8_t byteCount, void *context)
+{
+    auto *sink = static_cast<ParseSink *>(context);
+    sink->events++;
+    sink->checksum += cable + midiBytes[0] + byteCount;
+}
+
+// One full-speed bulk IN transfer: 16 USB-MIDI packets of mixed traffic.
+std::vector<uint8_t> MakeBulkInTransfer()
+{
+    std::vector<uint8_t> data;
+    for (uint8_t i = 0; i < 16; i++) {
+        uint8_t cable = i % 6;
+        switch (i % 4) {
+            case 0: data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_NoteOn), 0x90, (uint8_t)(0x30 + i), 0x64 }); break;
+            case 1: data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_ControlChange), 0xB0, 0x07, i }); break;
+            case 2: data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_SingleByte), 0xF8, 0x00, 0x00 }); break;
+            case 3: data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_SysExStart), 0xF0, 0x41, 0x10 }); break;
+        }
+    }
+    return data;
+}
+
+} // namespace
+
+BENCHMARK(ParseBulkIn, 2000000)
+{
+    std::vector<uint8_t> transfer = MakeBulkInTransfer();
+    ParseSink sink;
+    for (uint64_t it = 0; it < state.iterations; it++)
+        USBMIDIParseBulkIn(transfer.data(), (uint32_t)transfer.size(), CountEvent, &sink);
+    BenchDoNotOptimize(sink.checksum);
+    state.SetEvents(sink.events);
+}
+
+BENCHMARK(EncodeBulkOutChannel, 2000000)
+{
+    // Typical DrvSend packet: note on, CC, pitch bend, note off.
+    const uint8_t midi[] = {
+        0x90, 0x3C, 0x64, 0xB0, 0x07, 0x50, 0xE0, 0x00, 0x40, 0x80, 0x3C, 0x00,
+    };
+    uint8_t usbBuf[512];
+    uint32_t total = 0;
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        total += USBMIDIBuildBulkOut(midi, sizeof(midi), (uint8_t)(it & 0x0F),
+                                     usbBuf, sizeof(usbBuf));
+        BenchDoNotOptimize(usbBuf[0]);
+    }
+    BenchDoNotOptimize(total);
+    state.SetEvents(state.iterations * 4);
+}
+
+BENCHMARK(EncodeBulkOutShortSysEx, 2000000)
+{
+    // Roland DT1 as sent by patch editors: F0 41 10 00 00 64 12 aa aa aa aa dd sum F7
+    const uint8_t midi[] = {
+        0xF0, 0x41, 0x10, 0x00, 0x00, 0x64, 0x12,
+        0x19, 0x00, 0x00, 0x10, 0x40, 0x17, 0xF7,
+    };
+    uint8_t usbBuf[512];
+    uint32_t total = 0;
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        total += USBMIDIBuildBulkOut(midi, sizeof(midi), 0, usbBuf, sizeof(usbBuf));
+        BenchDoNotOptimize(usbBuf[0]);
+    }
+    BenchDoNotOptimize(total);
+    state.SetEvents(state.iterations);
+}
+
+BENCHMARK(SysExChunking4K, 20000)
+{
+    // A 4 KB bulk dump split into 256-byte paced chunks (one event = one chunk).
+    std::vector<uint8_t> sysex(4096, 0x22);
+    sysex.front() = 0xF0;
+    sysex.back() = 0xF7;
+    uint8_t usbBuf[512];
+    uint64_t chunks = 0;
+    for (uint64_t it = 0; it < state.iterations; it++) {
+        uint32_t offset = 0;
+        bool end = false;
+        while (offset < sysex.size()) {
+            uint32_t n = USBMIDIBuildSysExChunk(sysex.data(), (uint32_t)sysex.size(),
+                                                &offset, 0, 256,
+                                                usbBuf, sizeof(usbBuf), &end);
+            if (n == 0) break;
+            BenchDoNotOptimize(usbBuf[0]);
+            chunks++;
+        }
+    }
+    state.SetEvents(chunks);
+}
+
+namespace {
+
+// Clock-master traffic: mostly clock and active sensing with occasional notes.
+std::vector<uint8_t> MakeClockMasterTransfer()
+{
+    std::vector<uint8_t> data;
+    for (uint8_t i = 0; i < 16; i++) {
+        uint8_t cable = i % 6;
+        if (i % 8 == 0)
+            data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_NoteOn), 0x90, 0x3C, 0x64 });
+        else if (i % 8 == 7)
+            data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_SingleByte), 0xFE, 0x00, 0x00 });
+        else
+            data.insert(data.end(), { (uint8_t)(cable << 4 | kCIN_SingleByte), 0xF8, 0x00, 0x00 });
+    }
+    return data;
+}
+
+} // namespace
+
+BENCHMARK(ParseBulkInFilterPassAll, 2000000)
+{
+    std::vector<uint8_t> transfer = MakeClockMasterTransfer();
+    USBMIDIInputFilter filters[kUSBMIDINumCables];
+    ParseSink sink;
+    for (uint64_t it = 0; it < state.iterations; it++)
+        USBMIDIParseBulkInFiltered(transfer.data(), (uint32_t)transfer.size(),
+                                   filters, CountEvent, &sink);
+    BenchDoNotOptimize(sink.checksum);
+    state.SetEvents(state.iterations * 16);
+    state.SetCounter("delivered", (double)sink.events);
+}
+
+BENCHMARK(ParseBulkInFilterDropRealTime, 2000000)
+{
+    std::vector<uint8_t> transfer = MakeClockMasterTransfer();
+    USBMIDIInputFilter filters[kUSBMIDINumCables];
+    for (auto &f : filters) f.dropMask = kMIDIClass_ActiveSensing | kMIDIClass_Clock;
+    ParseSink sink;
+    for (uint64_t it = 0; it < state.iterations; it++)
+        USBMIDIParseBulkInFiltered(transfer.data(), (uint32_t)transfer.size(),
+                                   filters, CountEvent, &sink);
+    BenchDoNotOptimize(sink.checksum);
+    uint64_t filtered = 0;
+    for (auto &f : filters) filtered += f.filteredEvents;
+    state.SetEvents(state.iterations * 16);
+    state.SetCounter("delivered", (double)sink.events);
+    state.SetCounter("filtered", (double)filtered);
+}
+
+BENCHMARK(ParseBulkInFilterThinClock, 2000000)
+{
+    std::vector<uint8_t> transfer = MakeClockMasterTransfer();
+    USBMIDIInputFilter filters[kUSBMIDINumCables];
+    for (auto &f : filters) {
+        f.dropMask = kMIDIClass_ActiveSensing;
+        f.clockDivisor = 6;
+    }
+    ParseSink sink;
+    for (uint64_t it = 0; it < state.iterations; it++)
+        USBMIDIParseBulkInFiltered(transfer.data(), (uint32_t)transfer.size(),
+                                   filters, CountEvent, &sink);
+    BenchDoNotOptimize(sink.checksum);
+    state.SetEvents(state.iterations * 16);
+    state.SetCounter("delivered", (double)sink.events);
+}
@@ -0,0 +1,148 @@
+#ifndef EditorSession_h
+#define EditorSession_h
+
+#include <stdint.h>
+#include <map>
+#include <random>
+#include <vector>
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "RolandDT1.h"
+
+/// Shape of a synthetic editor/librarian session against an INTEGRA-7 style
+/// address map, modelled on captures of the vendor editors: every parameter
+/// is its own single-byte DT1, knob drags send one write per mouse event,
+/// a renamed patch rewrites every name character, and a librarian restore
+/// sends whole tones parameter by parameter. Auditioned notes interleave.
+struct EditorSessionOptions {
+    uint32_t knobDrags       = 40;
+    uint32_t dragSteps       = 30;
+    double   dragStepNs      = 4000000;   // Mean gap between mouse events
+    uint32_t renames         = 6;
+    uint32_t toneRestores    = 8;
+    uint32_t toneParameters  = 320;       // Parameters per restored tone
+    double   burstGapNs      = 40000;     // Between writes of one burst
+    double   auditionChance  = 0.05;      // Note pair after an edit
+    uint32_t seed            = 1;
+};
+
+struct EditorSessionEvent {
+    uint64_t timeNs;
+    std::vector<uint8_t> bytes;   // One MIDI message (DT1 or short)
+};
+
+static const uint8_t kEditorSessionModel[] = { 0x00, 0x00, 0x64 };   // INTEGRA-7
+static constexpr uint8_t kEditorSessionDeviceID = 0x10;
+
+inline std::vector<uint8_t> MakeEditorDT1(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    const uint8_t probe[] = { 0xF0, kRolandManufacturerID, kEditorSessionDeviceID,
+                              kEditorSessionModel[0], kEditorSessionModel[1], kEditorSessionModel[2] };
+    RolandDT1 header;
+    header.format = FindRolandSysExFormat(probe, sizeof(probe));
+    header.deviceID = kEditorSessionDeviceID;
+    std::vector<uint8_t> out;
+    BuildRolandDT1(header, address, data, length, out);
+    return out;
+}
+
+inline std::vector<EditorSessionEvent> MakeEditorSession(const EditorSessionOptions &o)
+{
+    std::mt19937 rng(o.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::exponential_distribution<double> stepGap(1.0 / o.dragStepNs);
+    std::uniform_int_distribution<uint32_t> value(0, 127);
+
+    std::vector<EditorSessionEvent> session;
+    double t = 1e9;
+    auto write = [&](uint32_t address, uint8_t v) {
+        session.push_back({ (uint64_t)t, MakeEditorDT1(address, &v, 1) });
+    };
+    auto audition = [&]() {
+        if (uniform(rng) >= o.auditionChance) return;
+        uint8_t key = (uint8_t)(48 + value(rng) % 24);
+        session.push_back({ (uint64_t)t, { 0x90, key, 0x64 } });
+        t += 300e6;
+        session.push_back({ (uint64_t)t, { 0x80, key, 0x40 } });
+    };
+    // Part n tone block: 19 2n 00 00 (7 bits per byte)
+    auto toneBase = [](uint32_t part) { return (0x19u << 21) | ((0x20u + part) << 14); };
+
+    uint32_t drags = o.knobDrags, renames = o.renames, restores = o.toneRestores;
+    while (drags + renames + restores) {
+        uint32_t pick = (uint32_t)(uniform(rng) * (drags + renames + restores));
+        uint32_t part = value(rng) % 16;
+        if (pick < drags) {
+            drags--;
+            uint32_t address = toneBase(part) + (0x10 + value(rng) % 0x30);
+            uint8_t v = (uint8_t)value(rng);
+            for (uint32_t s = 0; s < o.dragSteps; s++) {
+                v = (uint8_t)((v + 1) & 0x7F);
+                write(address, v);
+                t += stepGap(rng);
+            }
+        } else if (pick < drags + renames) {
+            renames--;
+            for (uint32_t c = 0; c < 12; c++) {
+                write(toneBase(part) + c, (uint8_t)(0x41 + value(rng) % 26));
+                t += o.burstGapNs * uniform(rng);
+            }
+        } else {
+            restores--;
+            // Parameter blocks of up to 0x60 bytes at successive 128-byte pages
+            for (uint32_t i = 0; i < o.toneParameters; i++) {
+                uint32_t address = toneBase(part) + (i / 0x60) * 0x80 + i % 0x60;
+                write(address, (uint8_t)value(rng));
+                t += o.burstGapNs * uniform(rng);
+            }
+        }
+        audition();
+        t += 250e6 + uniform(rng) * 750e6;
+    }
+    return session;
+}
+
+/// Feed a session to a transmitter in real (fake) time, pumping whenever
+/// output becomes due, until everything has been written.
+inline void ReplayEditorSession(const std::vector<EditorSessionEvent> &session, uint8_t cable,
+                                MIDITransmitter &tx, FakeHostClock &clock)
+{
+    uint64_t due = 0;
+    for (const auto &e : session) {
+        while (due && due <= e.timeNs) {
+            clock.Set(due);
+            due = tx.Pump();
+        }
+        if (e.timeNs > clock.NowNanos()) clock.Set(e.timeNs);
+        tx.Enqueue(cable, e.bytes.data(), (uint32_t)e.bytes.size());
+        due = tx.Pump();
+    }
+    while (due) {
+        if (due > clock.NowNanos()) clock.Set(due);
+        due = tx.Pump();
+    }
+}
+
+/// Final state of the address map after applying every DT1 in a byte stream.
+inline std::map<uint32_t, uint8_t> ApplyEditorDT1s(const std::vector<uint8_t> &stream, uint32_t *messages = nullptr)
+{
+    std::map<uint32_t, uint8_t> memory;
+    uint32_t count = 0;
+    for (size_t i = 0; i < stream.size(); i++) {
+        if (stream[i] != 0xF0) continue;
+        size_t end = i;
+        while (end < stream.size() && stream[end] != 0xF7) end++;
+        if (end == stream.size()) break;
+        RolandDT1 dt1;
+        if (ParseRolandDT1(&stream[i], (uint32_t)(end - i + 1), dt1)) {
+            for (uint32_t k = 0; k < dt1.dataLength; k++)
+                memory[dt1.address + k] = dt1.data[k];
+            count++;
+        }
+        i = end;
+    }
+    if (messages) *messages = count;
+    return memory;
+}
+
+#endif /* EditorSession_h */
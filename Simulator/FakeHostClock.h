@@ -0,0 +1,21 @@
+#ifndef FakeHostClock_h
+#define FakeHostClock_h
+
+#include <atomic>
+#include "HostClock.h"
+
+/// Manually advanced clock for deterministic tests and simulations.
+class FakeHostClock : public HostClock {
+public:
+    explicit FakeHostClock(uint64_t startNanos = 1000000000ull) : now(startNanos) {}
+
+    uint64_t NowNanos() const override { return now.load(std::memory_order_relaxed); }
+
+    void Set(uint64_t nanos)     { now.store(nanos, std::memory_order_relaxed); }
+    void Advance(uint64_t nanos) { now.fetch_add(nanos, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> now;
+};
+
+#endif /* FakeHostClock_h */
@@ -0,0 +1,50 @@
+#ifndef FakeMIDISetup_h
+#define FakeMIDISetup_h
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "PersistentDeviceIndex.h"
+
+/// In-memory MIDI setup database for reconciliation tests. Counts property
+/// reads and writes, which are IPC round trips into MIDIServer on the Mac.
+class FakeMIDISetup : public PersistentDeviceStore {
+public:
+    /// Add a persistent device; missing properties are passed as -1.
+    uint32_t AddDevice(int64_t location, int64_t vendorProduct)
+    {
+        uint32_t ref = nextRef++;
+        refs.push_back(ref);
+        if (location >= 0)      properties[{ ref, PersistentDeviceKey::Location }] = (int32_t)location;
+        if (vendorProduct >= 0) properties[{ ref, PersistentDeviceKey::VendorProduct }] = (int32_t)vendorProduct;
+        return ref;
+    }
+
+    size_t   Count() override { return refs.size(); }
+    uint32_t DeviceAt(size_t index) override { return refs[index]; }
+
+    bool GetInteger(uint32_t ref, PersistentDeviceKey key, int32_t &value) override
+    {
+        reads++;
+        auto it = properties.find({ ref, key });
+        if (it == properties.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    void SetInteger(uint32_t ref, PersistentDeviceKey key, int32_t value) override
+    {
+        writes++;
+        properties[{ ref, key }] = value;
+    }
+
+    uint64_t reads  = 0;
+    uint64_t writes = 0;
+
+private:
+    uint32_t nextRef = 0x1000;
+    std::vector<uint32_t> refs;
+    std::map<std::pair<uint32_t, PersistentDeviceKey>, int32_t> properties;
+};
+
+#endif /* FakeMIDISetup_h */
@@ -0,0 +1,62 @@
+#ifndef MIDIClockCapture_h
+#define MIDIClockCapture_h
+
+#include <math.h>
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+/// Shape of a synthetic inbound clock capture, modelled on traces of a
+/// hardware sequencer as clock master: pulses leave the device on its own
+/// crystal, wait for the next USB frame and reach the read callback after
+/// a scheduling delay, occasionally a long one.
+struct MIDIClockCaptureOptions {
+    double   startBPM         = 120;
+    double   endBPM           = 0;          // 0 = constant tempo, else a linear ramp
+    uint32_t pulses           = 24 * 64;
+    double   framePeriodNs    = 1000000;    // 0 = no frame quantization
+    double   callbackDelayNs  = 150000;     // Mean of an exponential delay
+    double   lateProbability  = 0.002;
+    double   lateDelayNs      = 4000000;
+    uint32_t seed             = 1;
+};
+
+struct MIDIClockCapturePulse {
+    uint64_t sentNs;       // When the master sent the pulse
+    uint64_t receivedNs;   // When the read callback saw it
+};
+
+inline std::vector<MIDIClockCapturePulse> MakeMIDIClockCapture(const MIDIClockCaptureOptions &o)
+{
+    std::mt19937 rng(o.seed);
+    std::exponential_distribution<double> delay(1.0 / o.callbackDelayNs);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<MIDIClockCapturePulse> capture;
+    capture.reserve(o.pulses);
+    double sent = 1e9 + uniform(rng) * 1e6;
+    uint64_t lastReceived = 0;
+    for (uint32_t i = 0; i < o.pulses; i++) {
+        double bpm = o.startBPM;
+        if (o.endBPM > 0)
+            bpm += (o.endBPM - o.startBPM) * (double)i / (double)o.pulses;
+
+        double arrive = sent;
+        if (o.framePeriodNs > 0)
+            arrive = ceil(sent / o.framePeriodNs) * o.framePeriodNs;
+        arrive += delay(rng);
+        if (uniform(rng) < o.lateProbability)
+            arrive += o.lateDelayNs;
+
+        // Completions are delivered in order
+        uint64_t received = (uint64_t)arrive;
+        if (received <= lastReceived) received = lastReceived + 1;
+        lastReceived = received;
+
+        capture.push_back({ (uint64_t)sent, received });
+        sent += 60e9 / (bpm * 24);
+    }
+    return capture;
+}
+
+#endif /* MIDIClockCapture_h */
@@ -0,0 +1,89 @@
+#ifndef MIDIEchoDevice_h
+#define MIDIEchoDevice_h
+
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include "FakeHostClock.h"
+#include "SimulatedUSBDevice.h"
+#include "USBMIDIParser.h"
+
+/// Answers the SysEx a SimulatedUSBDevice receives, for round-trip tests.
+///
+/// A Universal Identity Request gets a Roland identity reply, as the device
+/// itself would send; any other SysEx comes back unchanged, as through a
+/// cable from MIDI OUT to MIDI IN. Each answer leaves after the cable's
+/// latency plus uniform jitter and is queued on the bulk IN side.
+class MIDIEchoDevice {
+public:
+    MIDIEchoDevice(SimulatedUSBDevice &usb, HostClock &clock, uint32_t seed = 1)
+        : usb(usb), clock(clock), rng(seed) {}
+
+    void SetLatency(uint8_t cable, uint64_t baseNs, uint64_t jitterNs)
+    {
+        cables[cable & 0x0F].baseNs = baseNs;
+        cables[cable & 0x0F].jitterNs = jitterNs;
+    }
+
+    /// Pick up what was written since the last call and queue the answers
+    /// that are due.
+    void Service()
+    {
+        uint64_t now = clock.NowNanos();
+        for (uint8_t cable = 0; cable < kUSBMIDINumCables; cable++) {
+            Cable &c = cables[cable];
+            std::vector<uint8_t> bytes = usb.CableBytes(cable);
+            for (; c.consumed < bytes.size(); c.consumed++) {
+                uint8_t b = bytes[c.consumed];
+                if (b == 0xF0) c.msg.clear();
+                c.msg.push_back(b);
+                if (b != 0xF7 || c.msg[0] != 0xF0) continue;
+                std::uniform_int_distribution<uint64_t> jitter(0, c.jitterNs);
+                answers.push_back({ now + c.baseNs + jitter(rng), cable, Answer(c.msg) });
+                c.msg.clear();
+            }
+        }
+
+        for (auto it = answers.begin(); it != answers.end();) {
+            if (it->dueNs > now) { ++it; continue; }
+            uint8_t packets[256];
+            uint32_t n = USBMIDIBuildBulkOut(it->bytes.data(), (uint32_t)it->bytes.size(),
+                                             it->cable, packets, sizeof(packets));
+            usb.QueueInbound(packets, n);
+            it = answers.erase(it);
+        }
+    }
+
+    size_t PendingAnswers() const { return answers.size(); }
+
+private:
+    struct Cable {
+        uint64_t baseNs   = 1000000;
+        uint64_t jitterNs = 0;
+        size_t   consumed = 0;
+        std::vector<uint8_t> msg;
+    };
+
+    struct Pending {
+        uint64_t dueNs;
+        uint8_t  cable;
+        std::vector<uint8_t> bytes;
+    };
+
+    static std::vector<uint8_t> Answer(const std::vector<uint8_t> &msg)
+    {
+        if (msg.size() >= 6 && msg[1] == 0x7E && msg[3] == 0x06 && msg[4] == 0x01)
+            return { 0xF0, 0x7E, 0x10, 0x06, 0x02, 0x41, 0x64, 0x02, 0x00, 0x00,
+                     0x00, 0x01, 0x00, 0x00, 0xF7 };
+        return msg;
+    }
+
+    SimulatedUSBDevice &usb;
+    HostClock &clock;
+    std::mt19937_64 rng;
+    Cable cables[kUSBMIDINumCables];
+    std::deque<Pending> answers;
+};
+
+#endif /* MIDIEchoDevice_h */
@@ -0,0 +1,320 @@
+#include "SimulatedStatsSource.h"
+#include <algorithm>
+#include <random>
+#include "FakeHostClock.h"
+#include "LatencyProbe.h"
+#include "MIDITransmitter.h"
+#include "RolandDeviceTable.h"
+#include "SimulatedUSBDevice.h"
+
+static constexpr uint64_t kNever           = UINT64_MAX;
+static constexpr uint64_t kProbeIntervalNs = 1000000000;   // As the driver's probe timer
+static constexpr uint64_t kClockIntervalNs = 20833333;     // 24 ppqn at 120 BPM
+static constexpr uint32_t kBusBytesPerSecond = 1000000;    // Full-speed bulk, after overhead
+
+static const uint8_t kIdentityReply[] = { 0xF0, 0x7E, 0x10, 0x06, 0x02, 0x41, 0x64, 0x02,
+                                          0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0xF7 };
+
+struct SimulatedStatsSource::Rig {
+    Rig(const RolandDeviceInfo *info, uint64_t id, uint64_t startNs, uint32_t seed)
+        : info(info), id(id), clock(startNs), usb(&clock), tx(&usb, &clock), probe(&clock), rng(seed) {}
+
+    struct Port {
+        uint64_t nextNote    = kNever;
+        uint64_t nextControl = kNever;
+        uint64_t nextDump    = kNever;
+        uint64_t nextPlayed  = kNever;
+        bool     noteOn      = false;
+        bool     playedOn    = false;
+        uint8_t  value       = 0;
+    };
+
+    // Outbound SysEx head, enough to recognise an identity request
+    struct Request {
+        uint8_t  head[5] = {};
+        uint32_t length  = 0;
+        bool     open    = false;
+    };
+
+    struct Reply {
+        uint64_t dueNs;
+        uint8_t  cable;
+    };
+
+    const RolandDeviceInfo *info;
+    uint64_t id;
+    FakeHostClock clock;
+    SimulatedUSBDevice usb;
+    MIDITransmitter tx;
+    LatencyProbe probe;
+    std::mt19937 rng;
+
+    Port ports[kMaxPortsPerDevice];
+    uint64_t nextClock = kNever;
+    uint64_t nextProbe = kNever;
+    uint64_t nextFault = kNever;
+    Request  requests[kUSBMIDINumCables];
+    std::vector<Reply> replies;
+
+    MIDITrafficCounters rx[kUSBMIDINumCables];
+    uint64_t readErrors = 0;
+};
+
+namespace {
+
+// Exponentially distributed gap for events arriving at a mean rate
+uint64_t NextAfter(uint64_t now, std::mt19937 &rng, double perSecond)
+{
+    if (perSecond <= 0) return kNever;
+    std::exponential_distribution<double> gap(perSecond);
+    return now + (uint64_t)(gap(rng) * 1e9) + 1;
+}
+
+void QueueFromDevice(SimulatedUSBDevice &usb, uint8_t cable, const uint8_t *bytes, uint32_t length)
+{
+    std::vector<uint8_t> packets((length + 2) / 3 * 4 + 4);
+    uint32_t n = USBMIDIBuildBulkOut(bytes, length, cable, packets.data(), (uint32_t)packets.size());
+    usb.QueueInbound(packets.data(), n);
+}
+
+} // namespace
+
+SimulatedStatsSource::SimulatedStatsSource(HostClock *clock, const SimulatedTrafficOptions &options)
+    : clock(clock), options(options)
+{
+}
+
+SimulatedStatsSource::~SimulatedStatsSource() = default;
+
+bool SimulatedStatsSource::AddDevice(uint16_t productID)
+{
+    const RolandDeviceInfo *info = FindRolandDevice(productID);
+    if (!info) return false;
+
+    uint64_t now = clock->NowNanos();
+    auto rig = std::make_unique<Rig>(info, (uint64_t)(rigs.size() + 1) << 8, now,
+                                     options.seed + (uint32_t)rigs.size());
+
+    // Transmitter set up from the profile as the driver does
+    const RolandPerfProfile &profile = info->profile;
+    MIDITransmitterConfig config;
+    config.sysExChunkSize     = profile.sysExChunkSize;
+    config.sysExChunkGapNs    = (uint64_t)profile.sysExChunkGapUs * 1000;
+    config.minSysExChunkGapNs = (uint64_t)profile.minSysExChunkGapUs * 1000;
+    config.maxTransferSize    = profile.maxTxTransferSize;
+    config.maxWritesInFlight  = profile.writeQueueDepth;
+    for (uint8_t p = 0; p < info->numPorts; p++)
+        config.cableBytesPerSecond[info->ports[p].cable & 0x0F] = info->ports[p].dinBytesPerSecond;
+    rig->tx.SetConfig(config);
+    rig->usb.SetAsyncWrites(&rig->tx, options.completionLatencyNs, kBusBytesPerSecond);
+
+    for (uint8_t p = 0; p < info->numPorts; p++) {
+        Rig::Port &port = rig->ports[p];
+        port.nextNote    = NextAfter(now, rig->rng, options.notesPerSecond * 2);
+        port.nextControl = NextAfter(now, rig->rng, options.controlsPerSecond);
+        port.nextPlayed  = NextAfter(now, rig->rng, options.playedPerSecond * 2);
+        // Dumps on a multi-port device are spread over the interval
+        if (options.dumpBytes >= 2 && options.dumpIntervalNs)
+            port.nextDump = now + options.dumpIntervalNs * (p + 1) / (info->numPorts + 1);
+        rig->probe.SetMode(info->ports[p].cable & 0x0F, LatencyProbeMode::Identity);
+    }
+    if (options.clockFromDevice) rig->nextClock = now + kClockIntervalNs;
+    rig->nextProbe = now;
+    if (options.faultIntervalNs) rig->nextFault = now + options.faultIntervalNs;
+
+    rigs.push_back(std::move(rig));
+    return true;
+}
+
+// ---------- Simulation ----------
+
+void SimulatedStatsSource::Generate(Rig &r, uint64_t now)
+{
+    for (uint8_t p = 0; p < r.info->numPorts; p++) {
+        Rig::Port &port = r.ports[p];
+        uint8_t cable = r.info->ports[p].cable & 0x0F;
+
+        while (port.nextNote <= now) {
+            const uint8_t note[3] = { (uint8_t)(port.noteOn ? 0x80 : 0x90), (uint8_t)(60 + p), 100 };
+            r.tx.Enqueue(cable, note, 3);
+            port.noteOn = !port.noteOn;
+            port.nextNote = NextAfter(port.nextNote, r.rng, options.notesPerSecond * 2);
+        }
+        while (port.nextControl <= now) {
+            port.value = (uint8_t)((port.value + 1) & 0x7F);
+            const uint8_t control[3] = { 0xB0, 74, port.value };
+            r.tx.Enqueue(cable, control, 3);
+            port.nextControl = NextAfter(port.nextControl, r.rng, options.controlsPerSecond);
+        }
+        while (port.nextDump <= now) {
+            // A Roland DT1 bulk dump; only its size matters here
+            std::vector<uint8_t> dump(options.dumpBytes, 0x20);
+            const uint8_t header[] = { 0xF0, 0x41, 0x10, 0x00, 0x00, 0x64, 0x12 };
+            std::copy(header, header + std::min<size_t>(sizeof(header), dump.size() - 1), dump.begin());
+            dump.back() = 0xF7;
+            r.tx.Enqueue(cable, dump.data(), (uint32_t)dump.size());
+            port.nextDump += options.dumpIntervalNs;
+        }
+        while (port.nextPlayed <= now) {
+            const uint8_t note[3] = { (uint8_t)(port.playedOn ? 0x80 : 0x90), (uint8_t)(48 + p), 90 };
+            QueueFromDevice(r.usb, cable, note, 3);
+            port.playedOn = !port.playedOn;
+            port.nextPlayed = NextAfter(port.nextPlayed, r.rng, options.playedPerSecond * 2);
+        }
+    }
+
+    while (r.nextClock <= now) {
+        const uint8_t pulse = 0xF8;
+        QueueFromDevice(r.usb, r.info->ports[0].cable & 0x0F, &pulse, 1);
+        r.nextClock += kClockIntervalNs;
+    }
+
+    if (r.nextProbe <= now) {
+        std::vector<uint8_t> msg;
+        for (uint8_t p = 0; p < r.info->numPorts; p++) {
+            uint8_t cable = r.info->ports[p].cable & 0x0F;
+            if (r.probe.NextProbe(cable, msg))
+                r.tx.Enqueue(cable, msg.data(), (uint32_t)msg.size());
+        }
+        r.nextProbe = now + kProbeIntervalNs;
+    }
+
+    if (r.nextFault <= now) {
+        r.usb.FailNextWrites(1);
+        r.usb.FailNextReads(USBReadStatus::Transient, 1);
+        r.nextFault = now + options.faultIntervalNs;
+    }
+}
+
+void SimulatedStatsSource::Answer(Rig &r, uint64_t now)
+{
+    std::uniform_int_distribution<uint64_t> jitter(0, options.replyJitterNs);
+    for (const SimulatedUSBDevice::ReceivedEvent &e : r.usb.Events()) {
+        Rig::Request &q = r.requests[e.cable & 0x0F];
+        for (uint8_t i = 0; i < e.length; i++) {
+            uint8_t b = e.bytes[i];
+            if (b >= 0xF8) continue;
+            if (b == 0xF0) {
+                q.open = true;
+                q.length = 0;
+            }
+            if (!q.open) continue;
+            if (b == 0xF7) {
+                q.open = false;
+                if (q.length == 5 && q.head[1] == 0x7E && q.head[3] == 0x06 && q.head[4] == 0x01)
+                    r.replies.push_back({ std::max(e.hostTime, now) + options.replyLatencyNs + jitter(r.rng),
+                                          e.cable });
+            } else if (b >= 0x80 && b != 0xF0) {
+                q.open = false;
+            } else if (q.length < sizeof(q.head)) {
+                q.head[q.length++] = b;
+            } else {
+                q.length = sizeof(q.head) + 1;   // Longer than a request
+            }
+        }
+    }
+    r.usb.Clear();
+
+    for (auto it = r.replies.begin(); it != r.replies.end();) {
+        if (it->dueNs > now) { ++it; continue; }
+        QueueFromDevice(r.usb, it->cable, kIdentityReply, sizeof(kIdentityReply));
+        it = r.replies.erase(it);
+    }
+}
+
+void SimulatedStatsSource::Receive(Rig &r)
+{
+    uint8_t buffer[512];
+    for (;;) {
+        uint32_t length = 0;
+        if (r.usb.ReadTransfer(buffer, sizeof(buffer), &length) != USBReadStatus::Success) {
+            r.readErrors++;
+            break;
+        }
+        if (!length) break;
+        USBMIDIParseBulkInFiltered(buffer, length, nullptr,
+            [](uint8_t cable, const uint8_t *midiBytes, uint8_t byteCount, void *ctx) {
+                auto *rig = static_cast<Rig *>(ctx);
+                CountMIDITraffic(rig->rx[cable], midiBytes, byteCount);
+                rig->probe.ObserveInbound(cable, midiBytes, byteCount, rig->clock.NowNanos());
+            }, &r);
+    }
+}
+
+uint64_t SimulatedStatsSource::NextEvent(const Rig &r)
+{
+    uint64_t next = std::min({ r.nextClock, r.nextProbe, r.nextFault });
+    for (uint8_t p = 0; p < r.info->numPorts; p++) {
+        const Rig::Port &port = r.ports[p];
+        next = std::min({ next, port.nextNote, port.nextControl, port.nextDump, port.nextPlayed });
+    }
+    for (const Rig::Reply &a : r.replies)
+        next = std::min(next, a.dueNs);
+    return next;
+}
+
+void SimulatedStatsSource::Advance()
+{
+    uint64_t target = clock->NowNanos();
+    for (auto &rig : rigs) {
+        Rig &r = *rig;
+        for (;;) {
+            uint64_t now = r.clock.NowNanos();
+            Generate(r, now);
+            uint64_t due = r.tx.Pump();
+            size_t inFlight = r.usb.WritesInFlight();
+            uint64_t done = r.usb.CompleteWrites();
+            Answer(r, now);
+            Receive(r);
+            if (r.usb.WritesInFlight() < inFlight) continue;   // Slots freed: pump again now
+
+            uint64_t next = NextEvent(r);
+            if (due && due < next) next = due;
+            if (done && done < next) next = done;
+            if (next > target) {
+                if (target > now) r.clock.Set(target);
+                break;
+            }
+            r.clock.Set(next > now ? next : now + 1);
+        }
+    }
+}
+
+bool SimulatedStatsSource::Read(std::vector<PortStatsSample> &samples)
+{
+    Advance();
+    samples.clear();
+    for (const auto &rig : rigs) {
+        const Rig &r = *rig;
+        MIDITransmitterStats t = r.tx.GetStats();
+        for (uint8_t p = 0; p < r.info->numPorts; p++) {
+            uint8_t cable = r.info->ports[p].cable & 0x0F;
+            MIDICableStats c = r.tx.GetCableStats(cable);
+            LatencyProbeStats l = r.probe.GetStats(cable);
+
+            PortStatsSample s;
+            s.id     = r.id + p;
+            s.device = r.info->name;
+            s.port   = r.info->ports[p].name;
+            s.timeNs = r.clock.NowNanos();
+            s.rx = r.rx[cable];
+            s.tx = c.sent;
+            s.txQueueBytes   = c.pendingBytes;
+            s.txQueuePeak    = c.peakPendingBytes;
+            s.shaperHolds    = c.shaperHolds;
+            s.readErrors     = r.readErrors;
+            s.writeErrors    = t.writeErrors;
+            s.pacingWaitNs   = t.pacingWaitNs;
+            s.sysExGapNs     = t.sysExGapNs;
+            s.writeWindow    = t.writeWindow;
+            s.writesInFlight = t.writesInFlight;
+            s.writeLatencyNs = t.writeLatencyNs;
+            s.latencySamples = l.samples;
+            s.latencyP50Us   = l.p50Us;
+            s.latencyP95Us   = l.p95Us;
+            s.latencyP99Us   = l.p99Us;
+            samples.push_back(std::move(s));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef SimulatedStatsSource_h
+#define SimulatedStatsSource_h
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "HostClock.h"
+#include "PortStatistics.h"
+
+/// Traffic a SimulatedStatsSource plays on every port of its devices.
+struct SimulatedTrafficOptions {
+    double   notesPerSecond    = 8;            // Note On + Off pairs sent
+    double   controlsPerSecond = 40;           // Controller changes sent
+    uint32_t dumpBytes         = 4096;         // SysEx dump sent every dumpIntervalNs
+    uint64_t dumpIntervalNs    = 5000000000ull;
+    double   playedPerSecond   = 6;            // Notes played on the device's keys
+    bool     clockFromDevice   = true;         // 120 BPM clock on each device's first port
+    uint64_t replyLatencyNs    = 1500000;      // Device's answer to an identity request
+    uint64_t replyJitterNs     = 500000;
+    uint64_t completionLatencyNs = 250000;     // Bulk OUT submit to completion
+    uint64_t faultIntervalNs   = 0;            // A failed read and write this often (0 = none)
+    uint32_t seed              = 1;
+};
+
+/// Simulated driver for the stats viewer, on hosts without the hardware.
+///
+/// Each device from the model table gets the transmitter, parser and
+/// latency probe the driver uses, configured from its profile, writing into
+/// a SimulatedUSBDevice on a fake clock. The device answers identity
+/// requests, sends its own notes and clock, and every port is probed for
+/// round trips. Read() first runs the simulation up to `clock` time, then
+/// reports what the driver would publish.
+class SimulatedStatsSource : public PortStatsSource {
+public:
+    explicit SimulatedStatsSource(HostClock *clock = &DefaultHostClock(),
+                                  const SimulatedTrafficOptions &options = {});
+    ~SimulatedStatsSource() override;
+
+    /// Add a device by product ID; false if the table has no such model.
+    bool AddDevice(uint16_t productID);
+
+    /// Run every device up to the current time.
+    void Advance();
+
+    bool Read(std::vector<PortStatsSample> &samples) override;
+
+private:
+    struct Rig;
+
+    void Generate(Rig &r, uint64_t now);
+    /// The device's side: identity requests it received get their reply.
+    void Answer(Rig &r, uint64_t now);
+    /// The driver's read path: inbound counters and probe replies.
+    static void Receive(Rig &r);
+    static uint64_t NextEvent(const Rig &r);
+
+    HostClock *clock;
+    SimulatedTrafficOptions options;
+    std::vector<std::unique_ptr<Rig>> rigs;
+};
+
+#endif /* SimulatedStatsSource_h */
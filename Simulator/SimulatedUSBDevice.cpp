@@ -0,0 +1,314 @@
+#include "SimulatedUSBDevice.h"
+#include <algorithm>
+#include <thread>
+
+SimulatedUSBDevice::SimulatedUSBDevice(HostClock *clock)
+    : clock(clock)
+{
+}
+
+void SimulatedUSBDevice::FailNextWrites(uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    failuresLeft = count;
+}
+
+void SimulatedUSBDevice::SetReceiveBuffer(uint32_t capacityBytes, uint32_t drainBytesPerSecond,
+                                          FakeHostClock *clockToAdvance)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bufferCapacity = capacityBytes;
+    drainRate = drainBytesPerSecond;
+    timeline = clockToAdvance;
+    bufferLevel = 0;
+    bufferTime = clock->NowNanos();
+}
+
+uint64_t SimulatedUSBDevice::StallNanos() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stallNanos;
+}
+
+uint64_t SimulatedUSBDevice::StalledTransfers() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stalledTransfers;
+}
+
+uint32_t SimulatedUSBDevice::MIDIByteCount(const uint8_t *data, uint32_t length)
+{
+    uint32_t midiBytes = 0;
+    for (uint32_t i = 0; i + 4 <= length; i += 4)
+        midiBytes += USBMIDICinToMIDIByteCount(data[i] & 0x0F);
+    return midiBytes;
+}
+
+void SimulatedUSBDevice::DrainTo(uint64_t now)
+{
+    uint64_t drained = (now - bufferTime) * drainRate / 1000000000ull;
+    if (drained) {
+        bufferLevel = drained >= bufferLevel ? 0 : bufferLevel - drained;
+        bufferTime += drained * 1000000000ull / drainRate;
+    }
+    if (bufferLevel == 0) bufferTime = now;
+}
+
+void SimulatedUSBDevice::Receive(const uint8_t *data, uint32_t length, uint64_t at)
+{
+    lastTransfer = at;
+    USBMIDIParseBulkIn(data, length,
+        [](uint8_t cable, const uint8_t *midiBytes, uint8_t byteCount, void *ctx) {
+            auto *self = static_cast<SimulatedUSBDevice *>(ctx);
+            ReceivedEvent e = {};
+            e.hostTime = self->lastTransfer;
+            e.cable = cable;
+            e.length = byteCount;
+            for (uint8_t i = 0; i < byteCount && i < 3; i++)
+                e.bytes[i] = midiBytes[i];
+            self->events.push_back(e);
+        }, this);
+    transfers++;
+}
+
+bool SimulatedUSBDevice::WriteTransfer(const uint8_t *data, uint32_t length)
+{
+    if (writeLatencyNanos)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(writeLatencyNanos));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (failuresLeft) {
+        failuresLeft--;
+        return false;
+    }
+
+    if (bufferCapacity && drainRate) {
+        uint32_t midiBytes = MIDIByteCount(data, length);
+        DrainTo(clock->NowNanos());
+
+        if (bufferLevel + midiBytes > bufferCapacity) {
+            // NAK until enough has drained for the whole transfer
+            uint64_t excess = bufferLevel + midiBytes - bufferCapacity;
+            uint64_t stall = (excess * 1000000000ull + drainRate - 1) / drainRate;
+            stallNanos += stall;
+            stalledTransfers++;
+            if (timeline) {
+                timeline->Advance(stall);
+            } else {
+                lock.unlock();
+                std::this_thread::sleep_for(std::chrono::nanoseconds(stall));
+                lock.lock();
+            }
+            DrainTo(clock->NowNanos());
+            uint64_t room = midiBytes < bufferCapacity ? bufferCapacity - midiBytes : 0;
+            if (bufferLevel > room) bufferLevel = room;   // rounding in DrainTo
+        }
+        bufferLevel += midiBytes;
+    }
+
+    Receive(data, length, clock->NowNanos());
+    return true;
+}
+
+// ---------- Asynchronous bulk OUT ----------
+
+void SimulatedUSBDevice::SetAsyncWrites(MIDITransmitter *owner, uint64_t completionLatencyNanos,
+                                        uint32_t busBytesPerSecond)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    asyncOwner = owner;
+    completionLatency = completionLatencyNanos;
+    busRate = busBytesPerSecond;
+    busFreeAt = 0;
+}
+
+bool SimulatedUSBDevice::CanSubmitTransfers() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return asyncOwner != nullptr;
+}
+
+bool SimulatedUSBDevice::SubmitTransfer(const uint8_t *data, uint32_t length, uint64_t tag)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!asyncOwner) return false;
+
+    // On the bus once the transfers before it are through
+    uint64_t at = std::max(clock->NowNanos(), busFreeAt);
+    if (busRate) at += (uint64_t)length * 1000000000ull / busRate;
+
+    bool ok = true;
+    if (failuresLeft) {
+        failuresLeft--;
+        ok = false;
+    } else {
+        if (bufferCapacity && drainRate) {
+            uint32_t midiBytes = MIDIByteCount(data, length);
+            DrainTo(at);
+            if (bufferLevel + midiBytes > bufferCapacity) {
+                uint64_t excess = bufferLevel + midiBytes - bufferCapacity;
+                uint64_t stall = (excess * 1000000000ull + drainRate - 1) / drainRate;
+                stallNanos += stall;
+                stalledTransfers++;
+                at += stall;
+                DrainTo(at);
+                uint64_t room = midiBytes < bufferCapacity ? bufferCapacity - midiBytes : 0;
+                if (bufferLevel > room) bufferLevel = room;
+            }
+            bufferLevel += midiBytes;
+        }
+        Receive(data, length, at);
+    }
+    busFreeAt = at;
+    completions.push_back({ tag, at + completionLatency, ok });
+    return true;
+}
+
+uint64_t SimulatedUSBDevice::CompleteWrites()
+{
+    std::vector<PendingCompletion> due;
+    MIDITransmitter *owner;
+    uint64_t next = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t now = clock->NowNanos();
+        while (!completions.empty() && completions.front().due <= now) {
+            due.push_back(completions.front());
+            completions.pop_front();
+        }
+        if (!completions.empty()) next = completions.front().due;
+        owner = asyncOwner;
+    }
+    for (const PendingCompletion &c : due)
+        if (owner) owner->OnWriteCompleted(c.tag, c.ok);
+    return next;
+}
+
+size_t SimulatedUSBDevice::WritesInFlight() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return completions.size();
+}
+
+std::vector<SimulatedUSBDevice::ReceivedEvent> SimulatedUSBDevice::Events() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return events;
+}
+
+std::vector<uint8_t> SimulatedUSBDevice::CableBytes(uint8_t cable) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<uint8_t> bytes;
+    for (auto &e : events) {
+        if (e.cable == cable)
+            bytes.insert(bytes.end(), e.bytes, e.bytes + e.length);
+    }
+    return bytes;
+}
+
+uint64_t SimulatedUSBDevice::TransferCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return transfers;
+}
+
+uint64_t SimulatedUSBDevice::LastTransferTime() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastTransfer;
+}
+
+void SimulatedUSBDevice::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    transfers = 0;
+    lastTransfer = 0;
+}
+
+// ---------- Bulk IN ----------
+
+void SimulatedUSBDevice::QueueInbound(const uint8_t *packets, uint32_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    inbound.insert(inbound.end(), packets, packets + (length & ~3u));
+}
+
+USBReadStatus SimulatedUSBDevice::ReadTransfer(uint8_t *buffer, uint32_t capacity, uint32_t *length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    readAttempts++;
+    *length = 0;
+    if (inStalled)
+        return USBReadStatus::Stalled;
+    if (readFaultsLeft) {
+        readFaultsLeft--;
+        if (readFault == USBReadStatus::Stalled)
+            inStalled = true;   // A halted endpoint stays halted
+        return readFault;
+    }
+    if (babbling)
+        return USBReadStatus::Transient;
+
+    uint32_t n = std::min<uint32_t>(capacity & ~3u, (uint32_t)inbound.size());
+    std::copy(inbound.begin(), inbound.begin() + n, buffer);
+    inbound.erase(inbound.begin(), inbound.begin() + n);
+    *length = n;
+    return USBReadStatus::Success;
+}
+
+void SimulatedUSBDevice::FailNextReads(USBReadStatus status, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    readFault = status;
+    readFaultsLeft = count;
+}
+
+void SimulatedUSBDevice::StallInPipe()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    inStalled = true;
+}
+
+void SimulatedUSBDevice::ClearInPipeStall()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    inStalled = false;
+    stallClears++;
+}
+
+void SimulatedUSBDevice::SetBabbling(bool enable, bool survivesReset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    babbling = enable;
+    babbleSticky = survivesReset;
+}
+
+void SimulatedUSBDevice::ResetPort()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    portResets++;
+    inStalled = false;
+    readFaultsLeft = 0;
+    if (!babbleSticky)
+        babbling = false;
+}
+
+uint64_t SimulatedUSBDevice::ReadAttempts() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return readAttempts;
+}
+
+uint64_t SimulatedUSBDevice::StallClears() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stallClears;
+}
+
+uint64_t SimulatedUSBDevice::PortResets() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return portResets;
+}
@@ -0,0 +1,160 @@
+#ifndef SimulatedUSBDevice_h
+#define SimulatedUSBDevice_h
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "HostClock.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "ReadRecovery.h"
+
+/// A USB-MIDI device model for host-side tests and benchmarks.
+///
+/// Implements the bulk OUT pipe: every transfer is decoded and recorded with
+/// the host time at which it completed. An optional per-transfer write
+/// latency emulates the time a synchronous WritePipe blocks on real hardware.
+/// With a receive buffer model the device drains MIDI bytes at a fixed rate
+/// and NAKs (stalls the write) while the buffer has no room for a transfer.
+///
+/// The bulk IN side hands queued USB-MIDI packets to ReadTransfer() and can
+/// inject read faults: one-off errors, a halted endpoint that needs a clear,
+/// or a babbling endpoint that only a port reset (reopen) cures, or not even
+/// that.
+class SimulatedUSBDevice : public USBMIDIOutputPipe {
+public:
+    struct ReceivedEvent {
+        uint64_t hostTime;
+        uint8_t  cable;
+        uint8_t  length;
+        uint8_t  bytes[3];
+    };
+
+    explicit SimulatedUSBDevice(HostClock *clock = &DefaultHostClock());
+
+    /// Real time a synchronous write blocks (0 = returns immediately).
+    void SetWriteLatencyNanos(uint64_t nanos) { writeLatencyNanos = nanos; }
+
+    /// Model the device's receive buffer: capacity in MIDI bytes, drained at
+    /// drainBytesPerSecond. A write that does not fit blocks until it does;
+    /// the stall advances timeline when given, otherwise the writer sleeps.
+    void SetReceiveBuffer(uint32_t capacityBytes, uint32_t drainBytesPerSecond,
+                          FakeHostClock *timeline = nullptr);
+
+    /// Total time writes spent NAKed by a full receive buffer.
+    uint64_t StallNanos() const;
+    uint64_t StalledTransfers() const;
+
+    /// Make the next N writes fail (fault injection).
+    void FailNextWrites(uint32_t count);
+
+    bool WriteTransfer(const uint8_t *data, uint32_t length) override;
+
+    /// Take asynchronous writes and report their completions to owner.
+    void SetAsyncWrites(MIDITransmitter *owner, uint64_t completionLatencyNanos,
+                        uint32_t busBytesPerSecond);
+    bool CanSubmitTransfers() const override;
+    bool SubmitTransfer(const uint8_t *data, uint32_t length, uint64_t tag) override;
+    /// Report every completion due by now, in order. Returns when the next
+    /// one is due (0 = none in flight).
+    uint64_t CompleteWrites();
+    size_t WritesInFlight() const;
+
+    /// Snapshot of everything received so far.
+    std::vector<ReceivedEvent> Events() const;
+    /// Raw MIDI byte stream received on one cable.
+    std::vector<uint8_t> CableBytes(uint8_t cable) const;
+
+    uint64_t TransferCount() const;
+    uint64_t LastTransferTime() const;
+    void Clear();
+
+    // ---- Bulk IN ----
+
+    /// Queue USB-MIDI packets for the host to read.
+    void QueueInbound(const uint8_t *packets, uint32_t length);
+    /// One bulk IN read: copies up to capacity bytes of whole packets.
+    USBReadStatus ReadTransfer(uint8_t *buffer, uint32_t capacity, uint32_t *length);
+
+    /// The next N reads fail with this status.
+    void FailNextReads(USBReadStatus status, uint32_t count);
+    /// Halt the IN endpoint: reads return Stalled until ClearInPipeStall().
+    void StallInPipe();
+    void ClearInPipeStall();
+    /// Every read fails with Transient; ResetPort() cures it unless sticky.
+    void SetBabbling(bool babbling, bool survivesReset = false);
+    /// Port reset, as a device close/reopen causes.
+    void ResetPort();
+
+    uint64_t ReadAttempts() const;
+    uint64_t StallClears() const;
+    uint64_t PortResets() const;
+
+private:
+    struct PendingCompletion {
+        uint64_t tag;
+        uint64_t due;
+        bool     ok;
+    };
+
+    /// Drain the receive buffer model up to now.
+    void DrainTo(uint64_t now);
+    /// Record a transfer as received at host time `at`.
+    void Receive(const uint8_t *data, uint32_t length, uint64_t at);
+    static uint32_t MIDIByteCount(const uint8_t *data, uint32_t length);
+
+    HostClock *clock;
+    uint64_t   writeLatencyNanos = 0;
+
+    mutable std::mutex mutex;
+    std::vector<ReceivedEvent> events;
+    uint64_t transfers     = 0;
+    uint64_t lastTransfer  = 0;
+    uint32_t failuresLeft  = 0;
+
+    // Receive buffer model
+    uint32_t bufferCapacity = 0;      // 0 = unlimited
+    uint32_t drainRate      = 0;      // bytes per second
+    FakeHostClock *timeline = nullptr;
+    uint64_t bufferLevel    = 0;      // bytes, as of bufferTime
+    uint64_t bufferTime     = 0;
+    uint64_t stallNanos     = 0;
+    uint64_t stalledTransfers = 0;
+
+    // Asynchronous bulk OUT
+    MIDITransmitter *asyncOwner  = nullptr;
+    uint64_t completionLatency   = 0;
+    uint32_t busRate             = 0;   // bytes per second
+    uint64_t busFreeAt           = 0;
+    std::deque<PendingCompletion> completions;
+
+    // Bulk IN model
+    std::vector<uint8_t> inbound;
+    USBReadStatus readFault   = USBReadStatus::Success;
+    uint32_t readFaultsLeft   = 0;
+    bool     inStalled        = false;
+    bool     babbling         = false;
+    bool     babbleSticky     = false;
+    uint64_t readAttempts     = 0;
+    uint64_t stallClears      = 0;
+    uint64_t portResets       = 0;
+};
+
+/// Pump tx into device until everything queued is through, moving the fake
+/// clock to each pacing deadline and write completion in turn.
+inline void PumpUntilIdle(MIDITransmitter &tx, SimulatedUSBDevice &device, FakeHostClock &clock)
+{
+    for (;;) {
+        uint64_t due = tx.Pump();
+        size_t inFlight = device.WritesInFlight();
+        uint64_t done = device.CompleteWrites();
+        if (device.WritesInFlight() < inFlight) continue;   // Slots freed: pump again now
+
+        uint64_t next = due && (!done || due < done) ? due : done;
+        if (!next) break;
+        clock.Set(next > clock.NowNanos() ? next : clock.NowNanos() + 1);
+    }
+}
+
+#endif /* SimulatedUSBDevice_h */
@@ -0,0 +1,181 @@
+#include "BufferPool.h"
+#include <new>
+#include <string.h>
+
+constexpr uint32_t BufferPool::kClassSize[BufferPool::kNumClasses];
+
+// ---------- PooledBuffer ----------
+
+PooledBuffer::PooledBuffer(const PooledBuffer &other)
+    : block(other.block)
+{
+    if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+PooledBuffer &PooledBuffer::operator=(const PooledBuffer &other)
+{
+    if (other.block) other.block->refs.fetch_add(1, std::memory_order_relaxed);
+    Release();
+    block = other.block;
+    return *this;
+}
+
+PooledBuffer &PooledBuffer::operator=(PooledBuffer &&other) noexcept
+{
+    if (this != &other) {
+        Release();
+        block = other.block;
+        other.block = nullptr;
+    }
+    return *this;
+}
+
+bool PooledBuffer::resize(uint32_t length)
+{
+    if (!block || length > block->capacity) return false;
+    block->size = length;
+    return true;
+}
+
+bool PooledBuffer::append(const uint8_t *bytes, uint32_t length)
+{
+    if (!block || length > block->capacity - block->size) return false;
+    memcpy(block->Data() + block->size, bytes, length);
+    block->size += length;
+    return true;
+}
+
+uint32_t PooledBuffer::RefCount() const
+{
+    return block ? block->refs.load(std::memory_order_relaxed) : 0;
+}
+
+void PooledBuffer::Release()
+{
+    Block *b = block;
+    block = nullptr;
+    if (!b || b->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    if (b->pool) {
+        b->pool->Push(b);
+    } else {
+        b->~Block();
+        ::operator delete(b);
+    }
+}
+
+// ---------- BufferPool ----------
+
+BufferPool::BufferPool()
+{
+    for (uint32_t i = 0; i < kNumClasses; i++)
+        classes[i].blockSize = (uint32_t)sizeof(PooledBuffer::Block) + kClassSize[i];
+}
+
+BufferPool::~BufferPool()
+{
+    for (SizeClass &c : classes) {
+        for (uint32_t i = 0; i < c.blockCount; i++)
+            BlockAt(c, i)->~Block();
+    }
+}
+
+PooledBuffer::Block *BufferPool::BlockAt(const SizeClass &c, uint32_t index) const
+{
+    return reinterpret_cast<PooledBuffer::Block *>(c.storage.get() + (size_t)index * c.blockSize);
+}
+
+void BufferPool::Reserve(const BufferPoolConfig &config)
+{
+    const uint32_t counts[kNumClasses] = {
+        config.blocks64, config.blocks512, config.blocks4K, config.blocks64K
+    };
+    for (uint32_t cls = 0; cls < kNumClasses; cls++) {
+        SizeClass &c = classes[cls];
+        if (c.blockCount || !counts[cls]) continue;
+
+        c.storage.reset(new uint8_t[(size_t)counts[cls] * c.blockSize]);
+        c.blockCount = counts[cls];
+        for (uint32_t i = 0; i < c.blockCount; i++) {
+            PooledBuffer::Block *b = new (BlockAt(c, i)) PooledBuffer::Block();
+            b->capacity = kClassSize[cls];
+            b->pool = this;
+            b->index = i;
+            b->cls = (uint8_t)cls;
+            b->next.store(i, std::memory_order_relaxed);   // Block i - 1, as index + 1
+        }
+        c.head.store(c.blockCount, std::memory_order_release);
+    }
+}
+
+size_t BufferPool::ReservedBytes() const
+{
+    size_t bytes = 0;
+    for (const SizeClass &c : classes)
+        bytes += (size_t)c.blockCount * kClassSize[&c - classes];
+    return bytes;
+}
+
+PooledBuffer::Block *BufferPool::Pop(uint32_t cls)
+{
+    SizeClass &c = classes[cls];
+    uint64_t head = c.head.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t top = (uint32_t)head;
+        if (!top) return nullptr;
+        PooledBuffer::Block *b = BlockAt(c, top - 1);
+        // A stale link read here fails the exchange: every push and pop bumps the tag
+        uint64_t next = ((head >> 32) + 1) << 32 | b->next.load(std::memory_order_relaxed);
+        if (c.head.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                         std::memory_order_acquire))
+            return b;
+    }
+}
+
+void BufferPool::Push(PooledBuffer::Block *b)
+{
+    SizeClass &c = classes[b->cls];
+    uint64_t head = c.head.load(std::memory_order_relaxed);
+    for (;;) {
+        b->next.store((uint32_t)head, std::memory_order_relaxed);
+        uint64_t next = ((head >> 32) + 1) << 32 | (uint64_t)(b->index + 1);
+        if (c.head.compare_exchange_weak(head, next, std::memory_order_release,
+                                         std::memory_order_relaxed))
+            break;
+    }
+    inUse.fetch_sub(1, std::memory_order_relaxed);
+}
+
+PooledBuffer BufferPool::Acquire(uint32_t capacity)
+{
+    acquired.fetch_add(1, std::memory_order_relaxed);
+
+    for (uint32_t cls = 0; cls < kNumClasses; cls++) {
+        if (kClassSize[cls] < capacity) continue;
+        PooledBuffer::Block *b = Pop(cls);
+        if (!b) continue;
+        b->size = 0;
+        b->refs.store(1, std::memory_order_relaxed);
+        uint32_t held = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t peak = peakInUse.load(std::memory_order_relaxed);
+        while (held > peak && !peakInUse.compare_exchange_weak(peak, held, std::memory_order_relaxed)) {}
+        return PooledBuffer(b);
+    }
+
+    fallbacks.fetch_add(1, std::memory_order_relaxed);
+    void *storage = ::operator new(sizeof(PooledBuffer::Block) + capacity);
+    PooledBuffer::Block *b = new (storage) PooledBuffer::Block();
+    b->capacity = capacity;
+    b->refs.store(1, std::memory_order_relaxed);
+    return PooledBuffer(b);
+}
+
+BufferPoolStats BufferPool::GetStats() const
+{
+    BufferPoolStats s;
+    s.acquired  = acquired.load(std::memory_order_relaxed);
+    s.fallbacks = fallbacks.load(std::memory_order_relaxed);
+    s.inUse     = inUse.load(std::memory_order_relaxed);
+    s.peakInUse = peakInUse.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,133 @@
+#ifndef BufferPool_h
+#define BufferPool_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+class BufferPool;
+
+/// Blocks reserved per size class.
+struct BufferPoolConfig {
+    uint32_t blocks64  = 256;   // Short SysEx (DT1/RQ1, identity), mirror replies
+    uint32_t blocks512 = 64;    // Merged DT1 writes, transfers
+    uint32_t blocks4K  = 16;    // Patch dumps
+    uint32_t blocks64K = 2;     // Whole MIDIPacket of SysEx
+};
+
+struct BufferPoolStats {
+    uint64_t acquired  = 0;   // Buffers handed out
+    uint64_t fallbacks = 0;   // Served from the heap: class exhausted or too large
+    uint32_t inUse     = 0;   // Pooled blocks currently held
+    uint32_t peakInUse = 0;
+};
+
+/// Reference-counted handle to a pool block (or a heap block when the pool
+/// had none). Copies share the block; the last one returns it. The byte
+/// count lives with the block, so every holder sees the same contents.
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    PooledBuffer(const PooledBuffer &other);
+    PooledBuffer(PooledBuffer &&other) noexcept : block(other.block) { other.block = nullptr; }
+    PooledBuffer &operator=(const PooledBuffer &other);
+    PooledBuffer &operator=(PooledBuffer &&other) noexcept;
+    ~PooledBuffer() { Release(); }
+
+    explicit operator bool() const { return block != nullptr; }
+
+    uint8_t       *data();
+    const uint8_t *data() const;
+    uint32_t size() const;
+    uint32_t capacity() const;
+    bool     empty() const { return !block || size() == 0; }
+    uint8_t &operator[](size_t i) { return data()[i]; }
+    uint8_t  operator[](size_t i) const { return data()[i]; }
+
+    /// Set the byte count; false (unchanged) beyond capacity.
+    bool resize(uint32_t length);
+    /// Append bytes; false (unchanged) if they don't fit.
+    bool append(const uint8_t *bytes, uint32_t length);
+
+    uint32_t RefCount() const;
+    /// Drop this reference.
+    void Release();
+
+private:
+    friend class BufferPool;
+    struct Block;
+    explicit PooledBuffer(Block *block) : block(block) {}
+
+    Block *block = nullptr;
+};
+
+struct PooledBuffer::Block {
+    std::atomic<uint32_t> refs{0};
+    std::atomic<uint32_t> next{0};   // Free-stack link (index + 1)
+    uint32_t    size     = 0;
+    uint32_t    capacity = 0;
+    BufferPool *pool     = nullptr;  // nullptr = heap block
+    uint32_t    index    = 0;
+    uint8_t     cls      = 0;
+
+    uint8_t *Data() { return reinterpret_cast<uint8_t *>(this + 1); }
+};
+
+inline uint8_t       *PooledBuffer::data()           { return block ? block->Data() : nullptr; }
+inline const uint8_t *PooledBuffer::data() const     { return block ? block->Data() : nullptr; }
+inline uint32_t       PooledBuffer::size() const     { return block ? block->size : 0; }
+inline uint32_t       PooledBuffer::capacity() const { return block ? block->capacity : 0; }
+
+/// Fixed-size blocks in four size classes (64 B, 512 B, 4 KB, 64 KB),
+/// reserved up front so the I/O paths never touch the heap.
+///
+/// Acquire takes the smallest class that fits and moves up a class when
+/// that one is empty; a request no class can serve is satisfied from the
+/// heap and counted, so running dry degrades speed, not correctness. Free
+/// blocks sit on one lock-free stack per class (tagged head, ABA-safe), so
+/// Acquire and release are safe from any thread. Reserve is called once
+/// before I/O starts; later calls leave existing classes alone. Buffers
+/// must not outlive the pool.
+class BufferPool {
+public:
+    static constexpr uint32_t kNumClasses = 4;
+    static constexpr uint32_t kClassSize[kNumClasses] = { 64, 512, 4096, 65536 };
+
+    BufferPool();
+    ~BufferPool();
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    /// Allocate each class's blocks (those not reserved yet).
+    void Reserve(const BufferPoolConfig &config);
+    /// Bytes held by reserved blocks.
+    size_t ReservedBytes() const;
+
+    /// A buffer of at least `capacity` bytes, size 0.
+    PooledBuffer Acquire(uint32_t capacity);
+
+    BufferPoolStats GetStats() const;
+
+private:
+    friend class PooledBuffer;
+
+    struct SizeClass {
+        std::unique_ptr<uint8_t[]> storage;
+        uint32_t blockSize  = 0;   // Header + payload
+        uint32_t blockCount = 0;
+        std::atomic<uint64_t> head{0};   // tag << 32 | (index + 1), 0 index = empty
+    };
+
+    PooledBuffer::Block *Pop(uint32_t cls);
+    void Push(PooledBuffer::Block *block);
+    PooledBuffer::Block *BlockAt(const SizeClass &c, uint32_t index) const;
+
+    SizeClass classes[kNumClasses];
+    std::atomic<uint64_t> acquired{0};
+    std::atomic<uint64_t> fallbacks{0};
+    std::atomic<uint32_t> inUse{0};
+    std::atomic<uint32_t> peakInUse{0};
+};
+
+#endif /* BufferPool_h */
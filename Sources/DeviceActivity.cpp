@@ -0,0 +1,34 @@
+#include "DeviceActivity.h"
+
+void DeviceActivity::SetListening(uint8_t port, bool listening, uint64_t now)
+{
+    if (port >= 32) return;
+    if (listening)
+        listeners |= 1u << port;
+    else
+        listeners &= ~(1u << port);
+    // The idle period starts when the last client goes away
+    lastUse = now;
+}
+
+void DeviceActivity::OnOpened(uint64_t now, uint64_t tookNs)
+{
+    stats.open = true;
+    stats.opens++;
+    stats.lastOpenNs = tookNs;
+    lastUse = now;
+}
+
+void DeviceActivity::OnClosed(bool idle)
+{
+    if (stats.open && idle)
+        stats.idleCloses++;
+    stats.open = false;
+}
+
+bool DeviceActivity::IdleExpired(uint64_t now, bool outputPending) const
+{
+    if (!config.lazy || !config.idleCloseNs || !stats.open) return false;
+    if (Wanted() || outputPending) return false;
+    return now - lastUse >= config.idleCloseNs;
+}
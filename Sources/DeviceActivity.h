@@ -0,0 +1,64 @@
+#ifndef DeviceActivity_h
+#define DeviceActivity_h
+
+#include <stdint.h>
+
+struct DeviceActivityConfig {
+    bool     lazy        = false;   // Claim the device on first use instead of at start
+    uint64_t idleCloseNs = 0;       // Release a lazily opened device after this long unused (0 = keep)
+};
+
+struct DeviceActivityStats {
+    bool     open         = false;
+    uint64_t opens        = 0;
+    uint64_t openFailures = 0;
+    uint64_t idleCloses   = 0;
+    uint64_t lastOpenNs   = 0;   // Time Open + StartIO took, last time
+};
+
+/// Open/close decisions for a device in lazy mode.
+///
+/// A lazy device is registered with CoreMIDI but its USB interface is only
+/// claimed when it is used: a client enables one of its sources, sends to
+/// it, or it is pinned (thru routes and generated clock feed its queues
+/// directly). It is released again once nothing is listening, nothing is
+/// queued and it has not been sent to for idleCloseNs.
+///
+/// Not thread-safe; the owner serialises calls with its open/close path.
+class DeviceActivity {
+public:
+    void SetConfig(const DeviceActivityConfig &config) { this->config = config; }
+    const DeviceActivityConfig &GetConfig() const { return config; }
+    bool Lazy() const { return config.lazy; }
+
+    /// A client sent to the device.
+    void OnSend(uint64_t now) { lastUse = now; }
+    /// A client (dis)connected from one of the device's sources.
+    void SetListening(uint8_t port, bool listening, uint64_t now);
+    /// Thru routes or the clock generator use the device.
+    void SetPinned(bool pinned) { this->pinned = pinned; }
+
+    /// The device must be open before the current use proceeds.
+    bool NeedsOpen() const { return !stats.open; }
+    /// Listeners or pins hold the device open without sends.
+    bool Wanted() const { return listeners != 0 || pinned; }
+
+    void OnOpened(uint64_t now, uint64_t tookNs);
+    void OnOpenFailed() { stats.openFailures++; }
+    /// idle = released by IdleExpired rather than removal, stop or reopen.
+    void OnClosed(bool idle);
+
+    /// True when a lazily opened device should be released now.
+    bool IdleExpired(uint64_t now, bool outputPending) const;
+
+    DeviceActivityStats GetStats() const { return stats; }
+
+private:
+    DeviceActivityConfig config;
+    DeviceActivityStats  stats;
+    uint32_t listeners = 0;   // Bit per port with an enabled source
+    bool     pinned    = false;
+    uint64_t lastUse   = 0;
+};
+
+#endif /* DeviceActivity_h */
@@ -0,0 +1,189 @@
+#ifndef DeviceRegistry_h
+#define DeviceRegistry_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// Names a registered port: generation << 16 | (slot + 1). 0 is never issued.
+typedef uint32_t PortHandle;
+
+/// Bounded table of devices and their ports for the driver's send path.
+///
+/// Ports live in fixed slots and are named by generation-tagged handles,
+/// which the driver stores as endpoint refCons: a handle whose port has
+/// gone fails validation instead of reaching whatever reuses the slot.
+/// Devices that went offline are kept for reconnection until the table is
+/// full; the one offline longest then makes room for a new one.
+///
+/// Add, SetOffline, AddPort, RemovePorts and Remove are called under the
+/// owner's lock. Lookup and ForEachDevice are lock-free for the send path
+/// and must run inside a ReadGuard; a device that Add evicted may only be
+/// disposed of after WaitForReaders().
+template <typename Device>
+class DeviceRegistry {
+public:
+    struct Port {
+        Device *device = nullptr;
+        uint8_t cable  = 0;
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const DeviceRegistry &registry) : registry(registry)
+        {
+            registry.readers.fetch_add(1);
+        }
+        ~ReadGuard() { registry.readers.fetch_sub(1, std::memory_order_release); }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+    private:
+        const DeviceRegistry &registry;
+    };
+
+    DeviceRegistry(size_t maxDevices, size_t maxPorts)
+        : maxDevices(maxDevices), maxPorts(std::min<size_t>(maxPorts, 0xFFFF)),
+          deviceSlots(new std::atomic<Device *>[maxDevices]),
+          portSlots(new PortSlot[this->maxPorts])
+    {
+        for (size_t i = 0; i < maxDevices; i++)
+            deviceSlots[i].store(nullptr, std::memory_order_relaxed);
+        devices.reserve(maxDevices);
+        offline.reserve(maxDevices);
+        freePorts.reserve(this->maxPorts);
+        for (size_t i = this->maxPorts; i > 0; i--)
+            freePorts.push_back((uint16_t)(i - 1));
+    }
+
+    DeviceRegistry(const DeviceRegistry &) = delete;
+    DeviceRegistry &operator=(const DeviceRegistry &) = delete;
+
+    /// Register a device. When the table is full the device offline longest
+    /// is removed first and handed back through *evicted (nullptr if no room
+    /// had to be made). False if every slot holds an online device.
+    bool Add(Device *device, Device **evicted)
+    {
+        *evicted = nullptr;
+        if (devices.size() >= maxDevices) {
+            if (offline.empty()) return false;
+            *evicted = offline.front();
+            Remove(*evicted);
+        }
+        for (size_t i = 0; i < maxDevices; i++) {
+            if (deviceSlots[i].load(std::memory_order_relaxed)) continue;
+            deviceSlots[i].store(device, std::memory_order_release);
+            break;
+        }
+        devices.push_back(device);
+        return true;
+    }
+
+    /// Offline devices may be evicted, oldest first.
+    void SetOffline(Device *device, bool isOffline)
+    {
+        auto it = std::find(offline.begin(), offline.end(), device);
+        if (it != offline.end()) offline.erase(it);
+        if (isOffline) offline.push_back(device);
+    }
+
+    /// Give a port of a registered device a handle; 0 when the port table is full.
+    PortHandle AddPort(Device *device, uint8_t cable)
+    {
+        if (freePorts.empty()) return 0;
+        uint16_t slot = freePorts.back();
+        freePorts.pop_back();
+
+        // A reader that validated the slot's previous handle may still be
+        // reading its fields
+        WaitForReaders();
+        PortSlot &s = portSlots[slot];
+        s.device = device;
+        s.cable = cable;
+        s.generation = (uint16_t)(s.generation + 1);
+        PortHandle handle = (PortHandle)s.generation << 16 | (PortHandle)(slot + 1);
+        s.handle.store(handle, std::memory_order_release);
+        return handle;
+    }
+
+    /// Invalidate every port handle of a device (before mapping it again).
+    void RemovePorts(Device *device)
+    {
+        for (size_t i = 0; i < maxPorts; i++) {
+            PortSlot &s = portSlots[i];
+            if (!s.handle.load(std::memory_order_relaxed) || s.device != device) continue;
+            s.handle.store(0, std::memory_order_release);
+            freePorts.push_back((uint16_t)i);
+        }
+    }
+
+    /// Forget a device and invalidate its port handles.
+    void Remove(Device *device)
+    {
+        RemovePorts(device);
+        SetOffline(device, false);
+        for (size_t i = 0; i < maxDevices; i++) {
+            if (deviceSlots[i].load(std::memory_order_relaxed) == device)
+                deviceSlots[i].store(nullptr, std::memory_order_release);
+        }
+        auto it = std::find(devices.begin(), devices.end(), device);
+        if (it != devices.end()) devices.erase(it);
+    }
+
+    /// Resolve a handle; false if it is stale or was never issued.
+    bool Lookup(PortHandle handle, Port &port) const
+    {
+        size_t slot = (size_t)(handle & 0xFFFF);
+        if (slot == 0 || slot > maxPorts) return false;
+        const PortSlot &s = portSlots[slot - 1];
+        if (s.handle.load(std::memory_order_acquire) != handle) return false;
+        port.device = s.device;
+        port.cable = s.cable;
+        return true;
+    }
+
+    template <typename F>
+    void ForEachDevice(F f) const
+    {
+        for (size_t i = 0; i < maxDevices; i++) {
+            if (Device *d = deviceSlots[i].load(std::memory_order_acquire))
+                f(d);
+        }
+    }
+
+    /// Block until no ReadGuard is alive.
+    void WaitForReaders() const
+    {
+        while (readers.load() != 0)
+            std::this_thread::yield();
+    }
+
+    /// Registered devices in the order they were added (owner's lock).
+    const std::vector<Device *> &Devices() const { return devices; }
+    size_t PortCount() const { return maxPorts - freePorts.size(); }
+    size_t MaxDevices() const { return maxDevices; }
+    size_t MaxPorts() const { return maxPorts; }
+
+private:
+    struct PortSlot {
+        std::atomic<PortHandle> handle{0};   // 0 = free
+        Device  *device     = nullptr;
+        uint8_t  cable      = 0;
+        uint16_t generation = 0;
+    };
+
+    const size_t maxDevices;
+    const size_t maxPorts;
+    std::unique_ptr<std::atomic<Device *>[]> deviceSlots;
+    std::unique_ptr<PortSlot[]> portSlots;
+
+    std::vector<Device *>  devices;
+    std::vector<Device *>  offline;     // Oldest first
+    std::vector<uint16_t>  freePorts;
+    mutable std::atomic<uint32_t> readers{0};
+};
+
+#endif /* DeviceRegistry_h */
@@ -0,0 +1,115 @@
+#include "FrameClock.h"
+#include <math.h>
+
+// ---------- FrameClockDLL ----------
+
+FrameClockDLL::FrameClockDLL(uint64_t nominalPeriodNs)
+    : nominal(nominalPeriodNs), period((double)nominalPeriodNs)
+{
+}
+
+void FrameClockDLL::Reset()
+{
+    period = (double)nominal;
+    baseFrame = 0;
+    baseHost = 0;
+    updates = 0;
+    outlierRun = 0;
+}
+
+void FrameClockDLL::Observe(uint64_t frame, uint64_t hostNs)
+{
+    if (updates == 0 || frame <= baseFrame) {
+        // First observation, or the counter went backwards (bus reset)
+        if (updates != 0 && frame < baseFrame) Reset();
+        if (updates == 0) {
+            baseFrame = frame;
+            baseHost = (double)hostNs;
+            updates = 1;
+        }
+        return;
+    }
+
+    double frames = (double)(frame - baseFrame);
+    double predicted = baseHost + frames * period;
+    double error = (double)hostNs - predicted;
+
+    if (Locked() && fabs(error) > kOutlierFrames * period) {
+        outliers++;
+        if (++outlierRun < kRelockAfter) return;
+        // Persistent disagreement: start over from this observation
+        Reset();
+        baseFrame = frame;
+        baseHost = (double)hostNs;
+        updates = 1;
+        return;
+    }
+    outlierRun = 0;
+
+    // Faster acquisition until locked, then the narrow loop
+    double gain = Locked() ? kPhaseGain : 0.5;
+    baseFrame = frame;
+    baseHost = predicted + gain * error;
+    period += (gain * gain / 2) * error / (frames > kPeriodSpan ? frames : kPeriodSpan);
+
+    double limit = (double)nominal * kMaxDriftPpm / 1e6;
+    if (period > (double)nominal + limit) period = (double)nominal + limit;
+    if (period < (double)nominal - limit) period = (double)nominal - limit;
+    updates++;
+}
+
+uint64_t FrameClockDLL::FrameToHost(double frame) const
+{
+    double t = baseHost + (frame - (double)baseFrame) * period;
+    return t > 0 ? (uint64_t)llround(t) : 0;
+}
+
+double FrameClockDLL::HostToFrame(uint64_t hostNs) const
+{
+    return (double)baseFrame + ((double)hostNs - baseHost) / period;
+}
+
+// ---------- InboundTimestamper ----------
+
+InboundTimestamper::InboundTimestamper(uint64_t nominalPeriodNs)
+    : dll(nominalPeriodNs)
+{
+}
+
+void InboundTimestamper::Reset()
+{
+    dll.Reset();
+    completion = 0;
+    step = 0;
+    count = 0;
+    lastEvent = 0;
+}
+
+void InboundTimestamper::BeginTransfer(uint64_t frame, uint64_t fallbackNs, uint32_t eventCount,
+                                       uint64_t spacingNs)
+{
+    completion = dll.Locked() && frame != kNoFrame ? dll.FrameToHost((double)frame) : fallbackNs;
+    count = eventCount;
+    if (completion <= lastEvent)
+        completion = lastEvent + 1;
+
+    // Events arrived over at least the last frame, and no faster than the wire
+    uint64_t framePeriod = (uint64_t)dll.PeriodNs();
+    step = 0;
+    if (count > 1) {
+        step = framePeriod / count;
+        if (spacingNs > step) step = spacingNs;
+        // Not before the previous transfer's last event
+        uint64_t room = completion - lastEvent - 1;
+        if (lastEvent && step * (count - 1) > room)
+            step = room / (count - 1);
+    }
+    if (count)
+        lastEvent = completion;
+}
+
+uint64_t InboundTimestamper::EventTime(uint32_t index) const
+{
+    if (index >= count) return completion;
+    return completion - (uint64_t)(count - 1 - index) * step;
+}
@@ -0,0 +1,95 @@
+#ifndef FrameClock_h
+#define FrameClock_h
+
+#include <stdint.h>
+
+static constexpr uint64_t kUSBFramePeriodNs = 1000000;   // Full-speed SOF, 1 kHz
+
+/// Delay-locked loop mapping the USB bus frame counter to host time.
+///
+/// Each observation pairs a frame number with the host time at which the
+/// controller reports that frame started. The raw pairs jitter (the host
+/// time is sampled in software) and the bus clock drifts against the host
+/// clock by tens of ppm; the loop keeps a smoothed phase and period so
+/// FrameToHost() is stable to a few microseconds. Second-order loop as used
+/// for audio period timing: the phase follows with gain kPhaseGain, the
+/// period with kPhaseGain^2 / 2 per frame of error (gaps shorter than
+/// kPeriodSpan count as kPeriodSpan). Observations more than
+/// kOutlierFrames off the prediction are ignored unless they persist, in
+/// which case the loop re-locks (bus reset, sleep/wake).
+class FrameClockDLL {
+public:
+    explicit FrameClockDLL(uint64_t nominalPeriodNs = kUSBFramePeriodNs);
+
+    void Reset();
+    void Observe(uint64_t frame, uint64_t hostNs);
+
+    /// Enough observations for the mapping to be trusted.
+    bool Locked() const { return updates >= kLockUpdates; }
+
+    /// Host time at which a (possibly fractional) frame starts.
+    uint64_t FrameToHost(double frame) const;
+    double   HostToFrame(uint64_t hostNs) const;
+
+    double PeriodNs() const { return period; }
+    /// Bus clock rate against the host clock, parts per million (+ = slow bus).
+    double DriftPpm() const { return (period / (double)nominal - 1.0) * 1e6; }
+    uint64_t Outliers() const { return outliers; }
+
+    static constexpr double   kPhaseGain     = 0.05;
+    static constexpr uint32_t kLockUpdates   = 16;
+    static constexpr double   kOutlierFrames = 0.5;
+    static constexpr uint32_t kRelockAfter   = 8;     // Outliers in a row
+    static constexpr double   kMaxDriftPpm   = 1000;
+    static constexpr double   kPeriodSpan    = 32;    // Frames; shorter gaps say little about the rate
+
+private:
+    uint64_t nominal;
+    double   period;
+    uint64_t baseFrame = 0;
+    double   baseHost  = 0;     // Smoothed host time of baseFrame
+    uint32_t updates   = 0;
+    uint32_t outlierRun = 0;
+    uint64_t outliers  = 0;
+};
+
+/// Spreads the events of one completed bulk IN transfer over the time they
+/// arrived, instead of giving all of them the completion time.
+///
+/// The transfer is taken to complete at the start of the frame in which the
+/// completion was seen (DLL time, so sub-frame scheduling delay and clock
+/// sampling jitter drop out). Earlier events are placed before it at their
+/// wire spacing (at least frame period / events for USB-native ports, the
+/// DIN byte time for 5-pin inputs), never before the previous transfer's
+/// last event, so times stay monotonic.
+class InboundTimestamper {
+public:
+    static constexpr uint64_t kNoFrame = UINT64_MAX;
+
+    explicit InboundTimestamper(uint64_t nominalPeriodNs = kUSBFramePeriodNs);
+
+    void Reset();
+
+    /// Bus frame reference (frame number and the host time it started).
+    void OnFrameReference(uint64_t frame, uint64_t hostNs) { dll.Observe(frame, hostNs); }
+
+    /// A transfer completed in `frame`; fallbackNs (the callback time) is
+    /// used until the DLL has locked or when the frame is kNoFrame.
+    /// spacingNs is the minimum time between two events on the wire
+    /// (0 = USB speed).
+    void BeginTransfer(uint64_t frame, uint64_t fallbackNs, uint32_t eventCount, uint64_t spacingNs);
+
+    /// Host time of event `index` (0-based) of the current transfer.
+    uint64_t EventTime(uint32_t index) const;
+
+    const FrameClockDLL &Clock() const { return dll; }
+
+private:
+    FrameClockDLL dll;
+    uint64_t completion = 0;
+    uint64_t step       = 0;
+    uint32_t count      = 0;
+    uint64_t lastEvent  = 0;    // Last event time handed out
+};
+
+#endif /* FrameClock_h */
@@ -0,0 +1,31 @@
+#ifndef HostClock_h
+#define HostClock_h
+
+#include <stdint.h>
+#include <chrono>
+
+/// Monotonic time source for the portable core. The driver uses the steady
+/// clock; tests substitute a manually advanced clock.
+class HostClock {
+public:
+    virtual ~HostClock() = default;
+    virtual uint64_t NowNanos() const = 0;
+};
+
+class SteadyHostClock : public HostClock {
+public:
+    uint64_t NowNanos() const override
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/// Process-wide steady clock instance.
+inline HostClock &DefaultHostClock()
+{
+    static SteadyHostClock sClock;
+    return sClock;
+}
+
+#endif /* HostClock_h */
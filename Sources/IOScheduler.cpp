@@ -0,0 +1,209 @@
+#include "IOScheduler.h"
+#include <algorithm>
+#include <pthread.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#else
+#include <sched.h>
+#endif
+
+bool ApplyIOThreadPolicy(const IOThreadPolicy &policy)
+{
+    if (policy.computationNs == 0)
+        return true;
+
+#ifdef __APPLE__
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double nsToAbs = (double)timebase.denom / (double)timebase.numer;
+
+    thread_time_constraint_policy_data_t tc;
+    tc.period      = (uint32_t)((double)policy.periodNs * nsToAbs);
+    tc.computation = (uint32_t)((double)policy.computationNs * nsToAbs);
+    tc.constraint  = (uint32_t)((double)policy.constraintNs * nsToAbs);
+    tc.preemptible = true;
+
+    return thread_policy_set(mach_thread_self(), THREAD_TIME_CONSTRAINT_POLICY,
+                             (thread_policy_t)&tc,
+                             THREAD_TIME_CONSTRAINT_POLICY_COUNT) == KERN_SUCCESS;
+#else
+    // No deadline scheduling to map onto: a mid-range FIFO priority keeps
+    // the thread ahead of ordinary work without starving the kernel's own
+    sched_param param = {};
+    int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+    param.sched_priority = lo + (hi - lo) / 2;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
+
+void SetIOThreadName(const char *name)
+{
+    if (!name) return;
+#ifdef __APPLE__
+    pthread_setname_np(name);
+#else
+    char shortName[16];   // Linux limit, including the terminator
+    strncpy(shortName, name, sizeof(shortName) - 1);
+    shortName[sizeof(shortName) - 1] = '\0';
+    pthread_setname_np(pthread_self(), shortName);
+#endif
+}
+
+// ---------- IOScheduler ----------
+
+void IOScheduler::PostAndWait(Task task)
+{
+    if (!IsRunning() || IsCurrentThread()) {
+        task();
+        return;
+    }
+
+    std::mutex doneMutex;
+    std::condition_variable doneCond;
+    bool done = false;
+    Post([&] {
+        task();
+        std::lock_guard<std::mutex> lock(doneMutex);
+        done = true;
+        doneCond.notify_one();
+    });
+
+    // Stop() drops tasks that have not run; don't wait forever for one of them
+    std::unique_lock<std::mutex> lock(doneMutex);
+    while (!done && IsRunning())
+        doneCond.wait_for(lock, std::chrono::milliseconds(10));
+}
+
+// ---------- ThreadIOScheduler ----------
+
+ThreadIOScheduler::ThreadIOScheduler(HostClock *clock)
+    : clock(clock)
+{
+}
+
+ThreadIOScheduler::~ThreadIOScheduler()
+{
+    Stop();
+}
+
+bool ThreadIOScheduler::Later(const Timer &a, const Timer &b)
+{
+    return a.due > b.due || (a.due == b.due && a.id > b.id);
+}
+
+bool ThreadIOScheduler::Start(const char *name, const IOThreadPolicy &policy)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (running) return true;
+    running = true;
+    started = false;
+    thread = std::thread(&ThreadIOScheduler::ThreadMain, this,
+                         std::string(name ? name : ""), policy);
+    cond.wait(lock, [this] { return started; });
+    return true;
+}
+
+void ThreadIOScheduler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    cond.notify_all();
+    if (thread.joinable())
+        thread.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.clear();
+    timers.clear();
+    threadID = std::thread::id();
+}
+
+void ThreadIOScheduler::Post(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        tasks.push_back(std::move(task));
+    }
+    cond.notify_all();
+}
+
+IOScheduler::TimerID ThreadIOScheduler::PostAfter(uint64_t delayNs, Task task)
+{
+    TimerID id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextTimerID++;
+        if (!running) return id;
+        timers.push_back({ clock->NowNanos() + delayNs, id, std::move(task) });
+        std::push_heap(timers.begin(), timers.end(), Later);
+    }
+    cond.notify_all();
+    return id;
+}
+
+bool ThreadIOScheduler::Cancel(TimerID id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(timers.begin(), timers.end(),
+                           [id](const Timer &t) { return t.id == id; });
+    if (it == timers.end()) return false;
+    timers.erase(it);
+    std::make_heap(timers.begin(), timers.end(), Later);
+    return true;
+}
+
+bool ThreadIOScheduler::IsRunning() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+}
+
+bool ThreadIOScheduler::IsCurrentThread() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running && std::this_thread::get_id() == threadID;
+}
+
+void ThreadIOScheduler::ThreadMain(std::string name, IOThreadPolicy policy)
+{
+    SetIOThreadName(name.c_str());
+    bool applied = ApplyIOThreadPolicy(policy);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    threadID = std::this_thread::get_id();
+    policyApplied = applied;
+    started = true;
+    cond.notify_all();
+
+    std::vector<Task> batch;
+    while (running) {
+        // Posted tasks first, in order, then every timer that is due
+        batch.swap(tasks);
+        uint64_t now = clock->NowNanos();
+        while (!timers.empty() && timers.front().due <= now) {
+            std::pop_heap(timers.begin(), timers.end(), Later);
+            batch.push_back(std::move(timers.back().task));
+            timers.pop_back();
+        }
+
+        if (!batch.empty()) {
+            lock.unlock();
+            for (auto &task : batch) task();
+            batch.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (timers.empty())
+            cond.wait(lock);
+        else
+            cond.wait_for(lock, std::chrono::nanoseconds(timers.front().due - now));
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef IOScheduler_h
+#define IOScheduler_h
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HostClock.h"
+
+/// Scheduling class for a driver-owned I/O thread. On macOS a non-zero
+/// computation time selects the Mach time-constraint policy; elsewhere it
+/// asks for SCHED_FIFO. All zero leaves the thread at normal priority.
+struct IOThreadPolicy {
+    uint64_t periodNs      = 0;   // Expected wakeup period (0 = aperiodic)
+    uint64_t computationNs = 0;   // CPU time needed per wakeup
+    uint64_t constraintNs  = 0;   // Deadline for that work after the wakeup
+};
+
+/// Apply a policy to the calling thread. Returns false if the OS refused
+/// (e.g. no privilege for SCHED_FIFO); the thread then keeps running at
+/// its current priority.
+bool ApplyIOThreadPolicy(const IOThreadPolicy &policy);
+
+/// Name the calling thread for debuggers and profilers.
+void SetIOThreadName(const char *name);
+
+/// One thread that services a device's I/O: posted tasks and one-shot
+/// timers run there in order, never concurrently with each other.
+///
+/// The driver uses a CFRunLoop-backed implementation so IOKit async event
+/// sources can be attached to the same thread; ThreadIOScheduler is the
+/// portable implementation used on Linux and by the tests.
+class IOScheduler {
+public:
+    using Task    = std::function<void()>;
+    using TimerID = uint64_t;
+
+    virtual ~IOScheduler() = default;
+
+    /// Spawn the thread and apply the policy on it. Returns once the thread
+    /// is ready to accept work.
+    virtual bool Start(const char *name, const IOThreadPolicy &policy) = 0;
+    /// Cancel timers, drop tasks that have not run yet and join the thread.
+    /// Must not be called from the I/O thread itself.
+    virtual void Stop() = 0;
+
+    virtual void Post(Task task) = 0;
+    /// Run a task once after delayNs. Returns an id for Cancel (never 0).
+    virtual TimerID PostAfter(uint64_t delayNs, Task task) = 0;
+    /// Returns false if the timer has already fired or was cancelled.
+    virtual bool Cancel(TimerID id) = 0;
+
+    virtual bool IsRunning() const = 0;
+    virtual bool IsCurrentThread() const = 0;
+    /// Whether Start() managed to apply the requested policy.
+    virtual bool PolicyApplied() const = 0;
+
+    /// Run a task on the I/O thread and wait for it to finish; runs inline
+    /// when called from the I/O thread or when the scheduler is stopped.
+    void PostAndWait(Task task);
+};
+
+/// Portable IOScheduler on a std::thread with a condition variable and a
+/// timer heap.
+class ThreadIOScheduler : public IOScheduler {
+public:
+    explicit ThreadIOScheduler(HostClock *clock = &DefaultHostClock());
+    ~ThreadIOScheduler() override;
+
+    bool Start(const char *name, const IOThreadPolicy &policy) override;
+    void Stop() override;
+
+    void Post(Task task) override;
+    TimerID PostAfter(uint64_t delayNs, Task task) override;
+    bool Cancel(TimerID id) override;
+
+    bool IsRunning() const override;
+    bool IsCurrentThread() const override;
+    bool PolicyApplied() const override { return policyApplied; }
+
+private:
+    struct Timer {
+        uint64_t due;
+        TimerID  id;
+        Task     task;
+    };
+
+    static bool Later(const Timer &a, const Timer &b);   // Heap order
+    void ThreadMain(std::string name, IOThreadPolicy policy);
+
+    HostClock *clock;
+
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<Task>  tasks;
+    std::vector<Timer> timers;     // Min-heap on (due, id)
+    TimerID nextTimerID = 1;
+    bool running        = false;
+    bool started        = false;
+    bool policyApplied  = false;
+    std::thread thread;
+    std::thread::id threadID;
+};
+
+#endif /* IOScheduler_h */
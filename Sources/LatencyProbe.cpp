@@ -0,0 +1,206 @@
+#include "LatencyProbe.h"
+#include <algorithm>
+#include <math.h>
+
+static const uint8_t kIdentityRequest[] = { 0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7 };
+// 7D = non-commercial ID, "RL"; four 7-bit sequence bytes follow
+static const uint8_t kLoopbackID[] = { 0xF0, 0x7D, 0x52, 0x4C };
+
+static bool IsIdentityRequest(const uint8_t *m, uint32_t length)
+{
+    return length >= 5 && m[0] == 0xF0 && m[1] == 0x7E && m[3] == 0x06 && m[4] == 0x01;
+}
+
+static bool IsIdentityReply(const uint8_t *m, uint32_t length)
+{
+    return length >= 5 && m[1] == 0x7E && m[3] == 0x06 && m[4] == 0x02;
+}
+
+static bool IsLoopbackProbe(const uint8_t *m, uint32_t length)
+{
+    return length == 8 && std::equal(kLoopbackID, kLoopbackID + sizeof(kLoopbackID), m);
+}
+
+LatencyProbe::LatencyProbe(HostClock *clock)
+    : clock(clock)
+{
+}
+
+void LatencyProbe::SetConfig(const LatencyProbeConfig &newConfig)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    config = newConfig;
+    config.window = std::max<uint32_t>(1, config.window);
+    for (Cable &c : cables) {
+        LatencyProbeMode mode = c.mode;
+        c = Cable();
+        c.mode = mode;
+        if (mode != LatencyProbeMode::Off)
+            c.samples.assign(config.window, 0);
+    }
+}
+
+LatencyProbeConfig LatencyProbe::GetConfig() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+void LatencyProbe::SetMode(uint8_t cable, LatencyProbeMode mode)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Cable &c = cables[cable & 0x0F];
+    if (c.mode == mode) return;
+    c = Cable();
+    c.mode = mode;
+    if (mode != LatencyProbeMode::Off)
+        c.samples.assign(config.window, 0);
+}
+
+LatencyProbeMode LatencyProbe::GetMode(uint8_t cable) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cables[cable & 0x0F].mode;
+}
+
+void LatencyProbe::Expire(Cable &c, uint64_t now)
+{
+    if (!c.inFlight || now - c.sentNs < config.timeoutNs) return;
+    c.inFlight = false;
+    c.timedOut = true;
+    c.quietUntil = c.sentNs + 2 * config.timeoutNs;
+    c.stats.timeouts++;
+}
+
+bool LatencyProbe::NextProbe(uint8_t cable, std::vector<uint8_t> &msg)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Cable &c = cables[cable & 0x0F];
+    if (c.mode == LatencyProbeMode::Off) return false;
+
+    uint64_t now = clock->NowNanos();
+    Expire(c, now);
+    if (c.inFlight || now < c.quietUntil) return false;
+
+    if (c.mode == LatencyProbeMode::Identity) {
+        msg.assign(kIdentityRequest, kIdentityRequest + sizeof(kIdentityRequest));
+    } else {
+        c.sequence = (c.sequence + 1) & 0x0FFFFFFF;
+        msg.assign(kLoopbackID, kLoopbackID + sizeof(kLoopbackID));
+        for (int shift = 21; shift >= 0; shift -= 7)
+            msg.push_back((uint8_t)(c.sequence >> shift & 0x7F));
+        msg.push_back(0xF7);
+    }
+    c.inFlight = true;
+    c.timedOut = false;
+    c.sentNs = now;
+    c.stats.probes++;
+    return true;
+}
+
+void LatencyProbe::ObserveOutbound(uint8_t cable, const uint8_t *bytes, uint32_t length)
+{
+    if (!length || bytes[0] != 0xF0) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Cable &c = cables[cable & 0x0F];
+    if (c.mode != LatencyProbeMode::Identity || !c.inFlight
+        || !IsIdentityRequest(bytes, length))
+        return;
+
+    // Two requests, two indistinguishable replies: neither is credited
+    c.inFlight = false;
+    c.quietUntil = clock->NowNanos() + config.timeoutNs;
+    c.stats.voided++;
+}
+
+void LatencyProbe::ObserveInbound(uint8_t cable, const uint8_t *bytes, uint32_t length,
+                                  uint64_t whenNs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Cable &c = cables[cable & 0x0F];
+    if (c.mode == LatencyProbeMode::Off) return;
+
+    for (uint32_t i = 0; i < length; i++) {
+        uint8_t b = bytes[i];
+        if (b >= 0xF8) continue;   // Real-time may interleave
+        if (b == 0xF0) {
+            c.open = true;
+            c.head[0] = b;
+            c.headLength = 1;
+            c.startNs = whenNs;
+        } else if (b == 0xF7) {
+            if (c.open) OnReply(c);
+            c.open = false;
+        } else if (b & 0x80) {
+            c.open = false;
+        } else if (c.open && c.headLength < kHeadBytes) {
+            c.head[c.headLength++] = b;
+        } else if (c.open) {
+            c.headLength = kHeadBytes + 1;   // Longer than any probe
+        }
+    }
+}
+
+void LatencyProbe::OnReply(Cable &c)
+{
+    bool matched;
+    if (c.mode == LatencyProbeMode::Identity) {
+        if (!IsIdentityReply(c.head, std::min(c.headLength, kHeadBytes))) return;
+        // Untagged: whatever answers while the probe is in flight
+        Expire(c, c.startNs);
+        matched = c.inFlight && c.startNs >= c.sentNs;
+        if (!matched) {
+            // Anything else is a client's reply, bar one per timed-out probe
+            if (c.timedOut) c.stats.late++;
+            c.timedOut = false;
+            return;
+        }
+    } else {
+        if (!IsLoopbackProbe(c.head, c.headLength)) return;
+        uint32_t sequence = 0;
+        for (uint32_t i = 4; i < 8; i++) sequence = sequence << 7 | c.head[i];
+        Expire(c, c.startNs);
+        matched = c.inFlight && sequence == c.sequence;
+        if (!matched) {
+            c.stats.late++;
+            return;
+        }
+    }
+
+    uint64_t roundTrip = c.startNs - c.sentNs;
+    c.samples[c.next] = roundTrip;
+    c.next = (c.next + 1) % (uint32_t)c.samples.size();
+    c.inFlight = false;
+    c.stats.replies++;
+}
+
+LatencyProbeStats LatencyProbe::GetStats(uint8_t cable) const
+{
+    std::vector<uint64_t> window;
+    LatencyProbeStats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Cable &c = cables[cable & 0x0F];
+        s = c.stats;
+        size_t n = (size_t)std::min<uint64_t>(s.replies, c.samples.size());
+        window.assign(c.samples.begin(), c.samples.begin() + n);
+    }
+    s.samples = (uint32_t)window.size();
+    if (window.empty()) return s;
+
+    std::sort(window.begin(), window.end());
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)ceil(p * window.size());
+        return window[std::max<size_t>(rank, 1) - 1] / 1000.0;
+    };
+    double sum = 0;
+    for (uint64_t v : window) sum += (double)v;
+    s.minUs  = window.front() / 1000.0;
+    s.maxUs  = window.back() / 1000.0;
+    s.meanUs = sum / window.size() / 1000.0;
+    s.p50Us  = percentile(0.50);
+    s.p95Us  = percentile(0.95);
+    s.p99Us  = percentile(0.99);
+    return s;
+}
@@ -0,0 +1,107 @@
+#ifndef LatencyProbe_h
+#define LatencyProbe_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+#include "HostClock.h"
+#include "USBMIDIParser.h"
+
+/// What a probe sends and what counts as its answer.
+enum class LatencyProbeMode : uint8_t {
+    Off      = 0,
+    Identity = 1,   // Universal Identity Request, answered by the device itself
+    Loopback = 2,   // Tagged F0 7D 52 4C .. F7, echoed by a cable from MIDI OUT to IN
+};
+
+struct LatencyProbeConfig {
+    uint64_t timeoutNs = 500000000;   // A probe unanswered this long is a timeout
+    uint32_t window    = 256;         // Latest round trips kept per cable for the distribution
+};
+
+struct LatencyProbeStats {
+    uint64_t probes   = 0;   // Sent
+    uint64_t replies  = 0;   // Matched to the probe in flight
+    uint64_t timeouts = 0;
+    uint64_t voided   = 0;   // A client's identity request made the reply ambiguous
+    uint64_t late     = 0;   // Answers to probes that had already timed out
+    uint32_t samples  = 0;   // Round trips in the window below
+    double   minUs    = 0;
+    double   meanUs   = 0;
+    double   p50Us    = 0;
+    double   p95Us    = 0;
+    double   p99Us    = 0;
+    double   maxUs    = 0;
+};
+
+/// Round-trip latency measurement for the cables of one device.
+///
+/// One probe is in flight per cable. Loopback probes carry a 28-bit sequence
+/// number, so an echo is only credited to the probe it belongs to. An
+/// identity request carries no tag: its reply is credited to the probe in
+/// flight, a client's own identity request on the cable voids that probe,
+/// and after a timeout the cable stays quiet for another timeout so a late
+/// reply cannot be credited to the next probe.
+///
+/// The round trip runs from NextProbe() (the time the probe is queued, as a
+/// client's send would be) to the receive timestamp of the reply's F0.
+/// Thread-safe: probes go out from the driver's timer and replies arrive
+/// on the device's I/O thread.
+class LatencyProbe {
+public:
+    explicit LatencyProbe(HostClock *clock = &DefaultHostClock());
+
+    /// Applies the config and clears every cable's results.
+    void SetConfig(const LatencyProbeConfig &config);
+    LatencyProbeConfig GetConfig() const;
+
+    /// Switch probing on a cable; a change of mode clears its results.
+    void SetMode(uint8_t cable, LatencyProbeMode mode);
+    LatencyProbeMode GetMode(uint8_t cable) const;
+
+    /// If a cable may be probed now, fill `msg` with the probe, take the
+    /// send time and return true; the caller then sends it on the cable.
+    bool NextProbe(uint8_t cable, std::vector<uint8_t> &msg);
+
+    /// One client MIDIPacket sent on a cable.
+    void ObserveOutbound(uint8_t cable, const uint8_t *bytes, uint32_t length);
+    /// MIDI bytes received on a cable, in any split, with their receive time.
+    void ObserveInbound(uint8_t cable, const uint8_t *bytes, uint32_t length, uint64_t whenNs);
+
+    LatencyProbeStats GetStats(uint8_t cable) const;
+
+private:
+    // Enough of a reply to recognise it: F0 7E id 06 02 / F0 7D 52 4C s s s s
+    static constexpr uint32_t kHeadBytes = 8;
+
+    struct Cable {
+        LatencyProbeMode mode = LatencyProbeMode::Off;
+        bool     inFlight   = false;
+        bool     timedOut   = false;   // Last probe expired; its reply may still come
+        uint32_t sequence   = 0;       // Of the probe in flight or last sent
+        uint64_t sentNs     = 0;
+        uint64_t quietUntil = 0;       // No probe before this (after a timeout)
+
+        // Inbound SysEx head
+        uint8_t  head[kHeadBytes] = {};
+        uint32_t headLength = 0;
+        bool     open       = false;
+        uint64_t startNs    = 0;
+
+        std::vector<uint64_t> samples;   // Ring of round trips (ns)
+        uint32_t next = 0;
+        LatencyProbeStats stats;
+    };
+
+    void Expire(Cable &c, uint64_t now);
+    void OnReply(Cable &c);
+
+    HostClock *clock;
+    LatencyProbeConfig config;
+
+    mutable std::mutex mutex;
+    Cable cables[kUSBMIDINumCables];
+};
+
+#endif /* LatencyProbe_h */
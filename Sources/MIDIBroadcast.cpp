@@ -0,0 +1,98 @@
+#include "MIDIBroadcast.h"
+#include <algorithm>
+
+MIDIBroadcast::MIDIBroadcast(HostClock *clock, const BufferPoolConfig &poolConfig)
+    : clock(clock)
+{
+    pool.Reserve(poolConfig);
+}
+
+void MIDIBroadcast::SetGroups(std::vector<MIDIBroadcastGroup> newGroups)
+{
+    std::vector<Group> next;
+    next.reserve(newGroups.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (MIDIBroadcastGroup &g : newGroups) {
+        g.members.erase(std::remove_if(g.members.begin(), g.members.end(),
+                                       [](const MIDIBroadcastMember &m) {
+                                           return !m.target || m.cable >= kUSBMIDINumCables;
+                                       }),
+                        g.members.end());
+        Group group;
+        group.id = g.id;
+        group.members = std::move(g.members);
+
+        // A group that stays keeps its batch, and with it an open SysEx
+        auto old = std::find_if(groups.begin(), groups.end(),
+                                [&](const Group &o) { return o.id == g.id && o.batch; });
+        if (old != groups.end())
+            group.batch = std::move(old->batch);
+        else
+            group.batch = std::make_unique<MIDIMessageBatch>(&pool);
+        next.push_back(std::move(group));
+    }
+    std::sort(next.begin(), next.end(), [](const Group &a, const Group &b) { return a.id < b.id; });
+    next.erase(std::unique(next.begin(), next.end(),
+                           [](const Group &a, const Group &b) { return a.id == b.id; }),
+               next.end());
+    groups = std::move(next);
+}
+
+size_t MIDIBroadcast::GroupCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return groups.size();
+}
+
+size_t MIDIBroadcast::MemberCount(uint32_t group) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const Group *g = Find(group);
+    return g ? g->members.size() : 0;
+}
+
+const MIDIBroadcast::Group *MIDIBroadcast::Find(uint32_t id) const
+{
+    auto it = std::lower_bound(groups.begin(), groups.end(), id,
+                               [](const Group &g, uint32_t key) { return g.id < key; });
+    return (it != groups.end() && it->id == id) ? &*it : nullptr;
+}
+
+uint32_t MIDIBroadcast::Send(uint32_t group, const uint8_t *data, uint32_t length)
+{
+    if (!data || length == 0) return 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const Group *g = Find(group);
+    if (!g || g->members.empty()) return 0;
+
+    // Split once; every member queues the same entries
+    MIDIMessageBatch &batch = *g->batch;
+    batch.Add(data, length);
+    if (batch.Empty()) return 0;
+
+    uint32_t queued = 0;
+    uint64_t start = clock->NowNanos();
+    for (const MIDIBroadcastMember &m : g->members) {
+        if (m.target->EnqueueBatch(m.cable, batch)) {
+            stats.delivered++;
+            queued++;
+        } else {
+            stats.dropped++;
+        }
+    }
+    uint64_t fanOut = clock->NowNanos() - start;
+    batch.Clear();
+
+    stats.sends++;
+    stats.lastFanOutNs = fanOut;
+    stats.maxFanOutNs = std::max(stats.maxFanOutNs, fanOut);
+    return queued;
+}
+
+MIDIBroadcastStats MIDIBroadcast::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,82 @@
+#ifndef MIDIBroadcast_h
+#define MIDIBroadcast_h
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BufferPool.h"
+#include "HostClock.h"
+#include "MIDIMessageBatch.h"
+
+/// One device a broadcast group reaches, on one of its cables.
+struct MIDIBroadcastMember {
+    MIDIBatchTarget *target = nullptr;
+    uint8_t          cable  = 0;
+};
+
+/// A broadcast destination: every member receives what is sent to it.
+struct MIDIBroadcastGroup {
+    uint32_t id = 0;                             // Caller-chosen, unique
+    std::vector<MIDIBroadcastMember> members;
+};
+
+struct MIDIBroadcastStats {
+    uint64_t sends     = 0;   // Packets sent to a group with members
+    uint64_t delivered = 0;   // Queued on a member (counted per member)
+    uint64_t dropped   = 0;   // A member's queue was full
+    uint64_t lastFanOutNs = 0;   // First to last member queued, last send
+    uint64_t maxFanOutNs  = 0;
+};
+
+/// Broadcast destinations for racks of modules: the same output queued on
+/// every member of a group, e.g. all devices or all units of one model.
+///
+/// Send() splits a packet once into a MIDIMessageBatch, SysEx going into
+/// the broadcaster's own pool, and hands that batch to each member in turn.
+/// Members share the SysEx buffers, so reaching the last one costs a queue
+/// push per message rather than a copy of the data, and each member's
+/// transmitter thread starts writing as soon as its batch is queued. Groups
+/// are replaced as a whole by SetGroups(); a group that stays keeps its
+/// open SysEx, if any, and a member that joined after it started is not
+/// sent the rest (MIDITransmitter drops a continuation on a cable without
+/// an open SysEx). Sends and group changes are serialised by a mutex.
+/// Members must stay alive while they are in a group, and the broadcaster
+/// must outlive the queues holding its buffers.
+class MIDIBroadcast {
+public:
+    explicit MIDIBroadcast(HostClock *clock = &DefaultHostClock(),
+                           const BufferPoolConfig &poolConfig = BufferPoolConfig());
+
+    MIDIBroadcast(const MIDIBroadcast &) = delete;
+    MIDIBroadcast &operator=(const MIDIBroadcast &) = delete;
+
+    void SetGroups(std::vector<MIDIBroadcastGroup> groups);
+    size_t GroupCount() const;
+    /// Members of a group (0 if there is no such group).
+    size_t MemberCount(uint32_t group) const;
+
+    /// Queue the MIDI bytes of one MIDIPacket on every member of a group.
+    /// Returns the number of members it was queued on.
+    uint32_t Send(uint32_t group, const uint8_t *data, uint32_t length);
+
+    MIDIBroadcastStats GetStats() const;
+    BufferPoolStats GetPoolStats() const { return pool.GetStats(); }
+
+private:
+    struct Group {
+        uint32_t id = 0;
+        std::vector<MIDIBroadcastMember> members;
+        std::unique_ptr<MIDIMessageBatch> batch;   // Reused; carries an open SysEx
+    };
+
+    const Group *Find(uint32_t id) const;
+
+    HostClock *clock;
+    BufferPool pool;
+    mutable std::mutex mutex;
+    std::vector<Group> groups;   // Sorted by id
+    MIDIBroadcastStats stats;
+};
+
+#endif /* MIDIBroadcast_h */
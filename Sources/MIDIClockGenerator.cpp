@@ -0,0 +1,309 @@
+#include "MIDIClockGenerator.h"
+#include <math.h>
+
+static constexpr uint8_t kClockControlID[] = { 0xF0, 0x7D, 0x52, 0x43 };
+
+bool ParseMIDIClockControl(const uint8_t *data, uint32_t length, MIDIClockControl &control)
+{
+    if (!data || length < 6 || data[length - 1] != 0xF7) return false;
+    for (uint32_t i = 0; i < sizeof(kClockControlID); i++)
+        if (data[i] != kClockControlID[i]) return false;
+
+    switch (data[4]) {
+    case 0x01: control.command = MIDIClockCommand::Start;    return length == 6;
+    case 0x02: control.command = MIDIClockCommand::Stop;     return length == 6;
+    case 0x03: control.command = MIDIClockCommand::Continue; return length == 6;
+    case 0x05: control.command = MIDIClockCommand::ClockOn;  return length == 6;
+    case 0x06: control.command = MIDIClockCommand::ClockOff; return length == 6;
+    case 0x04: {
+        if (length != 9 || (data[5] | data[6] | data[7]) & 0x80) return false;
+        uint32_t centiBPM = data[5] | (uint32_t)data[6] << 7 | (uint32_t)data[7] << 14;
+        control.command = MIDIClockCommand::Tempo;
+        control.bpm = centiBPM / 100.0;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+MIDIClockGenerator::MIDIClockGenerator(HostClock *clock)
+    : clock(clock), io(clock)
+{
+}
+
+MIDIClockGenerator::~MIDIClockGenerator()
+{
+    StopThread();
+}
+
+void MIDIClockGenerator::SetConfig(const MIDIClockGeneratorConfig &config)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->config = config;
+}
+
+void MIDIClockGenerator::SetTargets(const std::vector<MIDIClockTarget> &targets)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Output> next;
+    next.reserve(targets.size());
+    for (const auto &t : targets) {
+        if (!t.target) continue;
+        bool known = false;
+        for (const auto &o : outputs) {
+            if (o.target == t.target && o.cable == t.cable) {
+                next.push_back(o);
+                known = true;
+                break;
+            }
+        }
+        if (!known)
+            next.push_back({ t.target, (uint8_t)(t.cable & 0x0F), playing ? Sync::Position : Sync::None });
+    }
+    outputs.swap(next);
+}
+
+size_t MIDIClockGenerator::TargetCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return outputs.size();
+}
+
+void MIDIClockGenerator::SetTempo(double bpm)
+{
+    if (!(bpm >= kMinClockBPM)) bpm = kMinClockBPM;
+    if (bpm > kMaxClockBPM) bpm = kMaxClockBPM;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (anchored) {
+            // The next pulse keeps its time; the new spacing starts after it
+            anchor += (double)pulseIndex * periodNs;
+            pulseIndex = 0;
+        }
+        periodNs = 60e9 / (bpm * 24);
+    }
+    Kick();
+}
+
+void MIDIClockGenerator::SetClockEnabled(bool enabled)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (clockOn == enabled) return;
+        clockOn = enabled;
+        anchored = false;
+    }
+    Kick();
+}
+
+void MIDIClockGenerator::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingTransport = 0xFA;
+        if (!clockOn) {
+            clockOn = true;
+            anchored = false;
+        }
+    }
+    Kick();
+}
+
+void MIDIClockGenerator::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingTransport = 0xFC;
+    }
+    Kick();
+}
+
+void MIDIClockGenerator::Continue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingTransport = 0xFB;
+        if (!clockOn) {
+            clockOn = true;
+            anchored = false;
+        }
+    }
+    Kick();
+}
+
+void MIDIClockGenerator::Apply(const MIDIClockControl &control)
+{
+    switch (control.command) {
+    case MIDIClockCommand::Start:    Start(); break;
+    case MIDIClockCommand::Stop:     Stop(); break;
+    case MIDIClockCommand::Continue: Continue(); break;
+    case MIDIClockCommand::Tempo:    SetTempo(control.bpm); break;
+    case MIDIClockCommand::ClockOn:  SetClockEnabled(true); break;
+    case MIDIClockCommand::ClockOff: SetClockEnabled(false); break;
+    }
+}
+
+void MIDIClockGenerator::Send(const uint8_t *bytes, uint32_t length)
+{
+    for (const auto &o : outputs) {
+        if (!o.target->Enqueue(o.cable, bytes, length))
+            stats.dropped++;
+    }
+}
+
+void MIDIClockGenerator::EmitPulse(uint64_t due, uint64_t now)
+{
+    if (pendingTransport) {
+        uint8_t status = pendingTransport;
+        pendingTransport = 0;
+        if (status == 0xFA) songPulses = 0;
+        playing = status != 0xFC;
+        Send(&status, 1);
+        stats.transportMessages += outputs.size();
+        for (auto &o : outputs) o.sync = Sync::None;
+    }
+
+    // Late joiners pick up the song on a sixteenth (six pulses) boundary:
+    // Song Position one pulse ahead, since the transmitter lets real-time
+    // bytes overtake it, then Continue right before the boundary pulse
+    for (auto &o : outputs) {
+        if (o.sync == Sync::None) continue;
+        if (!playing) {
+            o.sync = Sync::None;
+        } else if (o.sync == Sync::Position && songPulses % 6 == 5) {
+            uint32_t sixteenths = (uint32_t)(songPulses / 6 + 1) & 0x3FFF;
+            const uint8_t position[] = { 0xF2, (uint8_t)(sixteenths & 0x7F),
+                                         (uint8_t)(sixteenths >> 7) };
+            if (!o.target->Enqueue(o.cable, position, sizeof(position)))
+                stats.dropped++;
+            stats.transportMessages++;
+            o.sync = Sync::Continue;
+        } else if (o.sync == Sync::Continue) {
+            const uint8_t resume = 0xFB;
+            if (!o.target->Enqueue(o.cable, &resume, 1))
+                stats.dropped++;
+            stats.transportMessages++;
+            o.sync = Sync::None;
+        }
+    }
+
+    const uint8_t pulse = 0xF8;
+    Send(&pulse, 1);
+    if (playing) songPulses++;
+    stats.pulses++;
+
+    double lateness = (double)(now - due);
+    latenessVar += (lateness * lateness - latenessVar) / 96.0;
+    stats.latenessRmsNs = (uint64_t)llround(sqrt(latenessVar));
+    if (now - due > stats.latenessMaxNs) stats.latenessMaxNs = now - due;
+}
+
+uint64_t MIDIClockGenerator::Pump()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t now = clock->NowNanos();
+
+    if (!clockOn) {
+        // Stop is still delivered when the clock is off
+        if (pendingTransport == 0xFC) {
+            pendingTransport = 0;
+            playing = false;
+            const uint8_t stop = 0xFC;
+            Send(&stop, 1);
+            stats.transportMessages += outputs.size();
+        }
+        return 0;
+    }
+
+    if (!anchored) {
+        anchor = (double)now;
+        pulseIndex = 0;
+        anchored = true;
+    }
+
+    uint64_t due = (uint64_t)llround(anchor + (double)pulseIndex * periodNs);
+    for (uint32_t sent = 0; due <= now; sent++) {
+        if (sent == config.maxCatchUp) {
+            // Too far behind (the thread was starved): restart the grid
+            // rather than firing a burst of pulses
+            stats.overruns++;
+            anchor = (double)now + periodNs;
+            pulseIndex = 0;
+            due = (uint64_t)llround(anchor);
+            break;
+        }
+        EmitPulse(due, now);
+        pulseIndex++;
+        due = (uint64_t)llround(anchor + (double)pulseIndex * periodNs);
+    }
+    return due;
+}
+
+// ---------- Thread mode ----------
+
+bool MIDIClockGenerator::StartThread(const IOThreadPolicy &policy)
+{
+    if (threadRunning) return true;
+    if (!io.Start("MIDI clock", policy)) return false;
+    threadRunning = true;
+    Kick();
+    return true;
+}
+
+void MIDIClockGenerator::StopThread()
+{
+    if (!threadRunning.exchange(false)) return;
+    io.Stop();
+    timer = 0;
+}
+
+void MIDIClockGenerator::Kick()
+{
+    if (!threadRunning) return;
+    io.Post([this] {
+        // A timer that already fired may still be waiting to run; the
+        // sequence number retires it
+        if (timer) io.Cancel(timer);
+        timer = 0;
+        armSequence++;
+        Service();
+    });
+}
+
+void MIDIClockGenerator::Service()
+{
+    uint64_t next = Pump();
+    if (next) Arm(next);
+}
+
+void MIDIClockGenerator::Arm(uint64_t due)
+{
+    uint64_t lead;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lead = config.leadNs;
+    }
+    uint64_t now = clock->NowNanos();
+    uint64_t delay = due > now + lead ? due - now - lead : 0;
+    uint64_t sequence = ++armSequence;
+    timer = io.PostAfter(delay, [this, due, sequence] {
+        if (sequence != armSequence) return;
+        timer = 0;
+        // Timer wakeups land tens of microseconds late; wake early and
+        // spin the last stretch
+        while (clock->NowNanos() < due && threadRunning.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+        Service();
+    });
+}
+
+MIDIClockGeneratorStats MIDIClockGenerator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    MIDIClockGeneratorStats s = stats;
+    s.bpm = 60e9 / (periodNs * 24);
+    s.clockRunning = clockOn;
+    s.playing = playing;
+    return s;
+}
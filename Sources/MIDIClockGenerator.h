@@ -0,0 +1,141 @@
+#ifndef MIDIClockGenerator_h
+#define MIDIClockGenerator_h
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "IOScheduler.h"
+#include "MIDITransmitter.h"
+
+static constexpr double kMinClockBPM = 10;
+static constexpr double kMaxClockBPM = 400;
+
+/// One output fed by the clock generator.
+struct MIDIClockTarget {
+    MIDITransmitter *target = nullptr;
+    uint8_t          cable  = 0;
+};
+
+struct MIDIClockGeneratorConfig {
+    uint64_t leadNs     = 200000;   // Timer fires this early; the rest is spun off
+    uint32_t maxCatchUp = 4;        // Overdue pulses sent at once before the grid restarts
+};
+
+struct MIDIClockGeneratorStats {
+    double   bpm               = 0;
+    bool     clockRunning      = false;
+    bool     playing           = false;
+    uint64_t pulses            = 0;
+    uint64_t transportMessages = 0;   // Start/Stop/Continue/Song Position sent (per target)
+    uint64_t dropped           = 0;   // Target queue full
+    uint64_t overruns          = 0;   // Grid restarted after falling behind
+    uint64_t latenessRmsNs     = 0;   // Pulse hand-off against the grid, about 4 beats
+    uint64_t latenessMaxNs     = 0;
+};
+
+enum class MIDIClockCommand : uint8_t {
+    Start,
+    Stop,
+    Continue,
+    Tempo,
+    ClockOn,
+    ClockOff,
+};
+
+struct MIDIClockControl {
+    MIDIClockCommand command = MIDIClockCommand::Stop;
+    double           bpm     = 0;   // Tempo only
+};
+
+/// Parse a control message addressed to the driver rather than a device:
+///   F0 7D 52 43 <cmd> [data] F7     (7D = non-commercial ID, "RC")
+///   cmd 01 Start, 02 Stop, 03 Continue, 05 clock on, 06 clock off,
+///   04 tempo + BPM x 100 as three 7-bit bytes, least significant first.
+bool ParseMIDIClockControl(const uint8_t *data, uint32_t length, MIDIClockControl &control);
+
+/// Driver-generated MIDI clock and transport.
+///
+/// Pulses sit on an absolute grid (anchor + n x period), so timer lateness
+/// never accumulates and a tempo change takes effect from the next pulse
+/// without a phase jump. Every target gets each pulse in the same pass,
+/// queued as a real-time message ahead of other output, which keeps several
+/// devices in phase. Start/Stop/Continue go out with the next pulse; a
+/// target added while playing is brought in with Song Position + Continue
+/// on the next sixteenth. The clock keeps running while stopped so slaves
+/// can follow the tempo.
+///
+/// Pump() does the work and is driven either by the generator's own thread
+/// (StartThread/StopThread) or directly by tests with a fake clock. Control
+/// calls are thread-safe.
+class MIDIClockGenerator {
+public:
+    explicit MIDIClockGenerator(HostClock *clock = &DefaultHostClock());
+    ~MIDIClockGenerator();
+
+    MIDIClockGenerator(const MIDIClockGenerator &) = delete;
+    MIDIClockGenerator &operator=(const MIDIClockGenerator &) = delete;
+
+    void SetConfig(const MIDIClockGeneratorConfig &config);
+
+    /// Replace the outputs. Targets are not used after this returns.
+    void SetTargets(const std::vector<MIDIClockTarget> &targets);
+    size_t TargetCount() const;
+
+    void SetTempo(double bpm);
+    void SetClockEnabled(bool enabled);
+    void Start();
+    void Stop();
+    void Continue();
+    void Apply(const MIDIClockControl &control);
+
+    /// Send every pulse that is due. Returns the host time of the next
+    /// pulse, or 0 when the clock is off.
+    uint64_t Pump();
+
+    bool StartThread(const IOThreadPolicy &policy = IOThreadPolicy());
+    void StopThread();
+
+    MIDIClockGeneratorStats GetStats() const;
+
+private:
+    // Catch-up of a target that joined while playing
+    enum class Sync : uint8_t { None, Position, Continue };
+
+    struct Output {
+        MIDITransmitter *target;
+        uint8_t          cable;
+        Sync             sync;
+    };
+
+    void Send(const uint8_t *bytes, uint32_t length);
+    void EmitPulse(uint64_t due, uint64_t now);
+    void Kick();
+    void Service();
+    void Arm(uint64_t due);
+
+    HostClock *clock;
+    MIDIClockGeneratorConfig config;
+
+    mutable std::mutex mutex;
+    std::vector<Output> outputs;
+    double   periodNs     = 60e9 / (120 * 24);
+    bool     clockOn      = false;
+    bool     playing      = false;
+    bool     anchored     = false;
+    double   anchor       = 0;     // Host time of pulse 0 of the current grid
+    uint64_t pulseIndex   = 0;     // Next pulse on the grid
+    uint8_t  pendingTransport = 0; // FA/FB/FC to send with the next pulse
+    uint64_t songPulses   = 0;     // Pulses since Start, while playing
+    double   latenessVar  = 0;
+
+    MIDIClockGeneratorStats stats;
+
+    // Thread mode; `timer` and `armSequence` are only touched on the scheduler thread
+    ThreadIOScheduler io;
+    IOScheduler::TimerID timer = 0;
+    uint64_t armSequence = 0;
+    std::atomic<bool> threadRunning{false};
+};
+
+#endif /* MIDIClockGenerator_h */
@@ -0,0 +1,124 @@
+#include "MIDIClockSmoother.h"
+#include <math.h>
+
+MIDIClockSmoother::MIDIClockSmoother(const MIDIClockSmootherConfig &config)
+{
+    SetConfig(config);
+}
+
+void MIDIClockSmoother::SetConfig(const MIDIClockSmootherConfig &config)
+{
+    this->config = config;
+    minPeriod = 60e9 / (config.maxBPM * config.pulsesPerQuarter);
+    maxPeriod = 60e9 / (config.minBPM * config.pulsesPerQuarter);
+    Reset();
+}
+
+void MIDIClockSmoother::Reset()
+{
+    period = 0;
+    grid = 0;
+    lastRaw = 0;
+    lastOut = 0;
+    phasePulses = 0;
+    tracked = 0;
+    missRun = 0;
+    locked = false;
+    inVar = outVar = 0;
+    milliBPM.store(0, std::memory_order_relaxed);
+}
+
+void MIDIClockSmoother::OnTransport(uint8_t status)
+{
+    if (status == 0xFA || status == 0xFB || status == 0xFC) {
+        // The next pulse starts a new phase; the tempo carries over
+        phasePulses = 0;
+        missRun = 0;
+    }
+}
+
+void MIDIClockSmoother::Acquire(uint64_t hostNs)
+{
+    double interval = (double)(hostNs - lastRaw);
+    if (interval >= minPeriod && interval <= maxPeriod) {
+        period = interval;
+        tracked = 1;
+    } else {
+        period = 0;
+        tracked = 0;
+    }
+    grid = (double)hostNs;
+    missRun = 0;
+    locked = false;
+}
+
+uint64_t MIDIClockSmoother::OnPulse(uint64_t hostNs)
+{
+    pulses.fetch_add(1, std::memory_order_relaxed);
+    double raw = (double)hostNs;
+    double rawInterval = (double)(hostNs - lastRaw);
+    uint64_t prevOut = lastOut;
+
+    if (phasePulses == 0 || (period > 0 && rawInterval > 4 * period)) {
+        // First pulse after a reset, transport message or a gap in the clock
+        grid = raw;
+        missRun = 0;
+    } else if (period == 0 || tracked == 0) {
+        Acquire(hostNs);
+    } else {
+        double predicted = grid + period;
+        double error = raw - predicted;
+        if (locked && fabs(error) > config.relockFraction * period) {
+            // One late callback shouldn't bend the grid; a run of misses is a tempo change
+            if (++missRun >= config.relockAfter) {
+                relocks.fetch_add(1, std::memory_order_relaxed);
+                Acquire(hostNs);
+            } else {
+                grid = predicted;
+            }
+        } else {
+            missRun = 0;
+            double gain = tracked < config.acquirePulses ? config.acquireGain : config.phaseGain;
+            grid = predicted + gain * error;
+            period += (gain * gain / 2) * error;
+            if (period < minPeriod) period = minPeriod;
+            if (period > maxPeriod) period = maxPeriod;
+            tracked++;
+            locked = tracked >= config.acquirePulses;
+        }
+    }
+
+    phasePulses++;
+    lastRaw = hostNs;
+    uint64_t out = grid > 0 ? (uint64_t)llround(grid) : 0;
+    if (out <= lastOut) out = lastOut + 1;
+    lastOut = out;
+
+    if (locked && phasePulses > 1)
+        Publish(rawInterval, (double)(out - prevOut));
+    return out;
+}
+
+void MIDIClockSmoother::Publish(double rawInterval, double outInterval)
+{
+    // Exponentially weighted over about four beats
+    const double w = 1.0 / (4 * config.pulsesPerQuarter);
+    double din = rawInterval - period, dout = outInterval - period;
+    inVar += (din * din - inVar) * w;
+    outVar += (dout * dout - outVar) * w;
+
+    milliBPM.store((uint64_t)llround(60e12 / (period * config.pulsesPerQuarter)), std::memory_order_relaxed);
+    inJitter.store((uint64_t)llround(sqrt(inVar)), std::memory_order_relaxed);
+    outJitter.store((uint64_t)llround(sqrt(outVar)), std::memory_order_relaxed);
+}
+
+MIDIClockStats MIDIClockSmoother::GetStats() const
+{
+    MIDIClockStats s;
+    s.bpm            = (double)milliBPM.load(std::memory_order_relaxed) / 1000.0;
+    s.inputJitterNs  = (double)inJitter.load(std::memory_order_relaxed);
+    s.outputJitterNs = (double)outJitter.load(std::memory_order_relaxed);
+    s.pulses         = pulses.load(std::memory_order_relaxed);
+    s.relocks        = relocks.load(std::memory_order_relaxed);
+    return s;
+}
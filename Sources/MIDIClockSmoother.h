@@ -0,0 +1,79 @@
+#ifndef MIDIClockSmoother_h
+#define MIDIClockSmoother_h
+
+#include <stdint.h>
+#include <atomic>
+
+static constexpr uint32_t kMIDIClockPPQN = 24;
+
+struct MIDIClockSmootherConfig {
+    double   phaseGain      = 0.1;     // Locked loop; the tempo gain is phaseGain^2 / 2
+    double   acquireGain    = 0.5;     // For the first acquirePulses pulses
+    uint32_t acquirePulses  = kMIDIClockPPQN;
+    double   relockFraction = 0.25;    // Pulse error (of a period) that counts as a miss
+    uint32_t relockAfter    = 4;       // Misses in a row before re-acquiring
+    double   minBPM         = 20;
+    double   maxBPM         = 400;
+    double   pulsesPerQuarter = kMIDIClockPPQN;   // Lower when the clock is divided upstream
+};
+
+/// Published view of a smoother; readable from any thread.
+struct MIDIClockStats {
+    double   bpm            = 0;       // 0 until locked
+    double   inputJitterNs  = 0;       // RMS deviation of raw pulse intervals from the tempo
+    double   outputJitterNs = 0;       // Same for the re-timestamped pulses
+    uint64_t pulses         = 0;
+    uint64_t relocks        = 0;
+};
+
+/// Re-times inbound MIDI clock (0xF8) onto a smoothed pulse grid.
+///
+/// An alpha-beta tracker follows pulse phase and period: each pulse is
+/// compared with the predicted grid position, the phase moves by phaseGain
+/// of the error and the period by phaseGain^2 / 2. A late or early pulse
+/// (more than relockFraction of a period off) doesn't move the estimate; a
+/// run of them means the tempo really jumped and the tracker re-acquires
+/// from the latest interval. Start/Continue/Stop restart the phase and keep
+/// the tempo. Output times are strictly increasing.
+///
+/// OnPulse/OnTransport/Reset are called from the I/O thread only.
+class MIDIClockSmoother {
+public:
+    explicit MIDIClockSmoother(const MIDIClockSmootherConfig &config = MIDIClockSmootherConfig());
+
+    /// Replace the configuration; implies Reset().
+    void SetConfig(const MIDIClockSmootherConfig &config);
+    const MIDIClockSmootherConfig &GetConfig() const { return config; }
+
+    /// Forget phase and tempo (and the monotonic floor).
+    void Reset();
+
+    /// A clock pulse received at hostNs; returns its smoothed time.
+    uint64_t OnPulse(uint64_t hostNs);
+    /// Start (FA), Continue (FB) or Stop (FC) received.
+    void OnTransport(uint8_t status);
+
+    bool   Locked() const { return locked; }
+    double PeriodNs() const { return period; }
+    MIDIClockStats GetStats() const;
+
+private:
+    void Acquire(uint64_t hostNs);
+    void Publish(double rawInterval, double outInterval);
+
+    MIDIClockSmootherConfig config;
+    double   minPeriod  = 0, maxPeriod = 0;
+    double   period     = 0;
+    double   grid       = 0;      // Smoothed time of the last pulse
+    uint64_t lastRaw    = 0;
+    uint64_t lastOut    = 0;
+    uint32_t phasePulses = 0;     // Pulses since the phase (re)started
+    uint32_t tracked    = 0;      // Pulses tracked since (re)acquiring
+    uint32_t missRun    = 0;
+    bool     locked     = false;
+    double   inVar      = 0, outVar = 0;
+
+    std::atomic<uint64_t> milliBPM{0}, inJitter{0}, outJitter{0}, pulses{0}, relocks{0};
+};
+
+#endif /* MIDIClockSmoother_h */
@@ -0,0 +1,68 @@
+#include "MIDIMessageBatch.h"
+
+struct MIDIMessageBatchSink {
+    MIDIMessageBatch &batch;
+
+    void RealTime(uint8_t b) { Short(&b, 1); }
+
+    void Short(const uint8_t *msg, uint8_t length)
+    {
+        MIDIMessageBatch::Entry e;
+        for (uint8_t i = 0; i < length && i < 3; i++)
+            e.shortBytes[i] = msg[i];
+        e.shortLength = length;
+        batch.entries.push_back(std::move(e));
+        batch.bytes += length;
+    }
+
+    // Same packet alignment as MIDITransmitter::EnqueueSysEx, so that a
+    // shared segment is queued as it is
+    void SysEx(const uint8_t *segment, uint32_t length, bool ended)
+    {
+        MIDIMessageBatch::Entry e;
+        e.sysEx = batch.pool->Acquire(batch.sysExCarryLength + length);
+        e.sysEx.append(batch.sysExCarry, batch.sysExCarryLength);
+        e.sysEx.append(segment, length);
+        batch.sysExCarryLength = 0;
+
+        if (!ended) {
+            uint8_t keep = (uint8_t)(e.sysEx.size() % 3);
+            for (uint8_t k = 0; k < keep; k++)
+                batch.sysExCarry[k] = e.sysEx[e.sysEx.size() - keep + k];
+            batch.sysExCarryLength = keep;
+            e.sysEx.resize(e.sysEx.size() - keep);
+        }
+        if (e.sysEx.empty()) return;
+
+        e.sysExEnded = ended;
+        batch.bytes += e.sysEx.size();
+        batch.entries.push_back(std::move(e));
+    }
+
+    void EndSysEx() { batch.sysExCarryLength = 0; }
+};
+
+MIDIMessageBatch::MIDIMessageBatch(BufferPool *pool)
+    : pool(pool)
+{
+}
+
+void MIDIMessageBatch::Add(const uint8_t *data, uint32_t length)
+{
+    if (!data || length == 0) return;
+    MIDIMessageBatchSink sink = { *this };
+    SplitMIDIMessages(data, length, sysExOpen, sink);
+}
+
+void MIDIMessageBatch::Clear()
+{
+    entries.clear();
+    bytes = 0;
+}
+
+void MIDIMessageBatch::Reset()
+{
+    Clear();
+    sysExOpen = false;
+    sysExCarryLength = 0;
+}
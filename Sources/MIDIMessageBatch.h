@@ -0,0 +1,138 @@
+#ifndef MIDIMessageBatch_h
+#define MIDIMessageBatch_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "BufferPool.h"
+#include "USBMIDIParser.h"
+
+static inline uint8_t MIDIChannelMessageLength(uint8_t status)
+{
+    uint8_t kind = status & 0xF0;
+    return (kind == 0xC0 || kind == 0xD0) ? 2 : 3;
+}
+
+/// Split the MIDI bytes of one MIDIPacket into queue entries: real-time
+/// bytes, complete short messages (running status expanded) and SysEx
+/// segments. sysExOpen carries an unterminated SysEx across packets. The
+/// sink gets RealTime(byte), Short(bytes, length), SysEx(bytes, length,
+/// ended) and EndSysEx() when a status byte cuts an open SysEx off.
+///
+/// MIDITransmitter::Enqueue and MIDIMessageBatch share this, so a batch
+/// queues exactly what Enqueue would.
+template <typename Sink>
+void SplitMIDIMessages(const uint8_t *data, uint32_t length, bool &sysExOpen, Sink &sink)
+{
+    uint8_t status = 0;
+    uint32_t i = 0;
+    while (i < length) {
+        uint8_t b = data[i];
+
+        if (b >= 0xF8) {
+            // Real-time: may sit anywhere, even inside a SysEx
+            sink.RealTime(b);
+            i++;
+        } else if (b == 0xF0 || (sysExOpen && (b < 0x80 || b == 0xF7))) {
+            uint32_t start = i;
+            bool ended = (b == 0xF7);
+            i++;
+            if (!ended) {
+                while (i < length && data[i] < 0x80) i++;
+                if (i < length && data[i] == 0xF7) {
+                    ended = true;
+                    i++;
+                }
+            }
+            sink.SysEx(&data[start], i - start, ended);
+            sysExOpen = !ended;
+            status = 0;
+        } else if (b >= 0xF0) {
+            // System common (F7 outside SysEx is ignored)
+            sysExOpen = false;
+            sink.EndSysEx();
+            status = 0;
+            uint8_t n = USBMIDICinToMIDIByteCount(MIDIStatusToCin(b));
+            if (b == 0xF7 || n == 0) { i++; continue; }
+            if (i + n > length) break;
+            sink.Short(&data[i], n);
+            i += n;
+        } else if (b >= 0x80) {
+            sysExOpen = false;
+            sink.EndSysEx();
+            status = b;
+            uint8_t n = MIDIChannelMessageLength(b);
+            if (i + n > length) break;
+            sink.Short(&data[i], n);
+            i += n;
+        } else if (status) {
+            // Running status: expand to a full message
+            uint8_t n = MIDIChannelMessageLength(status);
+            if (i + n - 1 > length) break;
+            uint8_t msg[3] = { status, data[i], (n == 3) ? data[i + 1] : (uint8_t)0 };
+            sink.Short(msg, n);
+            i += n - 1;
+        } else {
+            i++;   // Data byte without status
+        }
+    }
+}
+
+/// MIDI bytes split once into the entries a MIDITransmitter queues, for
+/// sending the same output to several devices (see MIDIBroadcast).
+///
+/// Short messages are kept inline; SysEx segments go into buffers from the
+/// batch's pool, which every queue the batch is given to shares by
+/// reference instead of copying. Like a transmitter cable, the batch keeps
+/// an unterminated SysEx open across Add() calls and holds back the bytes
+/// that don't fill a USB-MIDI packet, so a shared segment never has to be
+/// joined with anything the target kept back.
+class MIDIMessageBatch {
+public:
+    struct Entry {
+        uint8_t      shortBytes[3] = {};
+        uint8_t      shortLength   = 0;       // 1-3; 0 for a SysEx segment
+        PooledBuffer sysEx;
+        bool         sysExEnded    = false;
+
+        const uint8_t *Data() const { return shortLength ? shortBytes : sysEx.data(); }
+        uint32_t Length() const { return shortLength ? shortLength : sysEx.size(); }
+    };
+
+    explicit MIDIMessageBatch(BufferPool *pool);
+
+    /// Split the MIDI bytes of one MIDIPacket onto the batch.
+    void Add(const uint8_t *data, uint32_t length);
+    /// Drop the entries; queues they were given to keep their buffers. An
+    /// unterminated SysEx stays open for the next Add().
+    void Clear();
+    /// Clear, and forget an open SysEx.
+    void Reset();
+
+    const std::vector<Entry> &Entries() const { return entries; }
+    bool     Empty() const { return entries.empty(); }
+    /// MIDI bytes in the entries, as counted against a queue's limit.
+    uint32_t Bytes() const { return bytes; }
+
+private:
+    friend struct MIDIMessageBatchSink;
+
+    BufferPool *pool;
+    std::vector<Entry> entries;
+    uint32_t bytes = 0;
+    bool     sysExOpen = false;
+    uint8_t  sysExCarry[2] = {};
+    uint8_t  sysExCarryLength = 0;
+};
+
+/// Something a batch can be queued on: a device's output.
+class MIDIBatchTarget {
+public:
+    virtual ~MIDIBatchTarget() = default;
+
+    /// Queue every entry of a batch on one cable, sharing its SysEx
+    /// buffers. False if the batch was dropped.
+    virtual bool EnqueueBatch(uint8_t cable, const MIDIMessageBatch &batch) = 0;
+};
+
+#endif /* MIDIMessageBatch_h */
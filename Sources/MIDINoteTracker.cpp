@@ -0,0 +1,94 @@
+#include "MIDINoteTracker.h"
+#include <string.h>
+
+void MIDINoteTracker::SetNote(uint8_t cable, uint8_t channel, uint8_t note, bool on)
+{
+    uint64_t bit = 1ull << (note & 63);
+    uint64_t &word = held[cable][channel][(note >> 6) & 1];
+    if (on) word |= bit;
+    else    word &= ~bit;
+}
+
+void MIDINoteTracker::Observe(uint8_t cable, const uint8_t *data, uint32_t length)
+{
+    if (!data || cable >= kUSBMIDINumCables) return;
+
+    uint8_t status = runningStatus[cable];
+    bool inSysEx = false;
+    uint32_t i = 0;
+    while (i < length) {
+        uint8_t b = data[i];
+
+        if (b >= 0xF8) { i++; continue; }            // Real-time, no effect
+        if (b == 0xF0) { inSysEx = true; i++; continue; }
+        if (b == 0xF7) { inSysEx = false; i++; continue; }
+        if (inSysEx)   { i++; continue; }
+
+        if (b >= 0xF0) {
+            // System common cancels running status
+            uint8_t n = USBMIDICinToMIDIByteCount(MIDIStatusToCin(b));
+            status = 0;
+            i += n ? n : 1;
+            continue;
+        }
+
+        if (b >= 0x80) {
+            status = b;
+            i++;
+            continue;
+        }
+
+        // Data byte under the current (running) status
+        if (status == 0) { i++; continue; }
+        uint8_t kind = status & 0xF0;
+        uint8_t dataLen = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+        if (i + dataLen > length) break;
+
+        if (kind == 0x90 || kind == 0x80) {
+            uint8_t note = data[i];
+            bool on = (kind == 0x90) && data[i + 1] != 0;
+            SetNote(cable, status & 0x0F, note, on);
+        }
+        i += dataLen;
+    }
+    runningStatus[cable] = status;
+}
+
+uint32_t MIDINoteTracker::ReleaseAll(uint8_t cable, uint8_t *outBuffer, uint32_t outBufferSize)
+{
+    if (!outBuffer || cable >= kUSBMIDINumCables) return 0;
+
+    uint32_t written = 0;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        for (uint8_t w = 0; w < 2; w++) {
+            uint64_t &word = held[cable][ch][w];
+            while (word) {
+                if (written + 3 > outBufferSize) return written;
+                uint8_t bit = (uint8_t)__builtin_ctzll(word);
+                outBuffer[written + 0] = (uint8_t)(0x80 | ch);
+                outBuffer[written + 1] = (uint8_t)(w * 64 + bit);
+                outBuffer[written + 2] = 0x00;
+                written += 3;
+                word &= word - 1;
+            }
+        }
+    }
+    runningStatus[cable] = 0;
+    return written;
+}
+
+uint32_t MIDINoteTracker::HeldCount(uint8_t cable) const
+{
+    if (cable >= kUSBMIDINumCables) return 0;
+    uint32_t count = 0;
+    for (uint8_t ch = 0; ch < 16; ch++)
+        count += (uint32_t)__builtin_popcountll(held[cable][ch][0])
+               + (uint32_t)__builtin_popcountll(held[cable][ch][1]);
+    return count;
+}
+
+void MIDINoteTracker::Reset()
+{
+    memset(held, 0, sizeof(held));
+    memset(runningStatus, 0, sizeof(runningStatus));
+}
@@ -0,0 +1,33 @@
+#ifndef MIDINoteTracker_h
+#define MIDINoteTracker_h
+
+#include <stdint.h>
+#include "USBMIDIParser.h"
+
+/// Tracks which notes have been switched on (and not yet off) per cable and
+/// channel in an outgoing MIDI stream, so that a flush can release them.
+class MIDINoteTracker {
+public:
+    /// Update held-note state from outgoing MIDI bytes on a cable.
+    /// Handles running status within the run; SysEx and real-time bytes are skipped.
+    void Observe(uint8_t cable, const uint8_t *data, uint32_t length);
+
+    /// Write Note Off messages for held notes on a cable into outBuffer and
+    /// mark them released. Returns MIDI bytes written (3 per note); call again
+    /// until it returns 0 if outBuffer may be too small.
+    uint32_t ReleaseAll(uint8_t cable, uint8_t *outBuffer, uint32_t outBufferSize);
+
+    /// Number of notes currently held on a cable.
+    uint32_t HeldCount(uint8_t cable) const;
+
+    void Reset();
+
+private:
+    void SetNote(uint8_t cable, uint8_t channel, uint8_t note, bool on);
+
+    // 128 notes per channel as two 64-bit words
+    uint64_t held[kUSBMIDINumCables][16][2] = {};
+    uint8_t  runningStatus[kUSBMIDINumCables] = {};
+};
+
+#endif /* MIDINoteTracker_h */
@@ -0,0 +1,130 @@
+#include "MIDIPacketListBuilder.h"
+#include <algorithm>
+#include <string.h>
+
+// The first buffer is sized from the Reserve hint up to this; a list
+// that turns out larger grows into the bigger classes
+static constexpr uint32_t kInitialCapacityLimit = 4096;
+
+MIDIPacketListBuilder::MIDIPacketListBuilder(BufferPool *pool, DeliverFunction deliver,
+                                             void *context,
+                                             const MIDIPacketListBuilderConfig &config)
+{
+    SetOutput(pool, deliver, context);
+    SetConfig(config);
+}
+
+void MIDIPacketListBuilder::SetOutput(BufferPool *p, DeliverFunction d, void *c)
+{
+    pool = p ? p : &ownBuffers;
+    deliver = d;
+    context = c;
+}
+
+void MIDIPacketListBuilder::SetConfig(const MIDIPacketListBuilderConfig &c)
+{
+    config = c;
+    if (config.packetAlignment == 0) config.packetAlignment = 1;
+    config.maxListBytes = std::min(std::max(config.maxListBytes,
+                                            kMIDIPacketListHeaderBytes + kMIDIPacketHeaderBytes
+                                            + config.packetAlignment),
+                                   kMIDIPacketListMaxBytes);
+}
+
+void MIDIPacketListBuilder::Reserve(uint32_t events, uint32_t dataBytes)
+{
+    uint64_t bytes = kMIDIPacketListHeaderBytes
+                   + (uint64_t)events * (kMIDIPacketHeaderBytes + config.packetAlignment - 1)
+                   + dataBytes;
+    reserveBytes = (uint32_t)std::min<uint64_t>(bytes, kInitialCapacityLimit);
+}
+
+uint32_t MIDIPacketListBuilder::Aligned(uint32_t offset) const
+{
+    uint32_t a = config.packetAlignment;
+    return (offset + a - 1) / a * a;
+}
+
+bool MIDIPacketListBuilder::Fit(uint32_t end)
+{
+    if (end > config.maxListBytes) return false;
+    if (end <= buffer.capacity()) return true;
+
+    uint32_t capacity = buffer ? std::min(std::max(end, buffer.capacity() * 2), config.maxListBytes)
+                               : std::max(end, reserveBytes);
+    PooledBuffer next = pool->Acquire(capacity);
+    if (buffer) {
+        next.append(buffer.data(), buffer.size());
+        stats.grows++;
+    }
+    buffer = std::move(next);
+    return true;
+}
+
+void MIDIPacketListBuilder::Add(uint64_t timeStamp, const uint8_t *data, uint32_t length)
+{
+    if (!length) return;
+
+    // Complete channel, common and realtime messages may share a packet;
+    // SysEx (a start or a continuation) always begins its own
+    bool mergeable = data[0] >= 0x80 && data[0] != 0xF0 && data[0] != 0xF7;
+
+    if (numPackets && mergeable && lastMergeable && timeStamp == lastTime) {
+        uint8_t *header = buffer.data() + lastPacket;
+        uint16_t packetLength;
+        memcpy(&packetLength, header + 8, sizeof(packetLength));
+        uint32_t end = buffer.size() + length;
+        if (packetLength + length <= kMIDIPacketMaxDataBytes && Fit(end)) {
+            header = buffer.data() + lastPacket;
+            memcpy(buffer.data() + buffer.size(), data, length);
+            packetLength = (uint16_t)(packetLength + length);
+            memcpy(header + 8, &packetLength, sizeof(packetLength));
+            buffer.resize(end);
+            return;
+        }
+    }
+
+    // Largest packet a list can hold
+    uint32_t maxData = std::min(kMIDIPacketMaxDataBytes,
+                                config.maxListBytes - kMIDIPacketListHeaderBytes
+                                - kMIDIPacketHeaderBytes);
+    while (length) {
+        uint32_t chunk = std::min(length, maxData);
+        uint32_t start = numPackets ? Aligned(buffer.size()) : kMIDIPacketListHeaderBytes;
+        uint32_t end = start + kMIDIPacketHeaderBytes + chunk;
+        if (!Fit(end)) {
+            // Only a list that already holds packets can be out of room
+            Flush();
+            stats.splits++;
+            continue;
+        }
+
+        uint8_t *base = buffer.data();
+        if (start > buffer.size()) memset(base + buffer.size(), 0, start - buffer.size());
+        uint16_t packetLength = (uint16_t)chunk;
+        memcpy(base + start, &timeStamp, sizeof(timeStamp));
+        memcpy(base + start + 8, &packetLength, sizeof(packetLength));
+        memcpy(base + start + kMIDIPacketHeaderBytes, data, chunk);
+        numPackets++;
+        memcpy(base, &numPackets, sizeof(numPackets));
+        buffer.resize(end);
+        stats.packets++;
+
+        lastPacket = start;
+        lastTime = timeStamp;
+        lastMergeable = mergeable && chunk == length;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void MIDIPacketListBuilder::Flush()
+{
+    if (numPackets) {
+        if (deliver) deliver(buffer.data(), buffer.size(), context);
+        stats.lists++;
+    }
+    buffer.Release();
+    numPackets = 0;
+    lastMergeable = false;
+}
@@ -0,0 +1,90 @@
+#ifndef MIDIPacketListBuilder_h
+#define MIDIPacketListBuilder_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BufferPool.h"
+
+// CoreMIDI's MIDIPacketList layout (#pragma pack(4)):
+//   UInt32 numPackets; then per packet UInt64 timeStamp, UInt16 length, data,
+//   the next packet starting at a 4-byte boundary on ARM (see MIDIPacketNext)
+static constexpr uint32_t kMIDIPacketListHeaderBytes = 4;
+static constexpr uint32_t kMIDIPacketHeaderBytes     = 10;
+static constexpr uint32_t kMIDIPacketMaxDataBytes    = 0xFFFF;   // UInt16 length
+static constexpr uint32_t kMIDIPacketListMaxBytes    = 65536;    // Per MIDIReceived
+#if defined(__arm64__) || defined(__aarch64__) || defined(__arm__)
+static constexpr uint32_t kMIDIPacketAlignment = 4;
+#else
+static constexpr uint32_t kMIDIPacketAlignment = 1;
+#endif
+
+struct MIDIPacketListBuilderConfig {
+    uint32_t maxListBytes    = kMIDIPacketListMaxBytes;
+    uint32_t packetAlignment = kMIDIPacketAlignment;
+};
+
+struct MIDIPacketListBuilderStats {
+    uint64_t lists   = 0;   // Delivered
+    uint64_t packets = 0;
+    uint64_t splits  = 0;   // Lists delivered early because the next event did not fit
+    uint64_t grows   = 0;   // Moves to a larger buffer
+};
+
+/// Builds MIDIPacketLists for delivery to a source, in pooled buffers.
+///
+/// Events are added as MIDIPacketListAdd would: an event with the same
+/// timestamp as the previous packet joins it when neither is SysEx. The
+/// buffer is taken from the pool on the first Add, sized from the Reserve
+/// hint, and moves up a size class when it fills. Only a list that would
+/// pass maxListBytes is delivered early, and a message longer than a
+/// packet can hold is continued in the next packet, so every list ends at
+/// a packet boundary. Flush delivers what was built and returns the buffer.
+/// Not thread-safe; one builder per delivering thread and source.
+class MIDIPacketListBuilder {
+public:
+    /// Receives each finished list in CoreMIDI layout.
+    typedef void (*DeliverFunction)(const uint8_t *list, uint32_t length, void *context);
+
+    MIDIPacketListBuilder() = default;
+    MIDIPacketListBuilder(BufferPool *pool, DeliverFunction deliver, void *context,
+                          const MIDIPacketListBuilderConfig &config = MIDIPacketListBuilderConfig());
+    ~MIDIPacketListBuilder() = default;
+    MIDIPacketListBuilder(const MIDIPacketListBuilder &) = delete;
+    MIDIPacketListBuilder &operator=(const MIDIPacketListBuilder &) = delete;
+
+    void SetOutput(BufferPool *pool, DeliverFunction deliver, void *context);
+    void SetConfig(const MIDIPacketListBuilderConfig &config);
+
+    /// Size the next buffer for up to `events` events of `dataBytes` MIDI
+    /// bytes in total (e.g. from the length of the transfer being parsed).
+    void Reserve(uint32_t events, uint32_t dataBytes);
+
+    void Add(uint64_t timeStamp, const uint8_t *data, uint32_t length);
+
+    /// Deliver the list built so far, if any.
+    void Flush();
+
+    uint32_t NumPackets() const { return numPackets; }
+    MIDIPacketListBuilderStats GetStats() const { return stats; }
+
+private:
+    /// Make room for `bytes` more; false if the list has to be delivered first.
+    bool Fit(uint32_t bytes);
+    uint32_t Aligned(uint32_t offset) const;
+
+    BufferPool      ownBuffers;   // Heap-backed unless SetOutput names a pool
+    BufferPool     *pool    = &ownBuffers;
+    DeliverFunction deliver = nullptr;
+    void           *context = nullptr;
+    MIDIPacketListBuilderConfig config;
+
+    PooledBuffer buffer;
+    uint32_t reserveBytes = 0;
+    uint32_t numPackets   = 0;
+    uint32_t lastPacket   = 0;       // Offset of the last packet's header
+    uint64_t lastTime     = 0;
+    bool     lastMergeable = false;  // Last packet holds only complete non-SysEx messages
+    MIDIPacketListBuilderStats stats;
+};
+
+#endif /* MIDIPacketListBuilder_h */
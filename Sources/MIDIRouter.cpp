@@ -0,0 +1,83 @@
+#include "MIDIRouter.h"
+#include <algorithm>
+
+static inline bool RouteBefore(const MIDIRoute &a, uint32_t source, uint8_t cable)
+{
+    return a.source < source || (a.source == source && a.sourceCable < cable);
+}
+
+MIDIRouter::MIDIRouter()
+    : table(std::make_shared<Table>())
+{
+}
+
+void MIDIRouter::SetRoutes(std::vector<MIDIRoute> routes)
+{
+    routes.erase(std::remove_if(routes.begin(), routes.end(),
+                                [](const MIDIRoute &r) {
+                                    return !r.target || r.sourceCable >= kUSBMIDINumCables
+                                        || r.targetCable >= kUSBMIDINumCables;
+                                }),
+                 routes.end());
+    std::stable_sort(routes.begin(), routes.end(), [](const MIDIRoute &a, const MIDIRoute &b) {
+        return RouteBefore(a, b.source, b.sourceCable);
+    });
+
+    auto next = std::make_shared<Table>();
+    next->routes = std::move(routes);
+    bool none = next->routes.empty();
+    std::atomic_store(&table, std::shared_ptr<const Table>(std::move(next)));
+    empty.store(none, std::memory_order_release);
+}
+
+size_t MIDIRouter::RouteCount() const
+{
+    return std::atomic_load(&table)->routes.size();
+}
+
+uint32_t MIDIRouter::Route(uint32_t source, uint8_t cable, const uint8_t *bytes, uint8_t length)
+{
+    if (empty.load(std::memory_order_acquire) || !bytes || length == 0)
+        return 0;
+
+    std::shared_ptr<const Table> snapshot = std::atomic_load(&table);
+    const std::vector<MIDIRoute> &routes = snapshot->routes;
+    auto it = std::lower_bound(routes.begin(), routes.end(), 0,
+                               [source, cable](const MIDIRoute &r, int) {
+                                   return RouteBefore(r, source, cable);
+                               });
+    if (it == routes.end() || it->source != source || it->sourceCable != cable)
+        return 0;
+
+    // SysEx continuations start with a data byte; everything else carries its status
+    uint8_t status = bytes[0];
+    uint8_t cin = status >= 0x80 ? MIDIStatusToCin(status) : (uint8_t)kCIN_SysExStart;
+    uint32_t cls = USBMIDIPacketStatusClass(cin, status);
+
+    uint32_t queued = 0;
+    for (; it != routes.end() && it->source == source && it->sourceCable == cable; ++it) {
+        bool pass = (it->statusMask & cls) != 0;
+        if (pass && (cls & kMIDIClass_ChannelVoice))
+            pass = (it->channelMask >> (status & 0x0F)) & 1;
+        if (!pass) {
+            filtered.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (it->target->Enqueue(it->targetCable, bytes, length)) {
+            forwarded.fetch_add(1, std::memory_order_relaxed);
+            queued++;
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return queued;
+}
+
+MIDIRouterStats MIDIRouter::GetStats() const
+{
+    MIDIRouterStats s;
+    s.forwarded = forwarded.load(std::memory_order_relaxed);
+    s.filtered  = filtered.load(std::memory_order_relaxed);
+    s.dropped   = dropped.load(std::memory_order_relaxed);
+    return s;
+}
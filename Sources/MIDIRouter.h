@@ -0,0 +1,62 @@
+#ifndef MIDIRouter_h
+#define MIDIRouter_h
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "MIDITransmitter.h"
+#include "USBMIDIParser.h"
+
+/// One thru connection: inbound events from (source, cable) that pass the
+/// filters are queued on another device's output.
+struct MIDIRoute {
+    uint32_t source       = 0;        // Caller-chosen id of the inbound device
+    uint8_t  sourceCable  = 0;
+    MIDITransmitter *target = nullptr;
+    uint8_t  targetCable  = 0;
+    uint16_t channelMask  = 0xFFFF;   // Channel voice messages on these channels
+    uint32_t statusMask   = kMIDIClass_ChannelVoice;   // MIDIStatusClass bits forwarded
+};
+
+struct MIDIRouterStats {
+    uint64_t forwarded = 0;   // Events queued on a target (counted per target)
+    uint64_t filtered  = 0;   // Matched a route but rejected by its filters
+    uint64_t dropped   = 0;   // Target queue full
+};
+
+/// In-driver MIDI thru matrix.
+///
+/// Route() is called from the inbound read path for every parsed event and
+/// hands matching events straight to the target's transmitter, skipping the
+/// round trip through MIDIServer and a client. The route table is replaced
+/// as a whole by SetRoutes(); Route() works on an immutable snapshot, so
+/// reconfiguration never blocks input. Targets must stay alive while a
+/// Route() call may still use a snapshot naming them.
+class MIDIRouter {
+public:
+    MIDIRouter();
+
+    void SetRoutes(std::vector<MIDIRoute> routes);
+    size_t RouteCount() const;
+
+    /// Forward one inbound event (a USB-MIDI packet's MIDI bytes). Returns
+    /// the number of targets it was queued on.
+    uint32_t Route(uint32_t source, uint8_t cable, const uint8_t *bytes, uint8_t length);
+
+    MIDIRouterStats GetStats() const;
+
+private:
+    struct Table {
+        std::vector<MIDIRoute> routes;   // Sorted by (source, sourceCable)
+    };
+
+    std::shared_ptr<const Table> table;
+    std::atomic<bool> empty{true};
+
+    std::atomic<uint64_t> forwarded{0};
+    std::atomic<uint64_t> filtered{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+#endif /* MIDIRouter_h */
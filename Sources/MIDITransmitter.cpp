@@ -0,0 +1,771 @@
+#include "MIDITransmitter.h"
+#include <algorithm>
+#include "RolandDT1.h"
+
+static inline uint64_t EarliestDue(uint64_t a, uint64_t b)
+{
+    if (a == 0) return b;
+    if (b == 0) return a;
+    return a < b ? a : b;
+}
+
+// sysExPacedUntil while a paced chunk is in flight: further chunks wait for
+// its completion, which wakes the transmitter
+static constexpr uint64_t kAwaitingCompletion = UINT64_MAX;
+
+// Coalescing targets: CC and poly pressure per (channel, number), pitch
+// bend and channel pressure per channel
+static constexpr int kCoalesceKeys = 2 * 16 * 128 + 2 * 16;
+
+// Controllers whose order against other messages matters (bank select,
+// data entry and (N)RPN selection, switches, channel mode) are never merged.
+static inline bool IsContinuousController(uint8_t cc)
+{
+    if (cc == 0 || cc == 32 || cc == 6 || cc == 38) return false;
+    if (cc >= 64 && cc <= 69) return false;
+    if (cc >= 96 && cc <= 101) return false;
+    return cc < 120;
+}
+
+static inline int CoalesceKey(const uint8_t *msg, uint8_t length)
+{
+    uint8_t channel = msg[0] & 0x0F;
+    switch (msg[0] & 0xF0) {
+        case 0xB0: return (length == 3 && IsContinuousController(msg[1])) ? channel * 128 + msg[1] : -1;
+        case 0xA0: return length == 3 ? 2048 + channel * 128 + msg[1] : -1;
+        case 0xE0: return 4096 + channel;
+        case 0xD0: return 4112 + channel;
+        default:   return -1;
+    }
+}
+
+MIDITransmitter::MIDITransmitter(USBMIDIOutputPipe *pipe, HostClock *clock)
+    : pipe(pipe), clock(clock)
+{
+    ResizeTxBuffer();
+    inFlight.reserve(kMaxWritesInFlight);
+    pacer.Reset(config.sysExChunkGapNs);
+}
+
+MIDITransmitter::~MIDITransmitter()
+{
+    Stop();
+}
+
+void MIDITransmitter::SetConfig(const MIDITransmitterConfig &newConfig)
+{
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    std::lock_guard<std::mutex> lock(queueMutex);
+    bool restartPacing = newConfig.sysExChunkGapNs != config.sysExChunkGapNs
+                      || newConfig.minSysExChunkGapNs != config.minSysExChunkGapNs;
+    config = newConfig;
+    if (config.sysExChunkSize == 0) config.sysExChunkSize = kDefaultSysExChunkSize;
+    if (config.maxTransferSize < 4) config.maxTransferSize = kDefaultMaxTransferSize;
+    config.maxTransferSize &= ~3u;
+    config.maxWritesInFlight = std::min(std::max(config.maxWritesInFlight, 1u), kMaxWritesInFlight);
+    ResizeTxBuffer();
+
+    WriteWindowConfig windowConfig;
+    windowConfig.maxDepth = config.maxWritesInFlight;
+    window.SetConfig(windowConfig);
+
+    // Re-applying the same settings keeps what the pacer has learned so far
+    if (config.minSysExChunkGapNs) {
+        SysExPacerConfig pacing;
+        pacing.minGapNs = config.minSysExChunkGapNs;
+        pacer.SetConfig(pacing);
+    }
+    if (restartPacing)
+        pacer.Reset(config.sysExChunkGapNs);
+
+    for (uint8_t c = 0; c < kUSBMIDINumCables; c++) {
+        CableQueue &q = cables[c];
+        q.shaper.Configure(config.cableBytesPerSecond[c], config.shaperBurstBytes);
+        if (config.coalesceCables & (1u << c)) {
+            if (q.latestByKey.empty())
+                q.latestByKey.assign(kCoalesceKeys, 0);
+        } else {
+            q.latestByKey.clear();
+        }
+    }
+}
+
+MIDITransmitterConfig MIDITransmitter::GetConfig() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return config;
+}
+
+// ---------- Enqueue ----------
+
+void MIDITransmitter::EnqueueShort(uint8_t cable, const uint8_t *bytes, uint8_t length)
+{
+    CableQueue &q = cables[cable];
+    int key = -1;
+    if (!q.latestByKey.empty() && (key = CoalesceKey(bytes, length)) >= 0) {
+        // Still queued from earlier? Overwrite its value where it stands.
+        uint64_t latest = q.latestByKey[key];
+        if (latest > q.headSeq) {
+            PendingMessage &queued = q.pending[(size_t)(latest - 1 - q.headSeq)];
+            if (queued.coalesceKey == key) {
+                for (uint8_t i = 1; i < length; i++)
+                    queued.shortBytes[i] = bytes[i];
+                stats.messagesCoalesced++;
+                return;
+            }
+        }
+        q.latestByKey[key] = q.headSeq + q.pending.size() + 1;
+    }
+
+    PendingMessage m;
+    for (uint8_t i = 0; i < length && i < 3; i++)
+        m.shortBytes[i] = bytes[i];
+    m.shortLength = length;
+    m.coalesceKey = (int16_t)key;
+    q.pending.push_back(std::move(m));
+    queuedBytes += length;
+    q.queuedBytes += length;
+    q.peakQueuedBytes = std::max(q.peakQueuedBytes, q.queuedBytes);
+    stats.messagesQueued++;
+}
+
+void MIDITransmitter::EnqueueRealTime(uint8_t cable, uint8_t byte)
+{
+    CableQueue &q = cables[cable];
+    if (q.realTimeCount == kRealTimeQueueSize) {
+        stats.messagesDropped++;
+        return;
+    }
+    q.realTime[(q.realTimeHead + q.realTimeCount) % kRealTimeQueueSize] = byte;
+    q.realTimeCount++;
+    stats.messagesQueued++;
+}
+
+void MIDITransmitter::EnqueueSysEx(uint8_t cable, const uint8_t *bytes, uint32_t length,
+                                   bool ended)
+{
+    // USB-MIDI carries an unterminated SysEx in whole 3-byte packets, so a
+    // segment that stops short (packet boundary, interleaved real-time byte)
+    // keeps its remainder back for the next continuation.
+    CableQueue &q = cables[cable];
+    PooledBuffer segment = buffers->Acquire(q.sysExCarryLength + length);
+    segment.append(q.sysExCarry, q.sysExCarryLength);
+    segment.append(bytes, length);
+    q.sysExCarryLength = 0;
+
+    if (!ended) {
+        uint8_t keep = (uint8_t)(segment.size() % 3);
+        for (uint8_t k = 0; k < keep; k++)
+            q.sysExCarry[k] = segment[segment.size() - keep + k];
+        q.sysExCarryLength = keep;
+        segment.resize(segment.size() - keep);
+    }
+    QueueSysEx(cable, std::move(segment), ended);
+}
+
+void MIDITransmitter::QueueSysEx(uint8_t cable, PooledBuffer segment, bool ended)
+{
+    if (segment.empty()) return;
+    CableQueue &q = cables[cable];
+    PendingMessage m;
+    m.sysEx = std::move(segment);
+
+    // A whole DT1 write may be folded into one still waiting at the tail of
+    // the queue; anything queued in between ends the merge, so order against
+    // other traffic is unchanged.
+    RolandDT1 dt1;
+    if ((config.mergeDT1Cables & (1u << cable)) && ended && m.sysEx[0] == 0xF0
+        && ParseRolandDT1(m.sysEx.data(), m.sysEx.size(), dt1)) {
+        if (!q.pending.empty() && q.pending.back().dt1 && q.pending.back().offset == 0) {
+            PendingMessage &tail = q.pending.back();
+            uint32_t before = tail.sysEx.size();
+            // Merged in place; a tail outgrowing its block moves up a size
+            // class, and one shared with other queues (a broadcast) is copied
+            if (tail.sysEx.capacity() < before + dt1.dataLength || tail.sysEx.RefCount() > 1) {
+                PooledBuffer larger = buffers->Acquire(before + dt1.dataLength);
+                larger.append(tail.sysEx.data(), before);
+                tail.sysEx = std::move(larger);
+            }
+            uint32_t after = before;
+            if (MergeRolandDT1(tail.sysEx.data(), after, tail.sysEx.capacity(),
+                               dt1, config.dt1MaxDataBytes)) {
+                tail.sysEx.resize(after);
+                queuedBytes += after - before;
+                q.queuedBytes += after - before;
+                q.peakQueuedBytes = std::max(q.peakQueuedBytes, q.queuedBytes);
+                stats.dt1Merged++;
+                return;
+            }
+        }
+        m.dt1 = true;
+        m.holdUntil = clock->NowNanos() + config.dt1MergeWindowNs;
+    }
+
+    queuedBytes += m.sysEx.size();
+    q.queuedBytes += m.sysEx.size();
+    q.peakQueuedBytes = std::max(q.peakQueuedBytes, q.queuedBytes);
+    q.pending.push_back(std::move(m));
+    stats.messagesQueued++;
+}
+
+bool MIDITransmitter::Enqueue(uint8_t cable, const uint8_t *data, uint32_t length)
+{
+    if (!data || length == 0 || cable >= kUSBMIDINumCables) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queuedBytes + length > config.maxQueuedBytes) {
+            stats.messagesDropped++;
+            return false;
+        }
+
+        // Split the packet into individual messages so that each queue entry
+        // is either one short message or one SysEx segment.
+        struct Sink {
+            MIDITransmitter &tx;
+            uint8_t cable;
+            void RealTime(uint8_t b) { tx.EnqueueRealTime(cable, b); }
+            void Short(const uint8_t *msg, uint8_t n) { tx.EnqueueShort(cable, msg, n); }
+            void SysEx(const uint8_t *bytes, uint32_t n, bool ended) { tx.EnqueueSysEx(cable, bytes, n, ended); }
+            void EndSysEx() { tx.cables[cable].sysExCarryLength = 0; }
+        } sink = { *this, cable };
+        SplitMIDIMessages(data, length, cables[cable].sysExOpen, sink);
+
+        wakePending = true;
+    }
+    wakeCond.notify_one();
+    return true;
+}
+
+bool MIDITransmitter::EnqueueBatch(uint8_t cable, const MIDIMessageBatch &batch)
+{
+    if (batch.Empty() || cable >= kUSBMIDINumCables) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queuedBytes + batch.Bytes() > config.maxQueuedBytes) {
+            stats.messagesDropped++;
+            return false;
+        }
+
+        CableQueue &q = cables[cable];
+        for (const MIDIMessageBatch::Entry &e : batch.Entries()) {
+            if (e.shortLength == 1 && e.shortBytes[0] >= 0xF8) {
+                EnqueueRealTime(cable, e.shortBytes[0]);
+            } else if (e.shortLength) {
+                q.sysExOpen = false;
+                q.sysExCarryLength = 0;
+                EnqueueShort(cable, e.shortBytes, e.shortLength);
+            } else if (!q.sysExOpen && e.sysEx[0] != 0xF0) {
+                // The rest of a SysEx this cable never saw start, e.g. the
+                // device joined a broadcast group in the middle of it;
+                // dropped as Enqueue drops stray data bytes
+                continue;
+            } else {
+                // Shared as it is, unless this cable kept back bytes of its
+                // own SysEx for the segment to join
+                if (q.sysExCarryLength)
+                    EnqueueSysEx(cable, e.sysEx.data(), e.sysEx.size(), e.sysExEnded);
+                else
+                    QueueSysEx(cable, e.sysEx, e.sysExEnded);
+                q.sysExOpen = !e.sysExEnded;
+            }
+        }
+        wakePending = true;
+    }
+    wakeCond.notify_one();
+    return true;
+}
+
+// ---------- Transmit ----------
+
+uint64_t MIDITransmitter::ChunkGapNs() const
+{
+    return config.minSysExChunkGapNs ? pacer.GapNs() : config.sysExChunkGapNs;
+}
+
+uint32_t MIDITransmitter::BuildTransfer(uint64_t now, uint8_t *buffer, uint32_t capacity,
+                                        uint64_t *nextDue, bool *pacedChunk)
+{
+    uint32_t used = 0;
+
+    for (uint8_t k = 0; k < kUSBMIDINumCables; k++) {
+        uint8_t c = (uint8_t)((nextCable + k) & 0x0F);
+        CableQueue &q = cables[c];
+
+        // Real-time bytes are never held back by pacing or the shaper; they
+        // still use up the shaper's budget so the wire rate holds overall.
+        while (q.realTimeCount) {
+            if (used + 4 > capacity) goto full;
+            used += USBMIDIBuildBulkOut(&q.realTime[q.realTimeHead], 1, c,
+                                        buffer + used, capacity - used);
+            q.realTimeHead = (uint8_t)((q.realTimeHead + 1) % kRealTimeQueueSize);
+            q.realTimeCount--;
+            q.shaper.Consume(now, 1);
+            stats.midiBytesSent++;
+            stats.messagesSent++;
+            q.sent.messages++;
+            q.sent.bytes++;
+        }
+
+        while (!q.pending.empty()) {
+            PendingMessage &m = q.pending.front();
+
+            if (m.shortLength) {
+                if (q.shaper.Enabled() && q.shaper.Available(now) < m.shortLength) {
+                    *nextDue = EarliestDue(*nextDue, q.shaper.DueTime(m.shortLength));
+                    q.shaperHolds++;
+                    break;
+                }
+                if (used + 4 > capacity) goto full;
+                used += USBMIDIBuildBulkOut(m.shortBytes, m.shortLength, c,
+                                            buffer + used, capacity - used);
+                noteTracker.Observe(c, m.shortBytes, m.shortLength);
+                q.shaper.Consume(now, m.shortLength);
+                stats.midiBytesSent += m.shortLength;
+                stats.messagesSent++;
+                q.sent.messages++;
+                q.sent.bytes += m.shortLength;
+                queuedBytes -= m.shortLength;
+                q.queuedBytes -= m.shortLength;
+                PopFront(q);
+                continue;
+            }
+
+            // A DT1 that nothing has been queued behind waits out its merge
+            // window; once anything follows it can no longer grow.
+            if (m.dt1 && m.offset == 0 && m.holdUntil > now && q.pending.size() == 1) {
+                *nextDue = EarliestDue(*nextDue, m.holdUntil);
+                break;
+            }
+
+            uint32_t size = m.sysEx.size();
+            uint32_t chunkSize = config.sysExChunkSize;
+            bool shaped = q.shaper.Enabled();
+            if (shaped) {
+                // A DIN-backed cable is paced by its shaper: wait for a batch
+                // worth a wakeup, then send as much as the budget allows.
+                uint32_t batch = std::min({ size - m.offset, chunkSize, q.shaper.BurstBytes() });
+                uint32_t available = q.shaper.Available(now);
+                if (available < batch) {
+                    *nextDue = EarliestDue(*nextDue, q.shaper.DueTime(batch));
+                    q.shaperHolds++;
+                    break;
+                }
+                chunkSize = std::min(chunkSize, std::max(3u, available / 3 * 3));
+            } else if (sysExPacedUntil > now) {
+                // SysEx segment: paced device-wide, strict order within the cable
+                if (sysExPacedUntil != kAwaitingCompletion)
+                    *nextDue = EarliestDue(*nextDue, sysExPacedUntil);
+                break;
+            } else if (sysExSinceGap) {
+                // Continuation of a chunk started by an earlier fragment
+                uint32_t left = chunkSize > sysExSinceGap ? chunkSize - sysExSinceGap : 0;
+                chunkSize = std::max(3u, left / 3 * 3);
+            }
+
+            uint32_t want = std::min(size - m.offset, chunkSize + 2);
+            uint32_t need = ((want + 2) / 3) * 4;
+            if (used > 0 && used + need > capacity) goto full;
+
+            uint32_t before = m.offset;
+            bool end = false;
+            uint32_t n = USBMIDIBuildSysExChunk(m.sysEx.data(), size, &m.offset, c,
+                                                chunkSize,
+                                                buffer + used, capacity - used, &end);
+            if (n == 0) goto full;
+            used += n;
+
+            uint32_t sent = m.offset - before;
+            q.shaper.Consume(now, sent);
+            stats.midiBytesSent += sent;
+            q.sent.bytes += sent;
+            q.sent.sysExBytes += sent;
+            queuedBytes -= sent;
+            q.queuedBytes -= sent;
+            q.sysExOnWire = !end;
+
+            bool complete = m.offset >= size;
+            if (complete) {
+                stats.messagesSent++;
+                q.sent.messages++;
+                PopFront(q);   // m is gone from here on
+            }
+            if (end || shaped) {
+                sysExSinceGap = 0;
+            } else {
+                // More of this SysEx follows. Once a full chunk has gone out
+                // (possibly gathered from small fragments, e.g. thru traffic)
+                // hold further chunks back; Pump() moves the deadline once
+                // the write has completed.
+                sysExSinceGap += sent;
+                if (sysExSinceGap >= config.sysExChunkSize || !complete) {
+                    sysExSinceGap = 0;
+                    *pacedChunk = true;
+                    sysExPacedUntil = now + ChunkGapNs();
+                    *nextDue = EarliestDue(*nextDue, sysExPacedUntil);
+                    break;
+                }
+            }
+        }
+    }
+
+full:
+    nextCable = (uint8_t)((nextCable + 1) & 0x0F);
+    if (used) stats.transfers++;
+    return used;
+}
+
+void MIDITransmitter::ResizeTxBuffer()
+{
+    size_t needed = (size_t)config.maxWritesInFlight * config.maxTransferSize;
+    if (txBuffer.size() == needed && txSlotSize == config.maxTransferSize) return;
+    // Writes in flight still read the old slots, which move even when the
+    // total size doesn't; the buffer is kept until the last write submitted
+    // from it has retired
+    if (!inFlight.empty()) {
+        RetiredTxBuffer retired;
+        retired.storage.swap(txBuffer);
+        retired.lastTag = nextWriteTag - 1;
+        retiredTxBuffers.push_back(std::move(retired));
+    }
+    txBuffer.assign(needed, 0);
+    txSlotSize = config.maxTransferSize;
+}
+
+bool MIDITransmitter::HasBacklog() const
+{
+    if (queuedBytes) return true;
+    for (const CableQueue &q : cables)
+        if (q.realTimeCount) return true;
+    return false;
+}
+
+uint64_t MIDITransmitter::Pump()
+{
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+
+    uint64_t nextDue = 0;
+    while (!flushRequested.load(std::memory_order_acquire)) {
+        uint32_t length;
+        bool pacedChunk = false;
+        uint64_t started;
+        uint8_t *buffer;
+        uint64_t tag = 0;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            nextDue = 0;
+            bool async = pipe->CanSubmitTransfers();
+            // Switching to synchronous writes waits for the last ones in flight
+            if (!async && !inFlight.empty()) break;
+            if (async && inFlight.size() >= window.Depth()) {
+                // The next completion frees a slot and wakes the thread
+                if (HasBacklog()) windowLimits++;
+                break;
+            }
+
+            started = clock->NowNanos();
+            uint32_t slot = async ? (uint32_t)(nextWriteTag % config.maxWritesInFlight) : 0;
+            buffer = txBuffer.data() + (size_t)slot * config.maxTransferSize;
+            length = BuildTransfer(started, buffer, config.maxTransferSize, &nextDue, &pacedChunk);
+
+            if (length && async) {
+                InFlightWrite w;
+                w.tag = tag = nextWriteTag++;
+                w.submitted = started;
+                w.limitsAtSubmit = windowLimits;
+                w.pacedChunk = pacedChunk;
+                inFlight.push_back(std::move(w));
+                stats.peakWritesInFlight = std::max(stats.peakWritesInFlight,
+                                                    (uint32_t)inFlight.size());
+                if (pacedChunk) sysExPacedUntil = kAwaitingCompletion;
+            }
+        }
+        if (length == 0) break;
+
+        if (tag) {
+            if (!pipe->SubmitTransfer(buffer, length, tag))
+                OnWriteCompleted(tag, false);
+            continue;
+        }
+
+        bool ok = pipe->WriteTransfer(buffer, length);
+        uint64_t completed = clock->NowNanos();
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!ok) stats.writeErrors++;
+        if (pacedChunk) {
+            // The gap runs from completion: a write the device NAKed for a
+            // while has not given its buffer any time to drain yet.
+            if (config.minSysExChunkGapNs)
+                pacer.OnChunkCompleted(completed - started, !ok);
+            sysExPacedUntil = completed + ChunkGapNs();
+            stats.pacingWaitNs += ChunkGapNs();
+        }
+    }
+    return nextDue;
+}
+
+void MIDITransmitter::OnWriteCompleted(uint64_t tag, bool ok)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        size_t i = 0;
+        while (i < inFlight.size() && (inFlight[i].tag != tag || inFlight[i].completed)) i++;
+        if (i == inFlight.size()) return;   // Abandoned
+
+        InFlightWrite &w = inFlight[i];
+        if (i > 0 && !inFlight[0].completed) stats.writesOutOfOrder++;
+        w.completed = std::max<uint64_t>(clock->NowNanos(), 1);
+        w.ok = ok;
+        RetireWrites();
+        wakePending = true;
+    }
+    wakeCond.notify_one();
+}
+
+void MIDITransmitter::RetireWrites()
+{
+    while (!inFlight.empty() && inFlight.front().completed) {
+        InFlightWrite &w = inFlight.front();
+        if (!w.ok) stats.writeErrors++;
+        window.OnCompleted(w.completed - w.submitted, !w.ok, windowLimits > w.limitsAtSubmit);
+        if (w.pacedChunk) {
+            // Writes ahead of the chunk are not the device's doing: the
+            // pacer sees only the time from when the pipe got to it
+            uint64_t reached = std::max(w.submitted, lastCompletion);
+            if (config.minSysExChunkGapNs)
+                pacer.OnChunkCompleted(w.completed > reached ? w.completed - reached : 0, !w.ok);
+            sysExPacedUntil = w.completed + ChunkGapNs();
+            stats.pacingWaitNs += ChunkGapNs();
+        }
+        lastCompletion = std::max(lastCompletion, w.completed);
+        inFlight.pop_front();
+    }
+    uint64_t oldest = inFlight.empty() ? UINT64_MAX : inFlight.front().tag;
+    retiredTxBuffers.erase(std::remove_if(retiredTxBuffers.begin(), retiredTxBuffers.end(),
+                                          [oldest](const RetiredTxBuffer &r) { return r.lastTag < oldest; }),
+                           retiredTxBuffers.end());
+}
+
+void MIDITransmitter::AbandonWrites()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    inFlight.clear();
+    retiredTxBuffers.clear();
+    if (sysExPacedUntil == kAwaitingCompletion) sysExPacedUntil = 0;
+    window.Reset();
+}
+
+// ---------- Flush ----------
+
+uint32_t MIDITransmitter::BuildFlush(uint8_t cable, std::vector<uint8_t> &out)
+{
+    uint32_t before = (uint32_t)out.size();
+    CableQueue &q = cables[cable];
+
+    // Close an interrupted SysEx so the device's parser resynchronises.
+    // Roland units discard it on the checksum.
+    if (q.sysExOnWire) {
+        out.insert(out.end(), { (uint8_t)(cable << 4 | kCIN_SysExEnd1Byte), 0xF7, 0x00, 0x00 });
+        q.sysExOnWire = false;
+        stats.sysExAborted++;
+    }
+
+    uint8_t noteOffs[96];
+    uint8_t usb[128];
+    uint32_t n;
+    while ((n = noteTracker.ReleaseAll(cable, noteOffs, sizeof(noteOffs))) > 0) {
+        uint32_t usbLen = USBMIDIBuildBulkOut(noteOffs, n, cable, usb, sizeof(usb));
+        out.insert(out.end(), usb, usb + usbLen);
+        stats.notesReleased += n / 3;
+    }
+
+    return (uint32_t)out.size() - before;
+}
+
+void MIDITransmitter::Flush(int cable)
+{
+    // Ask a running Pump() to stop after its current transfer, then take the pipe.
+    flushRequested.fetch_add(1, std::memory_order_acq_rel);
+    std::vector<uint8_t> out;
+    uint32_t chunk;
+    {
+        std::lock_guard<std::mutex> writeLock(writeMutex);
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (uint8_t c = 0; c < kUSBMIDINumCables; c++) {
+                if (cable >= 0 && c != (uint8_t)cable) continue;
+                CableQueue &q = cables[c];
+                queuedBytes -= q.queuedBytes;
+                ClearCable(q);
+                BuildFlush(c, out);
+            }
+
+            bool sysExActive = false;
+            for (auto &q : cables)
+                sysExActive |= q.sysExOnWire;
+            if (!sysExActive) {
+                sysExPacedUntil = 0;
+                sysExSinceGap = 0;
+            }
+
+            stats.flushes++;
+            chunk = config.maxTransferSize;
+        }
+
+        for (size_t off = 0; off < out.size(); off += chunk) {
+            uint32_t len = (uint32_t)std::min<size_t>(chunk, out.size() - off);
+            if (!pipe->WriteTransfer(out.data() + off, len)) {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stats.writeErrors++;
+            }
+        }
+    }
+    flushRequested.fetch_sub(1, std::memory_order_acq_rel);
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        wakePending = true;
+    }
+    wakeCond.notify_one();
+}
+
+void MIDITransmitter::PopFront(CableQueue &q)
+{
+    q.pending.pop_front();
+    q.headSeq++;
+}
+
+void MIDITransmitter::ClearCable(CableQueue &q)
+{
+    stats.messagesFlushed += q.pending.size() + q.realTimeCount;
+    q.headSeq += q.pending.size();
+    q.pending.clear();
+    q.realTimeHead = 0;
+    q.realTimeCount = 0;
+    q.queuedBytes = 0;
+    q.sysExOpen = false;
+    q.sysExCarryLength = 0;
+}
+
+void MIDITransmitter::Discard()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    for (auto &q : cables) {
+        ClearCable(q);
+        q.sysExOnWire = false;
+        q.shaper.Reset();
+    }
+    noteTracker.Reset();
+    queuedBytes = 0;
+    sysExPacedUntil = 0;
+    sysExSinceGap = 0;
+    inFlight.clear();
+    retiredTxBuffers.clear();
+    window.Reset();
+}
+
+// ---------- Thread ----------
+
+void MIDITransmitter::Start(const IOThreadPolicy &policy)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (running) return;
+    running = true;
+    wakePending = true;
+    thread = std::thread(&MIDITransmitter::ThreadMain, this, policy);
+}
+
+void MIDITransmitter::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!running) return;
+        running = false;
+        wakePending = true;
+    }
+    wakeCond.notify_one();
+    if (thread.joinable())
+        thread.join();
+}
+
+void MIDITransmitter::ThreadMain(IOThreadPolicy policy)
+{
+    SetIOThreadName("MIDITransmitter");
+    ApplyIOThreadPolicy(policy);
+
+    for (;;) {
+        uint64_t nextDue = Pump();
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (!running) break;
+        if (wakePending) {
+            wakePending = false;
+            continue;
+        }
+
+        auto woken = [this] { return !running || wakePending; };
+        if (nextDue == 0) {
+            wakeCond.wait(lock, woken);
+        } else {
+            uint64_t now = clock->NowNanos();
+            if (nextDue > now)
+                wakeCond.wait_for(lock, std::chrono::nanoseconds(nextDue - now), woken);
+        }
+        wakePending = false;
+    }
+}
+
+// ---------- Introspection ----------
+
+size_t MIDITransmitter::PendingMessages(int cable) const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    size_t n = 0;
+    for (uint8_t c = 0; c < kUSBMIDINumCables; c++) {
+        if (cable < 0 || c == (uint8_t)cable)
+            n += cables[c].pending.size() + cables[c].realTimeCount;
+    }
+    return n;
+}
+
+uint64_t MIDITransmitter::SysExGapNs() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return ChunkGapNs();
+}
+
+void MIDITransmitter::SeedSysExGap(uint64_t gapNs)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (config.minSysExChunkGapNs && gapNs)
+        pacer.Reset(gapNs);
+}
+
+MIDICableStats MIDITransmitter::GetCableStats(uint8_t cable) const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    MIDICableStats s;
+    if (cable >= kUSBMIDINumCables) return s;
+    const CableQueue &q = cables[cable];
+    s.pendingMessages  = (uint32_t)q.pending.size() + q.realTimeCount;
+    s.pendingBytes     = q.queuedBytes + q.realTimeCount;
+    s.peakPendingBytes = q.peakQueuedBytes;
+    s.shaperHolds      = q.shaperHolds;
+    s.sent             = q.sent;
+    return s;
+}
+
+MIDITransmitterStats MIDITransmitter::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    MIDITransmitterStats s = stats;
+    s.sysExGapNs = ChunkGapNs();
+    s.pacingStalls = pacer.GetStats().stalls;
+    s.writesInFlight = (uint32_t)inFlight.size();
+    WriteWindowStats w = window.GetStats();
+    s.writeWindow = w.depth;
+    s.writeLatencyNs = w.latencyNs;
+    return s;
+}
@@ -0,0 +1,289 @@
+#ifndef MIDITransmitter_h
+#define MIDITransmitter_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BufferPool.h"
+#include "HostClock.h"
+#include "IOScheduler.h"
+#include "MIDIMessageBatch.h"
+#include "MIDINoteTracker.h"
+#include "PortStatistics.h"
+#include "RateShaper.h"
+#include "RingQueue.h"
+#include "SysExPacer.h"
+#include "USBMIDIParser.h"
+#include "WriteWindow.h"
+
+/// Destination for encoded USB-MIDI transfers (the device's bulk OUT pipe).
+class USBMIDIOutputPipe {
+public:
+    virtual ~USBMIDIOutputPipe() = default;
+
+    /// Write one USB-MIDI transfer and wait for completion. Returns false on failure.
+    virtual bool WriteTransfer(const uint8_t *data, uint32_t length) = 0;
+
+    /// Whether SubmitTransfer can be used right now.
+    virtual bool CanSubmitTransfers() const { return false; }
+
+    /// Start one transfer without waiting for it. The pipe reports the
+    /// completion to MIDITransmitter::OnWriteCompleted with the same tag and
+    /// leaves data untouched until then. Returns false if it was not started.
+    virtual bool SubmitTransfer(const uint8_t *data, uint32_t length, uint64_t tag)
+    {
+        (void)data; (void)length; (void)tag;
+        return false;
+    }
+};
+
+static constexpr uint32_t kDefaultSysExChunkSize  = 256;        // MIDI bytes per chunk
+static constexpr uint64_t kDefaultSysExChunkGapNs = 20000000;   // 20ms between chunks
+static constexpr uint32_t kDefaultMaxTransferSize = 512;        // bytes per bulk OUT transfer
+static constexpr uint32_t kDefaultMaxQueuedBytes  = 1 << 20;    // per device
+static constexpr uint64_t kDefaultDT1MergeWindowNs = 2000000;   // 2ms
+static constexpr uint32_t kDefaultDT1MaxDataBytes  = 128;
+
+struct MIDITransmitterConfig {
+    uint32_t sysExChunkSize  = kDefaultSysExChunkSize;
+    uint64_t sysExChunkGapNs = kDefaultSysExChunkGapNs;
+    uint32_t maxTransferSize = kDefaultMaxTransferSize;
+    uint32_t maxQueuedBytes  = kDefaultMaxQueuedBytes;
+    // Adaptive pacing: when non-zero, the gap starts at sysExChunkGapNs and is
+    // tuned from write completion latency, never going below this floor.
+    uint64_t minSysExChunkGapNs = 0;
+    // Cables that feed a 5-pin DIN output are held to its wire rate
+    // (bytes per second, 0 = unshaped). SysEx on a shaped cable is paced by
+    // the shaper instead of the chunk gap.
+    uint32_t cableBytesPerSecond[kUSBMIDINumCables] = {};
+    uint32_t shaperBurstBytes = kDefaultShaperBurstBytes;
+    // Cables (bit per cable) on which a queued controller, pitch bend or
+    // pressure value is overwritten by a newer one for the same target
+    uint16_t coalesceCables = 0;
+    // Cables (bit per cable) on which a Roland DT1 write is held back for up
+    // to dt1MergeWindowNs so that following writes to the same or the next
+    // addresses can be folded into it (see MergeRolandDT1)
+    uint16_t mergeDT1Cables   = 0;
+    uint64_t dt1MergeWindowNs = kDefaultDT1MergeWindowNs;
+    uint32_t dt1MaxDataBytes  = kDefaultDT1MaxDataBytes;
+    // Bulk OUT writes kept in flight when the pipe takes SubmitTransfer; the
+    // window adapts between 1 and this from write latency
+    uint32_t maxWritesInFlight = 1;
+};
+
+struct MIDITransmitterStats {
+    uint64_t messagesQueued    = 0;
+    uint64_t messagesSent      = 0;
+    uint64_t messagesDropped   = 0;   // queue full
+    uint64_t messagesFlushed   = 0;   // discarded by Flush
+    uint64_t midiBytesSent     = 0;
+    uint64_t transfers         = 0;
+    uint64_t writeErrors       = 0;
+    uint64_t flushes           = 0;
+    uint64_t notesReleased     = 0;   // Note Offs emitted by Flush
+    uint64_t sysExAborted      = 0;   // SysEx terminated early by Flush
+    uint64_t sysExGapNs        = 0;   // Current inter-chunk gap
+    uint64_t pacingStalls      = 0;   // SysEx writes that came back late (adaptive pacing)
+    uint64_t pacingWaitNs      = 0;   // Total chunk gap SysEx has been held back for
+    uint64_t messagesCoalesced = 0;   // Replaced in the queue by a newer value
+    uint64_t dt1Merged         = 0;   // DT1 writes folded into a queued one
+    uint32_t writesInFlight    = 0;   // Submitted, not yet completed
+    uint32_t peakWritesInFlight = 0;
+    uint32_t writeWindow       = 1;   // Writes currently allowed in flight
+    uint64_t writeLatencyNs    = 0;   // Smoothed submit-to-completion latency
+    uint64_t writesOutOfOrder  = 0;   // Completions reported ahead of an earlier write
+};
+
+/// Queue depth and traffic of one cable.
+struct MIDICableStats {
+    uint32_t pendingMessages  = 0;
+    uint32_t pendingBytes     = 0;
+    uint32_t peakPendingBytes = 0;   // High-water mark since start
+    uint64_t shaperHolds      = 0;   // Times the rate shaper held the cable back
+    MIDITrafficCounters sent;        // Encoded into transfers since start
+};
+
+/// Per-device outbound queue and pacing engine.
+///
+/// DrvSend enqueues MIDI bytes and returns immediately; queued messages are
+/// encoded into USB-MIDI transfers by Pump(), either from the transmitter's
+/// own thread (Start/Stop) or driven directly by tests with a fake clock.
+/// Order is strict per cable, except that real-time messages jump ahead of
+/// anything still queued on their cable, and (optionally, per cable)
+/// continuous controllers are coalesced while queued, and Roland DT1 writes
+/// to contiguous addresses are merged into one message while the last one
+/// queued is briefly held back. SysEx goes out in paced chunks; a chunk that
+/// does not end the message holds back further SysEx chunks on the device
+/// for the chunk gap after the write completes, while other cables keep
+/// flowing. The gap is fixed (sysExChunkGapNs) or learned by a SysExPacer.
+///
+/// With a pipe that takes SubmitTransfer, Pump() keeps a window of up to
+/// maxWritesInFlight writes in flight (sized by a WriteWindow) and
+/// the pipe reports completions through OnWriteCompleted. Writes retire in
+/// submission order whatever order completions arrive in; a paced SysEx
+/// chunk holds further chunks back until it has retired, and the gap runs
+/// from then.
+class MIDITransmitter : public MIDIBatchTarget {
+public:
+    explicit MIDITransmitter(USBMIDIOutputPipe *pipe, HostClock *clock = &DefaultHostClock());
+    ~MIDITransmitter() override;
+
+    MIDITransmitter(const MIDITransmitter &) = delete;
+    MIDITransmitter &operator=(const MIDITransmitter &) = delete;
+
+    void SetConfig(const MIDITransmitterConfig &config);
+    MIDITransmitterConfig GetConfig() const;
+
+    /// Pool queued SysEx is kept in; set before anything is queued. Until
+    /// then the transmitter's own, which holds no blocks and so allocates.
+    void SetBufferPool(BufferPool *pool) { buffers = pool; }
+
+    /// Queue the MIDI bytes of one MIDIPacket for a cable. Thread-safe.
+    /// Returns false if the queue is full and the bytes were dropped.
+    bool Enqueue(uint8_t cable, const uint8_t *data, uint32_t length);
+
+    /// Queue a batch split elsewhere, as Enqueue would each of its packets,
+    /// keeping references to its SysEx buffers rather than copies. The whole
+    /// batch is dropped if it does not fit. Thread-safe.
+    bool EnqueueBatch(uint8_t cable, const MIDIMessageBatch &batch) override;
+
+    /// Write every transfer that is due now. Returns the host time (ns) at
+    /// which the next paced chunk becomes due, or 0 if nothing is waiting.
+    uint64_t Pump();
+
+    /// Discard queued output for one cable (or all cables when cable < 0).
+    /// A SysEx cut off mid-message is closed with 0xF7 and every note left
+    /// sounding on the flushed cables gets a Note Off. Thread-safe.
+    void Flush(int cable);
+
+    /// Drop everything queued without writing (device going away).
+    void Discard();
+
+    /// Completion of a transfer started with SubmitTransfer. Thread-safe;
+    /// called from the pipe's completion context.
+    void OnWriteCompleted(uint64_t tag, bool ok);
+
+    /// Forget writes still in flight (the pipe was aborted); completions that
+    /// still arrive for them are ignored.
+    void AbandonWrites();
+
+    /// Run Pump() on a dedicated thread until Stop(). The policy is applied
+    /// to that thread, which services write completions and pacing timers.
+    void Start(const IOThreadPolicy &policy = IOThreadPolicy());
+    void Stop();
+
+    /// Messages waiting on a cable (or all cables when cable < 0).
+    size_t PendingMessages(int cable) const;
+
+    /// Gap currently applied between SysEx chunks.
+    uint64_t SysExGapNs() const;
+    /// Continue adaptive pacing from a gap learned in an earlier session.
+    void SeedSysExGap(uint64_t gapNs);
+
+    MIDITransmitterStats GetStats() const;
+    MIDICableStats GetCableStats(uint8_t cable) const;
+
+private:
+    struct PendingMessage {
+        uint8_t  shortBytes[3] = {};
+        uint8_t  shortLength   = 0;     // 1-3 for non-SysEx messages
+        int16_t  coalesceKey   = -1;    // Target this value may be replaced for
+        PooledBuffer sysEx;             // SysEx segment (F0.., continuation, ..F7)
+        uint32_t offset        = 0;     // SysEx bytes already sent
+        bool     dt1           = false; // Complete Roland DT1, later writes may merge in
+        uint64_t holdUntil     = 0;     // Merge window of a DT1 at the tail of the queue
+    };
+
+    static constexpr uint32_t kRealTimeQueueSize = 64;
+
+    struct InFlightWrite {
+        uint64_t tag        = 0;
+        uint64_t submitted  = 0;
+        uint64_t completed  = 0;       // 0 = still in flight
+        uint64_t limitsAtSubmit = 0;   // windowLimits when it was submitted
+        bool     pacedChunk = false;
+        bool     ok         = true;
+    };
+
+    struct CableQueue {
+        RingQueue<PendingMessage> pending;
+        uint8_t realTime[kRealTimeQueueSize] = {};   // Ring of real-time bytes, sent first
+        uint8_t realTimeHead  = 0;
+        uint8_t realTimeCount = 0;
+        uint32_t queuedBytes     = 0;
+        uint32_t peakQueuedBytes = 0;
+        uint64_t shaperHolds     = 0;
+        MIDITrafficCounters sent;
+        RateShaper shaper;
+        // Coalescing: sequence number of the newest queued message per
+        // target (seq + 1, 0 = none); pending[seq - headSeq] is that message.
+        std::vector<uint64_t> latestByKey;
+        uint64_t headSeq = 0;
+        bool sysExOpen   = false;   // Enqueue side: last packet left a SysEx unterminated
+        uint8_t sysExCarry[2] = {}; // Bytes of an open SysEx not yet filling a 3-byte packet
+        uint8_t sysExCarryLength = 0;
+        bool sysExOnWire = false;   // Wire side: device has seen F0 but not F7
+    };
+
+    void EnqueueShort(uint8_t cable, const uint8_t *bytes, uint8_t length);
+    void EnqueueRealTime(uint8_t cable, uint8_t byte);
+    void ClearCable(CableQueue &q);
+    void PopFront(CableQueue &q);
+    void EnqueueSysEx(uint8_t cable, const uint8_t *bytes, uint32_t length, bool ended);
+    void QueueSysEx(uint8_t cable, PooledBuffer segment, bool ended);
+    uint32_t BuildTransfer(uint64_t now, uint8_t *buffer, uint32_t capacity, uint64_t *nextDue,
+                           bool *pacedChunk);
+    uint64_t ChunkGapNs() const;
+    uint32_t BuildFlush(uint8_t cable, std::vector<uint8_t> &out);
+    bool HasBacklog() const;
+    void RetireWrites();
+    void ResizeTxBuffer();
+    void ThreadMain(IOThreadPolicy policy);
+
+    USBMIDIOutputPipe *pipe;
+    HostClock         *clock;
+
+    mutable std::mutex queueMutex;      // queues, tracker, stats, config
+    std::mutex         writeMutex;      // one writer on the pipe at a time
+    std::condition_variable wakeCond;
+
+    MIDITransmitterConfig config;
+    BufferPool        ownBuffers;
+    BufferPool       *buffers = &ownBuffers;
+    CableQueue        cables[kUSBMIDINumCables];
+    MIDINoteTracker   noteTracker;
+    MIDITransmitterStats stats;
+    SysExPacer        pacer;
+    uint64_t          sysExPacedUntil = 0;
+    uint32_t          sysExSinceGap   = 0;   // SysEx bytes sent since the last gap
+    uint32_t          queuedBytes     = 0;
+    uint8_t           nextCable       = 0;   // Round-robin start
+
+    // Slot buffers replaced while writes still read them, oldest first
+    struct RetiredTxBuffer {
+        std::vector<uint8_t> storage;
+        uint64_t lastTag = 0;   // Newest write submitted from it
+    };
+
+    std::vector<uint8_t> txBuffer;        // One transfer per write slot
+    uint32_t          txSlotSize     = 0;   // Slot stride txBuffer was laid out with
+    std::vector<RetiredTxBuffer> retiredTxBuffers;
+
+    // Asynchronous writes, oldest first
+    RingQueue<InFlightWrite> inFlight;
+    WriteWindow       window;
+    uint64_t          nextWriteTag   = 1;
+    uint64_t          windowLimits   = 0;   // Times Pump() left data waiting for a slot
+    uint64_t          lastCompletion = 0;
+    std::atomic<int>  flushRequested{0};     // Flush() calls waiting for the pipe
+
+    std::thread       thread;
+    bool              running      = false;
+    bool              wakePending  = false;
+};
+
+#endif /* MIDITransmitter_h */
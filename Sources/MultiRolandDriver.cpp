@@ -1,13 +1,14 @@
 #include "RolandUSBDevice.h"
 #include "USBMIDIParser.h"
+#include "PersistentDeviceIndex.h"
+#include "DeviceRegistry.h"
+#include "MIDIBroadcast.h"
 #include <CoreMIDI/MIDIDriver.h>
 #include <CoreMIDI/MIDISetup.h>
 #include <IOKit/usb/IOUSBLib.h>
 #include <IOKit/IOMessage.h>
 #include <os/log.h>
-#include <mach/mach.h>
-#include <mach/mach_time.h>
-#include <mach/thread_policy.h>
+#include <algorithm>
 #include <vector>
 #include <mutex>
 
@@ -18,11 +19,63 @@ static os_log_t sLog = os_log_create("se.cutup.MultiRolandDriver", "driver");
 #define kRolandLocationProperty     CFSTR("Roland-Loc")
 #define kRolandVendorProductProperty CFSTR("Roland-VP")
 
+// Broadcast destinations live on a MIDIDevice of their own, marked with
+// Roland-Broadcast = 1. Each of its entities stores its group the same way:
+// 0 = every Roland device, otherwise the product ID of the model whose units
+// it reaches. Their endpoint refCons carry the group above the 32 bits of a
+// port handle.
+#define kRolandBroadcastProperty     CFSTR("Roland-Broadcast")
+static constexpr uintptr_t kBroadcastRefConTag  = (uintptr_t)1 << 32;
+static constexpr uint32_t  kBroadcastAllDevices = 0;
+
+// PersistentDeviceStore over a CoreMIDI device list (null for writes only)
+class MIDIDeviceListStore : public PersistentDeviceStore {
+public:
+    explicit MIDIDeviceListStore(MIDIDeviceListRef list) : list(list) {}
+
+    size_t Count() override
+    {
+        return list ? (size_t)MIDIDeviceListGetNumberOfDevices(list) : 0;
+    }
+    uint32_t DeviceAt(size_t index) override
+    {
+        return MIDIDeviceListGetDevice(list, (ItemCount)index);
+    }
+    bool GetInteger(uint32_t ref, PersistentDeviceKey key, int32_t &value) override
+    {
+        SInt32 v = 0;
+        if (MIDIObjectGetIntegerProperty(ref, PropertyName(key), &v) != noErr) return false;
+        value = v;
+        return true;
+    }
+    void SetInteger(uint32_t ref, PersistentDeviceKey key, int32_t value) override
+    {
+        MIDIObjectSetIntegerProperty(ref, PropertyName(key), value);
+    }
+
+private:
+    static CFStringRef PropertyName(PersistentDeviceKey key)
+    {
+        return key == PersistentDeviceKey::Location ? kRolandLocationProperty
+                                                    : kRolandVendorProductProperty;
+    }
+
+    MIDIDeviceListRef list;
+};
+
 // Factory UUID — must match Info.plist CFPlugInFactories key
 #define kDriverFactoryUUID CFUUIDGetConstantUUIDWithBytes(NULL, \
     0xE3, 0xE5, 0xB6, 0xC8, 0x2F, 0x4A, 0x4B, 0x1D, \
     0x9C, 0x7E, 0xA8, 0xD2, 0xF1, 0xB3, 0xC5, 0xE7)
 
+// Clock generator thread: wakes once per pulse (at most every 6.25 ms) and
+// may spin up to the generator's lead time before handing pulses off
+static const IOThreadPolicy kClockThreadPolicy = { 1000000, 300000, 1000000 };
+
+// Devices tracked at once, online or kept offline for reconnection; the one
+// offline longest is dropped to make room
+static constexpr size_t kMaxDevices = 32;
+
 // ---------- Forward declarations ----------
 static HRESULT  DrvQueryInterface(void *self, REFIID iid, LPVOID *ppv);
 static ULONG    DrvAddRef(void *self);
@@ -61,11 +114,7 @@ static MIDIDriverInterface sDriverVtable = {
     DrvMonitorEvents
 };
 
-// ---------- Port mapping for outgoing MIDI routing ----------
-struct PortMapping {
-    RolandUSBDevice *device;
-    uint8_t cable;
-};
+typedef DeviceRegistry<RolandUSBDevice> RolandDeviceRegistry;
 
 // ---------- Driver state ----------
 struct MultiRolandDriverState {
@@ -74,15 +123,33 @@ struct MultiRolandDriverState {
     int    mVersion;               // 1 = kMIDIDriverInterfaceID, 2 = kMIDIDriverInterface2ID
     CFUUIDRef factoryID;
 
-    std::vector<RolandUSBDevice *> devices;
-    std::vector<PortMapping> portMappings;
+    // Devices and their destination ports; endpoint refCons hold port
+    // handles that DrvSend validates
+    RolandDeviceRegistry registry{kMaxDevices, kMaxDevices * kMaxPortsPerDevice};
     std::mutex devicesMutex;
 
+    // Thru routes between our own ports (Roland-Thru entity property)
+    MIDIRouter router;
+
+    // Driver-generated clock, sent to ports with Roland-ClockOut set
+    MIDIClockGenerator clockGenerator;
+
+    // Broadcast destinations and the MIDIDevice that carries them
+    MIDIBroadcast broadcast;
+    MIDIDeviceRef broadcastDevice = 0;
+
+    // Persistent MIDIDevices by Roland-Loc / Roland-VP, loaded once per
+    // start and kept for hotplug
+    PersistentDeviceIndex persistentIndex;
+
     // USB hotplug notification
     IONotificationPortRef notifyPort;
     io_iterator_t addedIter;
     CFRunLoopRef runLoop;
 
+    // Releases idle lazy devices and publishes Roland-Activity
+    CFRunLoopTimerRef activityTimer;
+
     MultiRolandDriverState()
         : vtable(&sDriverVtable)
         , refCount(1)
@@ -90,10 +157,11 @@ struct MultiRolandDriverState {
         , factoryID(nullptr)
         , notifyPort(nullptr)
         , addedIter(0)
-        , runLoop(nullptr) {}
+        , runLoop(nullptr)
+        , activityTimer(nullptr) {}
 
     ~MultiRolandDriverState() {
-        for (auto *dev : devices)
+        for (auto *dev : registry.Devices())
             delete dev;
     }
 };
@@ -156,6 +224,31 @@ static ULONG DrvRelease(void *self)
     return count;
 }
 
+// ---------- Device registry ----------
+
+// Track a new device, dropping the device offline longest if the registry
+// is full. False (and the caller deletes dev) if every slot is online.
+static bool RegisterDevice(MultiRolandDriverState *state, RolandUSBDevice *dev)
+{
+    RolandUSBDevice *evicted = nullptr;
+    if (!state->registry.Add(dev, &evicted)) {
+        os_log_error(sLog, "RegisterDevice: %zu devices online, ignoring %{public}s",
+                     kMaxDevices, dev->deviceInfo->name);
+        return false;
+    }
+    if (evicted) {
+        os_log(sLog, "RegisterDevice: dropped %{public}s (locationID=0x%llx, offline longest)",
+               evicted->deviceInfo->name, evicted->locationID);
+        // Its MIDIDevice stays in the setup, offline, for when it returns.
+        // Its endpoints keep their refCons; the handles no longer validate.
+        // DrvSend may still be inside a lookup that found it.
+        state->persistentIndex.Release(evicted->midiDevice);
+        state->registry.WaitForReaders();
+        delete evicted;
+    }
+    return true;
+}
+
 // ---------- USB scanning ----------
 
 static void ScanUSBDevices(MultiRolandDriverState *state, MIDIDriverRef driverRef)
@@ -205,7 +298,7 @@ static void ScanUSBDevices(MultiRolandDriverState *state, MIDIDriverRef driverRe
                 }
 
                 bool alreadyTracked = false;
-                for (auto *dev : state->devices) {
+                for (auto *dev : state->registry.Devices()) {
                     if (dev->locationID == (uint64_t)locID) {
                         alreadyTracked = true;
                         break;
@@ -216,9 +309,11 @@ static void ScanUSBDevices(MultiRolandDriverState *state, MIDIDriverRef driverRe
                     auto *dev = new RolandUSBDevice(usbService, info);
                     dev->driverRef = driverRef;
                     dev->locationID = locID;
-                    state->devices.push_back(dev);
-                    os_log(sLog, "Found %{public}s (PID 0x%04X)",
-                           info->name, info->productID);
+                    if (RegisterDevice(state, dev))
+                        os_log(sLog, "Found %{public}s (PID 0x%04X)",
+                               info->name, info->productID);
+                    else
+                        delete dev;
                 }
             }
         }
@@ -229,30 +324,10 @@ static void ScanUSBDevices(MultiRolandDriverState *state, MIDIDriverRef driverRe
     IOObjectRelease(iter);
 }
 
-// ---------- Realtime thread priority ----------
-
-static void SetRealtimePriority()
-{
-    mach_timebase_info_data_t timebase;
-    mach_timebase_info(&timebase);
-    double nsToAbs = (double)timebase.denom / (double)timebase.numer;
-
-    thread_time_constraint_policy_data_t policy;
-    policy.period      = (uint32_t)(1000000 * nsToAbs);  // 1ms
-    policy.computation = (uint32_t)(500000 * nsToAbs);   // 0.5ms
-    policy.constraint  = (uint32_t)(1000000 * nsToAbs);  // 1ms
-    policy.preemptible = true;
-
-    thread_policy_set(mach_thread_self(),
-                      THREAD_TIME_CONSTRAINT_POLICY,
-                      (thread_policy_t)&policy,
-                      THREAD_TIME_CONSTRAINT_POLICY_COUNT);
-
-    os_log(sLog, "Realtime thread priority set");
-}
-
 // ---------- Device removal callback ----------
 
+static void RebuildRoutes(MultiRolandDriverState *state);
+
 static void DeviceRemoved(void *refCon, io_service_t /*service*/,
                            natural_t messageType, void * /*messageArgument*/)
 {
@@ -261,8 +336,7 @@ static void DeviceRemoved(void *refCon, io_service_t /*service*/,
     auto *dev = static_cast<RolandUSBDevice *>(refCon);
     os_log(sLog, "DeviceRemoved: %{public}s disconnected", dev->deviceInfo->name);
 
-    dev->StopIO();
-    dev->Close();
+    dev->Detach();
     dev->isOnline = false;
 
     // Mark offline so Audio MIDI Setup grays it out.
@@ -275,6 +349,15 @@ static void DeviceRemoved(void *refCon, io_service_t /*service*/,
         IOObjectRelease(dev->removalNotification);
         dev->removalNotification = 0;
     }
+
+    // Drop thru routes into the departed device; kept for reconnection
+    // until the registry needs its slot
+    if (dev->driverRef) {
+        auto *state = GetState(dev->driverRef);
+        std::lock_guard<std::mutex> lock(state->devicesMutex);
+        state->registry.SetOffline(dev, true);
+        RebuildRoutes(state);
+    }
 }
 
 static void RegisterRemovalNotification(MultiRolandDriverState *state, RolandUSBDevice *dev)
@@ -293,7 +376,8 @@ static void RegisterRemovalNotification(MultiRolandDriverState *state, RolandUSB
 }
 
 // Defined after DeviceAdded — forward-declared here so DeviceAdded can call them
-static MIDIDeviceRef FindOrCreateMIDIDevice(MIDIDriverRef driverRef, RolandUSBDevice *dev);
+static MIDIDeviceRef FindOrCreateMIDIDevice(MultiRolandDriverState *state, MIDIDriverRef driverRef,
+                                            RolandUSBDevice *dev);
 static void SetupPortMappings(MultiRolandDriverState *state, RolandUSBDevice *dev);
 
 // ---------- Hotplug callback ----------
@@ -349,7 +433,7 @@ static void DeviceAdded(void *refCon, io_iterator_t iterator)
                 // (happens when the drain in DrvStart sees a device that
                 // FindDevices + DrvStart already opened).
                 bool alreadyOnline = false;
-                for (auto *dev : state->devices) {
+                for (auto *dev : state->registry.Devices()) {
                     if (dev->isOnline && dev->locationID == (uint64_t)locID) {
                         alreadyOnline = true;
                         break;
@@ -363,7 +447,7 @@ static void DeviceAdded(void *refCon, io_iterator_t iterator)
                 // Check if we already have an offline device with same locationID
                 // (device was disconnected and reconnected).
                 RolandUSBDevice *existingDev = nullptr;
-                for (auto *dev : state->devices) {
+                for (auto *dev : state->registry.Devices()) {
                     if (!dev->isOnline && dev->locationID == (uint64_t)locID) {
                         existingDev = dev;
                         break;
@@ -373,17 +457,18 @@ static void DeviceAdded(void *refCon, io_iterator_t iterator)
                 if (existingDev) {
                     // Reconnect existing offline device
                     existingDev->UpdateService(usbService);
-                    if (existingDev->Open()) {
-                        CFRunLoopRef rl = state->runLoop ? state->runLoop
-                                                         : CFRunLoopGetCurrent();
-                        existingDev->StartIO(rl);
+                    CFRunLoopRef rl = state->runLoop ? state->runLoop
+                                                     : CFRunLoopGetCurrent();
+                    if (existingDev->Attach(rl)) {
                         existingDev->isOnline = true;
+                        state->registry.SetOffline(existingDev, false);
                         RegisterRemovalNotification(state, existingDev);
 
                         if (existingDev->midiDevice)
                             MIDIObjectSetIntegerProperty(existingDev->midiDevice,
                                                          kMIDIPropertyOffline, 0);
 
+                        RebuildRoutes(state);
                         os_log(sLog, "Hotplug: reconnected %{public}s", info->name);
                     } else {
                         os_log_error(sLog, "Hotplug: failed to reopen %{public}s", info->name);
@@ -393,24 +478,31 @@ static void DeviceAdded(void *refCon, io_iterator_t iterator)
                     auto *dev = new RolandUSBDevice(usbService, info);
                     dev->driverRef = driverRef;
                     dev->locationID = locID;
+                    if (!RegisterDevice(state, dev)) {
+                        delete dev;
+                        IOObjectRelease(usbService);
+                        continue;
+                    }
 
-                    dev->midiDevice = FindOrCreateMIDIDevice(driverRef, dev);
+                    dev->midiDevice = FindOrCreateMIDIDevice(state, driverRef, dev);
                     SetupPortMappings(state, dev);
 
-                    if (dev->Open()) {
-                        CFRunLoopRef rl = state->runLoop ? state->runLoop
-                                                         : CFRunLoopGetCurrent();
-                        dev->StartIO(rl);
+                    CFRunLoopRef rl = state->runLoop ? state->runLoop
+                                                     : CFRunLoopGetCurrent();
+                    if (dev->Attach(rl)) {
                         dev->isOnline = true;
                         MIDIObjectSetIntegerProperty(dev->midiDevice,
                                                      kMIDIPropertyOffline, 0);
                         RegisterRemovalNotification(state, dev);
-                        state->devices.push_back(dev);
+                        RebuildRoutes(state);
                         os_log(sLog, "Hotplug: added %{public}s (%u port(s))",
                                info->name, info->numPorts);
                     } else {
                         MIDIObjectSetIntegerProperty(dev->midiDevice,
                                                      kMIDIPropertyOffline, 1);
+                        state->persistentIndex.Release(dev->midiDevice);
+                        state->registry.Remove(dev);
+                        state->registry.WaitForReaders();
                         delete dev;
                     }
                 }
@@ -433,48 +525,26 @@ static void DeviceAdded(void *refCon, io_iterator_t iterator)
 // Entities (ports) are only created on first registration; subsequent uses
 // re-read them from the persistent MIDIDevice. This is what makes AMS show
 // port triangles correctly for multi-port devices.
-static MIDIDeviceRef FindOrCreateMIDIDevice(MIDIDriverRef driverRef,
-                                             RolandUSBDevice *dev)
+static MIDIDeviceRef FindOrCreateMIDIDevice(MultiRolandDriverState *state, MIDIDriverRef driverRef,
+                                            RolandUSBDevice *dev)
 {
     UInt32 vendorProduct = ((UInt32)kRolandVendorIDValue << 16)
                            | dev->deviceInfo->productID;
 
-    MIDIDeviceRef result = 0;
-    MIDIDeviceListRef persistentList = MIDIGetDriverDeviceList(driverRef);
-    if (persistentList) {
-        ItemCount n = MIDIDeviceListGetNumberOfDevices(persistentList);
-        os_log(sLog, "FindOrCreate: persistent list has %lu device(s) for %{public}s",
-               (unsigned long)n, dev->deviceInfo->name);
-
-        // Pass 1: match by locationID
-        for (ItemCount i = 0; i < n && !result; i++) {
-            MIDIDeviceRef candidate = MIDIDeviceListGetDevice(persistentList, i);
-            SInt32 storedLoc = 0;
-            if (MIDIObjectGetIntegerProperty(candidate,
-                    kRolandLocationProperty, &storedLoc) == noErr
-                && (UInt32)storedLoc == (UInt32)dev->locationID)
-                result = candidate;
-        }
-
-        // Pass 2: match by VID/PID for devices without stored locationID
-        for (ItemCount i = 0; i < n && !result; i++) {
-            MIDIDeviceRef candidate = MIDIDeviceListGetDevice(persistentList, i);
-            SInt32 storedVP = 0, storedLoc = 0;
-            bool hasVP  = MIDIObjectGetIntegerProperty(candidate,
-                              kRolandVendorProductProperty, &storedVP) == noErr;
-            bool hasLoc = MIDIObjectGetIntegerProperty(candidate,
-                              kRolandLocationProperty, &storedLoc) == noErr;
-            if (hasVP && (UInt32)storedVP == vendorProduct
-                && (!hasLoc || storedLoc == 0))
-                result = candidate;
-        }
-
-        MIDIDeviceListDispose(persistentList);
-    } else {
-        os_log(sLog, "FindOrCreate: MIDIGetDriverDeviceList returned NULL for %{public}s",
-               dev->deviceInfo->name);
+    // Start loads the index from its device list; v1 FindDevices and a
+    // hotplug before Start fall back to the driver's list
+    PersistentDeviceIndex &index = state->persistentIndex;
+    if (!index.Loaded()) {
+        MIDIDeviceListRef persistentList = MIDIGetDriverDeviceList(driverRef);
+        MIDIDeviceListStore store(persistentList);
+        index.Load(store);
+        if (persistentList)
+            MIDIDeviceListDispose(persistentList);
+        os_log(sLog, "FindOrCreate: indexed %zu persistent device(s)", index.Size());
     }
 
+    MIDIDeviceRef result = index.Claim((uint32_t)dev->locationID, vendorProduct);
+
     if (!result) {
         // Never seen before — create device + entities and store permanently.
         CFStringRef devName = CFStringCreateWithCString(
@@ -504,17 +574,20 @@ static MIDIDeviceRef FindOrCreateMIDIDevice(MIDIDriverRef driverRef,
     }
 
     // Persist current locationID and VID/PID for next-session matching.
-    MIDIObjectSetIntegerProperty(result, kRolandLocationProperty,
-                                 (SInt32)dev->locationID);
-    MIDIObjectSetIntegerProperty(result, kRolandVendorProductProperty,
-                                 (SInt32)vendorProduct);
+    if (result) {
+        MIDIDeviceListStore writer(nullptr);
+        index.Stamp(writer, result, (uint32_t)dev->locationID, vendorProduct);
+    }
     return result;
 }
 
 // Attach entity/endpoint refs to a RolandUSBDevice from its MIDIDeviceRef,
-// and rebuild portMappings entries.
+// and give each destination a port handle in the registry.
 static void SetupPortMappings(MultiRolandDriverState *state, RolandUSBDevice *dev)
 {
+    // Handles from an earlier mapping (previous Start) go stale
+    state->registry.RemovePorts(dev);
+
     ItemCount numEntities = MIDIDeviceGetNumberOfEntities(dev->midiDevice);
     os_log(sLog, "SetupPortMappings: %{public}s midiDevice=%lu numEntities=%lu expected=%u",
            dev->deviceInfo->name, (unsigned long)dev->midiDevice,
@@ -528,11 +601,9 @@ static void SetupPortMappings(MultiRolandDriverState *state, RolandUSBDevice *de
         ItemCount nDest = MIDIEntityGetNumberOfDestinations(ent);
         dev->midiSources[p] = nSrc  > 0 ? MIDIEntityGetSource(ent, 0)      : 0;
         dev->midiDests[p]   = nDest > 0 ? MIDIEntityGetDestination(ent, 0) : 0;
-        size_t globalIdx = state->portMappings.size();
-        state->portMappings.push_back({dev, dev->deviceInfo->ports[p].cable});
+        PortHandle handle = state->registry.AddPort(dev, dev->deviceInfo->ports[p].cable);
         if (dev->midiDests[p])
-            MIDIEndpointSetRefCons(dev->midiDests[p],
-                                   (void *)(uintptr_t)(globalIdx + 1), NULL);
+            MIDIEndpointSetRefCons(dev->midiDests[p], (void *)(uintptr_t)handle, NULL);
         os_log(sLog,
                "SetupPortMappings:   [%lu] ent=%lu nSrc=%lu nDest=%lu src=%lu dst=%lu",
                (unsigned long)p, (unsigned long)ent,
@@ -540,6 +611,237 @@ static void SetupPortMappings(MultiRolandDriverState *state, RolandUSBDevice *de
                (unsigned long)dev->midiSources[p],
                (unsigned long)dev->midiDests[p]);
     }
+    dev->LoadInputFilters();
+}
+
+static SInt32 DictionaryInteger(CFDictionaryRef dict, CFStringRef key, SInt32 fallback)
+{
+    CFTypeRef value = CFDictionaryGetValue(dict, key);
+    SInt32 number = fallback;
+    if (value && CFGetTypeID(value) == CFNumberGetTypeID())
+        CFNumberGetValue((CFNumberRef)value, kCFNumberSInt32Type, &number);
+    return number;
+}
+
+// Find the online destination endpoint with this unique ID and point the
+// route at its device's output queue.
+static bool ResolveThruDestination(MultiRolandDriverState *state, SInt32 uniqueID,
+                                   MIDIRoute &route)
+{
+    for (auto *dev : state->registry.Devices()) {
+        if (!dev->isOnline) continue;
+        for (uint8_t p = 0; p < dev->deviceInfo->numPorts; p++) {
+            SInt32 id = 0;
+            if (!dev->midiDests[p]
+                || MIDIObjectGetIntegerProperty(dev->midiDests[p], kMIDIPropertyUniqueID, &id) != noErr
+                || id != uniqueID)
+                continue;
+            route.target = dev->OutputQueue();
+            route.targetCable = dev->deviceInfo->ports[p].cable & 0x0F;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find the entity of the broadcast device that stands for a group.
+static MIDIEntityRef FindBroadcastEntity(MIDIDeviceRef device, uint32_t group)
+{
+    ItemCount numEntities = MIDIDeviceGetNumberOfEntities(device);
+    for (ItemCount e = 0; e < numEntities; e++) {
+        MIDIEntityRef ent = MIDIDeviceGetEntity(device, e);
+        SInt32 id = 0;
+        if (MIDIObjectGetIntegerProperty(ent, kRolandBroadcastProperty, &id) == noErr
+            && (uint32_t)id == group)
+            return ent;
+    }
+    return 0;
+}
+
+static void SetOfflineIfChanged(MIDIObjectRef object, bool offline)
+{
+    SInt32 current = 0;
+    if (MIDIObjectGetIntegerProperty(object, kMIDIPropertyOffline, &current) != noErr
+        || (current != 0) != offline)
+        MIDIObjectSetIntegerProperty(object, kMIDIPropertyOffline, offline ? 1 : 0);
+}
+
+// Broadcast groups: every online device, and the online units of each model
+// the driver has seen more than one of. Each reaches a device on its first
+// port. The destinations are created once and kept in the setup; one whose
+// group has no online member is shown offline. Called from RebuildRoutes.
+static void UpdateBroadcastDestinations(MultiRolandDriverState *state)
+{
+    const std::vector<RolandUSBDevice *> &devices = state->registry.Devices();
+    std::vector<MIDIBroadcastGroup> groups(1);
+    groups[0].id = kBroadcastAllDevices;
+    for (auto *dev : devices) {
+        uint16_t model = dev->deviceInfo->productID;
+        auto sameModel = [model](const RolandUSBDevice *d) { return d->deviceInfo->productID == model; };
+        MIDIBroadcastMember member = { dev, (uint8_t)(dev->deviceInfo->ports[0].cable & 0x0F) };
+
+        auto group = std::find_if(groups.begin(), groups.end(),
+                                  [model](const MIDIBroadcastGroup &g) { return g.id == model; });
+        if (group == groups.end() && std::count_if(devices.begin(), devices.end(), sameModel) > 1) {
+            groups.push_back(MIDIBroadcastGroup());
+            groups.back().id = model;
+            group = groups.end() - 1;
+        }
+        if (!dev->isOnline) continue;
+        groups[0].members.push_back(member);
+        if (group != groups.end())
+            group->members.push_back(member);
+    }
+
+    if (!state->broadcastDevice) {
+        MIDIDeviceRef device = 0;
+        OSStatus err = MIDIDeviceCreate((MIDIDriverRef)state, CFSTR("Roland Broadcast"),
+                                        CFSTR("Roland"), CFSTR("Broadcast"), &device);
+        if (err != noErr || !device) {
+            os_log_error(sLog, "Broadcast: MIDIDeviceCreate failed (%d)", (int)err);
+        } else {
+            MIDIObjectSetIntegerProperty(device, kRolandBroadcastProperty, 1);
+            MIDISetupAddDevice(device);
+            state->broadcastDevice = device;
+        }
+    }
+
+    if (MIDIDeviceRef device = state->broadcastDevice) {
+        SetOfflineIfChanged(device, false);
+        for (const MIDIBroadcastGroup &g : groups) {
+            MIDIEntityRef ent = FindBroadcastEntity(device, g.id);
+            if (!ent) {
+                const RolandDeviceInfo *info = g.id ? FindRolandDevice((uint16_t)g.id) : nullptr;
+                CFStringRef name = info
+                    ? CFStringCreateWithFormat(NULL, NULL, CFSTR("All %s"), info->name)
+                    : CFStringCreateCopy(NULL, CFSTR("All Roland Devices"));
+                if (MIDIDeviceAddEntity(device, name, false, 0, 1, &ent) == noErr && ent) {
+                    MIDIObjectSetIntegerProperty(ent, kRolandBroadcastProperty, (SInt32)g.id);
+                    os_log(sLog, "Broadcast: added destination for group 0x%04X", g.id);
+                }
+                CFRelease(name);
+            }
+            if (!ent) continue;
+            if (MIDIEntityGetNumberOfDestinations(ent) > 0)
+                MIDIEndpointSetRefCons(MIDIEntityGetDestination(ent, 0),
+                                       (void *)(kBroadcastRefConTag | g.id), NULL);
+        }
+
+        // Groups that lost their units since are kept, offline
+        ItemCount numEntities = MIDIDeviceGetNumberOfEntities(device);
+        for (ItemCount e = 0; e < numEntities; e++) {
+            MIDIEntityRef ent = MIDIDeviceGetEntity(device, e);
+            SInt32 id = 0;
+            if (MIDIObjectGetIntegerProperty(ent, kRolandBroadcastProperty, &id) != noErr) continue;
+            auto g = std::find_if(groups.begin(), groups.end(),
+                                  [id](const MIDIBroadcastGroup &x) { return x.id == (uint32_t)id; });
+            SetOfflineIfChanged(ent, g == groups.end() || g->members.empty());
+        }
+    }
+
+    state->broadcast.SetGroups(std::move(groups));
+}
+
+// Rebuild the thru matrix from every source entity's Roland-Thru property.
+// Called with devicesMutex held whenever a device comes or goes or a client
+// changes the configuration; routes only ever name online devices.
+static void RebuildRoutes(MultiRolandDriverState *state)
+{
+    std::vector<MIDIRoute> routes;
+    for (auto *src : state->registry.Devices()) {
+        src->router = &state->router;
+        if (!src->isOnline) continue;
+
+        for (uint8_t p = 0; p < src->deviceInfo->numPorts; p++) {
+            CFDictionaryRef thru = nullptr;
+            if (!src->midiEntities[p]
+                || MIDIObjectGetDictionaryProperty(src->midiEntities[p], kRolandThruProperty, &thru) != noErr
+                || !thru)
+                continue;
+
+            CFIndex count = CFDictionaryGetCount(thru);
+            std::vector<const void *> keys((size_t)count), values((size_t)count);
+            CFDictionaryGetKeysAndValues(thru, keys.data(), values.data());
+            for (CFIndex i = 0; i < count; i++) {
+                if (CFGetTypeID(keys[i]) != CFStringGetTypeID()) continue;
+                SInt32 destID = CFStringGetIntValue((CFStringRef)keys[i]);
+
+                MIDIRoute route;
+                route.source = (uint32_t)src->locationID;
+                route.sourceCable = src->deviceInfo->ports[p].cable & 0x0F;
+                if (!ResolveThruDestination(state, destID, route)) {
+                    os_log(sLog, "RebuildRoutes: %{public}s -> %d not available",
+                           src->deviceInfo->ports[p].name, (int)destID);
+                    continue;
+                }
+                if (CFGetTypeID(values[i]) == CFDictionaryGetTypeID()) {
+                    auto options = (CFDictionaryRef)values[i];
+                    route.channelMask = (uint16_t)DictionaryInteger(options, CFSTR("Channels"), 0xFFFF);
+                    route.statusMask  = (uint32_t)DictionaryInteger(options, CFSTR("Status"),
+                                                                    kMIDIClass_ChannelVoice);
+                }
+                routes.push_back(route);
+            }
+            CFRelease(thru);
+        }
+    }
+
+    // Routes and clock feed queues directly, bypassing DrvSend: lazy devices
+    // on either end are kept open
+    std::vector<bool> pinned(state->registry.Devices().size(), false);
+    for (size_t d = 0; d < state->registry.Devices().size(); d++) {
+        auto *dev = state->registry.Devices()[d];
+        for (const auto &route : routes) {
+            if (route.source == (uint32_t)dev->locationID || route.target == dev->OutputQueue())
+                pinned[d] = true;
+        }
+    }
+
+    size_t count = routes.size();
+    state->router.SetRoutes(std::move(routes));
+    if (count)
+        os_log(sLog, "RebuildRoutes: %zu thru route(s)", count);
+
+    // Generated clock goes to every online port that asks for it
+    std::vector<MIDIClockTarget> clockTargets;
+    for (auto *dev : state->registry.Devices()) {
+        dev->clockGenerator = &state->clockGenerator;
+        dev->clockOutPorts = 0;
+        if (!dev->isOnline) continue;
+        for (uint8_t p = 0; p < dev->deviceInfo->numPorts; p++) {
+            SInt32 clockOut = 0;
+            if (!dev->midiEntities[p]
+                || MIDIObjectGetIntegerProperty(dev->midiEntities[p], kRolandClockOutProperty,
+                                                &clockOut) != noErr
+                || !clockOut)
+                continue;
+            clockTargets.push_back({ dev->OutputQueue(), (uint8_t)(dev->deviceInfo->ports[p].cable & 0x0F) });
+            dev->clockOutPorts |= (uint8_t)(1u << p);
+        }
+    }
+    if (!clockTargets.empty())
+        os_log(sLog, "RebuildRoutes: %zu clock output(s)", clockTargets.size());
+    state->clockGenerator.SetTargets(clockTargets);
+
+    for (size_t d = 0; d < state->registry.Devices().size(); d++) {
+        auto *dev = state->registry.Devices()[d];
+        dev->SetPinned(dev->isOnline && (pinned[d] || dev->clockOutPorts != 0));
+    }
+
+    UpdateBroadcastDestinations(state);
+}
+
+static void ActivityTimerCallback(CFRunLoopTimerRef, void *info)
+{
+    auto *state = static_cast<MultiRolandDriverState *>(info);
+    std::lock_guard<std::mutex> lock(state->devicesMutex);
+    for (auto *dev : state->registry.Devices()) {
+        if (!dev->isOnline) continue;
+        dev->CloseIfIdle();
+        dev->PublishActivity();
+        dev->SendLatencyProbes();
+        dev->PublishLatency();
+    }
 }
 
 // ---------- MIDIDriverInterface ----------
@@ -561,24 +863,29 @@ static OSStatus DrvFindDevices(MIDIDriverRef self, MIDIDeviceListRef devList)
     // v1 fallback: scan USB, create devices, populate devList.
     ScanUSBDevices(state, self);
 
-    for (auto *dev : state->devices) {
+    for (auto *dev : state->registry.Devices()) {
         if (!dev->midiDevice)
-            dev->midiDevice = FindOrCreateMIDIDevice(self, dev);
+            dev->midiDevice = FindOrCreateMIDIDevice(state, self, dev);
         else
             os_log(sLog, "FindDevices(v1): reusing cached ref=%lu for %{public}s",
                    (unsigned long)dev->midiDevice, dev->deviceInfo->name);
         MIDIDeviceListAddDevice(devList, dev->midiDevice);
         os_log(sLog, "FindDevices(v1): added %{public}s to devList", dev->deviceInfo->name);
     }
-    os_log(sLog, "FindDevices(v1): %zu device(s)", state->devices.size());
+    if (state->broadcastDevice)
+        MIDIDeviceListAddDevice(devList, state->broadcastDevice);
+    os_log(sLog, "FindDevices(v1): %zu device(s)", state->registry.Devices().size());
     return noErr;
 }
 
 static OSStatus DrvStart(MIDIDriverRef self, MIDIDeviceListRef devList)
 {
     auto *state = GetState(self);
+    uint64_t startNs = DefaultHostClock().NowNanos();
+    // MIDIServer's run loop only carries hotplug notifications and the
+    // stats timers; USB I/O runs on each device's own time-constraint
+    // threads (RolandUSBDevice::StartIO), so this thread keeps its priority.
     state->runLoop = CFRunLoopGetCurrent();
-    SetRealtimePriority();
 
     os_log(sLog, "Start: mVersion=%d", state->mVersion);
 
@@ -590,69 +897,53 @@ static OSStatus DrvStart(MIDIDriverRef self, MIDIDeviceListRef devList)
     //
     // In both cases the algorithm is the same; the difference is who filled devList.
 
-    ScanUSBDevices(state, self);  // populate state->devices from USB
+    ScanUSBDevices(state, self);  // populate the registry from USB
 
     // Mark every persistent device offline initially.
     ItemCount numPersistent = MIDIDeviceListGetNumberOfDevices(devList);
     os_log(sLog, "Start: devList has %lu entry(s)", (unsigned long)numPersistent);
-    for (ItemCount i = 0; i < numPersistent; i++)
-        MIDIObjectSetIntegerProperty(MIDIDeviceListGetDevice(devList, i),
-                                     kMIDIPropertyOffline, 1);
-
-    state->portMappings.clear();
-
-    // Track which persistent entries we match to a physical device.
-    std::vector<bool> matched(numPersistent, false);
-
-    for (auto *dev : state->devices) {
-        // Try to find an existing persistent MIDIDeviceRef for this USB device.
-        MIDIDeviceRef found = 0;
-        ItemCount foundIdx = 0;
-        for (ItemCount i = 0; i < numPersistent && !found; i++) {
-            if (matched[i]) continue;
-            MIDIDeviceRef candidate = MIDIDeviceListGetDevice(devList, i);
-            SInt32 storedLoc = 0;
-            if (MIDIObjectGetIntegerProperty(candidate,
-                    kRolandLocationProperty, &storedLoc) == noErr
-                && (UInt32)storedLoc == (UInt32)dev->locationID) {
-                found = candidate;
-                foundIdx = i;
-            }
-        }
+    for (ItemCount i = 0; i < numPersistent; i++) {
+        MIDIDeviceRef ref = MIDIDeviceListGetDevice(devList, i);
+        MIDIObjectSetIntegerProperty(ref, kMIDIPropertyOffline, 1);
+        SInt32 broadcast = 0;
+        if (MIDIObjectGetIntegerProperty(ref, kRolandBroadcastProperty, &broadcast) == noErr
+            && broadcast)
+            state->broadcastDevice = ref;
+    }
 
-        if (found) {
-            matched[foundIdx] = true;
-            dev->midiDevice = found;
-            os_log(sLog, "Start: matched persistent ref=%lu for %{public}s",
-                   (unsigned long)found, dev->deviceInfo->name);
-        } else {
-            // Brand-new device — create and register with CoreMIDI.
-            dev->midiDevice = FindOrCreateMIDIDevice(self, dev);
-        }
+    // Read each persistent entry's Roland-Loc / Roland-VP once, then match
+    // every physical device against the index. The broadcast device is no
+    // USB device's entry and is not an orphan either.
+    MIDIDeviceListStore store(devList);
+    state->persistentIndex.Load(store);
+    if (state->broadcastDevice)
+        state->persistentIndex.Remove(state->broadcastDevice);
 
+    for (auto *dev : state->registry.Devices()) {
+        dev->midiDevice = FindOrCreateMIDIDevice(state, self, dev);
         SetupPortMappings(state, dev);
 
-        if (dev->Open()) {
-            dev->StartIO(state->runLoop);
+        if (dev->Attach(state->runLoop)) {
             dev->isOnline = true;
+            state->registry.SetOffline(dev, false);
             MIDIObjectSetIntegerProperty(dev->midiDevice, kMIDIPropertyOffline, 0);
             RegisterRemovalNotification(state, dev);
-            os_log(sLog, "Start: opened %{public}s", dev->deviceInfo->name);
+            os_log(sLog, "Start: %{public}s %{public}s", dev->deviceInfo->name,
+                   dev->ActivityStats().open ? "opened" : "online, opens on first use");
         } else {
             dev->isOnline = false;
+            state->registry.SetOffline(dev, true);
             MIDIObjectSetIntegerProperty(dev->midiDevice, kMIDIPropertyOffline, 1);
             os_log(sLog, "Start: %{public}s not ready", dev->deviceInfo->name);
         }
     }
 
     // Remove unmatched persistent entries (duplicates from earlier debug sessions).
-    for (ItemCount i = 0; i < numPersistent; i++) {
-        if (!matched[i]) {
-            MIDIDeviceRef orphan = MIDIDeviceListGetDevice(devList, i);
-            OSStatus err = MIDISetupRemoveDevice(orphan);
-            os_log(sLog, "Start: removed orphan persistent entry [%lu] err=%d",
-                   (unsigned long)i, (int)err);
-        }
+    for (MIDIDeviceRef orphan : state->persistentIndex.Unclaimed()) {
+        OSStatus err = MIDISetupRemoveDevice(orphan);
+        state->persistentIndex.Remove(orphan);
+        os_log(sLog, "Start: removed orphan persistent entry ref=%lu err=%d",
+               (unsigned long)orphan, (int)err);
     }
 
     // Register for USB hotplug notifications.
@@ -673,8 +964,25 @@ static OSStatus DrvStart(MIDIDriverRef self, MIDIDeviceListRef devList)
         }
     }
 
-    os_log(sLog, "Started (%zu device(s), %zu port(s))",
-           state->devices.size(), state->portMappings.size());
+    {
+        std::lock_guard<std::mutex> lock(state->devicesMutex);
+        RebuildRoutes(state);
+    }
+    if (!state->clockGenerator.StartThread(kClockThreadPolicy))
+        os_log_error(sLog, "Start: no clock generator thread");
+
+    CFRunLoopTimerContext timerContext = { 0, state, nullptr, nullptr, nullptr };
+    state->activityTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + 1.0,
+                                                1.0, 0, 0, ActivityTimerCallback, &timerContext);
+    if (state->activityTimer)
+        CFRunLoopAddTimer(state->runLoop, state->activityTimer, kCFRunLoopDefaultMode);
+
+    size_t opened = 0;
+    for (auto *dev : state->registry.Devices())
+        opened += dev->ActivityStats().open ? 1 : 0;
+    os_log(sLog, "Started (%zu device(s), %zu opened, %zu port(s)) in %llu us",
+           state->registry.Devices().size(), opened, state->registry.PortCount(),
+           (DefaultHostClock().NowNanos() - startNs) / 1000);
     return noErr;
 }
 
@@ -692,22 +1000,43 @@ static OSStatus DrvStop(MIDIDriverRef self)
         state->notifyPort = nullptr;
     }
 
-    for (auto *dev : state->devices) {
+    if (state->activityTimer) {
+        CFRunLoopTimerInvalidate(state->activityTimer);
+        CFRelease(state->activityTimer);
+        state->activityTimer = nullptr;
+    }
+
+    state->clockGenerator.StopThread();
+    state->clockGenerator.SetTargets({});
+
+    for (auto *dev : state->registry.Devices()) {
         if (dev->removalNotification) {
             IOObjectRelease(dev->removalNotification);
             dev->removalNotification = 0;
         }
-        dev->StopIO();
-        dev->Close();
+        dev->Detach();
         dev->isOnline = false;
+        state->registry.SetOffline(dev, true);
     }
+    state->router.SetRoutes({});
+    state->broadcast.SetGroups({});
+    state->persistentIndex.Clear();
 
     os_log(sLog, "Stopped");
     return noErr;
 }
 
-static OSStatus DrvConfigure(MIDIDriverRef /*self*/, MIDIDeviceRef /*device*/)
+static OSStatus DrvConfigure(MIDIDriverRef self, MIDIDeviceRef device)
 {
+    auto *state = GetState(self);
+    std::lock_guard<std::mutex> lock(state->devicesMutex);
+    for (auto *dev : state->registry.Devices()) {
+        if (dev->midiDevice == device) {
+            dev->LoadInputFilters();
+            dev->LoadProfile();
+        }
+    }
+    RebuildRoutes(state);
     return noErr;
 }
 
@@ -718,19 +1047,33 @@ static OSStatus DrvSend(MIDIDriverRef self, const MIDIPacketList *pktlist,
 
     // MIDIEndpointSetRefCons ref1 is delivered as destConnRefCon (3rd param).
     // endptRefCon (4th param) is always 0 and must not be used for port lookup.
-    size_t idx = (size_t)(uintptr_t)destConnRefCon;
+    uintptr_t refCon = (uintptr_t)destConnRefCon;
+    PortHandle handle = (PortHandle)refCon;
+
+    // A broadcast destination, or an endpoint without a refCon: every device
+    bool broadcast = (refCon & kBroadcastRefConTag) || !handle;
+    uint32_t group = broadcast ? (uint32_t)(refCon & 0xFFFF) : kBroadcastAllDevices;
+
+    // Keeps devices the registry drops meanwhile alive until we return
+    RolandDeviceRegistry::ReadGuard guard(state->registry);
+    RolandDeviceRegistry::Port port;
+    bool mapped = !broadcast && state->registry.Lookup(handle, port);
 
     const MIDIPacket *pkt = &pktlist->packet[0];
     for (UInt32 i = 0; i < pktlist->numPackets; i++) {
-        if (pkt->length > 0) {
-            if (idx > 0 && idx <= state->portMappings.size()) {
-                auto &pm = state->portMappings[idx - 1];
-                pm.device->SendMIDI(pm.cable, pkt->data, pkt->length);
-            } else {
-                // Fallback: send to all devices on cable 0
-                for (auto *dev : state->devices)
-                    dev->SendMIDI(0, pkt->data, pkt->length);
+        // Clock generator control messages stop here, whichever port they were sent to
+        MIDIClockControl control;
+        if (pkt->length > 0 && pkt->data[0] == 0xF0
+            && ParseMIDIClockControl(pkt->data, pkt->length, control)) {
+            state->clockGenerator.Apply(control);
+        } else if (pkt->length > 0) {
+            if (mapped) {
+                port.device->SendMIDI(port.cable, pkt->data, pkt->length);
+            } else if (broadcast) {
+                // Split once, queued on every member's first port
+                state->broadcast.Send(group, pkt->data, pkt->length);
             }
+            // A stale handle names a device the registry dropped: discard
         }
         pkt = MIDIPacketNext(pkt);
     }
@@ -738,15 +1081,43 @@ static OSStatus DrvSend(MIDIDriverRef self, const MIDIPacketList *pktlist,
     return noErr;
 }
 
-static OSStatus DrvEnableSource(MIDIDriverRef /*self*/, MIDIEndpointRef /*src*/,
-                                 Boolean /*enabled*/)
+static OSStatus DrvEnableSource(MIDIDriverRef self, MIDIEndpointRef src,
+                                 Boolean enabled)
 {
+    auto *state = GetState(self);
+    std::lock_guard<std::mutex> lock(state->devicesMutex);
+    for (auto *dev : state->registry.Devices()) {
+        int p = dev->PortForSource(src);
+        if (p < 0) continue;
+
+        dev->SetSourceEnabled((uint8_t)p, enabled);
+
+        // A client (dis)connecting is the point where filter settings it just
+        // wrote to the entity should take effect.
+        dev->LoadInputFilters();
+        dev->PublishInputFilterCounters();
+        return noErr;
+    }
     return noErr;
 }
 
-static OSStatus DrvFlush(MIDIDriverRef /*self*/, MIDIEndpointRef /*dest*/,
+static OSStatus DrvFlush(MIDIDriverRef self, MIDIEndpointRef dest,
                           void * /*destConnRefCon0*/, void * /*destConnRefCon1*/)
 {
+    // dest == 0 means flush every destination.
+    auto *state = GetState(self);
+    std::lock_guard<std::mutex> lock(state->devicesMutex);
+    for (auto *dev : state->registry.Devices()) {
+        if (!dest) {
+            dev->FlushOutput(-1);
+            continue;
+        }
+        int p = dev->PortForDest(dest);
+        if (p >= 0) {
+            dev->FlushOutput(dev->deviceInfo->ports[p].cable);
+            return noErr;
+        }
+    }
     return noErr;
 }
 
@@ -0,0 +1,128 @@
+#include "PersistentDeviceIndex.h"
+
+void PersistentDeviceIndex::Clear()
+{
+    entries.clear();
+    byRef.clear();
+    byLocation.clear();
+    byVendorProduct.clear();
+    loaded = false;
+}
+
+void PersistentDeviceIndex::Load(PersistentDeviceStore &store)
+{
+    Clear();
+    size_t count = store.Count();
+    entries.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        Entry e;
+        e.ref = store.DeviceAt(i);
+        if (!e.ref || byRef.count(e.ref)) continue;
+
+        int32_t value = 0;
+        if (store.GetInteger(e.ref, PersistentDeviceKey::Location, value)) {
+            e.hasLocation = true;
+            e.location = (uint32_t)value;
+        }
+        if (store.GetInteger(e.ref, PersistentDeviceKey::VendorProduct, value)) {
+            e.hasVendorProduct = true;
+            e.vendorProduct = (uint32_t)value;
+        }
+        Add(e);
+    }
+    loaded = true;
+}
+
+size_t PersistentDeviceIndex::Add(const Entry &entry)
+{
+    size_t i = entries.size();
+    entries.push_back(entry);
+    byRef[entry.ref] = i;
+    if (entry.hasLocation)
+        byLocation[entry.location].push_back(i);
+    if (entry.hasVendorProduct)
+        byVendorProduct[entry.vendorProduct].push_back(i);
+    return i;
+}
+
+uint32_t PersistentDeviceIndex::Claim(uint32_t location, uint32_t vendorProduct)
+{
+    // Buckets may name entries whose properties were restamped since; the
+    // entry itself is checked
+    auto byLoc = byLocation.find(location);
+    if (byLoc != byLocation.end()) {
+        for (size_t i : byLoc->second) {
+            Entry &e = entries[i];
+            if (e.claimed || e.removed || !e.hasLocation || e.location != location) continue;
+            e.claimed = true;
+            return e.ref;
+        }
+    }
+
+    auto byVP = byVendorProduct.find(vendorProduct);
+    if (byVP != byVendorProduct.end()) {
+        for (size_t i : byVP->second) {
+            Entry &e = entries[i];
+            if (e.claimed || e.removed || !e.hasVendorProduct || e.vendorProduct != vendorProduct)
+                continue;
+            if (e.hasLocation && e.location != 0) continue;
+            e.claimed = true;
+            return e.ref;
+        }
+    }
+    return 0;
+}
+
+void PersistentDeviceIndex::Stamp(PersistentDeviceStore &store, uint32_t ref,
+                                  uint32_t location, uint32_t vendorProduct)
+{
+    auto it = byRef.find(ref);
+    size_t i;
+    if (it == byRef.end()) {
+        Entry e;
+        e.ref = ref;
+        i = Add(e);
+    } else {
+        i = it->second;
+    }
+
+    Entry &e = entries[i];
+    e.claimed = true;
+    if (!e.hasLocation || e.location != location) {
+        store.SetInteger(ref, PersistentDeviceKey::Location, (int32_t)location);
+        byLocation[location].push_back(i);
+        e.hasLocation = true;
+        e.location = location;
+    }
+    if (!e.hasVendorProduct || e.vendorProduct != vendorProduct) {
+        store.SetInteger(ref, PersistentDeviceKey::VendorProduct, (int32_t)vendorProduct);
+        byVendorProduct[vendorProduct].push_back(i);
+        e.hasVendorProduct = true;
+        e.vendorProduct = vendorProduct;
+    }
+}
+
+void PersistentDeviceIndex::Release(uint32_t ref)
+{
+    auto it = byRef.find(ref);
+    if (it != byRef.end())
+        entries[it->second].claimed = false;
+}
+
+std::vector<uint32_t> PersistentDeviceIndex::Unclaimed() const
+{
+    std::vector<uint32_t> refs;
+    for (const Entry &e : entries) {
+        if (!e.claimed && !e.removed)
+            refs.push_back(e.ref);
+    }
+    return refs;
+}
+
+void PersistentDeviceIndex::Remove(uint32_t ref)
+{
+    auto it = byRef.find(ref);
+    if (it == byRef.end()) return;
+    entries[it->second].removed = true;
+    byRef.erase(it);
+}
@@ -0,0 +1,80 @@
+#ifndef PersistentDeviceIndex_h
+#define PersistentDeviceIndex_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+/// Matching properties the driver stores on its persistent MIDIDevices.
+enum class PersistentDeviceKey : uint8_t {
+    Location,        // Roland-Loc: USB locationID
+    VendorProduct,   // Roland-VP: VID << 16 | PID
+};
+
+/// The MIDI setup database as reconciliation sees it: a list of device refs
+/// with integer properties. Each call is an IPC into MIDIServer on the Mac.
+class PersistentDeviceStore {
+public:
+    virtual ~PersistentDeviceStore() = default;
+    virtual size_t   Count() = 0;
+    virtual uint32_t DeviceAt(size_t index) = 0;
+    virtual bool GetInteger(uint32_t ref, PersistentDeviceKey key, int32_t &value) = 0;
+    virtual void SetInteger(uint32_t ref, PersistentDeviceKey key, int32_t value) = 0;
+};
+
+/// Index of the driver's persistent MIDIDevices by stored location and
+/// VID/PID, for matching physical USB devices to them.
+///
+/// Load() reads each entry's two properties once; every match after that,
+/// at startup and on hotplug, is a hash lookup. A device matches an
+/// unclaimed entry with its location first, then one with its VID/PID that
+/// has no location stored. Claimed entries are not matched again, so
+/// whatever is unclaimed once all present devices are matched is stale.
+/// Not thread-safe; the driver uses it under its devices mutex.
+class PersistentDeviceIndex {
+public:
+    /// Replace the index with the store's entries.
+    void Load(PersistentDeviceStore &store);
+    bool Loaded() const { return loaded; }
+    void Clear();
+
+    /// Claim the entry for a physical device; 0 if none matches.
+    uint32_t Claim(uint32_t location, uint32_t vendorProduct);
+
+    /// Store location and VID/PID on a claimed or newly created entry,
+    /// writing only what differs from what the index last saw.
+    void Stamp(PersistentDeviceStore &store, uint32_t ref, uint32_t location, uint32_t vendorProduct);
+
+    /// Give a claim back when its device is dropped while the entry stays
+    /// in the setup, so the device is matched to it when it returns.
+    void Release(uint32_t ref);
+
+    /// Entries no present device has claimed, in store order.
+    std::vector<uint32_t> Unclaimed() const;
+    /// Forget an entry (removed from the setup).
+    void Remove(uint32_t ref);
+
+    size_t Size() const { return byRef.size(); }
+
+private:
+    struct Entry {
+        uint32_t ref;
+        uint32_t location      = 0;
+        uint32_t vendorProduct = 0;
+        bool     hasLocation      = false;
+        bool     hasVendorProduct = false;
+        bool     claimed          = false;
+        bool     removed          = false;
+    };
+
+    size_t Add(const Entry &entry);
+
+    std::vector<Entry> entries;   // Store order; removed entries stay as tombstones
+    std::unordered_map<uint32_t, size_t> byRef;
+    std::unordered_map<uint32_t, std::vector<size_t>> byLocation;
+    std::unordered_map<uint32_t, std::vector<size_t>> byVendorProduct;
+    bool loaded = false;
+};
+
+#endif /* PersistentDeviceIndex_h */
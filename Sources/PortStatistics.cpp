@@ -0,0 +1,209 @@
+#include "PortStatistics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
+
+// Data bytes first or a lone F7: the rest of a SysEx already counted
+static bool IsSysExPiece(uint8_t first)
+{
+    return first == 0xF0 || first == 0xF7 || first < 0x80;
+}
+
+static bool StartsMessage(uint8_t first)
+{
+    return first >= 0x80 && first != 0xF7;
+}
+
+void CountMIDITraffic(MIDITrafficCounters &counters, const uint8_t *bytes, uint32_t length)
+{
+    if (!length) return;
+    counters.bytes += length;
+    if (IsSysExPiece(bytes[0])) counters.sysExBytes += length;
+    if (StartsMessage(bytes[0])) counters.messages++;
+}
+
+void CountMIDITraffic(SharedMIDITrafficCounters &counters, const uint8_t *bytes, uint32_t length)
+{
+    if (!length) return;
+    counters.bytes.fetch_add(length, std::memory_order_relaxed);
+    if (IsSysExPiece(bytes[0])) counters.sysExBytes.fetch_add(length, std::memory_order_relaxed);
+    if (StartsMessage(bytes[0])) counters.messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+MIDITrafficCounters SharedMIDITrafficCounters::Load() const
+{
+    MIDITrafficCounters c;
+    c.messages   = messages.load(std::memory_order_relaxed);
+    c.bytes      = bytes.load(std::memory_order_relaxed);
+    c.sysExBytes = sysExBytes.load(std::memory_order_relaxed);
+    return c;
+}
+
+// ---------- Rates ----------
+
+static double Rate(uint64_t now, uint64_t before, double seconds)
+{
+    return now > before ? (double)(now - before) / seconds : 0.0;
+}
+
+static bool WentBackwards(const PortStatsSample &now, const PortStatsSample &before)
+{
+    return now.rx.bytes < before.rx.bytes || now.tx.bytes < before.tx.bytes
+        || now.readErrors < before.readErrors || now.writeErrors < before.writeErrors
+        || now.pacingWaitNs < before.pacingWaitNs;
+}
+
+void PortStatsMonitor::Update(const std::vector<PortStatsSample> &samples)
+{
+    std::vector<PortStatsView> next;
+    next.reserve(samples.size());
+
+    for (const PortStatsSample &s : samples) {
+        PortStatsView view;
+        view.sample = s;
+
+        auto it = std::find_if(ports.begin(), ports.end(),
+                               [&](const PortStatsView &v) { return v.sample.id == s.id; });
+        if (it != ports.end()) {
+            const PortStatsSample &before = it->sample;
+            if (s.timeNs == before.timeNs) {
+                view.rates = it->rates;   // Not republished yet
+            } else if (s.timeNs > before.timeNs && !WentBackwards(s, before)) {
+                PortStatsRates &r = view.rates;
+                r.seconds      = (s.timeNs - before.timeNs) / 1e9;
+                r.rxMessages   = Rate(s.rx.messages, before.rx.messages, r.seconds);
+                r.rxBytes      = Rate(s.rx.bytes, before.rx.bytes, r.seconds);
+                r.rxSysExBytes = Rate(s.rx.sysExBytes, before.rx.sysExBytes, r.seconds);
+                r.txMessages   = Rate(s.tx.messages, before.tx.messages, r.seconds);
+                r.txBytes      = Rate(s.tx.bytes, before.tx.bytes, r.seconds);
+                r.txSysExBytes = Rate(s.tx.sysExBytes, before.tx.sysExBytes, r.seconds);
+                // A gap is credited whole when it starts, so a short interval can overshoot
+                r.pacingWait   = std::min(1.0, Rate(s.pacingWaitNs, before.pacingWaitNs, r.seconds) / 1e9);
+                r.readErrors   = s.readErrors - before.readErrors;
+                r.writeErrors  = s.writeErrors - before.writeErrors;
+            }
+            // else: reopened, or the clock moved back; rates start over
+        }
+        next.push_back(std::move(view));
+    }
+    ports.swap(next);
+}
+
+// ---------- Output ----------
+
+static void Appendf(std::string &out, const char *format, ...)
+{
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n > 0) out.append(line, std::min<size_t>((size_t)n, sizeof(line) - 1));
+}
+
+static const char *Human(char *buffer, size_t size, double value)
+{
+    if (value < 1000)
+        snprintf(buffer, size, "%.1f", value);
+    else if (value < 1000000)
+        snprintf(buffer, size, "%.1fk", value / 1000);
+    else
+        snprintf(buffer, size, "%.2fM", value / 1000000);
+    return buffer;
+}
+
+std::string PortStatsMonitor::FormatTable() const
+{
+    std::string out;
+    Appendf(out, "%-20s %8s %8s %8s %8s %8s %8s %7s %7s %6s %5s %6s %6s  %s\n",
+            "PORT", "IN msg/s", "IN B/s", "IN SysX", "OUT msg", "OUT B/s", "OUT SysX",
+            "QUEUE", "PEAK", "PACING", "WIN", "RD ERR", "WR ERR", "RTT p50/p95/p99 ms");
+
+    for (const PortStatsView &v : ports) {
+        const PortStatsSample &s = v.sample;
+        const PortStatsRates &r = v.rates;
+
+        // Port names carry the model already ("SC-8850 Part A")
+        std::string name = s.port.empty() ? s.device : s.port;
+        if (name.size() > 20) name.resize(20);
+
+        char rtt[48] = "-";
+        if (s.latencySamples)
+            snprintf(rtt, sizeof(rtt), "%.2f/%.2f/%.2f",
+                     s.latencyP50Us / 1000, s.latencyP95Us / 1000, s.latencyP99Us / 1000);
+        char window[16];
+        snprintf(window, sizeof(window), "%u/%u", s.writesInFlight, s.writeWindow);
+
+        char a[16], b[16], c[16], d[16], e[16], f[16];
+        Appendf(out, "%-20s %8s %8s %8s %8s %8s %8s %7u %7u %5.0f%% %5s %6llu %6llu  %s\n",
+                name.c_str(),
+                Human(a, sizeof(a), r.rxMessages), Human(b, sizeof(b), r.rxBytes),
+                Human(c, sizeof(c), r.rxSysExBytes), Human(d, sizeof(d), r.txMessages),
+                Human(e, sizeof(e), r.txBytes), Human(f, sizeof(f), r.txSysExBytes),
+                s.txQueueBytes, s.txQueuePeak, r.pacingWait * 100, window,
+                (unsigned long long)s.readErrors, (unsigned long long)s.writeErrors, rtt);
+    }
+    return out;
+}
+
+static void AppendJSONString(std::string &out, const std::string &value)
+{
+    out += '"';
+    for (char ch : value) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if ((unsigned char)ch < 0x20) {
+            Appendf(out, "\\u%04x", (unsigned)(unsigned char)ch);
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+static void AppendTraffic(std::string &out, const char *name,
+                          const MIDITrafficCounters &c, double messages, double bytes, double sysExBytes)
+{
+    Appendf(out, "\"%s\": {\"messages\": %llu, \"bytes\": %llu, \"sysex_bytes\": %llu, "
+                 "\"messages_per_sec\": %.1f, \"bytes_per_sec\": %.1f, \"sysex_bytes_per_sec\": %.1f}",
+            name, (unsigned long long)c.messages, (unsigned long long)c.bytes,
+            (unsigned long long)c.sysExBytes, messages, bytes, sysExBytes);
+}
+
+std::string PortStatsMonitor::FormatJSON(uint64_t timeNs) const
+{
+    std::string out;
+    Appendf(out, "{\"time_us\": %llu, \"ports\": [", (unsigned long long)(timeNs / 1000));
+
+    for (size_t i = 0; i < ports.size(); i++) {
+        const PortStatsSample &s = ports[i].sample;
+        const PortStatsRates &r = ports[i].rates;
+
+        out += i ? ", {" : "{";
+        Appendf(out, "\"id\": %llu, \"device\": ", (unsigned long long)s.id);
+        AppendJSONString(out, s.device);
+        out += ", \"port\": ";
+        AppendJSONString(out, s.port);
+        Appendf(out, ", \"sample_us\": %llu, \"interval_s\": %.3f, ",
+                (unsigned long long)(s.timeNs / 1000), r.seconds);
+        AppendTraffic(out, "in", s.rx, r.rxMessages, r.rxBytes, r.rxSysExBytes);
+        out += ", ";
+        AppendTraffic(out, "out", s.tx, r.txMessages, r.txBytes, r.txSysExBytes);
+        Appendf(out, ", \"queue_bytes\": %u, \"queue_peak\": %u, \"shaper_holds\": %llu, "
+                     "\"pacing_wait_us\": %llu, \"pacing_wait_fraction\": %.3f, \"sysex_gap_us\": %llu, "
+                     "\"read_errors\": %llu, \"write_errors\": %llu, "
+                     "\"write_window\": %u, \"writes_in_flight\": %u, \"write_latency_us\": %llu",
+                s.txQueueBytes, s.txQueuePeak, (unsigned long long)s.shaperHolds,
+                (unsigned long long)(s.pacingWaitNs / 1000), r.pacingWait,
+                (unsigned long long)(s.sysExGapNs / 1000),
+                (unsigned long long)s.readErrors, (unsigned long long)s.writeErrors,
+                s.writeWindow, s.writesInFlight, (unsigned long long)(s.writeLatencyNs / 1000));
+        if (s.latencySamples)
+            Appendf(out, ", \"round_trip_us\": {\"samples\": %u, \"p50\": %.1f, \"p95\": %.1f, \"p99\": %.1f}",
+                    s.latencySamples, s.latencyP50Us, s.latencyP95Us, s.latencyP99Us);
+        out += "}";
+    }
+    out += "]}";
+    return out;
+}
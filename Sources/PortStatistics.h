@@ -0,0 +1,114 @@
+#ifndef PortStatistics_h
+#define PortStatistics_h
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/// MIDI traffic through one cable in one direction.
+struct MIDITrafficCounters {
+    uint64_t messages   = 0;   // A SysEx counts once, however it was split
+    uint64_t bytes      = 0;
+    uint64_t sysExBytes = 0;
+};
+
+/// MIDITrafficCounters counted on one thread and read on another, such as
+/// the driver's inbound counters (read path vs. stats timer). Fields are
+/// relaxed atomics: a reader may see one a message ahead of another, never
+/// a torn value.
+struct SharedMIDITrafficCounters {
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> sysExBytes{0};
+
+    MIDITrafficCounters Load() const;
+};
+
+/// Count one event's MIDI bytes: a whole message or any piece of a SysEx.
+void CountMIDITraffic(MIDITrafficCounters &counters, const uint8_t *bytes, uint32_t length);
+void CountMIDITraffic(SharedMIDITrafficCounters &counters, const uint8_t *bytes, uint32_t length);
+
+/// The counters the driver publishes for one port (Roland-PortStats on the
+/// entity), with the device-wide ones (Roland-IOStats, Roland-RxRecovery,
+/// Roland-Latency) alongside, as read at one moment.
+struct PortStatsSample {
+    uint64_t    id = 0;           // Stable per port (the entity's unique ID)
+    std::string device;
+    std::string port;
+    uint64_t    timeNs = 0;       // When the driver took the counters
+
+    MIDITrafficCounters rx;       // Delivered from the device
+    MIDITrafficCounters tx;       // Sent to the device
+    uint32_t txQueueBytes = 0;
+    uint32_t txQueuePeak  = 0;
+    uint64_t shaperHolds  = 0;
+
+    // Device-wide
+    uint64_t readErrors     = 0;
+    uint64_t writeErrors    = 0;
+    uint64_t pacingWaitNs   = 0;  // SysEx chunk gaps served so far
+    uint64_t sysExGapNs     = 0;  // Current chunk gap
+    uint32_t writeWindow    = 1;
+    uint32_t writesInFlight = 0;
+    uint64_t writeLatencyNs = 0;
+
+    // Round trips while the port is probed (Roland-LatencyProbe)
+    uint32_t latencySamples = 0;
+    double   latencyP50Us   = 0;
+    double   latencyP95Us   = 0;
+    double   latencyP99Us   = 0;
+};
+
+/// Where the stats viewer gets its samples: the driver's CoreMIDI
+/// properties, or a simulated rig.
+class PortStatsSource {
+public:
+    virtual ~PortStatsSource() = default;
+
+    /// Replace samples with the current counters of every port. False when
+    /// nothing can be read any more.
+    virtual bool Read(std::vector<PortStatsSample> &samples) = 0;
+};
+
+/// Per-second rates over the latest interval of one port.
+struct PortStatsRates {
+    double   seconds      = 0;   // Interval the rates cover (0 = none yet)
+    double   rxMessages   = 0;
+    double   rxBytes      = 0;
+    double   rxSysExBytes = 0;
+    double   txMessages   = 0;
+    double   txBytes      = 0;
+    double   txSysExBytes = 0;
+    double   pacingWait   = 0;   // Fraction of the interval SysEx sat out chunk gaps
+    uint64_t readErrors   = 0;   // New in the interval
+    uint64_t writeErrors  = 0;
+};
+
+struct PortStatsView {
+    PortStatsSample sample;
+    PortStatsRates  rates;
+};
+
+/// Turns successive samples into rates and renders them.
+///
+/// Rates are taken between the two latest distinct timestamps of a port, so
+/// polling faster than the driver publishes repeats the last rate instead
+/// of showing zero. Counters that went backwards (the device was reopened)
+/// start the port over. Ports are listed in the order the source gave them.
+class PortStatsMonitor {
+public:
+    void Update(const std::vector<PortStatsSample> &samples);
+
+    const std::vector<PortStatsView> &Ports() const { return ports; }
+
+    /// One line per port, with a header.
+    std::string FormatTable() const;
+    /// One JSON object on one line: { "time_us": ..., "ports": [ ... ] }.
+    std::string FormatJSON(uint64_t timeNs) const;
+
+private:
+    std::vector<PortStatsView> ports;
+};
+
+#endif /* PortStatistics_h */
@@ -0,0 +1,37 @@
+#include "RateShaper.h"
+
+void RateShaper::Configure(uint32_t bytesPerSecond, uint32_t burst)
+{
+    uint64_t newNsPerByte = bytesPerSecond ? 1000000000ull / bytesPerSecond : 0;
+    if (newNsPerByte != nsPerByte || burst != burstBytes)
+        drainedAt = 0;
+    nsPerByte = newNsPerByte;
+    burstBytes = burst ? burst : 1;
+}
+
+uint32_t RateShaper::Available(uint64_t now) const
+{
+    if (!nsPerByte) return UINT32_MAX;
+
+    uint64_t window = (uint64_t)burstBytes * nsPerByte;
+    if (drainedAt <= now) return burstBytes;
+    uint64_t owed = drainedAt - now;
+    if (owed >= window) return 0;
+    return (uint32_t)((window - owed) / nsPerByte);
+}
+
+uint64_t RateShaper::DueTime(uint32_t bytes) const
+{
+    if (!nsPerByte) return 0;
+    if (bytes > burstBytes) bytes = burstBytes;
+
+    uint64_t window = (uint64_t)burstBytes * nsPerByte;
+    uint64_t due = drainedAt + (uint64_t)bytes * nsPerByte;
+    return due > window ? due - window : 0;
+}
+
+void RateShaper::Consume(uint64_t now, uint32_t bytes)
+{
+    if (!nsPerByte) return;
+    drainedAt = (drainedAt > now ? drainedAt : now) + (uint64_t)bytes * nsPerByte;
+}
@@ -0,0 +1,36 @@
+#ifndef RateShaper_h
+#define RateShaper_h
+
+#include <stdint.h>
+
+static constexpr uint32_t kDefaultShaperBurstBytes = 32;   // ~10ms of DIN MIDI
+
+/// Token bucket holding one cable to a byte rate (a 5-pin DIN output runs at
+/// 3125 bytes/s). Kept as the time `drainedAt` at which everything sent so
+/// far has left the wire; up to burstBytes may be outstanding at once.
+/// Not thread-safe; the transmitter uses it under its queue lock.
+class RateShaper {
+public:
+    void Configure(uint32_t bytesPerSecond, uint32_t burstBytes = kDefaultShaperBurstBytes);
+    void Reset() { drainedAt = 0; }
+
+    bool Enabled() const { return nsPerByte != 0; }
+    uint32_t BurstBytes() const { return burstBytes; }
+
+    /// Bytes that can go out at `now` without exceeding the rate.
+    uint32_t Available(uint64_t now) const;
+
+    /// Host time at which `bytes` (capped at the burst size) are available.
+    uint64_t DueTime(uint32_t bytes) const;
+
+    /// Account for bytes sent at `now`. May overdraw (real-time messages are
+    /// never held back); later traffic then waits correspondingly longer.
+    void Consume(uint64_t now, uint32_t bytes);
+
+private:
+    uint64_t nsPerByte  = 0;   // 0 = unlimited
+    uint32_t burstBytes = 0;
+    uint64_t drainedAt  = 0;
+};
+
+#endif /* RateShaper_h */
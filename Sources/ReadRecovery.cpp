@@ -0,0 +1,164 @@
+#include "ReadRecovery.h"
+
+static inline void Bump(std::atomic<uint64_t> &counter)
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+ReadRecovery::ReadRecovery(const ReadRecoveryConfig &config)
+    : config(config)
+{
+}
+
+bool ReadRecovery::ShouldLog(uint64_t now, bool force, ReadRecoveryDecision &decision)
+{
+    if (force || !loggedOnce || now - lastLog >= config.logIntervalNs) {
+        decision.log = true;
+        decision.suppressedLogs = suppressed;
+        suppressed = 0;
+        lastLog = now;
+        loggedOnce = true;
+        return true;
+    }
+    suppressed++;
+    Bump(logsSuppressed);
+    return false;
+}
+
+ReadRecoveryDecision ReadRecovery::OnResult(USBReadStatus status, uint64_t now)
+{
+    ReadRecoveryDecision decision;
+    ReadRecoveryState current = state.load(std::memory_order_relaxed);
+
+    if (status == USBReadStatus::Success) {
+        if (current == ReadRecoveryState::Failed) {
+            decision.action = ReadRecoveryAction::Stop;
+            return decision;
+        }
+        if (consecutive > 0 || current != ReadRecoveryState::Healthy) {
+            Bump(recoveries);
+            ShouldLog(now, reopensSinceGood > 0, decision);
+        }
+        consecutive = 0;
+        reopensSinceGood = 0;
+        state.store(ReadRecoveryState::Healthy, std::memory_order_relaxed);
+        return decision;
+    }
+
+    if (status == USBReadStatus::Aborted) {
+        decision.action = ReadRecoveryAction::Stop;
+        return decision;
+    }
+
+    // Other slots keep completing with errors while a reopen is pending or
+    // after giving up; they just go idle
+    if (current == ReadRecoveryState::Reopening || current == ReadRecoveryState::Failed) {
+        decision.action = ReadRecoveryAction::Stop;
+        return decision;
+    }
+
+    Bump(errors);
+    if (status == USBReadStatus::DeviceGone) {
+        // The removal notification takes it from here
+        state.store(ReadRecoveryState::Failed, std::memory_order_relaxed);
+        decision.action = ReadRecoveryAction::Stop;
+        ShouldLog(now, true, decision);
+        return decision;
+    }
+
+    Bump(status == USBReadStatus::Stalled ? stalls : transients);
+    consecutive++;
+
+    if (consecutive > config.reopenAfter) {
+        consecutive = 0;
+        if (reopensSinceGood >= config.maxReopens) {
+            Bump(giveUps);
+            state.store(ReadRecoveryState::Failed, std::memory_order_relaxed);
+            decision.action = ReadRecoveryAction::Stop;
+        } else {
+            Bump(reopens);
+            reopensSinceGood++;
+            state.store(ReadRecoveryState::Reopening, std::memory_order_relaxed);
+            decision.action = ReadRecoveryAction::Reopen;
+        }
+        ShouldLog(now, true, decision);
+        return decision;
+    }
+
+    if (consecutive > 1) {
+        uint32_t shift = consecutive - 2;
+        uint64_t delay = shift >= 32 ? config.maxBackoffNs : config.initialBackoffNs << shift;
+        decision.delayNs = delay < config.maxBackoffNs ? delay : config.maxBackoffNs;
+        Bump(backoffs);
+    }
+    if (status == USBReadStatus::Stalled) {
+        decision.action = ReadRecoveryAction::ClearStall;
+        Bump(stallClears);
+    }
+    state.store(ReadRecoveryState::BackingOff, std::memory_order_relaxed);
+    ShouldLog(now, false, decision);
+    return decision;
+}
+
+void ReadRecovery::OnReopened()
+{
+    if (state.load(std::memory_order_relaxed) == ReadRecoveryState::Reopening)
+        state.store(ReadRecoveryState::BackingOff, std::memory_order_relaxed);
+}
+
+ReadRecoveryDecision ReadRecovery::OnReopenFailed(uint64_t now)
+{
+    ReadRecoveryDecision decision;
+    decision.action = ReadRecoveryAction::Stop;
+    if (state.load(std::memory_order_relaxed) == ReadRecoveryState::Failed)
+        return decision;
+
+    if (reopensSinceGood >= config.maxReopens) {
+        Bump(giveUps);
+        state.store(ReadRecoveryState::Failed, std::memory_order_relaxed);
+    } else {
+        uint32_t shift = reopensSinceGood > 0 ? reopensSinceGood - 1 : 0;
+        decision.delayNs = config.reopenRetryNs << (shift < 16 ? shift : 16);
+        decision.action = ReadRecoveryAction::Reopen;
+        Bump(reopens);
+        reopensSinceGood++;
+        state.store(ReadRecoveryState::Reopening, std::memory_order_relaxed);
+    }
+    ShouldLog(now, true, decision);
+    return decision;
+}
+
+void ReadRecovery::Reset()
+{
+    state.store(ReadRecoveryState::Healthy, std::memory_order_relaxed);
+    consecutive = 0;
+    reopensSinceGood = 0;
+    suppressed = 0;
+    loggedOnce = false;
+}
+
+ReadRecoveryStats ReadRecovery::GetStats() const
+{
+    ReadRecoveryStats s;
+    s.errors         = errors.load(std::memory_order_relaxed);
+    s.stalls         = stalls.load(std::memory_order_relaxed);
+    s.transients     = transients.load(std::memory_order_relaxed);
+    s.stallClears    = stallClears.load(std::memory_order_relaxed);
+    s.backoffs       = backoffs.load(std::memory_order_relaxed);
+    s.reopens        = reopens.load(std::memory_order_relaxed);
+    s.recoveries     = recoveries.load(std::memory_order_relaxed);
+    s.giveUps        = giveUps.load(std::memory_order_relaxed);
+    s.logsSuppressed = logsSuppressed.load(std::memory_order_relaxed);
+    return s;
+}
+
+const char *ReadRecoveryStateName(ReadRecoveryState state)
+{
+    switch (state) {
+    case ReadRecoveryState::Healthy:    return "healthy";
+    case ReadRecoveryState::BackingOff: return "backing off";
+    case ReadRecoveryState::Reopening:  return "reopening";
+    case ReadRecoveryState::Failed:     return "failed";
+    }
+    return "?";
+}
@@ -0,0 +1,112 @@
+#ifndef ReadRecovery_h
+#define ReadRecovery_h
+
+#include <stdint.h>
+#include <atomic>
+
+/// Outcome of one bulk IN read, classified from the platform's error code.
+enum class USBReadStatus : uint8_t {
+    Success,
+    Aborted,      // Pipe aborted by us (StopIO); not an error
+    Stalled,      // Endpoint halted; needs a clear-stall before it moves again
+    Transient,    // Overrun, timeout, CRC/babble and similar
+    DeviceGone,   // Unplugged or no longer responding
+};
+
+/// What the read loop should do next.
+enum class ReadRecoveryAction : uint8_t {
+    Resubmit,     // Queue the read again after delayNs (0 = now)
+    ClearStall,   // Clear the pipe stall, then resubmit after delayNs
+    Reopen,       // Close and reopen the device; don't resubmit
+    Stop,         // Leave the pipe idle (aborted, gone, reopening or given up)
+};
+
+enum class ReadRecoveryState : uint8_t {
+    Healthy,
+    BackingOff,   // Consecutive failures, resubmitting with growing delays
+    Reopening,    // Waiting for the device to be closed and reopened
+    Failed,       // Gave up until the device is replugged
+};
+
+struct ReadRecoveryConfig {
+    uint64_t initialBackoffNs = 1000000;     // Delay after the second failure in a row
+    uint64_t maxBackoffNs     = 200000000;   // Cap for the doubling delay
+    uint32_t reopenAfter      = 8;           // Consecutive failures before Close/reopen
+    uint32_t maxReopens       = 3;           // Reopens without a good read before giving up
+    uint64_t reopenRetryNs    = 100000000;   // Delay before retrying a failed reopen, doubling
+    uint64_t logIntervalNs    = 1000000000;  // At most one routine error log line per interval
+};
+
+/// Counters for every transition, readable from any thread.
+struct ReadRecoveryStats {
+    uint64_t errors         = 0;   // Failed reads (not counting aborts)
+    uint64_t stalls         = 0;
+    uint64_t transients     = 0;
+    uint64_t stallClears    = 0;
+    uint64_t backoffs       = 0;   // Resubmits that were delayed
+    uint64_t reopens        = 0;
+    uint64_t recoveries     = 0;   // Good read after one or more failures
+    uint64_t giveUps        = 0;
+    uint64_t logsSuppressed = 0;
+};
+
+struct ReadRecoveryDecision {
+    ReadRecoveryAction action   = ReadRecoveryAction::Resubmit;
+    uint64_t delayNs            = 0;
+    bool     log                = false;   // Emit a log line for this result
+    uint32_t suppressedLogs     = 0;       // Errors not logged since the last line
+};
+
+/// Error handling for the inbound read loop.
+///
+/// Every completed read is reported with OnResult(); the decision says how
+/// to continue. The first failure resubmits at once (a single glitch should
+/// cost nothing), further ones back off exponentially, a stalled endpoint is
+/// cleared first, and a run of failures escalates to reopening the device.
+/// Reopens that never lead to a good read end in Failed, so a babbling
+/// endpoint can't keep the real-time thread busy. A reopen that fails to
+/// open the device is retried after a growing delay and counts against the
+/// same limit. Logging is rate-limited.
+///
+/// OnResult is called from the I/O thread, OnReopened/OnReopenFailed from the
+/// control run loop while reads are stopped, Reset only with I/O stopped.
+class ReadRecovery {
+public:
+    explicit ReadRecovery(const ReadRecoveryConfig &config = ReadRecoveryConfig());
+
+    void SetConfig(const ReadRecoveryConfig &config) { this->config = config; }
+    const ReadRecoveryConfig &GetConfig() const { return config; }
+
+    ReadRecoveryDecision OnResult(USBReadStatus status, uint64_t now);
+
+    /// The device has been reopened after a Reopen decision.
+    void OnReopened();
+    /// Opening the device again after a Reopen decision failed. Returns
+    /// Reopen with the delay before the next attempt, or Stop once the
+    /// reopens are used up (Failed).
+    ReadRecoveryDecision OnReopenFailed(uint64_t now);
+    /// Fresh start (device replugged); counters are kept.
+    void Reset();
+
+    ReadRecoveryState GetState() const { return state.load(std::memory_order_relaxed); }
+    uint32_t ConsecutiveFailures() const { return consecutive; }
+    ReadRecoveryStats GetStats() const;
+
+private:
+    bool ShouldLog(uint64_t now, bool force, ReadRecoveryDecision &decision);
+
+    ReadRecoveryConfig config;
+    std::atomic<ReadRecoveryState> state{ReadRecoveryState::Healthy};
+    uint32_t consecutive       = 0;
+    uint32_t reopensSinceGood  = 0;
+    uint64_t lastLog           = 0;
+    bool     loggedOnce        = false;
+    uint32_t suppressed        = 0;
+
+    std::atomic<uint64_t> errors{0}, stalls{0}, transients{0}, stallClears{0}, backoffs{0},
+                          reopens{0}, recoveries{0}, giveUps{0}, logsSuppressed{0};
+};
+
+const char *ReadRecoveryStateName(ReadRecoveryState state);
+
+#endif /* ReadRecovery_h */
@@ -0,0 +1,68 @@
+#ifndef RingQueue_h
+#define RingQueue_h
+
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+/// FIFO on a power-of-two ring that doubles when full and never shrinks,
+/// so once a queue has reached its working depth it no longer allocates
+/// (std::deque allocates and frees a node every few elements). Popped
+/// slots are reset to T() so they let go of what they held.
+template <typename T>
+class RingQueue {
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return items.size(); }
+
+    T &front() { return items[head]; }
+    T &back() { return items[(head + count - 1) & mask]; }
+    T &operator[](size_t i) { return items[(head + i) & mask]; }
+
+    void push_back(T &&item)
+    {
+        if (count == items.size()) Grow(items.empty() ? 16 : items.size() * 2);
+        items[(head + count) & mask] = std::move(item);
+        count++;
+    }
+
+    void pop_front()
+    {
+        items[head] = T();
+        head = (head + 1) & mask;
+        count--;
+    }
+
+    void clear()
+    {
+        while (count) pop_front();
+        head = 0;
+    }
+
+    /// Grow ahead of time to hold at least n elements.
+    void reserve(size_t n)
+    {
+        size_t capacity = items.empty() ? 16 : items.size();
+        while (capacity < n) capacity *= 2;
+        if (capacity > items.size()) Grow(capacity);
+    }
+
+private:
+    void Grow(size_t capacity)
+    {
+        std::vector<T> next(capacity);
+        for (size_t i = 0; i < count; i++)
+            next[i] = std::move((*this)[i]);
+        items.swap(next);
+        head = 0;
+        mask = capacity - 1;
+    }
+
+    std::vector<T> items;
+    size_t head  = 0;
+    size_t count = 0;
+    size_t mask  = 0;
+};
+
+#endif /* RingQueue_h */
@@ -0,0 +1,149 @@
+#include "RolandDT1.h"
+#include <string.h>
+
+static const RolandSysExFormat kRolandSysExFormats[] = {
+    { "GS",             { 0x42 },                   1, 3 },
+    { "JV",             { 0x6A },                   1, 4 },
+    { "XV",             { 0x00, 0x10 },             2, 4 },
+    { "Fantom-G",       { 0x00, 0x00, 0x4C },       3, 4 },
+    { "INTEGRA-7",      { 0x00, 0x00, 0x64 },       3, 4 },
+    { "JUPITER-80/50",  { 0x00, 0x00, 0x65 },       3, 4 },
+    { "FA",             { 0x00, 0x00, 0x77 },       3, 4 },
+    { "JD-Xi",          { 0x00, 0x00, 0x00, 0x0E }, 4, 4 },
+};
+
+const RolandSysExFormat *FindRolandSysExFormat(const uint8_t *msg, uint32_t length)
+{
+    if (length < 4 || msg[0] != 0xF0 || msg[1] != kRolandManufacturerID) return nullptr;
+    for (const auto &f : kRolandSysExFormats) {
+        if (length >= 3u + f.modelIDLength && memcmp(msg + 3, f.modelID, f.modelIDLength) == 0)
+            return &f;
+    }
+    return nullptr;
+}
+
+uint8_t RolandChecksum(const uint8_t *bytes, size_t length)
+{
+    unsigned sum = 0;
+    for (size_t i = 0; i < length; i++)
+        sum += bytes[i];
+    return (uint8_t)((128 - (sum & 0x7F)) & 0x7F);
+}
+
+bool ParseRolandDT1(const uint8_t *msg, uint32_t length, RolandDT1 &dt1)
+{
+    const RolandSysExFormat *f = FindRolandSysExFormat(msg, length);
+    if (!f) return false;
+
+    // F0 41 dev model.. 12 addr.. data.. sum F7, at least one data byte
+    uint32_t command = 3u + f->modelIDLength;
+    uint32_t addressAt = command + 1;
+    uint32_t dataAt = addressAt + f->addressLength;
+    if (length < dataAt + 3 || msg[command] != kRolandCommandDT1 || msg[length - 1] != 0xF7)
+        return false;
+    for (uint32_t i = 1; i < length - 1; i++)
+        if (msg[i] & 0x80) return false;
+    if (RolandChecksum(msg + addressAt, length - 2 - addressAt) != msg[length - 2])
+        return false;
+
+    dt1.format = f;
+    dt1.deviceID = msg[2];
+    dt1.address = 0;
+    for (uint8_t i = 0; i < f->addressLength; i++)
+        dt1.address = dt1.address << 7 | msg[addressAt + i];
+    dt1.data = msg + dataAt;
+    dt1.dataLength = length - 2 - dataAt;
+    return true;
+}
+
+bool ParseRolandRQ1(const uint8_t *msg, uint32_t length, RolandRQ1 &rq1)
+{
+    const RolandSysExFormat *f = FindRolandSysExFormat(msg, length);
+    if (!f) return false;
+
+    // F0 41 dev model.. 11 addr.. size.. sum F7
+    uint32_t command = 3u + f->modelIDLength;
+    uint32_t addressAt = command + 1;
+    uint32_t sizeAt = addressAt + f->addressLength;
+    if (length != sizeAt + f->addressLength + 2 || msg[command] != kRolandCommandRQ1
+        || msg[length - 1] != 0xF7)
+        return false;
+    for (uint32_t i = 1; i < length - 1; i++)
+        if (msg[i] & 0x80) return false;
+    if (RolandChecksum(msg + addressAt, length - 2 - addressAt) != msg[length - 2])
+        return false;
+
+    rq1.format = f;
+    rq1.deviceID = msg[2];
+    rq1.address = 0;
+    rq1.size = 0;
+    for (uint8_t i = 0; i < f->addressLength; i++) {
+        rq1.address = rq1.address << 7 | msg[addressAt + i];
+        rq1.size = rq1.size << 7 | msg[sizeAt + i];
+    }
+    return true;
+}
+
+void RolandEncodeAddress(uint32_t address, uint8_t length, uint8_t *out)
+{
+    for (int i = length - 1; i >= 0; i--) {
+        out[i] = (uint8_t)(address & 0x7F);
+        address >>= 7;
+    }
+}
+
+void BuildRolandDT1(const RolandDT1 &header, uint32_t address, const uint8_t *data,
+                    uint32_t dataLength, std::vector<uint8_t> &out)
+{
+    const RolandSysExFormat *f = header.format;
+    out.push_back(0xF0);
+    out.push_back(kRolandManufacturerID);
+    out.push_back(header.deviceID);
+    out.insert(out.end(), f->modelID, f->modelID + f->modelIDLength);
+    out.push_back(kRolandCommandDT1);
+    size_t summed = out.size();
+    uint8_t addr[4];
+    RolandEncodeAddress(address, f->addressLength, addr);
+    out.insert(out.end(), addr, addr + f->addressLength);
+    out.insert(out.end(), data, data + dataLength);
+    out.push_back(RolandChecksum(out.data() + summed, out.size() - summed));
+    out.push_back(0xF7);
+}
+
+bool MergeRolandDT1(uint8_t *queued, uint32_t &length, uint32_t capacity,
+                    const RolandDT1 &incoming, uint32_t maxDataBytes)
+{
+    RolandDT1 prev;
+    if (!ParseRolandDT1(queued, length, prev)) return false;
+    if (prev.format != incoming.format || prev.deviceID != incoming.deviceID) return false;
+
+    uint32_t start = prev.address, end = prev.address + prev.dataLength;
+    if (incoming.address < start || incoming.address > end) return false;
+
+    // Stay inside the first message's page: merged writes never carry into
+    // another parameter block
+    uint32_t newEnd = incoming.address + incoming.dataLength;
+    if (((newEnd - 1) >> 7) != (start >> 7)) return false;
+    uint32_t mergedLength = (newEnd > end ? newEnd : end) - start;
+    if (mergedLength > maxDataBytes) return false;
+
+    // The start address stays, so the data is patched where it is
+    uint32_t dataAt = (uint32_t)(prev.data - queued);
+    uint32_t addressAt = dataAt - prev.format->addressLength;
+    if (dataAt + mergedLength + 2 > capacity) return false;
+    memcpy(queued + dataAt + (incoming.address - start), incoming.data, incoming.dataLength);
+    queued[dataAt + mergedLength] = RolandChecksum(queued + addressAt, dataAt + mergedLength - addressAt);
+    queued[dataAt + mergedLength + 1] = 0xF7;
+    length = dataAt + mergedLength + 2;
+    return true;
+}
+
+bool MergeRolandDT1(std::vector<uint8_t> &queued, const RolandDT1 &incoming, uint32_t maxDataBytes)
+{
+    uint32_t length = (uint32_t)queued.size();
+    queued.resize(length + incoming.dataLength);
+    bool merged = MergeRolandDT1(queued.data(), length, (uint32_t)queued.size(),
+                                 incoming, maxDataBytes);
+    queued.resize(length);
+    return merged;
+}
@@ -0,0 +1,70 @@
+#ifndef RolandDT1_h
+#define RolandDT1_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Roland exclusive: F0 41 <dev> <model...> <cmd> ... <sum> F7
+static constexpr uint8_t kRolandManufacturerID = 0x41;
+static constexpr uint8_t kRolandCommandDT1     = 0x12;   // Data Set 1
+static constexpr uint8_t kRolandCommandRQ1     = 0x11;   // Data Request 1
+
+/// Layout of Roland exclusive messages for one model ID. Addresses are
+/// 7 bits per byte, most significant first.
+struct RolandSysExFormat {
+    const char *name;
+    uint8_t modelID[4];
+    uint8_t modelIDLength;
+    uint8_t addressLength;
+};
+
+/// Known model IDs (GS, INTEGRA-7, JD-Xi, JUPITER-80/50, FA, Fantom-G, XV, JV).
+const RolandSysExFormat *FindRolandSysExFormat(const uint8_t *msg, uint32_t length);
+
+/// One parsed Data Set 1 message; `data` points into the parsed buffer.
+struct RolandDT1 {
+    const RolandSysExFormat *format = nullptr;
+    uint8_t        deviceID   = 0;
+    uint32_t       address    = 0;   // Linear (7 bits per address byte)
+    const uint8_t *data       = nullptr;
+    uint32_t       dataLength = 0;
+};
+
+/// One parsed Data Request 1 message: `size` bytes from `address`.
+struct RolandRQ1 {
+    const RolandSysExFormat *format = nullptr;
+    uint8_t  deviceID = 0;
+    uint32_t address  = 0;
+    uint32_t size     = 0;   // Encoded like the address
+};
+
+/// Roland checksum over address and data bytes.
+uint8_t RolandChecksum(const uint8_t *bytes, size_t length);
+
+/// Parse a complete F0..F7 message as a DT1 for a known model. Rejects bad
+/// checksums, so a corrupted message is never merged with good ones.
+bool ParseRolandDT1(const uint8_t *msg, uint32_t length, RolandDT1 &dt1);
+
+/// Parse a complete F0..F7 message as an RQ1 for a known model.
+bool ParseRolandRQ1(const uint8_t *msg, uint32_t length, RolandRQ1 &rq1);
+
+/// Encode a linear address into `length` 7-bit bytes.
+void RolandEncodeAddress(uint32_t address, uint8_t length, uint8_t *out);
+
+/// Append a DT1 message for the format/device of `header` to `out`.
+void BuildRolandDT1(const RolandDT1 &header, uint32_t address, const uint8_t *data,
+                    uint32_t dataLength, std::vector<uint8_t> &out);
+
+/// Fold `incoming` into the complete DT1 message in `queued` when it writes
+/// the same or the directly following addresses of the same model and
+/// device, without leaving the queued message's address page (all address
+/// bytes but the last equal) and without growing past maxDataBytes. Newer
+/// data wins where the two overlap; the checksum is recomputed.
+bool MergeRolandDT1(std::vector<uint8_t> &queued, const RolandDT1 &incoming, uint32_t maxDataBytes);
+/// The same in place: `queued` holds `length` bytes in a buffer of
+/// `capacity`; false, unchanged, when the merged message would not fit.
+bool MergeRolandDT1(uint8_t *queued, uint32_t &length, uint32_t capacity,
+                    const RolandDT1 &incoming, uint32_t maxDataBytes);
+
+#endif /* RolandDT1_h */
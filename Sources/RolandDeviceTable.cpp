@@ -0,0 +1,93 @@
+#include "RolandDeviceTable.h"
+#include <string.h>
+
+const RolandDeviceInfo *FindRolandDevice(uint16_t productID)
+{
+    for (size_t i = 0; i < kNumSupportedDevices; i++) {
+        if (kSupportedDevices[i].productID == productID)
+            return &kSupportedDevices[i];
+    }
+    return nullptr;
+}
+
+bool RolandPerfProfileIsValid(const RolandPerfProfile &profile, const char **reason)
+{
+    const char *bad = nullptr;
+
+    if (profile.sysExChunkSize < kMinSysExChunkSize)
+        bad = "SysExChunkSize";
+    // A paced chunk must fit one bulk OUT transfer (3 MIDI bytes per 4-byte packet)
+    else if (profile.maxTxTransferSize < 64 || profile.maxTxTransferSize > kMaxTxTransferSize
+             || (profile.maxTxTransferSize % 4) != 0)
+        bad = "MaxTxTransferSize";
+    else if ((uint32_t)(profile.sysExChunkSize + 2) / 3 * 4 > profile.maxTxTransferSize)
+        bad = "SysExChunkSize";
+    else if (profile.sysExChunkGapUs > kMaxSysExChunkGapUs)
+        bad = "SysExChunkGapUs";
+    else if (profile.minSysExChunkGapUs > kMaxSysExChunkGapUs)
+        bad = "MinSysExChunkGapUs";
+    else if (profile.readQueueDepth < 1 || profile.readQueueDepth > kMaxReadQueueDepth)
+        bad = "ReadQueueDepth";
+    else if (profile.writeQueueDepth < 1 || profile.writeQueueDepth > kMaxWriteQueueDepth)
+        bad = "WriteQueueDepth";
+    // Reads are whole USB-MIDI packets of at least one full-speed max packet
+    else if (profile.readBufferSize < 64 || profile.readBufferSize > kMaxReadBufferSize
+             || (profile.readBufferSize % 64) != 0)
+        bad = "ReadBufferSize";
+    // Mach rejects a computation longer than the constraint, or a constraint
+    // longer than the period
+    else if (profile.ioComputationUs > profile.ioConstraintUs
+             || profile.ioConstraintUs > kMaxIOConstraintUs)
+        bad = "IOThreadConstraintUs";
+    else if (profile.ioPeriodUs != 0 && profile.ioPeriodUs < profile.ioConstraintUs)
+        bad = "IOThreadPeriodUs";
+    else if (profile.lazyOpen > 1)
+        bad = "LazyOpen";
+    else if (profile.idleCloseS > kMaxIdleCloseS)
+        bad = "IdleCloseS";
+
+    if (reason) *reason = bad;
+    return bad == nullptr;
+}
+
+bool RolandPerfProfileAssignValue(RolandPerfProfile &profile, const char *key, int64_t value)
+{
+    if (!key || value < 0 || value > 0xFFFFFFFF) return false;
+
+    if (strcmp(key, "SysExChunkSize") == 0 && value <= 0xFFFF)
+        profile.sysExChunkSize = (uint16_t)value;
+    else if (strcmp(key, "SysExChunkGapUs") == 0)
+        profile.sysExChunkGapUs = (uint32_t)value;
+    else if (strcmp(key, "MinSysExChunkGapUs") == 0)
+        profile.minSysExChunkGapUs = (uint32_t)value;
+    else if (strcmp(key, "ReadQueueDepth") == 0 && value <= 0xFF)
+        profile.readQueueDepth = (uint8_t)value;
+    else if (strcmp(key, "ReadBufferSize") == 0 && value <= 0xFFFF)
+        profile.readBufferSize = (uint16_t)value;
+    else if (strcmp(key, "MaxTxTransferSize") == 0 && value <= 0xFFFF)
+        profile.maxTxTransferSize = (uint16_t)value;
+    else if (strcmp(key, "WriteQueueDepth") == 0 && value <= 0xFF)
+        profile.writeQueueDepth = (uint8_t)value;
+    else if (strcmp(key, "IOThreadPeriodUs") == 0)
+        profile.ioPeriodUs = (uint32_t)value;
+    else if (strcmp(key, "IOThreadComputationUs") == 0)
+        profile.ioComputationUs = (uint32_t)value;
+    else if (strcmp(key, "IOThreadConstraintUs") == 0)
+        profile.ioConstraintUs = (uint32_t)value;
+    else if (strcmp(key, "LazyOpen") == 0 && value <= 0xFF)
+        profile.lazyOpen = (uint8_t)value;
+    else if (strcmp(key, "IdleCloseS") == 0)
+        profile.idleCloseS = (uint32_t)value;
+    else
+        return false;
+    return true;
+}
+
+bool RolandPerfProfileSetValue(RolandPerfProfile &profile, const char *key, int64_t value)
+{
+    RolandPerfProfile candidate = profile;
+    if (!RolandPerfProfileAssignValue(candidate, key, value)) return false;
+    if (!RolandPerfProfileIsValid(candidate)) return false;
+    profile = candidate;
+    return true;
+}
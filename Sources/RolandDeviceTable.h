@@ -0,0 +1,128 @@
+#ifndef RolandDeviceTable_h
+#define RolandDeviceTable_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Supported Roland devices (all share VID 0x0582)
+#define kMaxPortsPerDevice 6
+
+// 5-pin DIN MIDI: 31250 baud, 10 bits per byte
+static constexpr uint16_t kDINBytesPerSecond = 3125;
+
+struct RolandPortInfo {
+    const char *name;   // Entity name in CoreMIDI (e.g. "FA-06/07/08 DAW CTRL")
+    uint8_t cable;      // USB-MIDI cable number (0-15)
+    uint16_t dinBytesPerSecond = 0;  // Cable feeds a DIN jack at this rate (0 = USB only)
+};
+
+/// I/O tuning for one model. Values can be overridden per device at runtime
+/// (see RolandPerfProfileSetValue) without a rebuild.
+struct RolandPerfProfile {
+    uint16_t sysExChunkSize;     // MIDI bytes per paced SysEx chunk
+    uint32_t sysExChunkGapUs;    // Gap before the next chunk of the same SysEx
+    uint32_t minSysExChunkGapUs; // Floor for adaptive pacing (0 = always use the fixed gap)
+    uint8_t  readQueueDepth;     // Bulk IN reads kept outstanding
+    uint16_t readBufferSize;     // Bytes per bulk IN read
+    uint16_t maxTxTransferSize;  // Bytes per bulk OUT transfer
+    uint8_t  writeQueueDepth = 1; // Bulk OUT writes kept in flight at most (1 = synchronous)
+    // Time-constraint policy of the device's I/O threads (0 computation = normal priority)
+    uint32_t ioPeriodUs      = 1000;
+    uint32_t ioComputationUs = 500;
+    uint32_t ioConstraintUs  = 1000;
+    // Lazy mode: claim the interface on first use, release it after
+    // idleCloseS seconds unused (0 = keep it once opened)
+    uint8_t  lazyOpen   = 0;
+    uint32_t idleCloseS = 0;
+};
+
+// Early full-speed sound modules with small receive buffers (Sound Canvas, SD series).
+static constexpr RolandPerfProfile kProfileSoundCanvas  = { 128, 25000,  5000, 2,  64,  256 };
+// Full-speed synths and modules of the XV/Fantom-X generation; the original global tuning.
+static constexpr RolandPerfProfile kProfileFullSpeed    = { 256, 20000,  2000, 2,  64,  512 };
+// USB 2.0 era instruments that drain SysEx quickly (Fantom-G, Jupiter, INTEGRA-7, FA).
+static constexpr RolandPerfProfile kProfileHighSpeed    = { 512, 10000,  1000, 4, 512, 1024, 4 };
+// Pure USB-to-DIN interfaces: a chunk must drain at 3125 B/s before the next one.
+static constexpr RolandPerfProfile kProfileDINInterface = { 128, 45000, 20000, 2,  64,  256 };
+
+// Bounds enforced by RolandPerfProfileIsValid
+static constexpr uint16_t kMinSysExChunkSize   = 16;
+static constexpr uint32_t kMaxSysExChunkGapUs  = 500000;
+static constexpr uint8_t  kMaxReadQueueDepth   = 8;
+static constexpr uint16_t kMaxReadBufferSize   = 4096;
+static constexpr uint16_t kMaxTxTransferSize   = 4096;
+static constexpr uint8_t  kMaxWriteQueueDepth  = 8;
+static constexpr uint32_t kMaxIOConstraintUs   = 50000;
+static constexpr uint32_t kMaxIdleCloseS       = 86400;
+
+struct RolandDeviceInfo {
+    const char *name;
+    uint16_t   productID;
+    uint8_t    numPorts;  // Number of MIDI cable ports
+    RolandPortInfo ports[kMaxPortsPerDevice];
+    RolandPerfProfile profile;
+};
+
+static const uint16_t kRolandVendorIDValue = 0x0582;
+
+static const RolandDeviceInfo kSupportedDevices[] = {
+    { "Roland SC-8850",          0x0003, 6, {{ "SC-8850 Part A", 0 }, { "SC-8850 Part B", 1 }, { "SC-8850 Part C", 2 }, { "SC-8850 Part D", 3 }, { "SC-8850 MIDI 1", 4, kDINBytesPerSecond }, { "SC-8850 MIDI 2", 5, kDINBytesPerSecond }}, kProfileSoundCanvas },
+    { "Roland SC-8820",          0x0007, 2, {{ "SC-8820 Part A", 0 }, { "SC-8820 Part B", 1 }}, kProfileSoundCanvas },
+    { "Roland SK-500",           0x000B, 2, {{ "SK-500 Part A", 0 }, { "SK-500 Part B", 1 }}, kProfileSoundCanvas },
+    { "Roland SC-D70",           0x000C, 2, {{ "SC-D70 Part A", 0 }, { "SC-D70 Part B", 1 }}, kProfileSoundCanvas },
+    { "Roland XV-5050",          0x0012, 1, {{ "XV-5050", 0 }}, kProfileFullSpeed },
+    { "Roland SD-90",            0x0016, 2, {{ "SD-90 MIDI 1", 0 }, { "SD-90 MIDI 2", 1 }}, kProfileSoundCanvas },
+    { "Roland V-Synth",          0x001D, 1, {{ "V-Synth", 0 }}, kProfileFullSpeed },
+    { "Roland SD-20",            0x0027, 1, {{ "SD-20", 0 }}, kProfileSoundCanvas },
+    { "Roland SD-80",            0x0029, 2, {{ "SD-80 MIDI 1", 0 }, { "SD-80 MIDI 2", 1 }}, kProfileSoundCanvas },
+    { "Roland XV-2020",          0x002D, 1, {{ "XV-2020", 0 }}, kProfileFullSpeed },
+    { "Edirol PCR",              0x0033, 3, {{ "PCR MIDI", 0 }, { "PCR 1", 1 }, { "PCR 2", 2 }}, kProfileFullSpeed },
+    { "Roland Fantom-X",         0x006D, 1, {{ "Fantom-X", 0 }}, kProfileFullSpeed },
+    { "Roland G-70",             0x0080, 2, {{ "G-70 MIDI", 0, kDINBytesPerSecond }, { "G-70 Control", 1 }}, kProfileFullSpeed },
+    { "Roland V-Synth XT",       0x0084, 1, {{ "V-Synth XT", 0 }}, kProfileFullSpeed },
+    { "Roland Juno-G",           0x00A6, 1, {{ "Juno-G", 0 }}, kProfileFullSpeed },
+    { "Roland MC-808",           0x00A9, 1, {{ "MC-808", 0 }}, kProfileFullSpeed },
+    { "Roland SH-201",           0x00AD, 1, {{ "SH-201", 0 }}, kProfileFullSpeed },
+    { "Roland SonicCell",        0x00C2, 1, {{ "SonicCell", 0 }}, kProfileFullSpeed },
+    { "Roland V-Synth GT",       0x00C7, 1, {{ "V-Synth GT", 0 }}, kProfileFullSpeed },
+    { "Roland Fantom-G",         0x00DE, 1, {{ "Fantom-G", 0 }}, kProfileHighSpeed },
+    { "Roland Juno-Di/Stage",    0x00F8, 1, {{ "JUNO", 0 }}, kProfileFullSpeed },
+    { "Roland VS-700C",          0x00FC, 1, {{ "VS-700C Console", 0 }}, kProfileFullSpeed },
+    // GAIA SH-01 (0x0111): Roland ships a dedicated kext (SH01USBDriver).
+    // Support put on hold — see CLAUDE.md for background.
+    { "Roland GAIA SH-01",     0x0111, 1, {{ "GAIA SH-01", 0 }}, kProfileFullSpeed },
+    { "Roland Lucina AX-09",     0x011C, 1, {{ "Lucina AX-09", 0 }}, kProfileFullSpeed },
+    { "Roland Juno-Gi",          0x0123, 1, {{ "Juno-Gi", 0 }}, kProfileFullSpeed },
+    { "Roland Jupiter-80",       0x013A, 1, {{ "Jupiter-80", 0 }}, kProfileHighSpeed },
+    { "Roland Jupiter-50",       0x0154, 1, {{ "Jupiter-50", 0 }}, kProfileHighSpeed },
+    { "Roland INTEGRA-7",        0x015B, 1, {{ "INTEGRA-7", 0 }}, kProfileHighSpeed },
+    { "Roland FA-06/07/08",         0x0174, 2, {{ "FA-06/07/08", 0 }, { "FA-06/07/08 DAW CTRL", 1 }}, kProfileHighSpeed },
+    { "Roland JD-Xi",            0x01A1, 1, {{ "JD-Xi", 0 }}, kProfileFullSpeed },
+    // Interfaces
+    { "Roland UM-ONE",           0x012A, 1, {{ "UM-ONE", 0, kDINBytesPerSecond }}, kProfileDINInterface },
+    { "Roland QUAD-CAPTURE",     0x012F, 1, {{ "QUAD-CAPTURE", 0, kDINBytesPerSecond }}, kProfileDINInterface },
+};
+
+static const size_t kNumSupportedDevices = sizeof(kSupportedDevices) / sizeof(kSupportedDevices[0]);
+
+/// Find device info for a given product ID. Returns nullptr if not supported.
+const RolandDeviceInfo *FindRolandDevice(uint16_t productID);
+
+/// Check a profile against the driver's limits. On failure *reason (if given)
+/// names the offending field.
+bool RolandPerfProfileIsValid(const RolandPerfProfile &profile, const char **reason = nullptr);
+
+/// Store one named field ("SysExChunkSize", "SysExChunkGapUs",
+/// "MinSysExChunkGapUs", "ReadQueueDepth", "ReadBufferSize",
+/// "MaxTxTransferSize", "WriteQueueDepth", "IOThreadPeriodUs",
+/// "IOThreadComputationUs", "IOThreadConstraintUs") without checking it
+/// against the other fields, so several overrides can be combined before
+/// RolandPerfProfileIsValid. Returns false and leaves the profile unchanged
+/// for an unknown key or a value that doesn't fit the field.
+bool RolandPerfProfileAssignValue(RolandPerfProfile &profile, const char *key, int64_t value);
+
+/// Apply one named override on its own. Returns false and leaves the profile
+/// unchanged for an unknown key or a value that would make the profile invalid.
+bool RolandPerfProfileSetValue(RolandPerfProfile &profile, const char *key, int64_t value);
+
+#endif /* RolandDeviceTable_h */
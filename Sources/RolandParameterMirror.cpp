@@ -0,0 +1,286 @@
+#include "RolandParameterMirror.h"
+#include <algorithm>
+#include <string.h>
+
+// Map and LRU node overhead per page, roughly
+static constexpr size_t kPageOverhead = 64;
+
+// GS reset is a DT1 of 00 to 40 00 7F
+static constexpr uint32_t kGSResetAddress = 0x40u << 14 | 0x7Fu;
+
+// Model ID length (2 bits), model ID (up to 4 x 7) and device ID (7): 37
+// bits, which leaves room for the 21-bit page number of a 4-byte address
+static uint64_t DeviceKey(const RolandSysExFormat *f, uint8_t deviceID)
+{
+    uint64_t model = f->modelIDLength - 1u;
+    for (uint8_t i = 0; i < f->modelIDLength; i++)
+        model = model << 7 | f->modelID[i];
+    return model << 7 | deviceID;
+}
+
+static uint64_t PageKey(uint64_t device, uint32_t address)
+{
+    return device << 21 | address >> 7;
+}
+
+static uint8_t TopAddressByte(const RolandSysExFormat *f, uint32_t address)
+{
+    return (uint8_t)(address >> (7 * (f->addressLength - 1)) & 0x7F);
+}
+
+RolandParameterMirror::RolandParameterMirror(HostClock *clock)
+    : clock(clock)
+{
+}
+
+void RolandParameterMirror::SetConfig(const RolandParameterMirrorConfig &newConfig)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    config = newConfig;
+    pages.clear();
+    lru.clear();
+}
+
+RolandParameterMirrorConfig RolandParameterMirror::GetConfig() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+void RolandParameterMirror::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pages.clear();
+    lru.clear();
+    for (auto &a : inbound) a = Assembler();
+    for (auto &a : outbound) a = Assembler();
+}
+
+size_t RolandParameterMirror::MaxPages() const
+{
+    return std::max<size_t>(1, config.maxBytes / (sizeof(Page) + kPageOverhead));
+}
+
+size_t RolandParameterMirror::CachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pages.size() * (sizeof(Page) + kPageOverhead);
+}
+
+// ---------- Observation ----------
+
+void RolandParameterMirror::ObserveInbound(uint8_t cable, const uint8_t *bytes, uint32_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Observe(inbound[cable & 0x0F], true, bytes, length);
+}
+
+void RolandParameterMirror::ObserveOutbound(uint8_t cable, const uint8_t *bytes, uint32_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Observe(outbound[cable & 0x0F], false, bytes, length);
+}
+
+void RolandParameterMirror::Observe(Assembler &a, bool isInbound, const uint8_t *bytes, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        uint8_t b = bytes[i];
+        if (b >= 0xF8) continue;
+
+        if (b == 0xF0) {
+            a.msg.clear();
+            a.msg.push_back(b);
+            a.open = true;
+            a.overflow = false;
+            continue;
+        }
+        if (a.open) {
+            if (b < 0x80) {
+                if (a.msg.size() < config.maxSysExBytes) a.msg.push_back(b);
+                else a.overflow = true;
+                continue;
+            }
+            a.open = false;
+            if (b == 0xF7) {
+                a.msg.push_back(b);
+                if (!a.overflow)
+                    OnSysEx(isInbound, a.msg.data(), (uint32_t)a.msg.size());
+                else if (a.msg.size() > 1 && a.msg[1] == kRolandManufacturerID)
+                    InvalidateAll();   // A write we could not follow
+                continue;
+            }
+        }
+
+        // A patch change replaces the temporary areas
+        uint8_t kind = b & 0xF0;
+        if (kind == 0xC0
+            || (kind == 0xB0 && i + 1 < length && (bytes[i + 1] == 0 || bytes[i + 1] == 32)))
+            InvalidateAll();
+    }
+}
+
+void RolandParameterMirror::OnSysEx(bool isInbound, const uint8_t *msg, uint32_t length)
+{
+    // Universal non-real-time GM System On/Off
+    if (length >= 6 && msg[1] == 0x7E && msg[3] == 0x09) {
+        InvalidateAll();
+        return;
+    }
+    if (length < 6 || msg[1] != kRolandManufacturerID) return;
+
+    RolandDT1 dt1;
+    if (!ParseRolandDT1(msg, length, dt1)) {
+        // A DT1 from the device we cannot read is an update we have missed
+        const RolandSysExFormat *f = FindRolandSysExFormat(msg, length);
+        if (isInbound && f && length > 3u + f->modelIDLength
+            && msg[3 + f->modelIDLength] == kRolandCommandDT1)
+            InvalidateAll();
+        return;
+    }
+
+    if (dt1.format->addressLength == 3 && dt1.address == kGSResetAddress) {
+        InvalidateAll();
+        return;
+    }
+
+    if (!isInbound) {
+        uint64_t device = DeviceKey(dt1.format, dt1.deviceID);
+        uint8_t top = TopAddressByte(dt1.format, dt1.address);
+        for (auto it = pages.begin(); it != pages.end();) {
+            auto next = std::next(it);
+            if (it->second.device == device && it->second.top != top)
+                Erase(it);
+            it = next;
+        }
+    }
+    Store(dt1);
+}
+
+// ---------- Pages ----------
+
+void RolandParameterMirror::Erase(std::unordered_map<uint64_t, Page>::iterator it)
+{
+    lru.erase(it->second.lru);
+    pages.erase(it);
+}
+
+RolandParameterMirror::Page *RolandParameterMirror::Find(uint64_t key, uint64_t now)
+{
+    auto it = pages.find(key);
+    if (it == pages.end()) return nullptr;
+    if (config.maxAgeNs && now - it->second.filledNs >= config.maxAgeNs) {
+        Erase(it);
+        stats.expired++;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void RolandParameterMirror::Store(const RolandDT1 &dt1)
+{
+    uint64_t now = clock->NowNanos();
+    uint64_t device = DeviceKey(dt1.format, dt1.deviceID);
+    uint32_t address = dt1.address;
+    uint32_t end = dt1.address + dt1.dataLength;
+
+    while (address < end) {
+        uint32_t pageStart = address & ~(kPageSize - 1);
+        uint32_t segmentEnd = std::min(end, pageStart + kPageSize);
+        uint64_t key = PageKey(device, address);
+
+        Page *page = Find(key, now);
+        if (page) {
+            lru.splice(lru.begin(), lru, page->lru);
+        } else {
+            while (pages.size() >= MaxPages()) {
+                pages.erase(lru.back());
+                lru.pop_back();
+                stats.evictions++;
+            }
+            page = &pages[key];
+            page->valid[0] = page->valid[1] = 0;
+            page->filledNs = now;
+            page->device = device;
+            page->top = TopAddressByte(dt1.format, address);
+            page->lru = lru.insert(lru.begin(), key);
+        }
+
+        for (uint32_t a = address; a < segmentEnd; a++) {
+            uint32_t i = a - pageStart;
+            page->data[i] = dt1.data[a - dt1.address];
+            page->valid[i >> 6] |= 1ull << (i & 63);
+        }
+        address = segmentEnd;
+    }
+}
+
+void RolandParameterMirror::InvalidateAll()
+{
+    if (pages.empty()) return;
+    pages.clear();
+    lru.clear();
+    stats.invalidations++;
+}
+
+// ---------- Requests ----------
+
+bool RolandParameterMirror::AnswerRQ1(const uint8_t *msg, uint32_t length, std::vector<uint8_t> &reply)
+{
+    RolandRQ1 rq1;
+    if (!ParseRolandRQ1(msg, length, rq1)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Broadcast requests are left to the device(s)
+    if (rq1.deviceID == 0x7F || rq1.size == 0 || rq1.size > config.maxRequestSize) {
+        stats.misses++;
+        return false;
+    }
+
+    uint64_t now = clock->NowNanos();
+    uint64_t device = DeviceKey(rq1.format, rq1.deviceID);
+    uint32_t end = rq1.address + rq1.size;
+    std::vector<Page *> hit;
+    for (uint32_t address = rq1.address; address < end;) {
+        uint32_t pageStart = address & ~(kPageSize - 1);
+        uint32_t segmentEnd = std::min(end, pageStart + kPageSize);
+        Page *page = Find(PageKey(device, address), now);
+        if (!page) {
+            stats.misses++;
+            return false;
+        }
+        for (uint32_t i = address - pageStart; i < segmentEnd - pageStart; i++) {
+            if (!(page->valid[i >> 6] & (1ull << (i & 63)))) {
+                stats.misses++;
+                return false;
+            }
+        }
+        hit.push_back(page);
+        address = segmentEnd;
+    }
+
+    // One DT1 per page, as the device replies
+    RolandDT1 header;
+    header.format = rq1.format;
+    header.deviceID = rq1.deviceID;
+    size_t k = 0;
+    for (uint32_t address = rq1.address; address < end; k++) {
+        uint32_t pageStart = address & ~(kPageSize - 1);
+        uint32_t segmentEnd = std::min(end, pageStart + kPageSize);
+        Page *page = hit[k];
+        lru.splice(lru.begin(), lru, page->lru);
+        BuildRolandDT1(header, address, page->data + (address - pageStart),
+                       segmentEnd - address, reply);
+        address = segmentEnd;
+    }
+    stats.hits++;
+    stats.answeredBytes += rq1.size;
+    return true;
+}
+
+RolandParameterMirrorStats RolandParameterMirror::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    RolandParameterMirrorStats s = stats;
+    s.pages = pages.size();
+    return s;
+}
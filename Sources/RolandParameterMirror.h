@@ -0,0 +1,113 @@
+#ifndef RolandParameterMirror_h
+#define RolandParameterMirror_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "HostClock.h"
+#include "RolandDT1.h"
+#include "USBMIDIParser.h"
+
+struct RolandParameterMirrorConfig {
+    uint32_t maxBytes      = 256 * 1024;    // Approximate memory cap, least recently used pages go first
+    uint64_t maxAgeNs      = 30000000000;   // Pages expire this long after they were first filled (0 = never)
+    uint32_t maxSysExBytes = 4096;          // Longer messages are not reassembled
+    uint32_t maxRequestSize = 4096;         // Larger RQ1 ranges always go to the device
+};
+
+struct RolandParameterMirrorStats {
+    uint64_t hits          = 0;   // RQ1 answered from the mirror
+    uint64_t misses        = 0;   // RQ1 passed on to the device
+    uint64_t answeredBytes = 0;   // Parameter bytes in synthesized DT1 replies
+    uint64_t pages         = 0;   // Currently cached
+    uint64_t evictions     = 0;   // Pages dropped for the memory cap
+    uint64_t expired       = 0;   // Pages dropped for age
+    uint64_t invalidations = 0;   // Whole mirror dropped (patch change, reset, lost update)
+};
+
+/// Sparse copy of a Roland device's parameter memory, used to answer editor
+/// RQ1 polls without a round trip to the device.
+///
+/// Filled from every DT1 seen in either direction: replies and front-panel
+/// edits the device transmits, and writes sent to it. Memory is kept in
+/// 128-byte pages (one per address page, keyed by model, device ID and the
+/// upper address bytes) with a valid bit per byte; an RQ1 is answered only
+/// when every byte it asks for is cached, with one DT1 per page as the
+/// device would send.
+///
+/// Front-panel and other device-side changes:
+///   - edits the device transmits as DT1 update the mirror in place
+///   - a Program Change or Bank Select in either direction, a universal
+///     GM/GS reset, or a corrupted Roland DT1 from the device drops it all
+///   - a write keeps only the device's pages under the same top address
+///     byte, because writes to setup areas load patches into the
+///     temporary areas
+///   - pages expire maxAgeNs after they were filled, which bounds the
+///     staleness of edits the device does not transmit
+/// Thread-safe: the read path and DrvSend call in concurrently.
+class RolandParameterMirror {
+public:
+    explicit RolandParameterMirror(HostClock *clock = &DefaultHostClock());
+
+    /// Applies the config and forgets everything cached.
+    void SetConfig(const RolandParameterMirrorConfig &config);
+    RolandParameterMirrorConfig GetConfig() const;
+
+    /// Forget everything (device reopened, mirror switched on).
+    void Reset();
+
+    /// MIDI bytes received from / sent to the device on a cable, in any
+    /// split (USB-MIDI packets, MIDIPackets); SysEx is reassembled per cable.
+    void ObserveInbound(uint8_t cable, const uint8_t *bytes, uint32_t length);
+    void ObserveOutbound(uint8_t cable, const uint8_t *bytes, uint32_t length);
+
+    /// If `msg` is one complete RQ1 whose range is fully cached, append the
+    /// DT1 replies to `reply` and return true. The RQ1 must then not be sent.
+    bool AnswerRQ1(const uint8_t *msg, uint32_t length, std::vector<uint8_t> &reply);
+
+    /// Approximate memory held by cached pages.
+    size_t CachedBytes() const;
+
+    RolandParameterMirrorStats GetStats() const;
+
+private:
+    static constexpr uint32_t kPageSize = 128;
+
+    struct Page {
+        uint8_t  data[kPageSize];
+        uint64_t valid[2];
+        uint64_t filledNs;
+        uint64_t device;   // Model and device ID
+        uint8_t  top;      // First address byte
+        std::list<uint64_t>::iterator lru;
+    };
+
+    struct Assembler {
+        std::vector<uint8_t> msg;
+        bool open     = false;
+        bool overflow = false;
+    };
+
+    void Observe(Assembler &a, bool inbound, const uint8_t *bytes, uint32_t length);
+    void OnSysEx(bool inbound, const uint8_t *msg, uint32_t length);
+    void Store(const RolandDT1 &dt1);
+    void InvalidateAll();
+    void Erase(std::unordered_map<uint64_t, Page>::iterator it);
+    Page *Find(uint64_t key, uint64_t now);
+    size_t MaxPages() const;
+
+    HostClock *clock;
+    RolandParameterMirrorConfig config;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Page> pages;
+    std::list<uint64_t> lru;   // Most recently used first
+    Assembler inbound[kUSBMIDINumCables];
+    Assembler outbound[kUSBMIDINumCables];
+    RolandParameterMirrorStats stats;
+};
+
+#endif /* RolandParameterMirror_h */
@@ -1,23 +1,56 @@
 #include "RolandUSBDevice.h"
 #include "USBMIDIParser.h"
 #include <os/log.h>
+#include <stdio.h>
+#include <stddef.h>
 #include <mach/mach_time.h>
 
 static os_log_t sLog = os_log_create("se.cutup.MultiRolandDriver", "usb");
 
-const RolandDeviceInfo *FindRolandDevice(uint16_t productID)
+static const mach_timebase_info_data_t &Timebase()
 {
-    for (size_t i = 0; i < kNumSupportedDevices; i++) {
-        if (kSupportedDevices[i].productID == productID)
-            return &kSupportedDevices[i];
-    }
-    return nullptr;
+    static mach_timebase_info_data_t sTimebase = [] {
+        mach_timebase_info_data_t tb;
+        mach_timebase_info(&tb);
+        return tb;
+    }();
+    return sTimebase;
+}
+
+static uint64_t AbsToNanos(uint64_t abs)
+{
+    const auto &tb = Timebase();
+    return (uint64_t)((double)abs * tb.numer / tb.denom);
+}
+
+// MIDIPacketListBuilder writes CoreMIDI's packet list layout without its headers
+static_assert(offsetof(MIDIPacketList, packet) == kMIDIPacketListHeaderBytes,
+              "MIDIPacketList header");
+static_assert(offsetof(MIDIPacket, data) == kMIDIPacketHeaderBytes, "MIDIPacket header");
+static_assert(kMaxWriteQueueDepth <= kMaxWritesInFlight, "one write slot per write in flight");
+
+static uint64_t NanosToAbs(uint64_t ns)
+{
+    const auto &tb = Timebase();
+    return (uint64_t)((double)ns * tb.denom / tb.numer);
 }
 
 RolandUSBDevice::RolandUSBDevice(io_service_t usbService, const RolandDeviceInfo *info)
-    : deviceInfo(info), service(usbService)
+    : deviceInfo(info), service(usbService), profile(info->profile)
 {
     IOObjectRetain(service);
+
+    for (auto &enabled : sourceEnabled)
+        enabled.store(true, std::memory_order_relaxed);
+    for (auto &port : cableToPort)
+        port = -1;
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++)
+        cableToPort[deviceInfo->ports[p].cable & 0x0F] = (int8_t)p;
+    transmitter.SetBufferPool(&bufferPool);
+    for (uint8_t p = 0; p < kMaxPortsPerDevice; p++) {
+        rxSinks[p] = { this, p };
+        rxLists[p].SetOutput(&bufferPool, DeliverToSource, &rxSinks[p]);
+    }
 }
 
 RolandUSBDevice::~RolandUSBDevice()
@@ -31,11 +64,568 @@ RolandUSBDevice::~RolandUSBDevice()
 
 void RolandUSBDevice::UpdateService(io_service_t newService)
 {
+    // Replugged: whatever made reads fail before gets a fresh start, and the
+    // bus frame counter may be a different one
+    readRecovery.Reset();
+    timestamper.Reset();
     if (service) IOObjectRelease(service);
     service = newService;
     IOObjectRetain(service);
 }
 
+int RolandUSBDevice::PortForSource(MIDIEndpointRef src) const
+{
+    if (!src) return -1;
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (midiSources[p] == src)
+            return p;
+    }
+    return -1;
+}
+
+int RolandUSBDevice::PortForDest(MIDIEndpointRef dest) const
+{
+    if (!dest) return -1;
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (midiDests[p] == dest)
+            return p;
+    }
+    return -1;
+}
+
+void RolandUSBDevice::SetSourceEnabled(uint8_t port, bool enabled)
+{
+    if (port >= deviceInfo->numPorts) return;
+    sourceEnabled[port].store(enabled, std::memory_order_relaxed);
+    os_log(sLog, "Source %{public}s %{public}s", deviceInfo->ports[port].name,
+           enabled ? "enabled" : "disabled");
+
+    if (!lazy.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    activity.SetListening(port, enabled, DefaultHostClock().NowNanos());
+    if (enabled && activity.NeedsOpen())
+        ActivateLocked();
+}
+
+void RolandUSBDevice::LoadInputFilters()
+{
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!midiEntities[p]) continue;
+        USBMIDIInputFilter &f = rxFilters[deviceInfo->ports[p].cable & 0x0F];
+
+        SInt32 dropMask = 0, clockDivide = 1;
+        if (MIDIObjectGetIntegerProperty(midiEntities[p], kRolandRxDropProperty,
+                                         &dropMask) != noErr)
+            dropMask = 0;
+        if (MIDIObjectGetIntegerProperty(midiEntities[p], kRolandRxClockDivideProperty,
+                                         &clockDivide) != noErr
+            || clockDivide < 1 || clockDivide > 96)
+            clockDivide = 1;
+
+        // Read by the I/O thread on every event; no lock needed for a flag word
+        f.dropMask.store((uint32_t)dropMask, std::memory_order_relaxed);
+        f.clockDivisor.store((uint8_t)clockDivide, std::memory_order_relaxed);
+        if (dropMask || clockDivide > 1)
+            os_log(sLog, "LoadInputFilters: %{public}s drop=0x%x clock 1/%d",
+                   deviceInfo->ports[p].name, (uint32_t)dropMask, (int)clockDivide);
+
+        // The smoother sees the divided clock; restart it only when that changes
+        SInt32 smooth = 0;
+        if (MIDIObjectGetIntegerProperty(midiEntities[p], kRolandRxClockSmoothProperty,
+                                         &smooth) != noErr)
+            smooth = 0;
+        MIDIClockSmootherConfig clockConfig;
+        clockConfig.pulsesPerQuarter = (double)kMIDIClockPPQN / clockDivide;
+        MIDIClockSmoother &smoother = clockSmoothers[p];
+        bool wasOn = clockSmoothing[p].load(std::memory_order_relaxed);
+        if (smooth && (!wasOn || smoother.GetConfig().pulsesPerQuarter != clockConfig.pulsesPerQuarter)) {
+            clockSmoothing[p].store(false, std::memory_order_relaxed);
+            if (ioThread.IsRunning())
+                ioThread.PostAndWait([&] { smoother.SetConfig(clockConfig); });
+            else
+                smoother.SetConfig(clockConfig);
+            os_log(sLog, "LoadInputFilters: %{public}s clock smoothing on", deviceInfo->ports[p].name);
+        }
+        clockSmoothing[p].store(smooth != 0, std::memory_order_relaxed);
+
+        // A mirror switched on starts empty: nothing seen while it was off counts
+        SInt32 mirror = 0;
+        if (MIDIObjectGetIntegerProperty(midiEntities[p], kRolandParamMirrorProperty,
+                                         &mirror) != noErr)
+            mirror = 0;
+        if (mirror && !paramMirroring[p].load(std::memory_order_relaxed)) {
+            paramMirror.Reset();
+            os_log(sLog, "LoadInputFilters: %{public}s parameter mirror on", deviceInfo->ports[p].name);
+        }
+        paramMirroring[p].store(mirror != 0, std::memory_order_relaxed);
+
+        SInt32 probe = 0;
+        if (MIDIObjectGetIntegerProperty(midiEntities[p], kRolandLatencyProbeProperty,
+                                         &probe) != noErr
+            || probe < 0 || probe > (SInt32)LatencyProbeMode::Loopback)
+            probe = 0;
+        uint8_t cable = deviceInfo->ports[p].cable & 0x0F;
+        auto mode = (LatencyProbeMode)probe;
+        if (mode != latencyProbe.GetMode(cable)) {
+            latencyProbe.SetMode(cable, mode);
+            os_log(sLog, "LoadInputFilters: %{public}s latency probe %{public}s", deviceInfo->ports[p].name,
+                   mode == LatencyProbeMode::Identity ? "identity" :
+                   mode == LatencyProbeMode::Loopback ? "loopback" : "off");
+        }
+        latencyProbing[p].store(probe != 0, std::memory_order_relaxed);
+    }
+}
+
+void RolandUSBDevice::PublishInputFilterCounters()
+{
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!midiEntities[p]) continue;
+        const USBMIDIInputFilter &f = rxFilters[deviceInfo->ports[p].cable & 0x0F];
+        MIDIObjectSetIntegerProperty(midiEntities[p], kRolandRxFilteredProperty,
+                                     (SInt32)f.filteredEvents);
+    }
+}
+
+void RolandUSBDevice::PublishOutputCounters()
+{
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!midiEntities[p]) continue;
+        MIDICableStats s = transmitter.GetCableStats(deviceInfo->ports[p].cable & 0x0F);
+        MIDIObjectSetIntegerProperty(midiEntities[p], kRolandTxQueueDepthProperty,
+                                     (SInt32)s.pendingBytes);
+        MIDIObjectSetIntegerProperty(midiEntities[p], kRolandTxQueuePeakProperty,
+                                     (SInt32)s.peakPendingBytes);
+        MIDIObjectSetIntegerProperty(midiEntities[p], kRolandTxShaperHoldsProperty,
+                                     (SInt32)s.shaperHolds);
+    }
+
+    if (midiDevice && profile.writeQueueDepth > 1) {
+        MIDITransmitterStats t = transmitter.GetStats();
+        MIDIObjectSetIntegerProperty(midiDevice, kRolandTxWriteWindowProperty,
+                                     (SInt32)t.writeWindow);
+        MIDIObjectSetIntegerProperty(midiDevice, kRolandTxWriteLatencyProperty,
+                                     (SInt32)(t.writeLatencyNs / 1000));
+    }
+}
+
+// Statistics published as dictionaries: event counts go out as SInt64,
+// measurements (tempo, times in µs) as double
+struct CounterField {
+    CFStringRef key;
+    uint64_t    value;
+};
+
+struct MeasureField {
+    CFStringRef key;
+    double      value;
+};
+
+static void SetNumber(CFMutableDictionaryRef dict, const CounterField &f)
+{
+    SInt64 v = (SInt64)f.value;
+    CFNumberRef number = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt64Type, &v);
+    CFDictionarySetValue(dict, f.key, number);
+    CFRelease(number);
+}
+
+static void SetNumber(CFMutableDictionaryRef dict, const MeasureField &f)
+{
+    CFNumberRef number = CFNumberCreate(kCFAllocatorDefault, kCFNumberDoubleType, &f.value);
+    CFDictionarySetValue(dict, f.key, number);
+    CFRelease(number);
+}
+
+template <typename Field, size_t N>
+static CFMutableDictionaryRef CreateNumberDictionary(const Field (&fields)[N])
+{
+    CFMutableDictionaryRef dict = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    for (const Field &f : fields)
+        SetNumber(dict, f);
+    return dict;
+}
+
+template <size_t N, size_t M>
+static CFMutableDictionaryRef CreateNumberDictionary(const CounterField (&counters)[N],
+                                                     const MeasureField (&measures)[M])
+{
+    CFMutableDictionaryRef dict = CreateNumberDictionary(counters);
+    for (const MeasureField &f : measures)
+        SetNumber(dict, f);
+    return dict;
+}
+
+template <typename... Fields>
+static void SetNumberDictionary(MIDIObjectRef object, CFStringRef property, const Fields &... fields)
+{
+    CFMutableDictionaryRef dict = CreateNumberDictionary(fields...);
+    MIDIObjectSetDictionaryProperty(object, property, dict);
+    CFRelease(dict);
+}
+
+void RolandUSBDevice::PublishReadRecoveryCounters()
+{
+    if (!midiDevice) return;
+
+    ReadRecoveryStats s = readRecovery.GetStats();
+    const CounterField fields[] = {
+        { CFSTR("Errors"),         s.errors },
+        { CFSTR("Stalls"),         s.stalls },
+        { CFSTR("Transients"),     s.transients },
+        { CFSTR("StallClears"),    s.stallClears },
+        { CFSTR("Backoffs"),       s.backoffs },
+        { CFSTR("Reopens"),        s.reopens },
+        { CFSTR("Recoveries"),     s.recoveries },
+        { CFSTR("GiveUps"),        s.giveUps },
+        { CFSTR("LogsSuppressed"), s.logsSuppressed },
+    };
+
+    CFMutableDictionaryRef dict = CreateNumberDictionary(fields);
+    CFStringRef state = CFStringCreateWithCString(kCFAllocatorDefault,
+        ReadRecoveryStateName(readRecovery.GetState()), kCFStringEncodingUTF8);
+    CFDictionarySetValue(dict, CFSTR("State"), state);
+    CFRelease(state);
+
+    MIDIObjectSetDictionaryProperty(midiDevice, kRolandRxRecoveryProperty, dict);
+    CFRelease(dict);
+}
+
+void RolandUSBDevice::PublishClockStats()
+{
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!midiEntities[p] || !clockSmoothing[p].load(std::memory_order_relaxed)) continue;
+        MIDIClockStats s = clockSmoothers[p].GetStats();
+        const CounterField counters[] = {
+            { CFSTR("Pulses"),         s.pulses },
+            { CFSTR("Relocks"),        s.relocks },
+        };
+        const MeasureField measures[] = {
+            { CFSTR("BPM"),            s.bpm },
+            { CFSTR("InputJitterUs"),  s.inputJitterNs / 1000.0 },
+            { CFSTR("OutputJitterUs"), s.outputJitterNs / 1000.0 },
+        };
+        SetNumberDictionary(midiEntities[p], kRolandRxClockProperty, counters, measures);
+    }
+}
+
+void RolandUSBDevice::PublishClockGeneratorStats()
+{
+    if (!midiDevice || !clockGenerator || !clockOutPorts) return;
+
+    MIDIClockGeneratorStats s = clockGenerator->GetStats();
+    const CounterField counters[] = {
+        { CFSTR("Running"),       s.clockRunning ? 1u : 0u },
+        { CFSTR("Playing"),       s.playing ? 1u : 0u },
+        { CFSTR("Pulses"),        s.pulses },
+        { CFSTR("Overruns"),      s.overruns },
+        { CFSTR("Dropped"),       s.dropped },
+    };
+    const MeasureField measures[] = {
+        { CFSTR("BPM"),           s.bpm },
+        { CFSTR("LatenessRmsUs"), s.latenessRmsNs / 1000.0 },
+        { CFSTR("LatenessMaxUs"), s.latenessMaxNs / 1000.0 },
+    };
+    SetNumberDictionary(midiDevice, kRolandClockGenProperty, counters, measures);
+}
+
+void RolandUSBDevice::PublishParamMirrorStats()
+{
+    if (!midiDevice) return;
+    bool mirroring = false;
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++)
+        mirroring |= paramMirroring[p].load(std::memory_order_relaxed);
+    if (!mirroring) return;
+
+    RolandParameterMirrorStats s = paramMirror.GetStats();
+    const CounterField fields[] = {
+        { CFSTR("Hits"),          s.hits },
+        { CFSTR("Misses"),        s.misses },
+        { CFSTR("Pages"),         s.pages },
+        { CFSTR("Evictions"),     s.evictions },
+        { CFSTR("Expired"),       s.expired },
+        { CFSTR("Invalidations"), s.invalidations },
+    };
+    SetNumberDictionary(midiDevice, kRolandParamMirrorStatsProperty, fields);
+}
+
+void RolandUSBDevice::PublishActivity()
+{
+    if (!midiDevice) return;
+
+    DeviceActivityStats s = ActivityStats();
+    const CounterField fields[] = {
+        { CFSTR("Open"),         s.open ? 1u : 0u },
+        { CFSTR("Opens"),        s.opens },
+        { CFSTR("OpenFailures"), s.openFailures },
+        { CFSTR("IdleCloses"),   s.idleCloses },
+        { CFSTR("LastOpenUs"),   s.lastOpenNs / 1000 },
+    };
+    SetNumberDictionary(midiDevice, kRolandActivityProperty, fields);
+}
+
+void RolandUSBDevice::PublishLatency()
+{
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!midiEntities[p] || !latencyProbing[p].load(std::memory_order_relaxed)) continue;
+        LatencyProbeStats s = latencyProbe.GetStats(deviceInfo->ports[p].cable & 0x0F);
+        const CounterField counters[] = {
+            { CFSTR("Probes"),   s.probes },
+            { CFSTR("Replies"),  s.replies },
+            { CFSTR("Timeouts"), s.timeouts },
+            { CFSTR("Voided"),   s.voided },
+            { CFSTR("Late"),     s.late },
+            { CFSTR("Samples"),  s.samples },
+        };
+        const MeasureField measures[] = {
+            { CFSTR("MinUs"),    s.minUs },
+            { CFSTR("MeanUs"),   s.meanUs },
+            { CFSTR("P50Us"),    s.p50Us },
+            { CFSTR("P95Us"),    s.p95Us },
+            { CFSTR("P99Us"),    s.p99Us },
+            { CFSTR("MaxUs"),    s.maxUs },
+        };
+        SetNumberDictionary(midiEntities[p], kRolandLatencyProperty, counters, measures);
+
+        if (s.samples >= 8)
+            MIDIObjectSetIntegerProperty(midiEntities[p], kRolandRoundTripProperty,
+                                         (SInt32)(s.p50Us + 0.5));
+    }
+}
+
+void RolandUSBDevice::PublishPortStats()
+{
+    // Monitors take rates between two of these; the time is when the
+    // counters were read, not when the monitor got to them
+    uint64_t nowUs = DefaultHostClock().NowNanos() / 1000;
+
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!midiEntities[p]) continue;
+        uint8_t cable = deviceInfo->ports[p].cable & 0x0F;
+        MIDITrafficCounters rx = rxTraffic[cable].Load();
+        MIDICableStats tx = transmitter.GetCableStats(cable);
+        const CounterField fields[] = {
+            { CFSTR("TimeUs"),       nowUs },
+            { CFSTR("RxMessages"),   rx.messages },
+            { CFSTR("RxBytes"),      rx.bytes },
+            { CFSTR("RxSysExBytes"), rx.sysExBytes },
+            { CFSTR("TxMessages"),   tx.sent.messages },
+            { CFSTR("TxBytes"),      tx.sent.bytes },
+            { CFSTR("TxSysExBytes"), tx.sent.sysExBytes },
+            { CFSTR("TxQueueBytes"), tx.pendingBytes },
+            { CFSTR("TxQueuePeak"),  tx.peakPendingBytes },
+            { CFSTR("ShaperHolds"),  tx.shaperHolds },
+        };
+        SetNumberDictionary(midiEntities[p], kRolandPortStatsProperty, fields);
+    }
+
+    if (!midiDevice) return;
+    MIDITransmitterStats t = transmitter.GetStats();
+    ReadRecoveryStats r = readRecovery.GetStats();
+    const CounterField fields[] = {
+        { CFSTR("TimeUs"),         nowUs },
+        { CFSTR("ReadErrors"),     r.errors },
+        { CFSTR("WriteErrors"),    t.writeErrors },
+        { CFSTR("Transfers"),      t.transfers },
+        { CFSTR("PacingWaitUs"),   t.pacingWaitNs / 1000 },
+        { CFSTR("SysExGapUs"),     t.sysExGapNs / 1000 },
+        { CFSTR("PacingStalls"),   t.pacingStalls },
+        { CFSTR("WriteWindow"),    t.writeWindow },
+        { CFSTR("WritesInFlight"), t.writesInFlight },
+        { CFSTR("WriteLatencyUs"), t.writeLatencyNs / 1000 },
+    };
+    SetNumberDictionary(midiDevice, kRolandIOStatsProperty, fields);
+}
+
+CFTimeInterval RolandUSBDevice::StatsInterval() const
+{
+    SInt32 ms = kMaxStatsIntervalMs;
+    if (!midiDevice
+        || MIDIObjectGetIntegerProperty(midiDevice, kRolandStatsIntervalProperty, &ms) != noErr)
+        ms = kMaxStatsIntervalMs;
+    if (ms < kMinStatsIntervalMs) ms = kMinStatsIntervalMs;
+    if (ms > kMaxStatsIntervalMs) ms = kMaxStatsIntervalMs;
+    return ms / 1000.0;
+}
+
+void RolandUSBDevice::StatsTimerCallback(CFRunLoopTimerRef timer, void *info)
+{
+    auto *self = static_cast<RolandUSBDevice *>(info);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    // A monitor's faster interval applies to the port stats only; the
+    // rest keeps to about once a second whatever the timer runs at
+    self->PublishPortStats();
+    if (now - self->lastStatsPublish >= 0.95) {
+        self->lastStatsPublish = now;
+        self->PublishInputFilterCounters();
+        self->PublishClockStats();
+        self->PublishClockGeneratorStats();
+        self->PublishParamMirrorStats();
+        self->PublishOutputCounters();
+        self->PublishReadRecoveryCounters();
+    }
+
+    // Picked up within one tick of a monitor setting or removing it
+    CFRunLoopTimerSetNextFireDate(timer, now + self->StatsInterval());
+}
+
+static void ApplyProfileOverrides(RolandPerfProfile &profile, CFDictionaryRef overrides,
+                                  const char *deviceName, const char *origin)
+{
+    static const char *const kKeys[] = {
+        "SysExChunkSize", "SysExChunkGapUs", "MinSysExChunkGapUs",
+        "ReadQueueDepth", "ReadBufferSize", "MaxTxTransferSize", "WriteQueueDepth",
+        "IOThreadPeriodUs", "IOThreadComputationUs", "IOThreadConstraintUs",
+        "LazyOpen", "IdleCloseS"
+    };
+
+    // Keys depend on each other (a bigger chunk needs a bigger transfer), so
+    // the dictionary is checked as a whole against the combined result
+    RolandPerfProfile candidate = profile;
+    for (const char *key : kKeys) {
+        CFStringRef cfKey = CFStringCreateWithCString(kCFAllocatorDefault, key, kCFStringEncodingUTF8);
+        CFTypeRef value = CFDictionaryGetValue(overrides, cfKey);
+        CFRelease(cfKey);
+        if (!value || CFGetTypeID(value) != CFNumberGetTypeID()) continue;
+
+        SInt64 number = 0;
+        CFNumberGetValue((CFNumberRef)value, kCFNumberSInt64Type, &number);
+        if (!RolandPerfProfileAssignValue(candidate, key, number)) {
+            os_log_error(sLog, "LoadProfile: %{public}s rejected %{public}s=%lld (%{public}s)",
+                         deviceName, key, number, origin);
+            return;
+        }
+    }
+
+    const char *reason = nullptr;
+    if (!RolandPerfProfileIsValid(candidate, &reason)) {
+        os_log_error(sLog, "LoadProfile: %{public}s rejected overrides, %{public}s out of range (%{public}s)",
+                     deviceName, reason, origin);
+        return;
+    }
+    profile = candidate;
+    os_log(sLog, "LoadProfile: %{public}s chunk=%u gap=%uus reads=%ux%u tx=%u (%{public}s)",
+           deviceName, profile.sysExChunkSize, profile.sysExChunkGapUs, profile.readQueueDepth,
+           profile.readBufferSize, profile.maxTxTransferSize, origin);
+}
+
+void RolandUSBDevice::LoadProfile()
+{
+    RolandPerfProfile loaded = deviceInfo->profile;
+
+    CFPropertyListRef perModel = CFPreferencesCopyAppValue(kRolandDeviceProfilesKey,
+                                                           kRolandPreferencesDomain);
+    if (perModel && CFGetTypeID(perModel) == CFDictionaryGetTypeID()) {
+        char pidKey[8];
+        snprintf(pidKey, sizeof(pidKey), "0x%04X", deviceInfo->productID);
+        CFStringRef cfKey = CFStringCreateWithCString(kCFAllocatorDefault, pidKey, kCFStringEncodingUTF8);
+        CFTypeRef overrides = CFDictionaryGetValue((CFDictionaryRef)perModel, cfKey);
+        CFRelease(cfKey);
+        if (overrides && CFGetTypeID(overrides) == CFDictionaryGetTypeID())
+            ApplyProfileOverrides(loaded, (CFDictionaryRef)overrides, deviceInfo->name, "defaults");
+    }
+    if (perModel) CFRelease(perModel);
+
+    CFDictionaryRef deviceOverrides = nullptr;
+    if (midiDevice
+        && MIDIObjectGetDictionaryProperty(midiDevice, kRolandProfileProperty, &deviceOverrides) == noErr
+        && deviceOverrides) {
+        ApplyProfileOverrides(loaded, deviceOverrides, deviceInfo->name, "device property");
+        CFRelease(deviceOverrides);
+    }
+
+    profile = loaded;
+
+    MIDITransmitterConfig config = transmitter.GetConfig();
+    config.sysExChunkSize  = profile.sysExChunkSize;
+    config.sysExChunkGapNs = (uint64_t)profile.sysExChunkGapUs * 1000;
+    config.minSysExChunkGapNs = (uint64_t)profile.minSysExChunkGapUs * 1000;
+    for (auto &rate : config.cableBytesPerSecond)
+        rate = 0;
+    config.coalesceCables = 0;
+    config.mergeDT1Cables = 0;
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        uint8_t cable = deviceInfo->ports[p].cable & 0x0F;
+        config.cableBytesPerSecond[cable] = deviceInfo->ports[p].dinBytesPerSecond;
+
+        SInt32 coalesce = 0;
+        if (midiEntities[p]
+            && MIDIObjectGetIntegerProperty(midiEntities[p], kRolandTxCoalesceProperty, &coalesce) == noErr
+            && coalesce)
+            config.coalesceCables |= (uint16_t)(1u << cable);
+
+        SInt32 mergeDT1 = 0;
+        if (midiEntities[p]
+            && MIDIObjectGetIntegerProperty(midiEntities[p], kRolandTxMergeDT1Property, &mergeDT1) == noErr
+            && mergeDT1)
+            config.mergeDT1Cables |= (uint16_t)(1u << cable);
+    }
+    config.maxTransferSize = profile.maxTxTransferSize;
+    config.maxWritesInFlight = profile.writeQueueDepth;
+    transmitter.SetConfig(config);
+}
+
+static CFStringRef CreatePacingKey(uint16_t productID, uint64_t locationID)
+{
+    return CFStringCreateWithFormat(kCFAllocatorDefault, nullptr, CFSTR("0x%04X@0x%llx"),
+                                    productID, (unsigned long long)locationID);
+}
+
+void RolandUSBDevice::RestoreLearnedPacing()
+{
+    if (!profile.minSysExChunkGapUs) return;
+
+    CFPropertyListRef learned = CFPreferencesCopyAppValue(kRolandLearnedPacingKey,
+                                                          kRolandPreferencesDomain);
+    if (learned && CFGetTypeID(learned) == CFDictionaryGetTypeID()) {
+        CFStringRef key = CreatePacingKey(deviceInfo->productID, locationID);
+        CFTypeRef value = CFDictionaryGetValue((CFDictionaryRef)learned, key);
+        CFRelease(key);
+
+        SInt64 gapUs = 0;
+        if (value && CFGetTypeID(value) == CFNumberGetTypeID()
+            && CFNumberGetValue((CFNumberRef)value, kCFNumberSInt64Type, &gapUs)
+            && gapUs > 0 && gapUs <= kMaxSysExChunkGapUs) {
+            transmitter.SeedSysExGap((uint64_t)gapUs * 1000);
+            os_log(sLog, "RestoreLearnedPacing: %{public}s starts at %lld us", deviceInfo->name, gapUs);
+        }
+    }
+    if (learned) CFRelease(learned);
+}
+
+void RolandUSBDevice::SaveLearnedPacing()
+{
+    if (!profile.minSysExChunkGapUs) return;
+
+    MIDITransmitterStats stats = transmitter.GetStats();
+    if (stats.sysExGapNs == (uint64_t)profile.sysExChunkGapUs * 1000 && stats.pacingStalls == 0)
+        return;   // Nothing learned this session
+
+    CFPropertyListRef learned = CFPreferencesCopyAppValue(kRolandLearnedPacingKey,
+                                                          kRolandPreferencesDomain);
+    CFMutableDictionaryRef updated =
+        (learned && CFGetTypeID(learned) == CFDictionaryGetTypeID())
+            ? CFDictionaryCreateMutableCopy(kCFAllocatorDefault, 0, (CFDictionaryRef)learned)
+            : CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+                                        &kCFTypeDictionaryKeyCallBacks,
+                                        &kCFTypeDictionaryValueCallBacks);
+    if (learned) CFRelease(learned);
+
+    SInt64 gapUs = (SInt64)(stats.sysExGapNs / 1000);
+    CFNumberRef value = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt64Type, &gapUs);
+    CFStringRef key = CreatePacingKey(deviceInfo->productID, locationID);
+    CFDictionarySetValue(updated, key, value);
+    CFRelease(key);
+    CFRelease(value);
+
+    CFPreferencesSetAppValue(kRolandLearnedPacingKey, updated, kRolandPreferencesDomain);
+    CFPreferencesAppSynchronize(kRolandPreferencesDomain);
+    CFRelease(updated);
+
+    os_log(sLog, "SaveLearnedPacing: %{public}s %lld us (%llu stalls)",
+           deviceInfo->name, gapUs, stats.pacingStalls);
+}
+
 bool RolandUSBDevice::Open()
 {
     IOCFPlugInInterface **plugInIntf = nullptr;
@@ -108,6 +698,9 @@ bool RolandUSBDevice::Open()
         return false;
     }
 
+    // Once per device; later opens find the blocks already there
+    bufferPool.Reserve(BufferPoolConfig());
+
     os_log(sLog, "Open: %{public}s (locationID=0x%llx)", deviceInfo->name, locationID);
     return true;
 }
@@ -115,7 +708,12 @@ bool RolandUSBDevice::Open()
 void RolandUSBDevice::Close()
 {
     StopIO();
+    transmitter.Discard();
+    ReleaseInterfaces();
+}
 
+void RolandUSBDevice::ReleaseInterfaces()
+{
     if (interfaceIntf) {
         (*interfaceIntf)->USBInterfaceClose(interfaceIntf);
         (*interfaceIntf)->Release(interfaceIntf);
@@ -341,191 +939,602 @@ bool RolandUSBDevice::FindPipes()
     return false;
 }
 
+IOThreadPolicy RolandUSBDevice::ThreadPolicy() const
+{
+    IOThreadPolicy policy;
+    policy.periodNs      = (uint64_t)profile.ioPeriodUs * 1000;
+    policy.computationNs = (uint64_t)profile.ioComputationUs * 1000;
+    policy.constraintNs  = (uint64_t)profile.ioConstraintUs * 1000;
+    return policy;
+}
+
 bool RolandUSBDevice::StartIO(CFRunLoopRef runLoop)
 {
     if (ioRunning || !interfaceIntf) return false;
 
+    LoadProfile();
+    RestoreLearnedPacing();
+    controlRunLoop = runLoop;
+
+    if (!ioThread.Start(deviceInfo->name, ThreadPolicy())) {
+        os_log_error(sLog, "StartIO: no I/O thread for %{public}s", deviceInfo->name);
+        return false;
+    }
+
     kern_return_t kr = (*interfaceIntf)->CreateInterfaceAsyncEventSource(
         interfaceIntf, &asyncSource);
     if (kr != kIOReturnSuccess) {
         os_log_error(sLog, "StartIO: CreateAsyncEventSource failed for %{public}s", deviceInfo->name);
+        ioThread.Stop();
         return false;
     }
 
-    CFRunLoopAddSource(runLoop, asyncSource, kCFRunLoopDefaultMode);
-    ioRunning = true;
-    SubmitRead();
-
-    os_log(sLog, "StartIO: I/O started for %{public}s", deviceInfo->name);
+    CFRunLoopAddSource(ioThread.RunLoop(), asyncSource, kCFRunLoopDefaultMode);
+
+    // Keep several reads queued so the host controller always has a buffer
+    // to fill while the previous transfer is being parsed.
+    numReadSlots = profile.readQueueDepth;
+    rxBufferSize = profile.readBufferSize;
+    rxStorage.assign((size_t)numReadSlots * rxBufferSize, 0);
+    for (uint8_t i = 0; i < numReadSlots; i++)
+        rxSlots[i] = { this, rxStorage.data() + (size_t)i * rxBufferSize };
+
+    ioThread.PostAndWait([this] {
+        ioRunning = true;
+        timestamper.Reset();
+        paramMirror.Reset();   // The device may have changed while closed
+        for (uint8_t i = 0; i < numReadSlots; i++)
+            SubmitRead(&rxSlots[i]);
+    });
+    transmitter.Start(ThreadPolicy());
+
+    lastStatsPublish = 0;
+    CFRunLoopTimerContext timerContext = { 0, this, nullptr, nullptr, nullptr };
+    statsTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + 1.0,
+                                      1.0, 0, 0, StatsTimerCallback, &timerContext);
+    if (statsTimer)
+        CFRunLoopAddTimer(runLoop, statsTimer, kCFRunLoopDefaultMode);
+
+    os_log(sLog, "StartIO: I/O started for %{public}s (%{public}s priority)", deviceInfo->name,
+           ioThread.PolicyApplied() ? "time-constraint" : "normal");
     return true;
 }
 
 void RolandUSBDevice::StopIO()
 {
-    if (!ioRunning) return;
-    ioRunning = false;
-
-    if (interfaceIntf && bulkInPipeRef)
-        (*interfaceIntf)->AbortPipe(interfaceIntf, bulkInPipeRef);
+    if (!ioRunning) {
+        CancelReopen();
+        return;
+    }
 
-    if (asyncSource) {
-        CFRunLoopSourceInvalidate(asyncSource);
-        CFRelease(asyncSource);
-        asyncSource = nullptr;
+    transmitter.Stop();
+    SaveLearnedPacing();
+
+    // Tear the reads down on the I/O thread so no completion is mid-parse
+    ioThread.PostAndWait([this] {
+        ioRunning = false;
+        if (interfaceIntf && bulkInPipeRef)
+            (*interfaceIntf)->AbortPipe(interfaceIntf, bulkInPipeRef);
+        if (interfaceIntf && bulkOutPipeRef && profile.writeQueueDepth > 1)
+            (*interfaceIntf)->AbortPipe(interfaceIntf, bulkOutPipeRef);
+
+        if (asyncSource) {
+            CFRunLoopSourceInvalidate(asyncSource);
+            CFRelease(asyncSource);
+            asyncSource = nullptr;
+        }
+    });
+    ioThread.Stop();
+    // Aborted writes report nothing once the event source is gone
+    transmitter.AbandonWrites();
+    // With the I/O thread gone nothing can schedule another one
+    CancelReopen();
+
+    if (statsTimer) {
+        CFRunLoopTimerInvalidate(statsTimer);
+        CFRelease(statsTimer);
+        statsTimer = nullptr;
     }
 
+    PublishInputFilterCounters();
+    PublishOutputCounters();
+    PublishReadRecoveryCounters();
+    PublishPortStats();
+
     os_log(sLog, "StopIO: I/O stopped for %{public}s", deviceInfo->name);
 }
 
-void RolandUSBDevice::SubmitRead()
+bool RolandUSBDevice::Attach(CFRunLoopRef runLoop)
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    attachRunLoop = runLoop;
+
+    // LazyOpen and IdleCloseS are read here only; changing them takes effect
+    // on the next attach
+    LoadProfile();
+    DeviceActivityConfig config;
+    config.lazy = profile.lazyOpen != 0;
+    config.idleCloseNs = (uint64_t)profile.idleCloseS * 1000000000ull;
+    activity.SetConfig(config);
+    lazy.store(config.lazy, std::memory_order_relaxed);
+
+    if (config.lazy && !activity.Wanted()) {
+        os_log(sLog, "Attach: %{public}s waits for first use", deviceInfo->name);
+        return true;
+    }
+    return ActivateLocked();
+}
+
+bool RolandUSBDevice::ActivateLocked()
+{
+    if (!activity.NeedsOpen()) return true;
+
+    uint64_t start = DefaultHostClock().NowNanos();
+    if (!Open() || !StartIO(attachRunLoop)) {
+        Close();
+        activity.OnOpenFailed();
+        os_log_error(sLog, "Activate: %{public}s failed to open", deviceInfo->name);
+        return false;
+    }
+    uint64_t now = DefaultHostClock().NowNanos();
+    activity.OnOpened(now, now - start);
+    os_log(sLog, "Activate: %{public}s open in %llu us", deviceInfo->name,
+           (now - start) / 1000);
+    return true;
+}
+
+void RolandUSBDevice::Detach()
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    // Sends to a detached device fail instead of reopening it
+    lazy.store(false, std::memory_order_relaxed);
+    StopIO();
+    Close();
+    activity.OnClosed(false);
+}
+
+void RolandUSBDevice::SetPinned(bool pinned)
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    activity.SetPinned(pinned);
+    if (pinned && lazy.load(std::memory_order_relaxed))
+        ActivateLocked();
+}
+
+void RolandUSBDevice::CloseIfIdle()
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (!activity.IdleExpired(DefaultHostClock().NowNanos(),
+                              transmitter.PendingMessages(-1) > 0))
+        return;
+
+    StopIO();
+    Close();
+    activity.OnClosed(true);
+    os_log(sLog, "CloseIfIdle: released %{public}s", deviceInfo->name);
+}
+
+DeviceActivityStats RolandUSBDevice::ActivityStats() const
+{
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    return activity.GetStats();
+}
+
+void RolandUSBDevice::SubmitRead(ReadSlot *slot)
 {
     if (!ioRunning || !interfaceIntf || !bulkInPipeRef) return;
 
     kern_return_t kr = (*interfaceIntf)->ReadPipeAsync(
         interfaceIntf, bulkInPipeRef,
-        rxBuffer, sizeof(rxBuffer),
-        ReadCallback, this);
+        slot->buffer, rxBufferSize,
+        ReadCallback, slot);
 
-    if (kr != kIOReturnSuccess) {
-        os_log_error(sLog, "SubmitRead: ReadPipeAsync failed for %{public}s (0x%x)", deviceInfo->name, kr);
-    }
+    // No completion will come for this slot; let recovery decide when to retry
+    if (kr != kIOReturnSuccess)
+        HandleReadResult(slot, kr, 0);
+}
+
+void RolandUSBDevice::ResubmitRead(ReadSlot *slot, uint64_t delayNs)
+{
+    if (delayNs == 0)
+        SubmitRead(slot);
+    else
+        ioThread.PostAfter(delayNs, [this, slot] { SubmitRead(slot); });
 }
 
 void RolandUSBDevice::ReadCallback(void *refCon, IOReturn result, void *arg0)
 {
-    auto *self = static_cast<RolandUSBDevice *>(refCon);
+    auto *slot = static_cast<ReadSlot *>(refCon);
+    RolandUSBDevice *self = slot ? slot->device : nullptr;
     if (!self || !self->ioRunning) return;
 
-    if (result == kIOReturnSuccess) {
-        UInt32 bytesRead = (UInt32)(uintptr_t)arg0;
-
-        if (bytesRead > 0 && self->driverRef) {
-            // Parse USB-MIDI bulk IN and route by cable number to correct source
-            USBMIDIParseBulkIn(self->rxBuffer, bytesRead,
-                [](uint8_t cable, const uint8_t *midiBytes,
-                   uint8_t byteCount, void *ctx) {
-                    auto *dev = static_cast<RolandUSBDevice *>(ctx);
-
-                    // Find port matching this cable number
-                    MIDIEndpointRef source = 0;
-                    for (uint8_t p = 0; p < dev->deviceInfo->numPorts; p++) {
-                        if (dev->deviceInfo->ports[p].cable == cable) {
-                            source = dev->midiSources[p];
-                            break;
-                        }
-                    }
-                    if (!source) return;
-
-                    Byte pktBuf[256];
-                    auto *pktList = reinterpret_cast<MIDIPacketList *>(pktBuf);
-                    MIDIPacket *pkt = MIDIPacketListInit(pktList);
-                    pkt = MIDIPacketListAdd(pktList, sizeof(pktBuf), pkt,
-                                            mach_absolute_time(),
-                                            byteCount, midiBytes);
-                    if (pkt)
-                        MIDIReceived(source, pktList);
-                }, self);
-        }
-    } else if (result != kIOReturnAborted) {
-        os_log_error(sLog, "ReadCallback: error for %{public}s (0x%x)", self->deviceInfo->name, result);
+    self->HandleReadResult(slot, result, (UInt32)(uintptr_t)arg0);
+}
+
+static USBReadStatus ClassifyReadResult(IOReturn result)
+{
+    switch (result) {
+    case kIOReturnSuccess:
+        return USBReadStatus::Success;
+    case kIOReturnAborted:
+        return USBReadStatus::Aborted;
+    case kIOUSBPipeStalled:
+#ifdef kUSBHostReturnPipeStalled
+    case kUSBHostReturnPipeStalled:
+#endif
+        return USBReadStatus::Stalled;
+    case kIOReturnNoDevice:
+    case kIOReturnNotResponding:
+    case kIOReturnNotAttached:
+    case kIOReturnNotOpen:
+        return USBReadStatus::DeviceGone;
+    default:
+        // Overrun, underrun, timeouts, CRC and babble errors
+        return USBReadStatus::Transient;
+    }
+}
+
+void RolandUSBDevice::HandleReadResult(ReadSlot *slot, IOReturn result, UInt32 bytesRead)
+{
+    USBReadStatus status = ClassifyReadResult(result);
+
+    if (status == USBReadStatus::Success && bytesRead > 0 && driverRef) {
+        StampTransfer(slot->buffer, bytesRead);
+
+        // Parse USB-MIDI bulk IN and route by cable number to correct source.
+        // Filtered events are dropped inside the parser before any packet-list work.
+        // Each port's list is sized for the whole transfer landing on it.
+        for (uint8_t p = 0; p < deviceInfo->numPorts; p++)
+            rxLists[p].Reserve(bytesRead / 4, bytesRead / 4 * 3);
+        USBMIDIParseBulkInFiltered(slot->buffer, bytesRead, rxFilters,
+            [](uint8_t cable, const uint8_t *midiBytes,
+               uint8_t byteCount, void *ctx) {
+                auto *dev = static_cast<RolandUSBDevice *>(ctx);
+                CountMIDITraffic(dev->rxTraffic[cable], midiBytes, byteCount);
+
+                // Thru routes run whether or not a client is listening
+                if (dev->router)
+                    dev->router->Route((uint32_t)dev->locationID, cable,
+                                       midiBytes, byteCount);
+
+                // Event index is the packet's position in the transfer, so
+                // filtered packets keep their slot in time
+                uint32_t index = (uint32_t)(midiBytes - 1 - dev->rxTransfer) / 4;
+                uint64_t whenNs = dev->timestamper.EventTime(index);
+
+                // Clock smoothing tracks the tempo even while nobody listens
+                int8_t p = dev->cableToPort[cable];
+                if (p >= 0 && byteCount == 1
+                    && dev->clockSmoothing[p].load(std::memory_order_relaxed)) {
+                    if (midiBytes[0] == 0xF8)
+                        whenNs = dev->clockSmoothers[p].OnPulse(whenNs);
+                    else
+                        dev->clockSmoothers[p].OnTransport(midiBytes[0]);
+                }
+
+                // The mirror follows the device whether or not a client listens
+                if (p >= 0 && dev->paramMirroring[p].load(std::memory_order_relaxed))
+                    dev->paramMirror.ObserveInbound(cable, midiBytes, byteCount);
+
+                // Probe replies are timed here and still delivered like any input
+                if (p >= 0 && dev->latencyProbing[p].load(std::memory_order_relaxed))
+                    dev->latencyProbe.ObserveInbound(cable, midiBytes, byteCount, whenNs);
+
+                // Skip the packet list entirely when no client is connected
+                if (p < 0 || !dev->sourceEnabled[p].load(std::memory_order_relaxed))
+                    return;
+                if (!dev->midiSources[p]) return;
+                dev->rxLists[p].Add(NanosToAbs(whenNs), midiBytes, byteCount);
+            }, this);
+
+        // One MIDIReceived per port for the whole transfer
+        for (uint8_t p = 0; p < deviceInfo->numPorts; p++)
+            rxLists[p].Flush();
+    }
+
+    ReadRecoveryDecision decision = readRecovery.OnResult(status, DefaultHostClock().NowNanos());
+    if (decision.log) {
+        if (status == USBReadStatus::Success)
+            os_log(sLog, "ReadCallback: %{public}s reads recovered (%u error(s) not logged)",
+                   deviceInfo->name, decision.suppressedLogs);
+        else
+            os_log_error(sLog, "ReadCallback: error for %{public}s (0x%x), %{public}s, "
+                         "%u in a row (%u error(s) not logged)",
+                         deviceInfo->name, result,
+                         ReadRecoveryStateName(readRecovery.GetState()),
+                         readRecovery.ConsecutiveFailures(), decision.suppressedLogs);
+    }
+
+    if (!ioRunning) return;
+    switch (decision.action) {
+    case ReadRecoveryAction::Resubmit:
+        ResubmitRead(slot, decision.delayNs);
+        break;
+    case ReadRecoveryAction::ClearStall:
+        if (interfaceIntf && bulkInPipeRef)
+            (*interfaceIntf)->ClearPipeStallBothEnds(interfaceIntf, bulkInPipeRef);
+        ResubmitRead(slot, decision.delayNs);
+        break;
+    case ReadRecoveryAction::Reopen:
+        ScheduleReopen();
+        break;
+    case ReadRecoveryAction::Stop:
+        break;
+    }
+}
+
+void RolandUSBDevice::StampTransfer(const uint8_t *data, UInt32 length)
+{
+    uint64_t now = AbsToNanos(mach_absolute_time());
+
+    // The frame counter read here is the reference for this completion: bulk
+    // IN has no per-transfer hardware timestamp, but the controller reports
+    // the host time of the current frame, and the DLL smooths out both the
+    // sampling jitter and our own wake-up delay within the frame.
+    UInt64 frame = 0;
+    AbsoluteTime atTime = {};
+    bool haveFrame = interfaceIntf &&
+        (*interfaceIntf)->GetBusFrameNumber(interfaceIntf, &frame, &atTime) == kIOReturnSuccess;
+    if (haveFrame) {
+        uint64_t atAbs = ((uint64_t)atTime.hi << 32) | atTime.lo;
+        timestamper.OnFrameReference(frame, AbsToNanos(atAbs));
+    }
+
+    // Events span up to the last non-empty packet (trailing padding excluded)
+    // Messages from a 5-pin input can't have arrived closer together than a
+    // three-byte message on the wire; any USB-native cable lifts the limit
+    uint32_t events = 0;
+    uint32_t dinRate = UINT32_MAX;
+    for (uint32_t offset = 0; offset + 4 <= length; offset += 4) {
+        if (USBMIDICinToMIDIByteCount(data[offset] & 0x0F) == 0) continue;
+        events = offset / 4 + 1;
+        int8_t p = cableToPort[(data[offset] >> 4) & 0x0F];
+        uint32_t rate = p < 0 ? 0 : deviceInfo->ports[p].dinBytesPerSecond;
+        if (rate < dinRate) dinRate = rate;
+    }
+    uint64_t spacingNs = 0;
+    if (dinRate != 0 && dinRate != UINT32_MAX)
+        spacingNs = 3ull * 1000000000ull / dinRate;
+
+    rxTransfer = data;
+    timestamper.BeginTransfer(haveFrame ? frame : InboundTimestamper::kNoFrame,
+                              now, events, spacingNs);
+}
+
+void RolandUSBDevice::ScheduleReopen(uint64_t delayNs)
+{
+    if (!controlRunLoop || reopenPending.exchange(true)) return;
+
+    // One-shot, kept until it has fired or StopIO cancels it, so it never
+    // fires on a device that was detached or deleted meanwhile
+    CFRunLoopTimerContext context = { 0, this, nullptr, nullptr, nullptr };
+    reopenTimer = CFRunLoopTimerCreate(kCFAllocatorDefault,
+                                       CFAbsoluteTimeGetCurrent() + (double)delayNs / 1e9,
+                                       0, 0, 0, ReopenTimerCallback, &context);
+    if (!reopenTimer) {
+        reopenPending = false;
+        return;
+    }
+    CFRunLoopAddTimer(controlRunLoop, reopenTimer, kCFRunLoopDefaultMode);
+}
+
+void RolandUSBDevice::CancelReopen()
+{
+    if (reopenTimer) {
+        CFRunLoopTimerInvalidate(reopenTimer);
+        CFRelease(reopenTimer);
+        reopenTimer = nullptr;
+    }
+    reopenPending = false;
+}
+
+void RolandUSBDevice::ReopenTimerCallback(CFRunLoopTimerRef, void *info)
+{
+    auto *self = static_cast<RolandUSBDevice *>(info);
+    std::lock_guard<std::mutex> lock(self->lifecycleMutex);
+    if (!self->isOnline
+        || (self->activity.NeedsOpen() && self->lazy.load(std::memory_order_relaxed))) {
+        self->CancelReopen();   // Unplugged or released as idle meanwhile
+        return;
+    }
+
+    // Only the USB side starts over: output queued meanwhile stays queued
+    // and goes out once the transmitter restarts (StopIO cancels this timer)
+    CFRunLoopRef runLoop = self->controlRunLoop;
+    os_log(sLog, "Reopen: %{public}s after repeated read errors", self->deviceInfo->name);
+    self->StopIO();
+    self->ReleaseInterfaces();
+    self->activity.OnClosed(false);
+    self->readRecovery.OnReopened();
+
+    uint64_t start = DefaultHostClock().NowNanos();
+    if (self->Open() && self->StartIO(runLoop)) {
+        uint64_t now = DefaultHostClock().NowNanos();
+        self->activity.OnOpened(now, now - start);
+        return;
     }
 
-    // Resubmit read unless stopped or aborted
-    if (self->ioRunning && result != kIOReturnAborted)
-        self->SubmitRead();
+    // Still online but closed: try again after a while, until the reopens
+    // are used up; a replug starts over
+    self->Close();
+    self->activity.OnOpenFailed();
+    ReadRecoveryDecision decision = self->readRecovery.OnReopenFailed(DefaultHostClock().NowNanos());
+    if (decision.action == ReadRecoveryAction::Reopen) {
+        os_log_error(sLog, "Reopen: %{public}s failed, retrying in %llu ms",
+                     self->deviceInfo->name, decision.delayNs / 1000000);
+        self->ScheduleReopen(decision.delayNs);
+    } else {
+        os_log_error(sLog, "Reopen: %{public}s failed, giving up until it is replugged",
+                     self->deviceInfo->name);
+    }
 }
 
 bool RolandUSBDevice::SendMIDI(uint8_t cable, const uint8_t *data, uint32_t length)
 {
-    if (!interfaceIntf || !bulkOutPipeRef || !data || length == 0)
-        return false;
+    return Send(cable, data, length, true);
+}
 
-    // Delegate large SysEx to throttled sender
-    if (data[0] == 0xF0 && length > kSysExChunkSize)
-        return SendSysExThrottled(cable, data, length);
+void RolandUSBDevice::SendLatencyProbes()
+{
+    std::vector<uint8_t> msg;
+    for (uint8_t p = 0; p < deviceInfo->numPorts; p++) {
+        if (!latencyProbing[p].load(std::memory_order_relaxed)) continue;
+        uint8_t cable = deviceInfo->ports[p].cable & 0x0F;
+        // A probe that can't be queued times out like one the device ignored
+        if (latencyProbe.NextProbe(cable, msg))
+            Send(cable, msg.data(), (uint32_t)msg.size(), false);
+    }
+}
 
-    uint8_t usbBuf[512];
-    uint32_t usbLen = USBMIDIBuildBulkOut(data, length, cable,
-                                           usbBuf, sizeof(usbBuf));
-    if (usbLen == 0) return false;
+bool RolandUSBDevice::Send(uint8_t cable, const uint8_t *data, uint32_t length, bool fromClient)
+{
+    if (!data || length == 0) return false;
 
-    kern_return_t kr = (*interfaceIntf)->WritePipe(
-        interfaceIntf, bulkOutPipeRef, usbBuf, usbLen);
-
-    return (kr == kIOReturnSuccess);
-}
-
-bool RolandUSBDevice::SendSysExThrottled(uint8_t cable, const uint8_t *data, uint32_t length)
-{
-    // Build USB-MIDI packets directly and send in chunks with delay.
-    // Each USB-MIDI packet is 4 bytes: [cable<<4|CIN, b0, b1, b2]
-    // Max USB transfer per chunk: 512 bytes (128 USB-MIDI packets = 384 MIDI bytes max)
-    static constexpr uint32_t kUSBBufSize = 512;
-    uint8_t usbBuf[kUSBBufSize];
-    uint32_t usbOffset = 0;
-    uint32_t midiBytesSinceFlush = 0;
-    uint8_t headerBase = (cable << 4);
-
-    uint32_t i = 0;
-    while (i < length) {
-        // Collect up to 3 bytes for one USB-MIDI packet
-        uint8_t group[3] = {0, 0, 0};
-        uint8_t count = 0;
-        bool endFound = false;
-
-        while (count < 3 && i < length) {
-            group[count] = data[i];
-            count++;
-            if (data[i] == 0xF7) {
-                endFound = true;
-                i++;
-                break;
-            }
-            i++;
-        }
+    std::unique_lock<std::mutex> lifecycle;
+    if (!ReadyToSend(lifecycle))
+        return false;
 
-        // Determine CIN
-        uint8_t cin;
-        if (endFound) {
-            switch (count) {
-                case 1: cin = kCIN_SysExEnd1Byte; break;
-                case 2: cin = kCIN_SysExEnd2Byte; break;
-                case 3: cin = kCIN_SysExEnd3Byte; break;
-                default: cin = kCIN_SysExEnd1Byte; break;
-            }
-        } else {
-            cin = kCIN_SysExStart; // SysEx start or continue (CIN=4)
+    // An RQ1 the mirror can answer never goes to the device
+    int8_t p = cableToPort[cable & 0x0F];
+    if (p >= 0 && paramMirroring[p].load(std::memory_order_relaxed)) {
+        std::vector<uint8_t> reply;
+        if (data[0] == 0xF0 && paramMirror.AnswerRQ1(data, length, reply)) {
+            DeliverMirrorReply((uint8_t)p, reply);
+            return true;
         }
+        paramMirror.ObserveOutbound(cable, data, length);
+    }
 
-        usbBuf[usbOffset + 0] = headerBase | cin;
-        usbBuf[usbOffset + 1] = group[0];
-        usbBuf[usbOffset + 2] = group[1];
-        usbBuf[usbOffset + 3] = group[2];
-        usbOffset += 4;
-        midiBytesSinceFlush += count;
-
-        // Flush when we've accumulated enough MIDI bytes or buffer is full
-        bool shouldFlush = (midiBytesSinceFlush >= kSysExChunkSize) ||
-                           (usbOffset + 4 > kUSBBufSize) ||
-                           endFound ||
-                           (i >= length);
-
-        if (shouldFlush && usbOffset > 0) {
-            kern_return_t kr = (*interfaceIntf)->WritePipe(
-                interfaceIntf, bulkOutPipeRef, usbBuf, usbOffset);
-            if (kr != kIOReturnSuccess) {
-                os_log_error(sLog, "SendSysExThrottled: WritePipe failed for %{public}s (0x%x)",
-                             deviceInfo->name, kr);
-                return false;
-            }
-            usbOffset = 0;
-            midiBytesSinceFlush = 0;
+    // A client's identity request makes the reply to an identity probe ambiguous
+    if (fromClient && p >= 0 && latencyProbing[p].load(std::memory_order_relaxed))
+        latencyProbe.ObserveOutbound(cable, data, length);
+
+    // Queued and paced on the transmitter thread; DrvSend never blocks on USB.
+    return transmitter.Enqueue(cable, data, length);
+}
+
+bool RolandUSBDevice::EnqueueBatch(uint8_t cable, const MIDIMessageBatch &batch)
+{
+    if (batch.Empty()) return false;
+
+    std::unique_lock<std::mutex> lifecycle;
+    if (!ReadyToSend(lifecycle))
+        return false;
 
-            // Delay between chunks, but not after the last one
-            if (!endFound && i < length)
-                usleep(kSysExChunkDelay);
+    int8_t p = cableToPort[cable & 0x0F];
+    if (p < 0) return transmitter.EnqueueBatch(cable, batch);
+    bool mirroring = paramMirroring[p].load(std::memory_order_relaxed);
+    bool probing = latencyProbing[p].load(std::memory_order_relaxed);
+
+    // An RQ1 the mirror can answer never goes to this device, as in Send.
+    // The batch is shared, so once one is answered the rest of it is queued
+    // message by message instead.
+    const std::vector<MIDIMessageBatch::Entry> &entries = batch.Entries();
+    std::vector<uint8_t> reply;
+    bool perMessage = false, queued = true;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const MIDIMessageBatch::Entry &e = entries[i];
+        if (mirroring && !e.shortLength && e.sysExEnded && e.Data()[0] == 0xF0
+            && paramMirror.AnswerRQ1(e.Data(), e.Length(), reply)) {
+            for (size_t k = 0; !perMessage && k < i; k++)
+                queued &= transmitter.Enqueue(cable, entries[k].Data(), entries[k].Length());
+            perMessage = true;
+            DeliverMirrorReply((uint8_t)p, reply);
+            continue;
         }
+        if (mirroring) paramMirror.ObserveOutbound(cable, e.Data(), e.Length());
+        if (probing) latencyProbe.ObserveOutbound(cable, e.Data(), e.Length());
+        if (perMessage) queued &= transmitter.Enqueue(cable, e.Data(), e.Length());
+    }
+    return perMessage ? queued : transmitter.EnqueueBatch(cable, batch);
+}
+
+bool RolandUSBDevice::ReadyToSend(std::unique_lock<std::mutex> &lifecycle)
+{
+    // Held until the message is queued, so a reopen or close can't swap the
+    // interface out underneath; a lazy device opens on its first send
+    lifecycle = std::unique_lock<std::mutex>(lifecycleMutex);
+    if (lazy.load(std::memory_order_relaxed)) {
+        activity.OnSend(DefaultHostClock().NowNanos());
+        if (activity.NeedsOpen() && !ActivateLocked())
+            return false;
     }
+    return interfaceIntf && bulkOutPipeRef;
+}
 
+void RolandUSBDevice::DeliverMirrorReply(uint8_t port, const std::vector<uint8_t> &reply)
+{
+    if (!sourceEnabled[port].load(std::memory_order_relaxed) || !midiSources[port]) return;
+
+    // Called from DrvSend, so not the I/O thread's per-port lists
+    MIDIPacketListBuilder list(&bufferPool, DeliverToSource, &rxSinks[port]);
+    list.Reserve(1, (uint32_t)reply.size());
+    list.Add(NanosToAbs(DefaultHostClock().NowNanos()), reply.data(), (uint32_t)reply.size());
+    list.Flush();
+}
+
+void RolandUSBDevice::DeliverToSource(const uint8_t *list, uint32_t, void *context)
+{
+    auto *sink = static_cast<SourceSink *>(context);
+    MIDIEndpointRef source = sink->device->midiSources[sink->port];
+    if (source)
+        MIDIReceived(source, reinterpret_cast<const MIDIPacketList *>(list));
+}
+
+void RolandUSBDevice::FlushOutput(int cable)
+{
+    transmitter.Flush(cable);
+    MIDITransmitterStats stats = transmitter.GetStats();
+    os_log(sLog, "FlushOutput: %{public}s cable %d (%llu flushed, %llu notes released)",
+           deviceInfo->name, cable, stats.messagesFlushed, stats.notesReleased);
+}
+
+bool RolandUSBDevice::WriteTransfer(const uint8_t *data, uint32_t length)
+{
+    if (!interfaceIntf || !bulkOutPipeRef)
+        return false;
+
+    kern_return_t kr = (*interfaceIntf)->WritePipe(
+        interfaceIntf, bulkOutPipeRef, const_cast<uint8_t *>(data), length);
+    if (kr != kIOReturnSuccess) {
+        os_log_error(sLog, "WriteTransfer: WritePipe failed for %{public}s (0x%x)",
+                     deviceInfo->name, kr);
+        return false;
+    }
+    return true;
+}
+
+bool RolandUSBDevice::CanSubmitTransfers() const
+{
+    // Completions are delivered through the I/O thread's event source
+    return profile.writeQueueDepth > 1 && interfaceIntf && bulkOutPipeRef && asyncSource;
+}
+
+bool RolandUSBDevice::SubmitTransfer(const uint8_t *data, uint32_t length, uint64_t tag)
+{
+    if (!interfaceIntf || !bulkOutPipeRef)
+        return false;
+
+    // The transmitter keeps at most writeQueueDepth consecutive tags in flight
+    WriteSlot *slot = &txSlots[tag % kMaxWritesInFlight];
+    slot->device = this;
+    slot->tag = tag;
+    IOReturn kr = (*interfaceIntf)->WritePipeAsync(
+        interfaceIntf, bulkOutPipeRef, const_cast<uint8_t *>(data), length,
+        WriteCallback, slot);
+    if (kr != kIOReturnSuccess) {
+        os_log_error(sLog, "SubmitTransfer: WritePipeAsync failed for %{public}s (0x%x)",
+                     deviceInfo->name, kr);
+        return false;
+    }
     return true;
 }
+
+void RolandUSBDevice::WriteCallback(void *refCon, IOReturn result, void * /*arg0*/)
+{
+    auto *slot = static_cast<WriteSlot *>(refCon);
+    if (result != kIOReturnSuccess && result != kIOReturnAborted)
+        os_log_error(sLog, "WriteCallback: write failed for %{public}s (0x%x)",
+                     slot->device->deviceInfo->name, result);
+    slot->device->transmitter.OnWriteCompleted(slot->tag, result == kIOReturnSuccess);
+}
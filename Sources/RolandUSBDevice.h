@@ -7,69 +7,129 @@
 #include <IOKit/usb/IOUSBLib.h>
 #include <IOKit/IOCFPlugIn.h>
 #include <unistd.h>
+#include <atomic>
+#include "USBMIDIParser.h"
+#include "MIDITransmitter.h"
+#include "MIDIMessageBatch.h"
+#include "MIDIRouter.h"
+#include "RunLoopIOScheduler.h"
+#include "RolandDeviceTable.h"
+#include "ReadRecovery.h"
+#include "FrameClock.h"
+#include "MIDIClockSmoother.h"
+#include "MIDIClockGenerator.h"
+#include "RolandParameterMirror.h"
+#include "DeviceActivity.h"
+#include "LatencyProbe.h"
+#include "MIDIPacketListBuilder.h"
+#include "PortStatistics.h"
 
-// Supported Roland devices (all share VID 0x0582)
-#define kMaxPortsPerDevice 6
+// Per-entity inbound filter, set by clients as CoreMIDI properties on the entity.
+//   Roland-RxDrop        MIDIStatusClass bits to discard (e.g. 0x10000 = active sensing)
+//   Roland-RxClockDivide pass 1 of every N clock pulses (0/1 = all)
+//   Roland-RxFiltered    published count of discarded events
+#define kRolandRxDropProperty         CFSTR("Roland-RxDrop")
+#define kRolandRxClockDivideProperty  CFSTR("Roland-RxClockDivide")
+#define kRolandRxFilteredProperty     CFSTR("Roland-RxFiltered")
 
-struct RolandPortInfo {
-    const char *name;   // Entity name in CoreMIDI (e.g. "FA-06/07/08 DAW CTRL")
-    uint8_t cable;      // USB-MIDI cable number (0-15)
-};
+// Inbound clock smoothing, set by clients on the entity:
+//   Roland-RxClockSmooth 1 = re-timestamp clock pulses onto a smoothed tempo grid
+//   Roland-RxClock       published about once a second while smoothing: dictionary
+//                        with BPM, InputJitterUs, OutputJitterUs, Pulses, Relocks
+#define kRolandRxClockSmoothProperty  CFSTR("Roland-RxClockSmooth")
+#define kRolandRxClockProperty        CFSTR("Roland-RxClock")
 
-struct RolandDeviceInfo {
-    const char *name;
-    uint16_t   productID;
-    uint8_t    numPorts;  // Number of MIDI cable ports
-    RolandPortInfo ports[kMaxPortsPerDevice];
-};
+// Driver-generated clock:
+//   Roland-ClockOut      1 on an entity = its output receives the driver's clock
+//   Roland-ClockGen      published on devices with a clock output: dictionary with
+//                        BPM, Running, Playing, Pulses, LatenessRmsUs,
+//                        LatenessMaxUs, Overruns, Dropped
+#define kRolandClockOutProperty       CFSTR("Roland-ClockOut")
+#define kRolandClockGenProperty       CFSTR("Roland-ClockGen")
 
-static const uint16_t kRolandVendorIDValue = 0x0582;
-
-static const RolandDeviceInfo kSupportedDevices[] = {
-    { "Roland SC-8850",          0x0003, 6, {{ "SC-8850 Part A", 0 }, { "SC-8850 Part B", 1 }, { "SC-8850 Part C", 2 }, { "SC-8850 Part D", 3 }, { "SC-8850 MIDI 1", 4 }, { "SC-8850 MIDI 2", 5 }} },
-    { "Roland SC-8820",          0x0007, 2, {{ "SC-8820 Part A", 0 }, { "SC-8820 Part B", 1 }} },
-    { "Roland SK-500",           0x000B, 2, {{ "SK-500 Part A", 0 }, { "SK-500 Part B", 1 }} },
-    { "Roland SC-D70",           0x000C, 2, {{ "SC-D70 Part A", 0 }, { "SC-D70 Part B", 1 }} },
-    { "Roland XV-5050",          0x0012, 1, {{ "XV-5050", 0 }} },
-    { "Roland SD-90",            0x0016, 2, {{ "SD-90 MIDI 1", 0 }, { "SD-90 MIDI 2", 1 }} },
-    { "Roland V-Synth",          0x001D, 1, {{ "V-Synth", 0 }} },
-    { "Roland SD-20",            0x0027, 1, {{ "SD-20", 0 }} },
-    { "Roland SD-80",            0x0029, 2, {{ "SD-80 MIDI 1", 0 }, { "SD-80 MIDI 2", 1 }} },
-    { "Roland XV-2020",          0x002D, 1, {{ "XV-2020", 0 }} },
-    { "Edirol PCR",              0x0033, 3, {{ "PCR MIDI", 0 }, { "PCR 1", 1 }, { "PCR 2", 2 }} },
-    { "Roland Fantom-X",         0x006D, 1, {{ "Fantom-X", 0 }} },
-    { "Roland G-70",             0x0080, 2, {{ "G-70 MIDI", 0 }, { "G-70 Control", 1 }} },
-    { "Roland V-Synth XT",       0x0084, 1, {{ "V-Synth XT", 0 }} },
-    { "Roland Juno-G",           0x00A6, 1, {{ "Juno-G", 0 }} },
-    { "Roland MC-808",           0x00A9, 1, {{ "MC-808", 0 }} },
-    { "Roland SH-201",           0x00AD, 1, {{ "SH-201", 0 }} },
-    { "Roland SonicCell",        0x00C2, 1, {{ "SonicCell", 0 }} },
-    { "Roland V-Synth GT",       0x00C7, 1, {{ "V-Synth GT", 0 }} },
-    { "Roland Fantom-G",         0x00DE, 1, {{ "Fantom-G", 0 }} },
-    { "Roland Juno-Di/Stage",    0x00F8, 1, {{ "JUNO", 0 }} },
-    { "Roland VS-700C",          0x00FC, 1, {{ "VS-700C Console", 0 }} },
-    // GAIA SH-01 (0x0111): Roland ships a dedicated kext (SH01USBDriver).
-    // Support put on hold — see CLAUDE.md for background.
-    { "Roland GAIA SH-01",     0x0111, 1, {{ "GAIA SH-01", 0 }} },
-    { "Roland Lucina AX-09",     0x011C, 1, {{ "Lucina AX-09", 0 }} },
-    { "Roland Juno-Gi",          0x0123, 1, {{ "Juno-Gi", 0 }} },
-    { "Roland Jupiter-80",       0x013A, 1, {{ "Jupiter-80", 0 }} },
-    { "Roland Jupiter-50",       0x0154, 1, {{ "Jupiter-50", 0 }} },
-    { "Roland INTEGRA-7",        0x015B, 1, {{ "INTEGRA-7", 0 }} },
-    { "Roland FA-06/07/08",         0x0174, 2, {{ "FA-06/07/08", 0 }, { "FA-06/07/08 DAW CTRL", 1 }} },
-    { "Roland JD-Xi",            0x01A1, 1, {{ "JD-Xi", 0 }} },
-    // Interfaces
-    { "Roland UM-ONE",           0x012A, 1, {{ "UM-ONE", 0 }} },
-    { "Roland QUAD-CAPTURE",     0x012F, 1, {{ "QUAD-CAPTURE", 0 }} },
-};
+// Parameter mirror, set by clients on the entity:
+//   Roland-ParamMirror   1 = cache parameter memory from the DT1 traffic on this
+//                        port and answer RQ1 requests from it when fully cached
+//   Roland-ParamMirrorStats published on the device while mirroring: dictionary
+//                        with Hits, Misses, Pages, Evictions, Expired, Invalidations
+#define kRolandParamMirrorProperty    CFSTR("Roland-ParamMirror")
+#define kRolandParamMirrorStatsProperty CFSTR("Roland-ParamMirrorStats")
+
+// Round-trip latency probe, set by clients on the entity:
+//   Roland-LatencyProbe  1 = send a Universal Identity Request about once a second
+//                        and time the device's reply; 2 = send a tagged SysEx and
+//                        time its echo through a cable from the port's OUT to IN
+//   Roland-Latency       published on the entity while probing: dictionary with
+//                        Probes, Replies, Timeouts, Voided, Late, Samples, MinUs,
+//                        MeanUs, P50Us, P95Us, P99Us and MaxUs
+//   Roland-RoundTripUs   median round trip once 8 replies are in, a hint for
+//                        host latency compensation (inherited by the endpoints)
+#define kRolandLatencyProbeProperty   CFSTR("Roland-LatencyProbe")
+#define kRolandLatencyProperty        CFSTR("Roland-Latency")
+#define kRolandRoundTripProperty      CFSTR("Roland-RoundTripUs")
+
+// Outbound options set by clients on the entity:
+//   Roland-TxCoalesce    1 = merge queued CC / pitch bend / pressure updates
+//                        for the same target while output is backed up
+//   Roland-TxMergeDT1    1 = hold Roland DT1 writes briefly and merge writes to
+//                        contiguous addresses (editor/librarian traffic)
+#define kRolandTxCoalesceProperty     CFSTR("Roland-TxCoalesce")
+#define kRolandTxMergeDT1Property     CFSTR("Roland-TxMergeDT1")
 
-static const size_t kNumSupportedDevices = sizeof(kSupportedDevices) / sizeof(kSupportedDevices[0]);
+// Outbound queue metrics, published on the entity about once a second:
+//   Roland-TxQueueDepth  bytes waiting on the cable
+//   Roland-TxQueuePeak   high-water mark of the above
+//   Roland-TxShaperHolds times the DIN-rate shaper held the cable back
+#define kRolandTxQueueDepthProperty   CFSTR("Roland-TxQueueDepth")
+#define kRolandTxQueuePeakProperty    CFSTR("Roland-TxQueuePeak")
+#define kRolandTxShaperHoldsProperty  CFSTR("Roland-TxShaperHolds")
+// Bulk OUT writes allowed in flight now, and their smoothed latency (device)
+#define kRolandTxWriteWindowProperty  CFSTR("Roland-TxWriteWindow")
+#define kRolandTxWriteLatencyProperty CFSTR("Roland-TxWriteLatencyUs")
 
-/// Find device info for a given product ID. Returns nullptr if not supported.
-const RolandDeviceInfo *FindRolandDevice(uint16_t productID);
+// Traffic counters for monitors (Tools/RolandStat), published with the others:
+//   Roland-PortStats     entity dictionary with TimeUs, RxMessages, RxBytes,
+//                        RxSysExBytes, TxMessages, TxBytes, TxSysExBytes,
+//                        TxQueueBytes, TxQueuePeak, ShaperHolds
+//   Roland-IOStats       device dictionary with TimeUs, ReadErrors, WriteErrors,
+//                        Transfers, PacingWaitUs, SysExGapUs, PacingStalls,
+//                        WriteWindow, WritesInFlight, WriteLatencyUs
+//   Roland-StatsIntervalMs set by a monitor on the device: publish the two above
+//                        this often (100-1000 ms) instead of once a second
+#define kRolandPortStatsProperty      CFSTR("Roland-PortStats")
+#define kRolandIOStatsProperty        CFSTR("Roland-IOStats")
+#define kRolandStatsIntervalProperty  CFSTR("Roland-StatsIntervalMs")
+static constexpr SInt32 kMinStatsIntervalMs = 100;
+static constexpr SInt32 kMaxStatsIntervalMs = 1000;
+
+// In-driver thru, set by clients on a source entity:
+//   Roland-Thru          dictionary keyed by the unique ID (decimal string) of a
+//                        destination on another Roland port; each value is a
+//                        dictionary with optional Channels (16-bit mask) and
+//                        Status (MIDIStatusClass bits, default channel voice)
+#define kRolandThruProperty           CFSTR("Roland-Thru")
+
+// Inbound error recovery counters, published on the device about once a
+// second: dictionary with Errors, Stalls, Transients, StallClears, Backoffs,
+// Reopens, Recoveries, GiveUps, LogsSuppressed and State
+#define kRolandRxRecoveryProperty     CFSTR("Roland-RxRecovery")
+
+// Open/close activity, published on the device about once a second:
+// dictionary with Open (0/1), Opens, OpenFailures, IdleCloses and LastOpenUs
+// (time Open + StartIO took). Lazy devices (profile LazyOpen) open on first use.
+#define kRolandActivityProperty       CFSTR("Roland-Activity")
+
+// Performance profile overrides (see RolandPerfProfileSetValue for keys):
+//   Roland-Profile on the device          dictionary, highest priority
+//   DeviceProfiles in the user defaults   { "0x015B" = { SysExChunkGapUs = 5000; }; }
+#define kRolandProfileProperty        CFSTR("Roland-Profile")
+#define kRolandPreferencesDomain      CFSTR("se.cutup.MultiRolandDriver")
+#define kRolandDeviceProfilesKey      CFSTR("DeviceProfiles")
+// Adaptive SysEx pacing state carried across sessions, keyed "<PID>@<locationID>"
+#define kRolandLearnedPacingKey       CFSTR("LearnedSysExGapUs")
 
 /// Manages USB I/O for a single Roland device
-class RolandUSBDevice {
+class RolandUSBDevice : public USBMIDIOutputPipe, public MIDIBatchTarget {
 public:
     RolandUSBDevice(io_service_t usbService, const RolandDeviceInfo *info);
     ~RolandUSBDevice();
@@ -77,14 +137,41 @@ public:
     bool Open();
     void Close();
 
+    /// Start the device's I/O thread, queue the bulk IN reads on it and start
+    /// the transmitter. runLoop only hosts the once-a-second stats publisher.
     bool StartIO(CFRunLoopRef runLoop);
     void StopIO();
 
-    /// Send raw MIDI bytes to USB bulk OUT on a given cable
+    /// Bring a present device into use: Open + StartIO now or, when the
+    /// profile asks for LazyOpen, on the first send, enabled source or pin.
+    /// False only if the device had to be opened and could not be.
+    bool Attach(CFRunLoopRef runLoop);
+    /// StopIO + Close for removal or driver stop.
+    void Detach();
+    /// Thru routes or the clock generator feed this device directly; a lazy
+    /// device is opened and kept open while pinned.
+    void SetPinned(bool pinned);
+    /// Release a lazy device nothing has used for IdleCloseS (driver timer).
+    void CloseIfIdle();
+    DeviceActivityStats ActivityStats() const;
+
+    /// Queue raw MIDI bytes for USB bulk OUT on a given cable
     bool SendMIDI(uint8_t cable, const uint8_t *data, uint32_t length);
 
-    static constexpr uint32_t kSysExChunkSize  = 256;    // MIDI bytes per chunk
-    static constexpr useconds_t kSysExChunkDelay = 20000; // 20ms between chunks
+    /// Queue output sent to a broadcast destination (MIDIBroadcast). Opens a
+    /// lazy device like SendMIDI; the parameter mirror and latency probe see
+    /// it, and the mirror answers the RQ1 requests it can for this device.
+    bool EnqueueBatch(uint8_t cable, const MIDIMessageBatch &batch) override;
+
+    /// Send the latency probes that are due (driver timer).
+    void SendLatencyProbes();
+
+    /// Discard queued output for one cable (or all when cable < 0), closing
+    /// an interrupted SysEx and releasing hanging notes (DrvFlush).
+    void FlushOutput(int cable);
+
+    /// Outbound queue, the target for thru routes into this device.
+    MIDITransmitter *OutputQueue() { return &transmitter; }
 
     // MIDI device/endpoint associations (multi-port)
     MIDIDeviceRef    midiDevice                     = 0;
@@ -92,6 +179,15 @@ public:
     MIDIEndpointRef  midiSources[kMaxPortsPerDevice]  = {};  // USB IN → CoreMIDI
     MIDIEndpointRef  midiDests[kMaxPortsPerDevice]    = {};   // CoreMIDI → USB OUT
 
+    /// Port index for a source/destination endpoint, or -1 if it is not one of ours.
+    int PortForSource(MIDIEndpointRef src) const;
+    int PortForDest(MIDIEndpointRef dest) const;
+
+    /// Track whether any client is connected to a source (DrvEnableSource).
+    /// Disabled sources are still read, but events are dropped before any
+    /// packet-list work so enabling takes effect with the next transfer.
+    void SetSourceEnabled(uint8_t port, bool enabled);
+
     const RolandDeviceInfo *deviceInfo = nullptr;
     io_service_t    service    = 0;
     uint64_t        locationID = 0;
@@ -100,15 +196,129 @@ public:
 
     void UpdateService(io_service_t newService);
 
+    /// Re-read the inbound filter properties from each entity.
+    void LoadInputFilters();
+    /// Publish filtered-event counters as entity properties.
+    void PublishInputFilterCounters();
+    /// Publish tempo and jitter of smoothed inbound clocks.
+    void PublishClockStats();
+    /// Publish the clock generator's state while a port here receives it.
+    void PublishClockGeneratorStats();
+    /// Publish parameter mirror hit rate and size while a port uses it.
+    void PublishParamMirrorStats();
+    /// Publish outbound queue depth per entity.
+    void PublishOutputCounters();
+    /// Publish the inbound error recovery counters on the device.
+    void PublishReadRecoveryCounters();
+    /// Publish open/close activity on the device.
+    void PublishActivity();
+    /// Publish round-trip latency of the ports being probed.
+    void PublishLatency();
+    /// Publish traffic counters per entity and I/O counters on the device.
+    void PublishPortStats();
+
+    /// Rebuild the active profile from the table entry plus user overrides and
+    /// hand the output side to the transmitter. Read depth and buffer size
+    /// take effect on the next StartIO.
+    void LoadProfile();
+
+    RolandPerfProfile profile;
+
+    /// Seed / persist the SysEx gap learned by adaptive pacing for this
+    /// model at this USB location.
+    void RestoreLearnedPacing();
+    void SaveLearnedPacing();
+
+    /// Scheduling policy for this device's I/O and transmitter threads.
+    IOThreadPolicy ThreadPolicy() const;
+
+    // Inbound filter per USB-MIDI cable, applied inside the parser
+    USBMIDIInputFilter rxFilters[kUSBMIDINumCables] = {};
+    // Inbound traffic per cable after the filter, counted on the read path
+    // and snapshotted by the stats timer
+    SharedMIDITrafficCounters rxTraffic[kUSBMIDINumCables];
+
+    // Per-port clock smoothing; the smoothers are touched by the I/O thread only
+    std::atomic<bool> clockSmoothing[kMaxPortsPerDevice] = {};
+    MIDIClockSmoother clockSmoothers[kMaxPortsPerDevice];
+
+    // Parameter mirror shared by the ports that enable it (Roland-ParamMirror)
+    std::atomic<bool>     paramMirroring[kMaxPortsPerDevice] = {};
+    RolandParameterMirror paramMirror;
+
+    // Round-trip probing per port (Roland-LatencyProbe)
+    std::atomic<bool> latencyProbing[kMaxPortsPerDevice] = {};
+    LatencyProbe      latencyProbe;
+
+    // Per-port delivery state; sources start enabled until MIDIServer says otherwise
+    std::atomic<bool> sourceEnabled[kMaxPortsPerDevice];
+    int8_t            cableToPort[kUSBMIDINumCables];   // -1 = cable not mapped
+
     // Callback context for the driver to deliver received MIDI
     MIDIDriverRef   driverRef  = nullptr;
 
+    // Thru matrix shared by all devices; inbound events are offered to it
+    // (keyed by locationID) before the source-enabled check
+    MIDIRouter     *router     = nullptr;
+
+    // Shared clock generator and the ports here that receive it (bit per
+    // port); maintained with the thru routes
+    MIDIClockGenerator *clockGenerator = nullptr;
+    uint8_t             clockOutPorts  = 0;
+
 private:
     bool FindInterface();
     bool FindPipes();
-    void SubmitRead();
+    // One outstanding bulk IN read; the slot is the ReadPipeAsync refCon
+    struct ReadSlot {
+        RolandUSBDevice *device;
+        uint8_t         *buffer;
+    };
+
+    /// SendMIDI for clients and the probe; the probe's own requests are not
+    /// held against it
+    bool Send(uint8_t cable, const uint8_t *data, uint32_t length, bool fromClient);
+    /// Takes lifecycle, so the device stays open until the caller has queued
+    /// its output; a lazy device is opened on first send. False if the device
+    /// cannot take output.
+    bool ReadyToSend(std::unique_lock<std::mutex> &lifecycle);
+
+    void SubmitRead(ReadSlot *slot);
     static void ReadCallback(void *refCon, IOReturn result, void *arg0);
-    bool SendSysExThrottled(uint8_t cable, const uint8_t *data, uint32_t length);
+    /// Parse a completed read and carry out the recovery decision (I/O thread)
+    void HandleReadResult(ReadSlot *slot, IOReturn result, UInt32 bytesRead);
+    /// Hand DT1 replies synthesized by the parameter mirror to a port's source
+    void DeliverMirrorReply(uint8_t port, const std::vector<uint8_t> &reply);
+    /// MIDIPacketListBuilder output: MIDIReceived on the port's source
+    static void DeliverToSource(const uint8_t *list, uint32_t length, void *context);
+    /// Sample the bus frame clock and prepare per-event times for a transfer
+    void StampTransfer(const uint8_t *data, UInt32 length);
+    void ResubmitRead(ReadSlot *slot, uint64_t delayNs);
+    /// Close and reopen on the control run loop; the I/O thread can't stop itself
+    void ScheduleReopen(uint64_t delayNs = 0);
+    /// Drop a scheduled reopen (control run loop)
+    void CancelReopen();
+    /// Release the USB interfaces; the transmitter's queue is left alone
+    void ReleaseInterfaces();
+    /// Open + StartIO for Attach and first use; lifecycleMutex held
+    bool ActivateLocked();
+    static void ReopenTimerCallback(CFRunLoopTimerRef timer, void *info);
+    static void StatsTimerCallback(CFRunLoopTimerRef timer, void *info);
+    /// Roland-StatsIntervalMs as set by a monitor, clamped; 1 s without one
+    CFTimeInterval StatsInterval() const;
+
+    // USBMIDIOutputPipe: synchronous bulk OUT write, called from the transmitter thread
+    bool WriteTransfer(const uint8_t *data, uint32_t length) override;
+    // Asynchronous writes (WriteQueueDepth > 1); completions arrive on the I/O thread
+    bool CanSubmitTransfers() const override;
+    bool SubmitTransfer(const uint8_t *data, uint32_t length, uint64_t tag) override;
+    static void WriteCallback(void *refCon, IOReturn result, void *arg0);
+
+    // One bulk OUT write in flight; the slot is the WritePipeAsync refCon
+    struct WriteSlot {
+        RolandUSBDevice *device;
+        uint64_t         tag;
+    };
 
     IOUSBDeviceInterface650    **deviceIntf    = nullptr;
     IOUSBInterfaceInterface650 **interfaceIntf = nullptr;
@@ -116,10 +326,53 @@ private:
     bool     deviceOpened    = false;
     uint8_t  bulkInPipeRef   = 0;
     uint8_t  bulkOutPipeRef  = 0;
-    uint8_t  rxBuffer[64]    = {};
+    std::vector<uint8_t> rxStorage;              // readQueueDepth x readBufferSize
+    ReadSlot rxSlots[kMaxReadQueueDepth] = {};
+    WriteSlot txSlots[kMaxWritesInFlight] = {};
+    uint8_t  numReadSlots    = 0;
+    uint16_t rxBufferSize    = 0;
     bool     ioRunning       = false;
 
     CFRunLoopSourceRef asyncSource = nullptr;
+    CFRunLoopTimerRef  statsTimer  = nullptr;
+    CFAbsoluteTime     lastStatsPublish = 0;   // Of the once-a-second properties
+
+    // Driver-owned thread whose run loop services read completions; keeps
+    // USB I/O off MIDIServer's thread
+    RunLoopIOScheduler ioThread;
+    CFRunLoopRef       controlRunLoop = nullptr;   // StartIO's caller (MIDIServer)
+
+    // Read-error classification, backoff and escalation
+    ReadRecovery       readRecovery;
+    std::atomic<bool>  reopenPending{false};
+    CFRunLoopTimerRef  reopenTimer = nullptr;   // Written only by whoever set reopenPending
+
+    // Open/close decisions in lazy mode; the mutex serialises sends, first
+    // use (DrvEnableSource, pins) with idle close, reopen and Detach
+    mutable std::mutex lifecycleMutex;
+    DeviceActivity     activity;
+    std::atomic<bool>  lazy{false};
+    CFRunLoopRef       attachRunLoop = nullptr;
+
+    // Inbound timestamps from the bus frame clock (I/O thread only)
+    InboundTimestamper timestamper;
+    const uint8_t     *rxTransfer = nullptr;   // Transfer being parsed
+
+    // Buffers for queued SysEx and synthesized replies, reserved at the
+    // first Open so steady-state I/O never allocates; outlives the transmitter
+    BufferPool bufferPool;
+
+    // Inbound packet lists, one per port for the transfer being parsed and
+    // delivered once it is done (I/O thread only)
+    struct SourceSink {
+        RolandUSBDevice *device;
+        uint8_t          port;
+    };
+    SourceSink            rxSinks[kMaxPortsPerDevice] = {};
+    MIDIPacketListBuilder rxLists[kMaxPortsPerDevice];
+
+    // Outbound queue + SysEx pacing; runs its own thread while I/O is started
+    MIDITransmitter transmitter{this};
 };
 
 #endif /* RolandUSBDevice_h */
@@ -0,0 +1,189 @@
+#include "RunLoopIOScheduler.h"
+#include <os/log.h>
+
+static os_log_t sLog = os_log_create("se.cutup.MultiRolandDriver", "io");
+
+RunLoopIOScheduler::~RunLoopIOScheduler()
+{
+    Stop();
+}
+
+bool RunLoopIOScheduler::Start(const char *name, const IOThreadPolicy &policy)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (running) return true;
+    running  = true;
+    stopping = false;
+    started  = false;
+    thread = std::thread(&RunLoopIOScheduler::ThreadMain, this,
+                         std::string(name ? name : ""), policy);
+    cond.wait(lock, [this] { return started; });
+    return runLoop != nullptr;
+}
+
+void RunLoopIOScheduler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || stopping) return;
+        stopping = true;
+        if (runLoop) {
+            CFRunLoopStop(runLoop);
+            CFRunLoopWakeUp(runLoop);
+        }
+    }
+    if (thread.joinable())
+        thread.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.clear();
+    running  = false;
+    stopping = false;
+    threadID = std::thread::id();
+}
+
+void RunLoopIOScheduler::Post(Task task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running || stopping || !taskSource) return;
+    tasks.push_back(std::move(task));
+    CFRunLoopSourceSignal(taskSource);
+    CFRunLoopWakeUp(runLoop);
+}
+
+IOScheduler::TimerID RunLoopIOScheduler::PostAfter(uint64_t delayNs, Task task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    TimerID id = nextTimerID++;
+    if (!running || stopping || !runLoop) return id;
+
+    CFRunLoopTimerContext context = { 0, new TimerContext{ this, id }, nullptr,
+                                      ReleaseTimerContext, nullptr };
+    CFRunLoopTimerRef timer = CFRunLoopTimerCreate(kCFAllocatorDefault,
+                                                   CFAbsoluteTimeGetCurrent() + (double)delayNs / 1e9,
+                                                   0, 0, 0, TimerFired, &context);
+    if (!timer) {
+        delete static_cast<TimerContext *>(context.info);
+        return id;
+    }
+    timers[id] = { timer, std::move(task) };
+    CFRunLoopAddTimer(runLoop, timer, kCFRunLoopDefaultMode);
+    return id;
+}
+
+bool RunLoopIOScheduler::Cancel(TimerID id)
+{
+    CFRunLoopTimerRef timer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = timers.find(id);
+        if (it == timers.end()) return false;
+        timer = it->second.timer;
+        timers.erase(it);
+    }
+    CFRunLoopTimerInvalidate(timer);
+    CFRelease(timer);
+    return true;
+}
+
+bool RunLoopIOScheduler::IsRunning() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+}
+
+bool RunLoopIOScheduler::IsCurrentThread() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running && std::this_thread::get_id() == threadID;
+}
+
+void RunLoopIOScheduler::RunPendingTasks()
+{
+    std::vector<Task> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(tasks);
+    }
+    for (auto &task : batch)
+        task();
+}
+
+void RunLoopIOScheduler::PerformTasks(void *info)
+{
+    static_cast<RunLoopIOScheduler *>(info)->RunPendingTasks();
+}
+
+void RunLoopIOScheduler::TimerFired(CFRunLoopTimerRef timer, void *info)
+{
+    auto *context = static_cast<TimerContext *>(info);
+    RunLoopIOScheduler *self = context->scheduler;
+
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        auto it = self->timers.find(context->id);
+        if (it == self->timers.end()) return;
+        task = std::move(it->second.task);
+        self->timers.erase(it);
+    }
+    // One-shot: the run loop holds its own reference for the callout
+    CFRunLoopTimerInvalidate(timer);
+    CFRelease(timer);
+    task();
+}
+
+void RunLoopIOScheduler::ReleaseTimerContext(const void *info)
+{
+    delete static_cast<const TimerContext *>(info);
+}
+
+void RunLoopIOScheduler::ThreadMain(std::string name, IOThreadPolicy policy)
+{
+    SetIOThreadName(name.c_str());
+    bool applied = ApplyIOThreadPolicy(policy);
+    if (!applied)
+        os_log_error(sLog, "IOScheduler: %{public}s keeps normal priority (policy refused)",
+                     name.c_str());
+
+    CFRunLoopSourceContext sourceContext = {};
+    sourceContext.info = this;
+    sourceContext.perform = PerformTasks;
+    CFRunLoopRef rl = CFRunLoopGetCurrent();
+    CFRunLoopSourceRef source = CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &sourceContext);
+    CFRunLoopAddSource(rl, source, kCFRunLoopDefaultMode);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        runLoop = (CFRunLoopRef)CFRetain(rl);
+        taskSource = source;
+        threadID = std::this_thread::get_id();
+        policyApplied = applied;
+        started = true;
+    }
+    cond.notify_all();
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) break;
+        }
+        // Stop() interrupts this; the timeout only bounds a missed wakeup
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0, false);
+    }
+
+    std::map<TimerID, PendingTimer> leftover;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        leftover.swap(timers);
+        taskSource = nullptr;
+        runLoop = nullptr;
+    }
+    for (auto &entry : leftover) {
+        CFRunLoopTimerInvalidate(entry.second.timer);
+        CFRelease(entry.second.timer);
+    }
+    CFRunLoopSourceInvalidate(source);
+    CFRelease(source);
+    CFRelease(rl);
+}
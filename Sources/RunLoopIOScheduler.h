@@ -0,0 +1,63 @@
+#ifndef RunLoopIOScheduler_h
+#define RunLoopIOScheduler_h
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <map>
+#include "IOScheduler.h"
+
+/// IOScheduler on a driver-owned thread running its own CFRunLoop, so IOKit
+/// async event sources (read completions) can be attached next to the
+/// posted tasks and timers. Tasks are delivered through a version 0 run
+/// loop source; timers are one-shot CFRunLoopTimers.
+class RunLoopIOScheduler : public IOScheduler {
+public:
+    RunLoopIOScheduler() = default;
+    ~RunLoopIOScheduler() override;
+
+    bool Start(const char *name, const IOThreadPolicy &policy) override;
+    void Stop() override;
+
+    void Post(Task task) override;
+    TimerID PostAfter(uint64_t delayNs, Task task) override;
+    bool Cancel(TimerID id) override;
+
+    bool IsRunning() const override;
+    bool IsCurrentThread() const override;
+    bool PolicyApplied() const override { return policyApplied; }
+
+    /// The I/O thread's run loop while running (nullptr otherwise).
+    CFRunLoopRef RunLoop() const { return runLoop; }
+
+private:
+    struct TimerContext {
+        RunLoopIOScheduler *scheduler;
+        TimerID id;
+    };
+    struct PendingTimer {
+        CFRunLoopTimerRef timer;
+        Task task;
+    };
+
+    void ThreadMain(std::string name, IOThreadPolicy policy);
+    void RunPendingTasks();
+    static void PerformTasks(void *info);
+    static void TimerFired(CFRunLoopTimerRef timer, void *info);
+    static void ReleaseTimerContext(const void *info);
+
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<Task> tasks;
+    std::map<TimerID, PendingTimer> timers;
+    TimerID nextTimerID = 1;
+    bool running        = false;
+    bool started        = false;
+    bool stopping       = false;
+    bool policyApplied  = false;
+    std::thread thread;
+    std::thread::id threadID;
+
+    CFRunLoopRef       runLoop    = nullptr;
+    CFRunLoopSourceRef taskSource = nullptr;
+};
+
+#endif /* RunLoopIOScheduler_h */
@@ -0,0 +1,61 @@
+#include "SysExPacer.h"
+
+SysExPacer::SysExPacer(uint64_t initialGapNs, const SysExPacerConfig &config)
+    : config(config)
+{
+    Reset(initialGapNs);
+}
+
+void SysExPacer::SetConfig(const SysExPacerConfig &newConfig)
+{
+    config = newConfig;
+    if (config.maxGapNs < config.minGapNs) config.maxGapNs = config.minGapNs;
+    gapNs = Clamp(gapNs);
+}
+
+void SysExPacer::Reset(uint64_t gap)
+{
+    gapNs = Clamp(gap);
+    baselineNs = 0;
+    haveBaseline = false;
+    hold = 0;
+    stats = {};
+}
+
+uint64_t SysExPacer::Clamp(uint64_t gap) const
+{
+    if (gap < config.minGapNs) return config.minGapNs;
+    if (gap > config.maxGapNs) return config.maxGapNs;
+    return gap;
+}
+
+void SysExPacer::OnChunkCompleted(uint64_t latencyNs, bool failed)
+{
+    stats.chunks++;
+
+    // Baseline follows the fastest writes immediately and drifts up slowly,
+    // so a device that is simply slower than expected is not read as stalling.
+    if (!failed) {
+        if (!haveBaseline || latencyNs < baselineNs)
+            baselineNs = latencyNs;
+        else
+            baselineNs += (latencyNs - baselineNs) >> 8;
+        haveBaseline = true;
+    }
+    stats.baselineNs = baselineNs;
+
+    bool stalled = failed || latencyNs > baselineNs * 2 + config.stallMarginNs;
+    if (stalled) {
+        stats.stalls++;
+        gapNs = Clamp(gapNs * 2);
+        hold = config.holdAfterStall;
+        return;
+    }
+
+    if (hold) {
+        hold--;
+        return;
+    }
+    uint64_t step = gapNs >> config.decreaseShift;
+    gapNs = Clamp(gapNs - (step ? step : 1));
+}
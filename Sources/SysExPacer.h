@@ -0,0 +1,57 @@
+#ifndef SysExPacer_h
+#define SysExPacer_h
+
+#include <stdint.h>
+
+static constexpr uint64_t kMaxSysExPacingGapNs = 500000000;   // 500ms
+
+struct SysExPacerConfig {
+    uint64_t minGapNs        = 1000000;              // Floor the gap may shrink to
+    uint64_t maxGapNs        = kMaxSysExPacingGapNs;
+    uint64_t stallMarginNs   = 2000000;              // Latency above 2x baseline + this = stall
+    uint32_t decreaseShift   = 3;                    // Shrink by gap/8 per clean chunk
+    uint32_t holdAfterStall  = 2;                    // Clean chunks to wait before shrinking again
+};
+
+struct SysExPacerStats {
+    uint64_t chunks      = 0;
+    uint64_t stalls      = 0;   // Chunks whose write came back late or failed
+    uint64_t baselineNs  = 0;   // Typical write latency of an uncongested device
+};
+
+/// Learns the inter-chunk SysEx gap a device can sustain.
+///
+/// Fed with the completion latency of every transfer that carried a SysEx
+/// chunk. A device whose receive buffer is full NAKs the bulk OUT endpoint,
+/// so a synchronous write that takes much longer than usual (or fails)
+/// means the previous chunks arrived too fast: the gap doubles. Every clean
+/// chunk shrinks it by a small fraction, so the gap settles just above the
+/// rate at which the device drains its buffer. Not thread-safe; the
+/// transmitter calls it under its queue lock.
+class SysExPacer {
+public:
+    explicit SysExPacer(uint64_t initialGapNs = 20000000, const SysExPacerConfig &config = {});
+
+    void SetConfig(const SysExPacerConfig &config);
+
+    /// Restart learning from a given gap (profile default or a remembered value).
+    void Reset(uint64_t gapNs);
+
+    /// Report one SysEx transfer: how long the write took and whether it failed.
+    void OnChunkCompleted(uint64_t latencyNs, bool failed);
+
+    uint64_t GapNs() const { return gapNs; }
+    SysExPacerStats GetStats() const { return stats; }
+
+private:
+    uint64_t Clamp(uint64_t gap) const;
+
+    SysExPacerConfig config;
+    SysExPacerStats  stats;
+    uint64_t gapNs       = 0;
+    uint64_t baselineNs  = 0;
+    bool     haveBaseline = false;
+    uint32_t hold        = 0;
+};
+
+#endif /* SysExPacer_h */
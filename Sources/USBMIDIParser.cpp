@@ -73,6 +73,90 @@ void USBMIDIParseBulkIn(const uint8_t *data,
     }
 }
 
+uint32_t USBMIDIPacketStatusClass(uint8_t cin, uint8_t firstByte)
+{
+    switch (cin) {
+        case kCIN_NoteOff:         return kMIDIClass_NoteOff;
+        case kCIN_NoteOn:          return kMIDIClass_NoteOn;
+        case kCIN_PolyAftertouch:  return kMIDIClass_PolyAftertouch;
+        case kCIN_ControlChange:   return kMIDIClass_ControlChange;
+        case kCIN_ProgramChange:   return kMIDIClass_ProgramChange;
+        case kCIN_ChannelPressure: return kMIDIClass_ChannelPressure;
+        case kCIN_PitchBend:       return kMIDIClass_PitchBend;
+        case kCIN_SysExStart:
+        case kCIN_SysExEnd2Byte:
+        case kCIN_SysExEnd3Byte:   return kMIDIClass_SysEx;
+        case kCIN_SysExEnd1Byte:
+            // CIN 5 also carries single-byte system common (Tune Request)
+            return firstByte == 0xF6 ? kMIDIClass_TuneRequest : kMIDIClass_SysEx;
+        default: break;
+    }
+
+    switch (firstByte) {
+        case 0xF1: return kMIDIClass_TimeCode;
+        case 0xF2: return kMIDIClass_SongPosition;
+        case 0xF3: return kMIDIClass_SongSelect;
+        case 0xF6: return kMIDIClass_TuneRequest;
+        case 0xF8: return kMIDIClass_Clock;
+        case 0xFA: return kMIDIClass_Start;
+        case 0xFB: return kMIDIClass_Continue;
+        case 0xFC: return kMIDIClass_Stop;
+        case 0xFE: return kMIDIClass_ActiveSensing;
+        case 0xFF: return kMIDIClass_SystemReset;
+        default:   return kMIDIClass_None;
+    }
+}
+
+void USBMIDIParseBulkInFiltered(const uint8_t *data,
+                                uint32_t length,
+                                USBMIDIInputFilter *filters,
+                                USBMIDIParseCallback callback,
+                                void *context)
+{
+    if (!filters) {
+        USBMIDIParseBulkIn(data, length, callback, context);
+        return;
+    }
+    if (!data || !callback) return;
+
+    for (uint32_t offset = 0; offset + 4 <= length; offset += 4) {
+        uint8_t header = data[offset];
+        uint8_t cin   = header & 0x0F;
+        uint8_t cable = (header >> 4) & 0x0F;
+
+        uint8_t byteCount = USBMIDICinToMIDIByteCount(cin);
+        if (byteCount == 0) continue;
+
+        const uint8_t *midiBytes = &data[offset + 1];
+        USBMIDIInputFilter &f = filters[cable];
+        uint32_t cls = USBMIDIPacketStatusClass(cin, midiBytes[0]);
+
+        if (f.dropMask.load(std::memory_order_relaxed) & cls) {
+            f.filteredEvents++;
+            if (cls == kMIDIClass_Clock)         f.filteredClock++;
+            if (cls == kMIDIClass_ActiveSensing) f.filteredActiveSensing++;
+            continue;
+        }
+
+        if (cls == kMIDIClass_Start) {
+            f.clockPhase = 0;
+        } else if (cls == kMIDIClass_Clock) {
+            uint8_t divisor = f.clockDivisor.load(std::memory_order_relaxed);
+            if (divisor > 1) {
+                uint8_t phase = f.clockPhase;
+                f.clockPhase = (uint8_t)((phase + 1) % divisor);
+                if (phase != 0) {
+                    f.filteredEvents++;
+                    f.filteredClock++;
+                    continue;
+                }
+            }
+        }
+
+        callback(cable, midiBytes, byteCount, context);
+    }
+}
+
 static uint8_t channelMessageLength(uint8_t statusByte)
 {
     switch (statusByte & 0xF0) {
@@ -182,3 +266,68 @@ uint32_t USBMIDIBuildBulkOut(const uint8_t *midiBytes,
 
     return outOffset;
 }
+
+uint32_t USBMIDIBuildSysExChunk(const uint8_t *midiBytes,
+                                uint32_t byteCount,
+                                uint32_t *offset,
+                                uint8_t cableNumber,
+                                uint32_t chunkSize,
+                                uint8_t *outBuffer,
+                                uint32_t outBufferSize,
+                                bool *endOfSysEx)
+{
+    if (endOfSysEx) *endOfSysEx = false;
+    if (!midiBytes || !offset || !outBuffer) return 0;
+
+    // Each USB-MIDI packet is 4 bytes: [cable<<4|CIN, b0, b1, b2]
+    uint32_t i = *offset;
+    uint32_t outOffset = 0;
+    uint32_t midiBytesPacked = 0;
+    uint8_t headerBase = (uint8_t)(cableNumber << 4);
+
+    while (i < byteCount && outOffset + 4 <= outBufferSize) {
+        // Collect up to 3 bytes for one USB-MIDI packet
+        uint8_t group[3] = {0, 0, 0};
+        uint8_t count = 0;
+        bool endFound = false;
+
+        while (count < 3 && i < byteCount) {
+            group[count] = midiBytes[i];
+            count++;
+            if (midiBytes[i] == 0xF7) {
+                endFound = true;
+                i++;
+                break;
+            }
+            i++;
+        }
+
+        uint8_t cin;
+        if (endFound) {
+            switch (count) {
+                case 1: cin = kCIN_SysExEnd1Byte; break;
+                case 2: cin = kCIN_SysExEnd2Byte; break;
+                case 3: cin = kCIN_SysExEnd3Byte; break;
+                default: cin = kCIN_SysExEnd1Byte; break;
+            }
+        } else {
+            cin = kCIN_SysExStart; // SysEx start or continue (CIN=4)
+        }
+
+        outBuffer[outOffset + 0] = headerBase | cin;
+        outBuffer[outOffset + 1] = group[0];
+        outBuffer[outOffset + 2] = group[1];
+        outBuffer[outOffset + 3] = group[2];
+        outOffset += 4;
+        midiBytesPacked += count;
+
+        if (endFound) {
+            if (endOfSysEx) *endOfSysEx = true;
+            break;
+        }
+        if (midiBytesPacked >= chunkSize) break;
+    }
+
+    *offset = i;
+    return outOffset;
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <atomic>
 
 // USB-MIDI 1.0 Code Index Numbers (CIN)
 enum USBMIDICin : uint8_t {
@@ -47,6 +48,60 @@ void USBMIDIParseBulkIn(const uint8_t *data,
                         USBMIDIParseCallback callback,
                         void *context);
 
+// Status classes for inbound filtering, one bit per class.
+enum MIDIStatusClass : uint32_t {
+    kMIDIClass_None            = 0,
+    kMIDIClass_NoteOff         = 1u << 0,
+    kMIDIClass_NoteOn          = 1u << 1,
+    kMIDIClass_PolyAftertouch  = 1u << 2,
+    kMIDIClass_ControlChange   = 1u << 3,
+    kMIDIClass_ProgramChange   = 1u << 4,
+    kMIDIClass_ChannelPressure = 1u << 5,
+    kMIDIClass_PitchBend       = 1u << 6,
+    kMIDIClass_SysEx           = 1u << 7,   // F0 ... F7, including continuations
+    kMIDIClass_TimeCode        = 1u << 8,   // F1
+    kMIDIClass_SongPosition    = 1u << 9,   // F2
+    kMIDIClass_SongSelect      = 1u << 10,  // F3
+    kMIDIClass_TuneRequest     = 1u << 11,  // F6
+    kMIDIClass_Clock           = 1u << 12,  // F8
+    kMIDIClass_Start           = 1u << 13,  // FA
+    kMIDIClass_Continue        = 1u << 14,  // FB
+    kMIDIClass_Stop            = 1u << 15,  // FC
+    kMIDIClass_ActiveSensing   = 1u << 16,  // FE
+    kMIDIClass_SystemReset     = 1u << 17,  // FF
+
+    kMIDIClass_ChannelVoice = 0x7F,
+    kMIDIClass_RealTime     = kMIDIClass_Clock | kMIDIClass_Start | kMIDIClass_Continue
+                            | kMIDIClass_Stop | kMIDIClass_ActiveSensing | kMIDIClass_SystemReset,
+};
+
+/// Returns the MIDIStatusClass bit of a USB-MIDI event packet (CIN + first MIDI byte).
+uint32_t USBMIDIPacketStatusClass(uint8_t cin, uint8_t firstByte);
+
+/// Per-cable inbound filter, checked before an event reaches the parse callback.
+/// dropMask and clockDivisor may be changed from any thread while reads are
+/// running; counters are written only from the read path.
+struct USBMIDIInputFilter {
+    std::atomic<uint32_t> dropMask{0};       // MIDIStatusClass bits to discard
+    std::atomic<uint8_t>  clockDivisor{1};   // Pass 1 of every N clock pulses (1 = all)
+    uint8_t  clockPhase   = 0;   // Reset by Start so thinned clock stays on the beat
+
+    uint64_t filteredEvents        = 0;
+    uint64_t filteredClock         = 0;
+    uint64_t filteredActiveSensing = 0;
+};
+
+static constexpr uint8_t kUSBMIDINumCables = 16;
+
+/// Parse USB-MIDI bulk IN data, discarding events rejected by the per-cable
+/// filter. filters points to kUSBMIDINumCables entries (indexed by cable), or
+/// nullptr to pass everything.
+void USBMIDIParseBulkInFiltered(const uint8_t *data,
+                                uint32_t length,
+                                USBMIDIInputFilter *filters,
+                                USBMIDIParseCallback callback,
+                                void *context);
+
 /// Build USB-MIDI event packets from a raw MIDI byte stream.
 /// Returns number of bytes written to outBuffer (always a multiple of 4).
 uint32_t USBMIDIBuildBulkOut(const uint8_t *midiBytes,
@@ -55,4 +110,18 @@ uint32_t USBMIDIBuildBulkOut(const uint8_t *midiBytes,
                              uint8_t *outBuffer,
                              uint32_t outBufferSize);
 
+/// Build one paced chunk of a SysEx stream as USB-MIDI event packets.
+/// Packs MIDI bytes starting at midiBytes[*offset] until chunkSize MIDI bytes
+/// have been packed, outBuffer is full, or the terminating 0xF7 is reached.
+/// Advances *offset past the consumed bytes and sets *endOfSysEx when the
+/// chunk carries the 0xF7. Returns number of bytes written to outBuffer.
+uint32_t USBMIDIBuildSysExChunk(const uint8_t *midiBytes,
+                                uint32_t byteCount,
+                                uint32_t *offset,
+                                uint8_t cableNumber,
+                                uint32_t chunkSize,
+                                uint8_t *outBuffer,
+                                uint32_t outBufferSize,
+                                bool *endOfSysEx);
+
 #endif /* USBMIDIParser_h */
@@ -0,0 +1,85 @@
+#include "WriteWindow.h"
+
+WriteWindow::WriteWindow(const WriteWindowConfig &config)
+{
+    SetConfig(config);
+}
+
+void WriteWindow::SetConfig(const WriteWindowConfig &newConfig)
+{
+    config = newConfig;
+    if (config.maxDepth < 1) config.maxDepth = 1;
+    if (config.maxDepth > kMaxWritesInFlight) config.maxDepth = kMaxWritesInFlight;
+    if (config.epochWrites < 1) config.epochWrites = 1;
+    if (depth > config.maxDepth) depth = config.maxDepth;
+}
+
+void WriteWindow::Reset()
+{
+    depth = 1;
+    sinceChange = 0;
+    smoothedNs = 0;
+    epochMinNs = 0;
+    lastEpochMinNs = 0;
+    epochCount = 0;
+    stats = {};
+}
+
+void WriteWindow::OnCompleted(uint64_t latencyNs, bool failed, bool windowLimited)
+{
+    stats.completions++;
+    sinceChange++;
+
+    if (failed) {
+        stats.failures++;
+        if (depth > 1) {
+            depth /= 2;
+            stats.shrinks++;
+        }
+        sinceChange = 0;
+        return;
+    }
+
+    // Base latency: the fastest write lately. It is renewed every epoch so
+    // a device that has become slower for good stops looking congested.
+    if (!epochMinNs || latencyNs < epochMinNs) epochMinNs = latencyNs;
+    if (++epochCount >= config.epochWrites) {
+        lastEpochMinNs = epochMinNs;
+        epochMinNs = 0;
+        epochCount = 0;
+    }
+    uint64_t baseNs = epochMinNs;
+    if (lastEpochMinNs && (!baseNs || lastEpochMinNs < baseNs)) baseNs = lastEpochMinNs;
+
+    if (!smoothedNs)
+        smoothedNs = latencyNs;
+    else if (latencyNs > smoothedNs)
+        smoothedNs += (latencyNs - smoothedNs) >> 3;
+    else
+        smoothedNs -= (smoothedNs - latencyNs) >> 3;
+
+    stats.baseNs = baseNs;
+    stats.latencyNs = smoothedNs;
+
+    // Move at most once per window's worth of completions, so each change
+    // is judged on writes that were sent with it
+    if (sinceChange < depth) return;
+    uint64_t queueNs = smoothedNs > baseNs ? smoothedNs - baseNs : 0;
+    if (queueNs > config.targetQueueNs && depth > 1) {
+        depth--;
+        stats.shrinks++;
+        sinceChange = 0;
+    } else if (windowLimited && queueNs <= config.targetQueueNs / 2 && depth < config.maxDepth) {
+        depth++;
+        stats.grows++;
+        if (depth > stats.peakDepth) stats.peakDepth = depth;
+        sinceChange = 0;
+    }
+}
+
+WriteWindowStats WriteWindow::GetStats() const
+{
+    WriteWindowStats s = stats;
+    s.depth = depth;
+    return s;
+}
@@ -0,0 +1,64 @@
+#ifndef WriteWindow_h
+#define WriteWindow_h
+
+#include <stdint.h>
+
+static constexpr uint32_t kMaxWritesInFlight = 8;
+
+struct WriteWindowConfig {
+    uint32_t maxDepth      = 1;         // Writes that may be in flight at once
+    uint64_t targetQueueNs = 1000000;   // Queueing above the base latency the window may add
+    uint32_t epochWrites   = 256;       // Base latency is the fastest write of the last two epochs
+};
+
+struct WriteWindowStats {
+    uint64_t completions = 0;
+    uint64_t failures    = 0;
+    uint64_t grows       = 0;
+    uint64_t shrinks     = 0;
+    uint64_t baseNs      = 0;   // Latency of a write that waited on nothing
+    uint64_t latencyNs   = 0;   // Smoothed submit-to-completion latency
+    uint32_t depth       = 1;
+    uint32_t peakDepth   = 1;
+};
+
+/// Sizes the window of bulk OUT writes kept in flight.
+///
+/// Fed with the submit-to-completion latency of every asynchronous write.
+/// With one write at a time the pipe idles for a whole completion round
+/// trip between transfers; each extra write in flight hides one more of
+/// them, until the device or bus is the bottleneck and further writes only
+/// wait in line. So the window grows by one per window's worth of writes
+/// while there was more to send than it allowed and the smoothed latency
+/// stays within targetQueueNs / 2 of the base latency, and shrinks by one
+/// when it is more than targetQueueNs above: queued writes delay whatever
+/// is sent behind them, real-time bytes included. A failed write halves
+/// it. Not thread-safe; the transmitter calls it under its queue lock.
+class WriteWindow {
+public:
+    explicit WriteWindow(const WriteWindowConfig &config = {});
+
+    void SetConfig(const WriteWindowConfig &config);
+    void Reset();
+
+    /// Writes that may be in flight now.
+    uint32_t Depth() const { return depth; }
+
+    /// One write completed latencyNs after submission. windowLimited: data
+    /// was left waiting for a free slot while it was in flight.
+    void OnCompleted(uint64_t latencyNs, bool failed, bool windowLimited);
+
+    WriteWindowStats GetStats() const;
+
+private:
+    WriteWindowConfig config;
+    WriteWindowStats  stats;
+    uint32_t depth        = 1;
+    uint32_t sinceChange  = 0;    // Completions since the depth last moved
+    uint64_t smoothedNs   = 0;
+    uint64_t epochMinNs   = 0;    // 0 = none yet
+    uint64_t lastEpochMinNs = 0;
+    uint32_t epochCount   = 0;
+};
+
+#endif /* WriteWindow_h */
@@ -0,0 +1,222 @@
+#include "TestHarness.h"
+#include "BufferPool.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "RolandDT1.h"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Bulk OUT that only counts, so the pipe itself allocates nothing
+class CountingPipe : public USBMIDIOutputPipe {
+public:
+    bool WriteTransfer(const uint8_t *, uint32_t length) override
+    {
+        bytes += length;
+        transfers++;
+        return true;
+    }
+    uint64_t bytes = 0;
+    uint64_t transfers = 0;
+};
+
+std::vector<uint8_t> MakeDump(uint32_t length)
+{
+    std::vector<uint8_t> m(length);
+    m[0] = 0xF0;
+    for (uint32_t i = 1; i + 1 < length; i++) m[i] = (uint8_t)(i & 0x7F);
+    m[length - 1] = 0xF7;
+    return m;
+}
+
+std::vector<uint8_t> MakeDT1(uint32_t address, uint8_t value)
+{
+    // INTEGRA-7: F0 41 10 00 00 64 12 aa aa aa aa dd sum F7
+    const uint8_t probe[] = { 0xF0, kRolandManufacturerID, 0x10, 0x00, 0x00, 0x64 };
+    RolandDT1 header;
+    header.format = FindRolandSysExFormat(probe, sizeof(probe));
+    header.deviceID = 0x10;
+    std::vector<uint8_t> out;
+    BuildRolandDT1(header, address, &value, 1, out);
+    return out;
+}
+
+// One round of a device's output: notes and controllers, an editor's DT1
+// burst (merged past the 64-byte class), a patch dump, a bank dump in one
+// packet, a dump split across packets and clock
+struct OutputRound {
+    std::vector<std::vector<uint8_t>> dt1;
+    std::vector<uint8_t> patch = MakeDump(3000);
+    std::vector<uint8_t> bank  = MakeDump(40000);
+    std::vector<uint8_t> split = MakeDump(1000);
+
+    OutputRound()
+    {
+        for (uint32_t i = 0; i < 100; i++)
+            dt1.push_back(MakeDT1((0x19u << 21) | (0x20u << 14) | i, (uint8_t)i));
+    }
+
+    void Send(MIDITransmitter &tx, FakeHostClock &clock)
+    {
+        for (uint8_t n = 0; n < 32; n++) {
+            const uint8_t on[] = { 0x90, (uint8_t)(36 + n), 0x64 };
+            const uint8_t cc[] = { 0xB0, 0x4A, (uint8_t)(n * 4) };
+            const uint8_t off[] = { 0x80, (uint8_t)(36 + n), 0x40 };
+            const uint8_t tick = 0xF8;
+            tx.Enqueue(0, on, 3);
+            tx.Enqueue(0, cc, 3);
+            tx.Enqueue(0, &tick, 1);
+            tx.Enqueue(0, off, 3);
+        }
+        for (const auto &m : dt1) tx.Enqueue(1, m.data(), (uint32_t)m.size());
+        tx.Enqueue(2, patch.data(), (uint32_t)patch.size());
+        tx.Enqueue(3, bank.data(), (uint32_t)bank.size());
+        for (uint32_t off = 0; off < split.size(); off += 100)
+            tx.Enqueue(2, split.data() + off, 100);
+
+        for (uint64_t due = tx.Pump(); due; due = tx.Pump())
+            clock.Set(due);
+    }
+};
+
+} // namespace
+
+TEST(PoolServesSizeClassesAndSharesBlocks)
+{
+    BufferPoolConfig config;
+    config.blocks64 = 2;
+    config.blocks512 = 1;
+    config.blocks4K = 0;
+    config.blocks64K = 1;
+    BufferPool pool;
+    pool.Reserve(config);
+    CHECK_EQ(pool.ReservedBytes(), 2u * 64 + 512 + 65536);
+
+    PooledBuffer a = pool.Acquire(10);
+    PooledBuffer b = pool.Acquire(64);
+    CHECK_EQ(a.capacity(), 64u);
+    CHECK_EQ(b.capacity(), 64u);
+    // 64-byte class empty: the next class up
+    PooledBuffer c = pool.Acquire(20);
+    CHECK_EQ(c.capacity(), 512u);
+    // No 4 KB blocks: 64 KB; then nothing left but the heap
+    PooledBuffer d = pool.Acquire(1000);
+    CHECK_EQ(d.capacity(), 65536u);
+    PooledBuffer e = pool.Acquire(1000);
+    CHECK_EQ(e.capacity(), 1000u);
+    CHECK_EQ(pool.GetStats().fallbacks, 1u);
+    CHECK_EQ(pool.GetStats().inUse, 4u);
+
+    const uint8_t bytes[] = { 1, 2, 3 };
+    CHECK(a.append(bytes, 3));
+    CHECK(!a.resize(65));
+    CHECK_EQ(a.size(), 3u);
+
+    // Copies share the block; the last reference returns it
+    PooledBuffer shared = a;
+    CHECK_EQ(a.RefCount(), 2u);
+    CHECK(shared.data() == a.data());
+    a.Release();
+    CHECK_EQ(shared.RefCount(), 1u);
+    CHECK_EQ(shared[2], 3);
+    CHECK_EQ(pool.GetStats().inUse, 4u);
+    shared.Release();
+    CHECK_EQ(pool.GetStats().inUse, 3u);
+    PooledBuffer again = pool.Acquire(5);
+    CHECK_EQ(again.capacity(), 64u);
+    CHECK_EQ(again.size(), 0u);
+    CHECK_EQ(pool.GetStats().peakInUse, 4u);
+}
+
+TEST(PoolHandsEachBlockToOneHolderAcrossThreads)
+{
+    BufferPoolConfig config;
+    config.blocks64 = 8;
+    config.blocks512 = 4;
+    config.blocks4K = 0;
+    config.blocks64K = 0;
+    BufferPool pool;
+    pool.Reserve(config);
+
+    const uint32_t kThreads = 4, kRounds = 50000;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> corrupted{0};
+    for (uint32_t t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t] {
+            uint8_t pattern[48];
+            for (uint32_t r = 0; r < kRounds; r++) {
+                memset(pattern, (int)(t * 31 + r), sizeof(pattern));
+                PooledBuffer held[3];
+                for (auto &h : held) {
+                    h = pool.Acquire(sizeof(pattern));
+                    h.append(pattern, sizeof(pattern));
+                }
+                for (auto &h : held)
+                    if (memcmp(h.data(), pattern, sizeof(pattern)) != 0) corrupted++;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    BufferPoolStats s = pool.GetStats();
+    printf("    %u threads x %u rounds: %llu acquired, %llu from the heap, peak %u of 12 blocks\n",
+           kThreads, kRounds, (unsigned long long)s.acquired,
+           (unsigned long long)s.fallbacks, s.peakInUse);
+    CHECK_EQ(corrupted.load(), 0u);
+    CHECK_EQ(s.inUse, 0u);
+    CHECK(s.peakInUse <= 12);
+}
+
+TEST(TransmitterSteadyStateAllocatesNothing)
+{
+    FakeHostClock clock;
+    OutputRound round;
+
+    // The same traffic without reserved blocks, as before the pool
+    uint64_t heapPerRound;
+    {
+        CountingPipe pipe;
+        MIDITransmitter tx(&pipe, &clock);
+        MIDITransmitterConfig config;
+        config.coalesceCables = 0x0001;
+        config.mergeDT1Cables = 0x0002;
+        tx.SetConfig(config);
+        round.Send(tx, clock);
+        uint64_t before = TestAllocationCount();
+        for (int i = 0; i < 10; i++) round.Send(tx, clock);
+        heapPerRound = (TestAllocationCount() - before) / 10;
+    }
+
+    CountingPipe pipe;
+    BufferPool pool;
+    pool.Reserve(BufferPoolConfig());
+    MIDITransmitter tx(&pipe, &clock);
+    tx.SetBufferPool(&pool);
+    MIDITransmitterConfig config;
+    config.coalesceCables = 0x0001;
+    config.mergeDT1Cables = 0x0002;
+    tx.SetConfig(config);
+
+    round.Send(tx, clock);   // Queues reach their working depth
+    uint64_t before = TestAllocationCount();
+    uint64_t bytesBefore = pipe.bytes;
+    const int kRounds = 50;
+    for (int i = 0; i < kRounds; i++) round.Send(tx, clock);
+    uint64_t allocations = TestAllocationCount() - before;
+
+    MIDITransmitterStats stats = tx.GetStats();
+    BufferPoolStats s = pool.GetStats();
+    printf("    %d rounds, %llu KB out, %llu DT1 merged: %llu heap allocations "
+           "(%llu per round without the pool), pool peak %u blocks, %llu fallbacks\n",
+           kRounds, (unsigned long long)(pipe.bytes - bytesBefore) / 1024,
+           (unsigned long long)stats.dt1Merged, (unsigned long long)allocations,
+           (unsigned long long)heapPerRound, s.peakInUse, (unsigned long long)s.fallbacks);
+    CHECK_EQ(allocations, 0u);
+    CHECK_EQ(s.fallbacks, 0u);
+    CHECK_EQ(s.inUse, 0u);
+    CHECK(heapPerRound > 0);
+    CHECK(stats.dt1Merged > 0);
+}
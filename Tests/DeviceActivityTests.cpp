@@ -0,0 +1,96 @@
+#include "TestHarness.h"
+#include "DeviceActivity.h"
+
+namespace {
+
+const uint64_t kSecond = 1000000000;
+
+DeviceActivityConfig LazyConfig(uint64_t idleCloseNs)
+{
+    DeviceActivityConfig config;
+    config.lazy = true;
+    config.idleCloseNs = idleCloseNs;
+    return config;
+}
+
+} // namespace
+
+TEST(ActivityOpensOnFirstSendAndClosesWhenIdle)
+{
+    DeviceActivity activity;
+    activity.SetConfig(LazyConfig(60 * kSecond));
+    CHECK(activity.NeedsOpen());
+    CHECK(!activity.Wanted());
+
+    // First send at t = 10 s opens the device
+    activity.OnSend(10 * kSecond);
+    REQUIRE(activity.NeedsOpen());
+    activity.OnOpened(10 * kSecond, 40000000);
+    CHECK(!activity.NeedsOpen());
+
+    // Each send pushes the idle deadline out
+    activity.OnSend(30 * kSecond);
+    CHECK(!activity.IdleExpired(89 * kSecond, false));
+    CHECK(!activity.IdleExpired(90 * kSecond, true));   // Output still queued
+    CHECK(activity.IdleExpired(90 * kSecond, false));
+
+    activity.OnClosed(true);
+    CHECK(activity.NeedsOpen());
+    CHECK(!activity.IdleExpired(200 * kSecond, false));
+
+    DeviceActivityStats s = activity.GetStats();
+    CHECK(!s.open);
+    CHECK_EQ(s.opens, 1u);
+    CHECK_EQ(s.idleCloses, 1u);
+    CHECK_EQ(s.lastOpenNs, 40000000u);
+}
+
+TEST(ActivityListenersAndPinsHoldTheDeviceOpen)
+{
+    DeviceActivity activity;
+    activity.SetConfig(LazyConfig(kSecond));
+
+    // A client connects to port 1 at t = 5 s
+    activity.SetListening(1, true, 5 * kSecond);
+    CHECK(activity.Wanted());
+    activity.OnOpened(5 * kSecond, 0);
+    CHECK(!activity.IdleExpired(100 * kSecond, false));
+
+    // ... and port 0; the device stays open until both have gone
+    activity.SetListening(0, true, 6 * kSecond);
+    activity.SetListening(1, false, 7 * kSecond);
+    CHECK(!activity.IdleExpired(100 * kSecond, false));
+    activity.SetListening(0, false, 100 * kSecond);
+    CHECK(!activity.IdleExpired(100 * kSecond + kSecond - 1, false));
+    CHECK(activity.IdleExpired(101 * kSecond, false));
+
+    // Thru routes and clock output pin it
+    activity.SetPinned(true);
+    CHECK(activity.Wanted());
+    CHECK(!activity.IdleExpired(200 * kSecond, false));
+    activity.SetPinned(false);
+    CHECK(activity.IdleExpired(200 * kSecond, false));
+}
+
+TEST(ActivityNeverClosesEagerOrKeptDevices)
+{
+    DeviceActivity eager;
+    eager.SetConfig(DeviceActivityConfig());
+    eager.OnOpened(0, 0);
+    CHECK(!eager.Lazy());
+    CHECK(!eager.IdleExpired(1000 * kSecond, false));
+
+    // Lazy with IdleCloseS = 0: opened on use, then kept
+    DeviceActivity kept;
+    kept.SetConfig(LazyConfig(0));
+    kept.OnOpened(0, 0);
+    CHECK(!kept.IdleExpired(1000 * kSecond, false));
+
+    // Removal and failed opens are not idle closes
+    kept.OnClosed(false);
+    kept.OnOpenFailed();
+    DeviceActivityStats s = kept.GetStats();
+    CHECK_EQ(s.idleCloses, 0u);
+    CHECK_EQ(s.openFailures, 1u);
+    CHECK(kept.NeedsOpen());
+}
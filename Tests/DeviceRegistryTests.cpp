@@ -0,0 +1,229 @@
+#include "TestHarness.h"
+#include "DeviceRegistry.h"
+#include "FakeMIDISetup.h"
+#include "PersistentDeviceIndex.h"
+#include "SimulatedUSBDevice.h"
+#include <stdio.h>
+#include <random>
+
+namespace {
+
+struct RigDevice {
+    RigDevice(uint32_t unit, uint32_t location) : unit(unit), location(location) {}
+
+    uint32_t unit;       // Physical unit in the rig
+    uint32_t location;   // Hub port it was found at
+    bool     online = true;
+    uint32_t midiDevice = 0;   // Persistent entry in the setup
+    SimulatedUSBDevice usb;
+    PortHandle ports[2] = {};
+};
+
+typedef DeviceRegistry<RigDevice> RigRegistry;
+
+// A rack of identical modules
+const uint32_t kRigVendorProduct = 0x0582u << 16 | 0x00C5;
+
+// The registry with the persistent MIDIDevices behind it
+struct Rig {
+    Rig(size_t maxDevices, size_t maxPorts) : registry(maxDevices, maxPorts)
+    {
+        index.Load(setup);
+    }
+
+    RigRegistry           registry;
+    FakeMIDISetup         setup;
+    PersistentDeviceIndex index;
+    uint64_t              created = 0;   // MIDIDevices added to the setup
+};
+
+// The driver's hotplug bookkeeping: reconnect the device known at this
+// location, or register a new one (evicting the device offline longest)
+// and find or create its persistent MIDIDevice
+RigDevice *Plug(Rig &rig, uint32_t unit, uint32_t location,
+                std::vector<PortHandle> *retired = nullptr)
+{
+    RigRegistry &registry = rig.registry;
+    for (RigDevice *dev : registry.Devices()) {
+        if (!dev->online && dev->location == location) {
+            dev->unit = unit;   // Identical units can't be told apart
+            dev->online = true;
+            registry.SetOffline(dev, false);
+            return dev;
+        }
+    }
+
+    auto *dev = new RigDevice(unit, location);
+    RigDevice *evicted = nullptr;
+    if (!registry.Add(dev, &evicted)) {
+        delete dev;
+        return nullptr;
+    }
+    if (evicted) {
+        if (retired) retired->assign(evicted->ports, evicted->ports + 2);
+        rig.index.Release(evicted->midiDevice);
+        registry.WaitForReaders();
+        delete evicted;
+    }
+
+    dev->midiDevice = rig.index.Claim(location, kRigVendorProduct);
+    if (!dev->midiDevice) {
+        dev->midiDevice = rig.setup.AddDevice(-1, -1);
+        rig.created++;
+    }
+    rig.index.Stamp(rig.setup, dev->midiDevice, location, kRigVendorProduct);
+    for (uint8_t p = 0; p < 2; p++)
+        dev->ports[p] = registry.AddPort(dev, p);
+    return dev;
+}
+
+void Unplug(RigRegistry &registry, RigDevice *dev)
+{
+    dev->online = false;
+    registry.SetOffline(dev, true);
+}
+
+} // namespace
+
+TEST(RegistryRejectsStaleHandles)
+{
+    Rig rig(2, 4);
+    RigRegistry &registry = rig.registry;
+    RigDevice *a = Plug(rig, 0, 0x100);
+    RigDevice *b = Plug(rig, 1, 0x200);
+    REQUIRE(a && b);
+    CHECK_EQ(registry.PortCount(), 4u);
+
+    RigRegistry::Port port;
+    REQUIRE(registry.Lookup(b->ports[1], port));
+    CHECK(port.device == b && port.cable == 1);
+    CHECK(!registry.Lookup(0, port));
+    CHECK(!registry.Lookup(0xFFFF0003u, port));
+
+    // Full of online devices: a third is refused
+    CHECK(Plug(rig, 2, 0x300) == nullptr);
+
+    // a goes offline and is evicted for the newcomer; its old handles name
+    // the same slots but fail validation
+    PortHandle stale[2] = { a->ports[0], a->ports[1] };
+    Unplug(registry, a);
+    RigDevice *c = Plug(rig, 2, 0x300);
+    REQUIRE(c != nullptr);
+    for (PortHandle h : stale) {
+        CHECK(!registry.Lookup(h, port));
+        // Same slot, next generation
+        PortHandle reused = (c->ports[0] & 0xFFFF) == (h & 0xFFFF) ? c->ports[0] : c->ports[1];
+        CHECK_EQ((reused & 0xFFFF), (h & 0xFFFF));
+        CHECK_EQ((reused >> 16), (h >> 16) + 1);
+    }
+    REQUIRE(registry.Lookup(c->ports[0], port));
+    CHECK(port.device == c);
+    CHECK_EQ(registry.Devices().size(), 2u);
+
+    int visited = 0;
+    registry.ForEachDevice([&](RigDevice *) { visited++; });
+    CHECK_EQ(visited, 2);
+
+    for (RigDevice *dev : std::vector<RigDevice *>(registry.Devices())) {
+        registry.Remove(dev);
+        delete dev;
+    }
+    CHECK_EQ(registry.PortCount(), 0u);
+}
+
+// A rig of 12 units on a 16-port hub, power-cycled and moved between hub
+// ports for 200k hotplug events, with sends resolved throughout. The
+// registry holds fewer devices than there are hub ports, so devices left
+// offline are evicted and come back as new ones; they must find their
+// persistent MIDIDevice again rather than add another to the setup
+TEST(RegistrySoakStaysFlatUnderHotplugChurn)
+{
+    const uint32_t kUnits = 12, kHubPorts = 16, kEvents = 200000;
+    Rig rig(14, 28);
+    RigRegistry &registry = rig.registry;
+    std::mt19937 rng(7);
+
+    uint32_t unitLocation[kUnits];
+    RigDevice *unitDevice[kUnits];
+    for (uint32_t u = 0; u < kUnits; u++) {
+        unitLocation[u] = u;
+        unitDevice[u] = Plug(rig, u, u);
+    }
+
+    int64_t baseline = 0;
+    int64_t peak = 0;
+    size_t baselineEntries = 0;
+    uint64_t baselineCreated = 0;
+    uint64_t sends = 0, staleSends = 0, moves = 0, evictions = 0;
+    std::vector<PortHandle> retired, justRetired;
+    retired.reserve(2);
+    justRetired.reserve(2);
+    for (uint32_t e = 0; e < kEvents; e++) {
+        uint32_t u = rng() % kUnits;
+        Unplug(registry, unitDevice[u]);
+
+        // Replugged at the same hub port, or moved to a free one
+        bool move = rng() % 3 == 0;
+        if (move) {
+            uint32_t location = rng() % kHubPorts;
+            bool taken = false;
+            for (uint32_t v = 0; v < kUnits; v++)
+                taken |= v != u && unitDevice[v] && unitLocation[v] == location;
+            if (!taken) {
+                unitLocation[u] = location;
+                moves++;
+            }
+        }
+        justRetired.clear();
+        unitDevice[u] = Plug(rig, u, unitLocation[u], &justRetired);
+        REQUIRE(unitDevice[u] != nullptr);
+        if (!justRetired.empty()) {
+            retired = justRetired;
+            evictions++;
+        }
+
+        // Sends to current endpoints resolve; those of evicted devices never
+        // do, even once their slots are reused
+        {
+            RigRegistry::ReadGuard guard(registry);
+            RigRegistry::Port port;
+            for (uint32_t v = 0; v < kUnits; v++) {
+                CHECK(registry.Lookup(unitDevice[v]->ports[1], port));
+                CHECK(port.device == unitDevice[v]);
+                sends++;
+            }
+            for (PortHandle h : retired) {
+                CHECK(!registry.Lookup(h, port));
+                staleSends++;
+            }
+        }
+
+        CHECK(registry.Devices().size() <= registry.MaxDevices());
+        CHECK(registry.PortCount() <= registry.MaxPorts());
+        if (e == 1000) {
+            baseline = TestLiveAllocations();
+            baselineEntries = rig.index.Size();
+            baselineCreated = rig.created;
+        }
+        if (e > 1000) peak = std::max(peak, TestLiveAllocations());
+    }
+
+    printf("    %u hotplug events (%llu moves, %llu evictions): %zu devices, %zu ports, "
+           "%zu MIDIDevices (%llu created), live heap blocks %lld -> peak %lld, "
+           "%llu sends, %llu stale handles rejected\n",
+           kEvents, (unsigned long long)moves, (unsigned long long)evictions,
+           registry.Devices().size(), registry.PortCount(),
+           rig.index.Size(), (unsigned long long)rig.created,
+           (long long)baseline, (long long)peak,
+           (unsigned long long)sends, (unsigned long long)staleSends);
+    CHECK(peak <= baseline);
+    CHECK(evictions > 0);
+    CHECK_EQ(rig.index.Size(), baselineEntries);
+    CHECK_EQ(rig.created, baselineCreated);
+    CHECK(rig.index.Size() <= kHubPorts);
+
+    for (RigDevice *dev : std::vector<RigDevice *>(registry.Devices())) {
+        registry.Remove(dev);
+        delete dev;
+    }
+}
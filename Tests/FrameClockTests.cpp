@@ -0,0 +1,161 @@
+#include "TestHarness.h"
+#include "FrameClock.h"
+#include <math.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+const double kTruePeriodNs = 1e6 * (1.0 + 80e-6);   // Bus clock 80 ppm slow
+const double kHostStartNs  = 5e9;
+
+double TrueFrameStart(uint64_t frame)
+{
+    return kHostStartNs + (double)frame * kTruePeriodNs;
+}
+
+struct ErrorStats {
+    double mean = 0, stddev = 0, maxAbs = 0;
+};
+
+ErrorStats Summarize(const std::vector<double> &errors)
+{
+    ErrorStats s;
+    for (double e : errors) s.mean += e;
+    s.mean /= (double)errors.size();
+    for (double e : errors) {
+        s.stddev += (e - s.mean) * (e - s.mean);
+        if (fabs(e - s.mean) > s.maxAbs) s.maxAbs = fabs(e - s.mean);
+    }
+    s.stddev = sqrt(s.stddev / (double)errors.size());
+    return s;
+}
+
+} // namespace
+
+TEST(FrameClockTracksDriftThroughJitter)
+{
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> jitter(0.0, 30000.0);   // 30 us sampling jitter
+    FrameClockDLL dll;
+
+    // Irregular observations, as reads complete only when data arrives
+    std::uniform_int_distribution<int> gap(1, 40);
+    uint64_t frame = 100;
+    std::vector<double> errors;
+    for (int i = 0; i < 3000; i++) {
+        frame += (uint64_t)gap(rng);
+        dll.Observe(frame, (uint64_t)(TrueFrameStart(frame) + jitter(rng)));
+        if (i > 1000)
+            errors.push_back((double)dll.FrameToHost((double)frame + 1) - TrueFrameStart(frame + 1));
+    }
+    REQUIRE(dll.Locked());
+    ErrorStats s = Summarize(errors);
+    CHECK(fabs(s.mean) < 5000);
+    double drift = dll.DriftPpm();
+    CHECK(s.stddev < 15000);              // Half the raw jitter or better
+    CHECK(fabs(drift - 80) < 10);
+
+    // A wildly late sample is ignored
+    uint64_t before = dll.FrameToHost((double)frame + 10);
+    dll.Observe(frame + 5, (uint64_t)(TrueFrameStart(frame + 5) + 3e6));
+    CHECK_EQ(dll.Outliers(), 1u);
+    CHECK_EQ(dll.FrameToHost((double)frame + 10), before);
+
+    // Bus reset: the counter restarts and the loop re-locks
+    for (uint64_t f = 1; f < 40; f++)
+        dll.Observe(f, (uint64_t)(TrueFrameStart(frame + 1000 + f)));
+    CHECK(dll.Locked());
+    CHECK(fabs((double)dll.FrameToHost(50) - TrueFrameStart(frame + 1050)) < 20000);
+
+    printf("    DLL: residual %.1f us rms against 30 us jitter, drift %.1f ppm (true 80)\n",
+           s.stddev / 1000, drift);
+}
+
+TEST(FrameClockTimestampsAreTighterThanCallbackTime)
+{
+    std::mt19937 rng(42);
+    std::exponential_distribution<double> schedDelay(1.0 / 300000.0);   // mean 300 us
+    std::normal_distribution<double> refJitter(0.0, 30000.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // Drum pad on a 5-pin input: hits every ~40-120 ms, a third of them
+    // flams/chords of three notes back to back at the DIN byte rate
+    const double kDINMessageNs = 3 * 320000.0;
+    std::vector<double> events;
+    double t = TrueFrameStart(10);
+    while (events.size() < 6000) {
+        t += 40e6 + uniform(rng) * 80e6;
+        int notes = uniform(rng) < 0.33 ? 3 : 1;
+        for (int n = 0; n < notes; n++)
+            events.push_back(t + n * kDINMessageNs);
+    }
+
+    // Transfers complete at the frame boundary after their events arrived
+    InboundTimestamper stamper;
+    std::vector<double> oldErr, newErr;
+    std::vector<double> oldIOI, newIOI;   // Interval errors inside a flam
+    size_t i = 0;
+    while (i < events.size()) {
+        uint64_t frame = (uint64_t)((events[i] - kHostStartNs) / kTruePeriodNs) + 1;
+        size_t j = i;
+        while (j < events.size() && events[j] < TrueFrameStart(frame)) j++;
+
+        double callback = TrueFrameStart(frame) + 20000 + schedDelay(rng);
+        uint64_t callbackFrame = (uint64_t)((callback - kHostStartNs) / kTruePeriodNs);
+        stamper.OnFrameReference(callbackFrame,
+                                 (uint64_t)(TrueFrameStart(callbackFrame) + refJitter(rng)));
+        stamper.BeginTransfer(callbackFrame, (uint64_t)callback, (uint32_t)(j - i),
+                              (uint64_t)kDINMessageNs);
+
+        for (size_t k = i; k < j; k++) {
+            double stamped = (double)stamper.EventTime((uint32_t)(k - i));
+            if (k > 200) {
+                oldErr.push_back(callback - events[k]);
+                newErr.push_back(stamped - events[k]);
+            }
+            if (k > i && events[k] - events[k - 1] < 2e6) {
+                oldIOI.push_back(0 - (events[k] - events[k - 1]));
+                newIOI.push_back((stamped - (double)stamper.EventTime((uint32_t)(k - i - 1)))
+                                 - (events[k] - events[k - 1]));
+            }
+        }
+        i = j;
+    }
+
+    ErrorStats oldS = Summarize(oldErr), newS = Summarize(newErr);
+    CHECK(newS.stddev < oldS.stddev * 0.9);
+    CHECK(stamper.Clock().Locked());
+
+    // Flam spacing survives when the notes share a transfer
+    double oldIOIRms = 0, newIOIRms = 0;
+    for (double e : oldIOI) oldIOIRms += e * e;
+    for (double e : newIOI) newIOIRms += e * e;
+    REQUIRE(!newIOI.empty());
+    oldIOIRms = sqrt(oldIOIRms / (double)oldIOI.size());
+    newIOIRms = sqrt(newIOIRms / (double)newIOI.size());
+    CHECK(newIOIRms < oldIOIRms / 4);
+
+    printf("    timestamp jitter: callback time %.0f us rms (max %.0f), frame DLL %.0f us rms (max %.0f)\n",
+           oldS.stddev / 1000, oldS.maxAbs / 1000, newS.stddev / 1000, newS.maxAbs / 1000);
+    printf("    same-transfer flam spacing error: %.0f us rms -> %.0f us rms\n",
+           oldIOIRms / 1000, newIOIRms / 1000);
+}
+
+TEST(FrameClockStampsStayMonotonic)
+{
+    InboundTimestamper stamper;
+    for (uint64_t f = 0; f < 32; f++)
+        stamper.OnFrameReference(f, (uint64_t)TrueFrameStart(f));
+
+    // A large transfer right after another can't reach back past it
+    stamper.BeginTransfer(40, 0, 4, 0);
+    uint64_t lastOfFirst = stamper.EventTime(3);
+    stamper.BeginTransfer(40, 0, 16, 960000);
+    uint64_t prev = lastOfFirst;
+    for (uint32_t k = 0; k < 16; k++) {
+        CHECK(stamper.EventTime(k) > prev || (k > 0 && stamper.EventTime(k) >= prev));
+        prev = stamper.EventTime(k);
+    }
+    CHECK(stamper.EventTime(0) > lastOfFirst);
+}
@@ -0,0 +1,117 @@
+#include "TestHarness.h"
+#include "IOScheduler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Spin until a condition holds or a generous deadline passes
+template <typename Pred>
+bool WaitFor(Pred pred, int timeoutMs = 2000)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(SchedulerRunsPostedTasksInOrderOnItsThread)
+{
+    ThreadIOScheduler io;
+    REQUIRE(io.Start("test-io", IOThreadPolicy()));
+    CHECK(io.IsRunning());
+    CHECK(io.PolicyApplied());   // All-zero policy: nothing to apply
+    CHECK(!io.IsCurrentThread());
+
+    std::vector<int> order;
+    std::atomic<bool> onThread{true};
+    for (int i = 0; i < 100; i++) {
+        io.Post([&, i] {
+            if (!io.IsCurrentThread()) onThread = false;
+            order.push_back(i);
+        });
+    }
+    io.PostAndWait([] {});
+    REQUIRE(order.size() == 100u);
+    for (int i = 0; i < 100; i++)
+        CHECK_EQ(order[i], i);
+    CHECK(onThread.load());
+
+    // PostAndWait from the I/O thread runs inline instead of deadlocking
+    bool inner = false;
+    io.PostAndWait([&] { io.PostAndWait([&] { inner = true; }); });
+    CHECK(inner);
+    io.Stop();
+    CHECK(!io.IsRunning());
+}
+
+TEST(SchedulerTimersFireInDueOrderAndCancel)
+{
+    ThreadIOScheduler io;
+    REQUIRE(io.Start("test-io", IOThreadPolicy()));
+
+    std::mutex m;
+    std::vector<int> fired;
+    auto record = [&](int v) {
+        return [&, v] {
+            std::lock_guard<std::mutex> lock(m);
+            fired.push_back(v);
+        };
+    };
+    uint64_t ms = 1000000;
+    io.PostAfter(30 * ms, record(3));
+    io.PostAfter(10 * ms, record(1));
+    IOScheduler::TimerID cancelled = io.PostAfter(20 * ms, record(2));
+    io.PostAfter(10 * ms, record(11));   // Same due time: posting order
+    CHECK(io.Cancel(cancelled));
+    CHECK(!io.Cancel(cancelled));
+
+    CHECK(WaitFor([&] { std::lock_guard<std::mutex> lock(m); return fired.size() == 3; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    std::lock_guard<std::mutex> lock(m);
+    std::vector<int> expected = { 1, 11, 3 };
+    CHECK(fired == expected);
+}
+
+TEST(SchedulerStopDropsPendingWork)
+{
+    ThreadIOScheduler io;
+    REQUIRE(io.Start("test-io", IOThreadPolicy()));
+    std::atomic<int> ran{0};
+    io.PostAfter(50ull * 1000000, [&] { ran++; });
+    io.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    CHECK_EQ(ran.load(), 0);
+
+    // Stopped: no thread to post to, PostAndWait runs inline
+    io.Post([&] { ran++; });
+    io.PostAndWait([&] { ran += 10; });
+    CHECK_EQ(ran.load(), 10);
+
+    // Restartable, as a device is across unplug/replug
+    REQUIRE(io.Start("test-io", IOThreadPolicy()));
+    io.PostAndWait([&] { ran++; });
+    CHECK_EQ(ran.load(), 11);
+}
+
+TEST(SchedulerRealtimePolicyIsBestEffort)
+{
+    // Without privileges the OS may refuse; the thread must still run
+    IOThreadPolicy policy;
+    policy.periodNs = 1000000;
+    policy.computationNs = 500000;
+    policy.constraintNs = 1000000;
+
+    ThreadIOScheduler io;
+    REQUIRE(io.Start("test-rt", policy));
+    std::atomic<bool> ran{false};
+    io.PostAndWait([&] { ran = true; });
+    CHECK(ran.load());
+    printf("    realtime policy %s\n", io.PolicyApplied() ? "applied" : "refused (unprivileged)");
+}
@@ -0,0 +1,148 @@
+#include "TestHarness.h"
+#include "LatencyProbe.h"
+#include "MIDIEchoDevice.h"
+#include "MIDITransmitter.h"
+#include <stdio.h>
+
+namespace {
+
+// The driver's view of one device: probes and client traffic queued on the
+// transmitter, the echo device answering, replies parsed on the way in
+struct EchoRig {
+    FakeHostClock      clock;
+    SimulatedUSBDevice usb{ &clock };
+    MIDITransmitter    tx{ &usb, &clock };
+    MIDIEchoDevice     echo{ usb, clock };
+    LatencyProbe       probe{ &clock };
+
+    void Send(uint8_t cable, const std::vector<uint8_t> &msg)
+    {
+        probe.ObserveOutbound(cable, msg.data(), (uint32_t)msg.size());
+        tx.Enqueue(cable, msg.data(), (uint32_t)msg.size());
+    }
+
+    // Advance in 100 us steps, probing every cable each probeEveryNs
+    void Run(uint64_t durationNs, uint64_t probeEveryNs, uint8_t cables)
+    {
+        const uint64_t kStep = 100000;
+        for (uint64_t t = 0; t < durationNs; t += kStep) {
+            if (t % probeEveryNs == 0) {
+                std::vector<uint8_t> msg;
+                for (uint8_t c = 0; c < cables; c++)
+                    if (probe.NextProbe(c, msg))
+                        tx.Enqueue(c, msg.data(), (uint32_t)msg.size());
+            }
+            tx.Pump();
+            echo.Service();
+
+            uint8_t buffer[512];
+            uint32_t length = 0;
+            usb.ReadTransfer(buffer, sizeof(buffer), &length);
+            USBMIDIParseBulkIn(buffer, length,
+                [](uint8_t cable, const uint8_t *bytes, uint8_t count, void *ctx) {
+                    auto *rig = static_cast<EchoRig *>(ctx);
+                    rig->probe.ObserveInbound(cable, bytes, count, rig->clock.NowNanos());
+                }, this);
+            clock.Advance(kStep);
+        }
+    }
+};
+
+void Print(const char *label, const LatencyProbeStats &s)
+{
+    printf("    %s: %llu probes, %llu replies, %llu timeouts, %llu late; "
+           "min %.0f p50 %.0f p95 %.0f p99 %.0f max %.0f us\n", label,
+           (unsigned long long)s.probes, (unsigned long long)s.replies,
+           (unsigned long long)s.timeouts, (unsigned long long)s.late,
+           s.minUs, s.p50Us, s.p95Us, s.p99Us, s.maxUs);
+}
+
+} // namespace
+
+TEST(ProbeMeasuresEchoRoundTripPerCable)
+{
+    EchoRig rig;
+    rig.probe.SetMode(0, LatencyProbeMode::Loopback);
+    rig.probe.SetMode(1, LatencyProbeMode::Identity);
+    rig.echo.SetLatency(0, 2000000, 1000000);   // DIN loop: 2-3 ms
+    rig.echo.SetLatency(1, 6000000, 0);         // Identity reply after 6 ms
+
+    rig.Run(20000000000ull, 50000000, 2);
+
+    LatencyProbeStats loop = rig.probe.GetStats(0);
+    LatencyProbeStats ident = rig.probe.GetStats(1);
+    Print("loopback", loop);
+    Print("identity", ident);
+
+    CHECK_EQ(loop.probes, 400u);
+    CHECK(loop.replies + 1 >= loop.probes);
+    CHECK_EQ(loop.timeouts, 0u);
+    CHECK_EQ(loop.samples, 256u);
+    // Echo latency plus at most a 100 us step each way
+    CHECK(loop.minUs >= 2000 && loop.maxUs <= 3200);
+    CHECK(loop.p50Us > 2300 && loop.p50Us < 2800);
+    CHECK(loop.p50Us <= loop.p95Us && loop.p95Us <= loop.p99Us && loop.p99Us <= loop.maxUs);
+
+    CHECK(ident.replies + 1 >= ident.probes);
+    CHECK(ident.minUs >= 6000 && ident.maxUs <= 6200);
+
+    // Cable 2 was never switched on
+    CHECK_EQ(rig.probe.GetStats(2).probes, 0u);
+}
+
+TEST(ProbeNeverCreditsALateEchoToTheNextProbe)
+{
+    EchoRig rig;
+    rig.probe.SetMode(0, LatencyProbeMode::Loopback);
+    rig.probe.SetMode(1, LatencyProbeMode::Identity);
+    rig.echo.SetLatency(0, 3000000, 0);
+    rig.echo.SetLatency(1, 3000000, 0);
+    rig.Run(1000000000, 50000000, 2);
+
+    // Echoes slower than the 500 ms timeout: the loopback echo of one probe
+    // comes back while the next is in flight, the identity reply during the
+    // quiet period after the timeout
+    rig.echo.SetLatency(0, 1200000000, 0);
+    rig.echo.SetLatency(1, 700000000, 0);
+    rig.Run(600000000, 50000000, 2);
+    rig.echo.SetLatency(0, 3000000, 0);
+    rig.echo.SetLatency(1, 3000000, 0);
+    rig.Run(3000000000ull, 50000000, 2);
+
+    for (uint8_t cable = 0; cable < 2; cable++) {
+        LatencyProbeStats s = rig.probe.GetStats(cable);
+        Print(cable ? "identity" : "loopback", s);
+        CHECK_EQ(s.timeouts, 1u);
+        CHECK_EQ(s.late, 1u);
+        CHECK(s.replies + s.timeouts + 1 >= s.probes);
+        // Every credited round trip is a 3 ms one
+        CHECK(s.minUs >= 3000 && s.maxUs <= 3200);
+    }
+}
+
+TEST(ClientIdentityRequestVoidsTheProbe)
+{
+    EchoRig rig;
+    rig.probe.SetMode(0, LatencyProbeMode::Identity);
+    rig.echo.SetLatency(0, 4000000, 0);
+
+    std::vector<uint8_t> msg;
+    REQUIRE(rig.probe.NextProbe(0, msg));
+    rig.tx.Enqueue(0, msg.data(), (uint32_t)msg.size());
+    // An editor asks too, 1 ms later: the two replies cannot be told apart
+    rig.Run(1000000, 1000000000, 0);
+    rig.Send(0, { 0xF0, 0x7E, 0x10, 0x06, 0x01, 0xF7 });
+    rig.Run(20000000, 1000000000, 0);
+
+    LatencyProbeStats s = rig.probe.GetStats(0);
+    CHECK_EQ(s.voided, 1u);
+    CHECK_EQ(s.replies, 0u);
+    CHECK_EQ(s.late, 0u);
+    // Quiet for a timeout, then probing resumes
+    CHECK(!rig.probe.NextProbe(0, msg));
+    rig.clock.Advance(500000000);
+    rig.Run(8000000, 10000000, 1);
+    s = rig.probe.GetStats(0);
+    CHECK_EQ(s.replies, 1u);
+    CHECK(s.p50Us >= 4000 && s.p50Us <= 4200);
+}
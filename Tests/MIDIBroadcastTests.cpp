@@ -0,0 +1,200 @@
+#include "TestHarness.h"
+#include "EditorSession.h"
+#include "FakeHostClock.h"
+#include "MIDIBroadcast.h"
+#include "SimulatedUSBDevice.h"
+#include <memory>
+#include <vector>
+
+namespace {
+
+// A rack of identical modules, each with its own transmitter
+struct Rack {
+    explicit Rack(FakeHostClock *clock, size_t units)
+    {
+        for (size_t i = 0; i < units; i++) {
+            devices.push_back(std::make_unique<SimulatedUSBDevice>(clock));
+            outputs.push_back(std::make_unique<MIDITransmitter>(devices.back().get(), clock));
+        }
+    }
+
+    MIDIBroadcastGroup Group(uint32_t id, uint8_t cable) const
+    {
+        MIDIBroadcastGroup g;
+        g.id = id;
+        for (const auto &tx : outputs)
+            g.members.push_back({ tx.get(), cable });
+        return g;
+    }
+
+    void Pump(FakeHostClock &clock)
+    {
+        for (size_t i = 0; i < outputs.size(); i++)
+            PumpUntilIdle(*outputs[i], *devices[i], clock);
+    }
+
+    std::vector<std::unique_ptr<SimulatedUSBDevice>> devices;
+    std::vector<std::unique_ptr<MIDITransmitter>> outputs;
+};
+
+} // namespace
+
+TEST(BroadcastReachesEveryMemberWithOneCopy)
+{
+    FakeHostClock clock;
+    MIDIBroadcast broadcast(&clock);
+    Rack rack(&clock, 4);
+    broadcast.SetGroups({ rack.Group(0, 0) });
+    CHECK_EQ(broadcast.GroupCount(), 1u);
+    CHECK_EQ(broadcast.MemberCount(0), 4u);
+
+    const uint8_t gsReset[] = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7 };
+    std::vector<uint8_t> bank(3000, 0x22);
+    bank.front() = 0xF0;
+    bank.back() = 0xF7;
+    const uint8_t program[] = { 0xC0, 0x05 };
+    CHECK_EQ(broadcast.Send(0, gsReset, sizeof(gsReset)), 4u);
+    CHECK_EQ(broadcast.Send(0, bank.data(), (uint32_t)bank.size()), 4u);
+    CHECK_EQ(broadcast.Send(0, program, sizeof(program)), 4u);
+    CHECK_EQ(broadcast.Send(9, program, sizeof(program)), 0u);     // No such group
+
+    // Both SysEx messages were copied once, and every queue holds a reference
+    BufferPoolStats pool = broadcast.GetPoolStats();
+    CHECK_EQ(pool.acquired, 2u);
+    CHECK_EQ(pool.inUse, 2u);
+
+    rack.Pump(clock);
+    std::vector<uint8_t> expected(gsReset, gsReset + sizeof(gsReset));
+    expected.insert(expected.end(), bank.begin(), bank.end());
+    expected.insert(expected.end(), program, program + sizeof(program));
+    for (const auto &device : rack.devices)
+        CHECK(device->CableBytes(0) == expected);
+    CHECK_EQ(broadcast.GetPoolStats().inUse, 0u);
+
+    MIDIBroadcastStats s = broadcast.GetStats();
+    CHECK_EQ(s.sends, 3u);
+    CHECK_EQ(s.delivered, 12u);
+    CHECK_EQ(s.dropped, 0u);
+}
+
+TEST(BroadcastQueuesWhatEnqueueWould)
+{
+    FakeHostClock clock;
+    MIDIBroadcast broadcast(&clock);
+    Rack rack(&clock, 2);
+    broadcast.SetGroups({ rack.Group(0x0003, 2) });
+
+    SimulatedUSBDevice direct(&clock);
+    MIDITransmitter directOut(&direct, &clock);
+
+    // A SysEx split at odd places with clock inside it, running status, and
+    // a SysEx cut off by a status byte
+    std::vector<std::vector<uint8_t>> packets = {
+        { 0x90, 0x3C, 0x40, 0x3E, 0x40 },
+        { 0xF0, 0x41, 0x10, 0x42, 0x12 },
+        { 0x40, 0x01, 0xF8, 0x30, 0x00 },
+        { 0x0F, 0xF7, 0xB0, 0x07, 0x64, 0x0A, 0x40 },
+        { 0xF0, 0x41, 0x10, 0x42 },
+        { 0x80, 0x3C, 0x00 },
+        { 0xF7, 0xFA, 0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7 },
+    };
+    for (const auto &p : packets) {
+        broadcast.Send(0x0003, p.data(), (uint32_t)p.size());
+        directOut.Enqueue(2, p.data(), (uint32_t)p.size());
+    }
+
+    // The group survives being replaced; the second member leaves
+    MIDIBroadcastGroup one = rack.Group(0x0003, 2);
+    one.members.pop_back();
+    const uint8_t open[]  = { 0xF0, 0x41, 0x10, 0x42, 0x12 };
+    const uint8_t close[] = { 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7 };
+    broadcast.Send(0x0003, open, sizeof(open));
+    directOut.Enqueue(2, open, sizeof(open));
+    broadcast.SetGroups({ one });
+    CHECK_EQ(broadcast.Send(0x0003, close, sizeof(close)), 1u);
+    directOut.Enqueue(2, close, sizeof(close));
+
+    rack.Pump(clock);
+    PumpUntilIdle(directOut, direct, clock);
+    CHECK(rack.devices[0]->Events().size() == direct.Events().size());
+    CHECK(rack.devices[0]->CableBytes(2) == direct.CableBytes(2));
+    CHECK(rack.devices[1]->CableBytes(2).size() < direct.CableBytes(2).size());
+}
+
+TEST(BroadcastMemberJoiningMidSysExGetsNoFragment)
+{
+    FakeHostClock clock;
+    MIDIBroadcast broadcast(&clock);
+    Rack rack(&clock, 2);
+    MIDIBroadcastGroup first = rack.Group(0, 0);
+    first.members.pop_back();
+    broadcast.SetGroups({ first });
+
+    // The second unit is plugged in while a dump is half sent
+    const uint8_t head[] = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00 };
+    const uint8_t tail[] = { 0x7F, 0x00, 0x41, 0xF7 };
+    const uint8_t program[] = { 0xC0, 0x05 };
+    CHECK_EQ(broadcast.Send(0, head, sizeof(head)), 1u);
+    broadcast.SetGroups({ rack.Group(0, 0) });
+    CHECK_EQ(broadcast.Send(0, tail, sizeof(tail)), 2u);
+    CHECK_EQ(broadcast.Send(0, program, sizeof(program)), 2u);
+
+    rack.Pump(clock);
+    std::vector<uint8_t> whole(head, head + sizeof(head));
+    whole.insert(whole.end(), tail, tail + sizeof(tail));
+    whole.insert(whole.end(), program, program + sizeof(program));
+    CHECK(rack.devices[0]->CableBytes(0) == whole);
+    CHECK(rack.devices[1]->CableBytes(0) == std::vector<uint8_t>(program, program + sizeof(program)));
+}
+
+TEST(BroadcastDT1MergeLeavesSharedBufferAlone)
+{
+    FakeHostClock clock;
+    MIDIBroadcast broadcast(&clock);
+    Rack rack(&clock, 2);
+    MIDITransmitterConfig merging;
+    merging.mergeDT1Cables = 1u << 0;
+    rack.outputs[0]->SetConfig(merging);
+    broadcast.SetGroups({ rack.Group(0, 0) });
+
+    // Four single-byte writes to consecutive addresses
+    const uint32_t base = 0x19u << 21;
+    std::vector<uint8_t> separate;
+    for (uint8_t i = 0; i < 4; i++) {
+        std::vector<uint8_t> dt1 = MakeEditorDT1(base + i, &i, 1);
+        broadcast.Send(0, dt1.data(), (uint32_t)dt1.size());
+        separate.insert(separate.end(), dt1.begin(), dt1.end());
+    }
+    CHECK_EQ(rack.outputs[0]->GetStats().dt1Merged, 3u);
+
+    rack.Pump(clock);
+    const uint8_t data[] = { 0, 1, 2, 3 };
+    CHECK(rack.devices[0]->CableBytes(0) == MakeEditorDT1(base, data, 4));
+    CHECK(rack.devices[1]->CableBytes(0) == separate);
+}
+
+TEST(BroadcastDropsOnlyAtFullMembers)
+{
+    FakeHostClock clock;
+    MIDIBroadcast broadcast(&clock);
+    Rack rack(&clock, 3);
+    MIDITransmitterConfig small;
+    small.maxQueuedBytes = 1024;
+    rack.outputs[1]->SetConfig(small);
+    broadcast.SetGroups({ rack.Group(0, 0) });
+
+    std::vector<uint8_t> dump(800, 0x11);
+    dump.front() = 0xF0;
+    dump.back() = 0xF7;
+    CHECK_EQ(broadcast.Send(0, dump.data(), (uint32_t)dump.size()), 3u);
+    CHECK_EQ(broadcast.Send(0, dump.data(), (uint32_t)dump.size()), 2u);
+
+    MIDIBroadcastStats s = broadcast.GetStats();
+    CHECK_EQ(s.delivered, 5u);
+    CHECK_EQ(s.dropped, 1u);
+    CHECK_EQ(rack.outputs[1]->GetStats().messagesDropped, 1u);
+
+    rack.Pump(clock);
+    CHECK_EQ(rack.devices[0]->CableBytes(0).size(), 1600u);
+    CHECK_EQ(rack.devices[1]->CableBytes(0).size(), 800u);
+}
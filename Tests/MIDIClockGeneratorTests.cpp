@@ -0,0 +1,180 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "MIDIClockGenerator.h"
+#include "SimulatedUSBDevice.h"
+#include <vector>
+
+namespace {
+
+// Advance the fake clock in 100 us steps, pumping the generator and the
+// transmitters as their threads would.
+void RunFor(FakeHostClock &clock, MIDIClockGenerator &gen,
+            std::vector<MIDITransmitter *> outs, uint64_t durationNs)
+{
+    uint64_t end = clock.NowNanos() + durationNs;
+    while (clock.NowNanos() < end) {
+        gen.Pump();
+        for (auto *out : outs) out->Pump();
+        clock.Advance(100000);
+    }
+}
+
+std::vector<uint64_t> PulseTimes(const SimulatedUSBDevice &dev, uint8_t cable)
+{
+    std::vector<uint64_t> times;
+    for (const auto &e : dev.Events())
+        if (e.cable == cable && e.length == 1 && e.bytes[0] == 0xF8)
+            times.push_back(e.hostTime);
+    return times;
+}
+
+} // namespace
+
+TEST(ClockGeneratorFansOutInPhase)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice a(&clock), b(&clock);
+    MIDITransmitter outA(&a, &clock), outB(&b, &clock);
+
+    MIDIClockGenerator gen(&clock);
+    gen.SetTargets({ { &outA, 0 }, { &outB, 2 } });
+    gen.SetTempo(125);                       // 20 ms per pulse
+    gen.Start();
+    RunFor(clock, gen, { &outA, &outB }, 24 * 20000000);
+
+    auto ta = PulseTimes(a, 0), tb = PulseTimes(b, 2);
+    CHECK_EQ(ta.size(), 24u);
+    REQUIRE(ta.size() == tb.size());
+    for (size_t i = 0; i < ta.size(); i++) {
+        CHECK_EQ(ta[i], tb[i]);
+        if (i) CHECK_EQ(ta[i] - ta[i - 1], 20000000u);
+    }
+
+    // Start precedes the first pulse on both devices
+    auto ea = a.Events(), eb = b.Events();
+    CHECK(ea.size() > 1 && ea[0].bytes[0] == 0xFA && ea[1].bytes[0] == 0xF8);
+    CHECK(eb.size() > 1 && eb[0].bytes[0] == 0xFA && eb[0].cable == 2);
+
+    MIDIClockGeneratorStats s = gen.GetStats();
+    CHECK_EQ(s.pulses, 24u);
+    CHECK(s.playing);
+    CHECK_EQ(s.latenessMaxNs, 0u);           // Pumped exactly on the grid
+}
+
+TEST(ClockGeneratorTempoChangeKeepsPhase)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice dev(&clock);
+    MIDITransmitter out(&dev, &clock);
+    MIDIClockGenerator gen(&clock);
+    gen.SetTargets({ { &out, 0 } });
+    gen.SetTempo(125);
+    gen.SetClockEnabled(true);
+
+    RunFor(clock, gen, { &out }, 5 * 20000000 + 5000000);   // 6 pulses, 5 ms into the gap
+    uint64_t next = gen.Pump();
+    gen.SetTempo(62.5);                      // 40 ms per pulse
+    CHECK_EQ(gen.Pump(), next);              // The pending pulse stays put
+    RunFor(clock, gen, { &out }, 100000000);
+
+    auto t = PulseTimes(dev, 0);
+    REQUIRE(t.size() >= 9);
+    CHECK_EQ(t[6] - t[5], 20000000u);
+    CHECK_EQ(t[7] - t[6], 40000000u);
+    CHECK_EQ(t[8] - t[7], 40000000u);
+    CHECK(!gen.GetStats().playing);          // Clock only, no transport
+    for (const auto &e : dev.Events())
+        CHECK_EQ(e.bytes[0], 0xF8);
+}
+
+TEST(ClockGeneratorSyncsLateJoiner)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice a(&clock), b(&clock);
+    MIDITransmitter outA(&a, &clock), outB(&b, &clock);
+    MIDIClockGenerator gen(&clock);
+    gen.SetTargets({ { &outA, 0 } });
+    gen.SetTempo(125);
+    gen.Start();
+    RunFor(clock, gen, { &outA, &outB }, 27 * 20000000 + 1000000);   // 28 pulses sent
+
+    // Joins mid-bar: clock at once, Song Position 5 a pulse ahead of the
+    // next sixteenth (pulse 30), Continue right before that pulse
+    gen.SetTargets({ { &outA, 0 }, { &outB, 0 } });
+    RunFor(clock, gen, { &outA, &outB }, 4 * 20000000);
+
+    std::vector<SimulatedUSBDevice::ReceivedEvent> transport;
+    uint64_t firstAfterContinue = 0;
+    for (const auto &e : b.Events()) {
+        if (e.bytes[0] != 0xF8)
+            transport.push_back(e);
+        else if (!transport.empty() && transport.back().bytes[0] == 0xFB && !firstAfterContinue)
+            firstAfterContinue = e.hostTime;
+    }
+    REQUIRE(transport.size() == 2);
+    CHECK_EQ(transport[0].bytes[0], 0xF2);
+    CHECK_EQ(transport[0].bytes[1], 5);
+    CHECK_EQ(transport[0].bytes[2], 0);
+    CHECK_EQ(transport[1].bytes[0], 0xFB);
+    auto ta = PulseTimes(a, 0);
+    REQUIRE(ta.size() >= 31);
+    CHECK_EQ(firstAfterContinue, ta[30]);
+
+    // Stop goes out with the next pulse; the clock keeps running
+    gen.Stop();
+    RunFor(clock, gen, { &outA, &outB }, 2 * 20000000);
+    CHECK(!gen.GetStats().playing);
+    bool sawStop = false;
+    for (const auto &e : a.Events()) sawStop |= e.bytes[0] == 0xFC;
+    CHECK(sawStop);
+}
+
+TEST(ClockGeneratorRecoversFromStarvation)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice dev(&clock);
+    MIDITransmitter out(&dev, &clock);
+    MIDIClockGenerator gen(&clock);
+    gen.SetTargets({ { &out, 0 } });
+    gen.SetTempo(125);
+    gen.SetClockEnabled(true);
+    gen.Pump();
+
+    // Half a millisecond late: sent at once, lateness recorded
+    clock.Advance(20500000);
+    gen.Pump();
+    CHECK_EQ(gen.GetStats().pulses, 2u);
+    CHECK_EQ(gen.GetStats().latenessMaxNs, 500000u);
+
+    // 200 ms stall: a few catch-up pulses, then the grid restarts
+    clock.Advance(200000000);
+    uint64_t next = gen.Pump();
+    MIDIClockGeneratorStats s = gen.GetStats();
+    CHECK_EQ(s.pulses, 6u);
+    CHECK_EQ(s.overruns, 1u);
+    CHECK_EQ(next, clock.NowNanos() + 20000000);
+
+    gen.SetClockEnabled(false);
+    CHECK_EQ(gen.Pump(), 0u);
+}
+
+TEST(ClockGeneratorParsesControlMessages)
+{
+    MIDIClockControl c;
+    const uint8_t start[] = { 0xF0, 0x7D, 0x52, 0x43, 0x01, 0xF7 };
+    CHECK(ParseMIDIClockControl(start, sizeof(start), c));
+    CHECK(c.command == MIDIClockCommand::Start);
+
+    // 133.25 BPM = 13325 = 0x340D -> 0D 68 00
+    const uint8_t tempo[] = { 0xF0, 0x7D, 0x52, 0x43, 0x04, 0x0D, 0x68, 0x00, 0xF7 };
+    CHECK(ParseMIDIClockControl(tempo, sizeof(tempo), c));
+    CHECK(c.command == MIDIClockCommand::Tempo);
+    CHECK(c.bpm > 133.249 && c.bpm < 133.251);
+
+    const uint8_t roland[] = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0xF7 };
+    const uint8_t truncated[] = { 0xF0, 0x7D, 0x52, 0x43, 0x04, 0x0D, 0xF7 };
+    const uint8_t unknown[] = { 0xF0, 0x7D, 0x52, 0x43, 0x09, 0xF7 };
+    CHECK(!ParseMIDIClockControl(roland, sizeof(roland), c));
+    CHECK(!ParseMIDIClockControl(truncated, sizeof(truncated), c));
+    CHECK(!ParseMIDIClockControl(unknown, sizeof(unknown), c));
+}
@@ -0,0 +1,134 @@
+#include "TestHarness.h"
+#include "MIDIClockSmoother.h"
+#include "MIDIClockCapture.h"
+#include <math.h>
+
+namespace {
+
+/// RMS deviation of consecutive intervals from the true ones.
+double IntervalJitterNs(const std::vector<MIDIClockCapturePulse> &capture,
+                        const std::vector<uint64_t> &times, size_t from)
+{
+    double sum = 0;
+    size_t n = 0;
+    for (size_t i = from + 1; i < times.size(); i++) {
+        double e = (double)(times[i] - times[i - 1])
+                 - (double)(capture[i].sentNs - capture[i - 1].sentNs);
+        sum += e * e;
+        n++;
+    }
+    return sqrt(sum / (double)n);
+}
+
+} // namespace
+
+TEST(ClockSmootherSteadyTempo)
+{
+    MIDIClockCaptureOptions options;
+    options.startBPM = 123.5;
+    auto capture = MakeMIDIClockCapture(options);
+
+    MIDIClockSmoother smoother;
+    std::vector<uint64_t> raw, out;
+    for (const auto &p : capture) {
+        raw.push_back(p.receivedNs);
+        uint64_t t = smoother.OnPulse(p.receivedNs);
+        if (!out.empty()) CHECK(t > out.back());
+        out.push_back(t);
+    }
+
+    REQUIRE(smoother.Locked());
+    MIDIClockStats s = smoother.GetStats();
+    CHECK(fabs(s.bpm - 123.5) < 0.1);
+    CHECK_EQ(s.pulses, (uint64_t)capture.size());
+    CHECK(s.outputJitterNs < s.inputJitterNs / 4);
+
+    double rawJitter = IntervalJitterNs(capture, raw, 96);
+    double outJitter = IntervalJitterNs(capture, out, 96);
+    CHECK(outJitter < rawJitter / 4);
+    printf("    123.5 BPM: interval jitter %.0f us raw -> %.0f us smoothed, estimate %.2f BPM\n",
+           rawJitter / 1000, outJitter / 1000, s.bpm);
+}
+
+TEST(ClockSmootherIgnoresLateCallback)
+{
+    MIDIClockCaptureOptions options;
+    options.lateProbability = 0;
+    options.callbackDelayNs = 50000;
+    auto capture = MakeMIDIClockCapture(options);
+
+    MIDIClockSmoother smoother;
+    uint64_t prev = 0;
+    for (size_t i = 0; i < 200; i++)
+        prev = smoother.OnPulse(capture[i].receivedNs);
+    double period = smoother.PeriodNs();
+
+    // One pulse arrives 6 ms late; it lands on the grid anyway
+    uint64_t late = smoother.OnPulse(capture[200].receivedNs + 6000000);
+    CHECK(fabs((double)(late - prev) - period) < 100000);
+    CHECK(fabs(smoother.PeriodNs() - period) < 1000);
+    CHECK_EQ(smoother.GetStats().relocks, 0u);
+}
+
+TEST(ClockSmootherFollowsTempoChanges)
+{
+    // Ramp 100 -> 140 BPM over 32 beats, then a jump to 90 BPM
+    MIDIClockCaptureOptions ramp;
+    ramp.startBPM = 100;
+    ramp.endBPM = 140;
+    ramp.pulses = 24 * 32;
+    auto capture = MakeMIDIClockCapture(ramp);
+
+    MIDIClockSmoother smoother;
+    for (const auto &p : capture)
+        smoother.OnPulse(p.receivedNs);
+    CHECK(fabs(smoother.GetStats().bpm - 140) < 1.5);
+
+    MIDIClockCaptureOptions jump;
+    jump.startBPM = 90;
+    jump.pulses = 24 * 4;
+    jump.lateProbability = 0;
+    auto after = MakeMIDIClockCapture(jump);
+    uint64_t offset = capture.back().receivedNs + 20000000 - after.front().receivedNs;
+    for (const auto &p : after)
+        smoother.OnPulse(p.receivedNs + offset);
+    CHECK_EQ(smoother.GetStats().relocks, 1u);
+    CHECK(smoother.Locked());
+    CHECK(fabs(smoother.GetStats().bpm - 90) < 0.5);
+}
+
+TEST(ClockSmootherTransportKeepsTempo)
+{
+    MIDIClockSmoother smoother;
+    uint64_t t = 1000000000;
+    const uint64_t period = 20833333;   // 120 BPM
+    for (int i = 0; i < 96; i++, t += period)
+        smoother.OnPulse(t);
+    REQUIRE(smoother.Locked());
+
+    // Stop, two seconds of silence, Start: the first pulse is taken as is
+    smoother.OnTransport(0xFC);
+    t += 2000000000;
+    smoother.OnTransport(0xFA);
+    CHECK_EQ(smoother.OnPulse(t), t);
+    CHECK(smoother.Locked());
+    CHECK(fabs(smoother.GetStats().bpm - 120) < 0.01);
+    CHECK(smoother.OnPulse(t + period) - t == period);
+
+    smoother.Reset();
+    CHECK(!smoother.Locked());
+    CHECK_EQ(smoother.GetStats().bpm, 0.0);
+}
+
+TEST(ClockSmootherDividedClock)
+{
+    // Roland-RxClockDivide 4 upstream: 6 pulses per quarter reach the smoother
+    MIDIClockSmootherConfig config;
+    config.pulsesPerQuarter = 6;
+    MIDIClockSmoother smoother(config);
+    uint64_t t = 1000000000;
+    for (int i = 0; i < 48; i++, t += 4 * 20833333)
+        smoother.OnPulse(t);
+    CHECK(smoother.Locked());
+    CHECK(fabs(smoother.GetStats().bpm - 120) < 0.01);
+}
@@ -0,0 +1,46 @@
+#include "TestHarness.h"
+#include "MIDINoteTracker.h"
+
+TEST(NoteTrackerHoldsAndReleases)
+{
+    MIDINoteTracker tracker;
+    const uint8_t on[] = { 0x90, 0x3C, 0x64, 0x91, 0x40, 0x50, 0x90, 0x7F, 0x01 };
+    tracker.Observe(2, on, sizeof(on));
+    CHECK_EQ(tracker.HeldCount(2), 3u);
+    CHECK_EQ(tracker.HeldCount(0), 0u);
+
+    const uint8_t off[] = { 0x80, 0x3C, 0x00, 0x91, 0x40, 0x00 };   // Note Off + velocity-0 Note On
+    tracker.Observe(2, off, sizeof(off));
+    CHECK_EQ(tracker.HeldCount(2), 1u);
+
+    uint8_t out[16];
+    uint32_t n = tracker.ReleaseAll(2, out, sizeof(out));
+    REQUIRE(n == 3);
+    CHECK_EQ(out[0], 0x80);
+    CHECK_EQ(out[1], 0x7F);
+    CHECK_EQ(tracker.HeldCount(2), 0u);
+}
+
+TEST(NoteTrackerRunningStatusAndSysEx)
+{
+    MIDINoteTracker tracker;
+    // Running status note-ons, interrupted by SysEx containing 0x90-like data, then clock.
+    const uint8_t bytes[] = { 0x90, 0x30, 0x40, 0x31, 0x40, 0xF0, 0x41, 0x10, 0x32, 0xF7, 0xF8 };
+    tracker.Observe(0, bytes, sizeof(bytes));
+    CHECK_EQ(tracker.HeldCount(0), 2u);
+}
+
+TEST(NoteTrackerReleaseInSmallBuffers)
+{
+    MIDINoteTracker tracker;
+    for (uint8_t note = 0; note < 20; note++) {
+        const uint8_t on[] = { 0x95, note, 0x40 };
+        tracker.Observe(1, on, sizeof(on));
+    }
+    uint8_t out[9];
+    uint32_t total = 0, n;
+    while ((n = tracker.ReleaseAll(1, out, sizeof(out))) > 0)
+        total += n;
+    CHECK_EQ(total, 60u);
+    CHECK_EQ(tracker.HeldCount(1), 0u);
+}
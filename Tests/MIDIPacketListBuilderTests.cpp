@@ -0,0 +1,217 @@
+#include "TestHarness.h"
+#include "MIDIPacketListBuilder.h"
+#include "USBMIDIParser.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+struct Packet {
+    uint64_t timeStamp;
+    std::vector<uint8_t> data;
+};
+
+// Every delivered list, walked the way MIDIPacketNext does
+struct ListSink {
+    uint32_t alignment = kMIDIPacketAlignment;
+    std::vector<std::vector<Packet>> lists;
+    std::vector<uint32_t> sizes;
+    bool wellFormed = true;
+
+    static void Deliver(const uint8_t *list, uint32_t length, void *context)
+    {
+        auto *self = static_cast<ListSink *>(context);
+        uint32_t numPackets;
+        memcpy(&numPackets, list, 4);
+        std::vector<Packet> packets;
+        uint32_t offset = kMIDIPacketListHeaderBytes;
+        for (uint32_t i = 0; i < numPackets; i++) {
+            if (offset + kMIDIPacketHeaderBytes > length) { self->wellFormed = false; break; }
+            Packet p;
+            uint16_t n;
+            memcpy(&p.timeStamp, list + offset, 8);
+            memcpy(&n, list + offset + 8, 2);
+            const uint8_t *data = list + offset + kMIDIPacketHeaderBytes;
+            if (offset + kMIDIPacketHeaderBytes + n > length) { self->wellFormed = false; break; }
+            p.data.assign(data, data + n);
+            packets.push_back(p);
+            uint32_t end = offset + kMIDIPacketHeaderBytes + n;
+            offset = (end + self->alignment - 1) / self->alignment * self->alignment;
+        }
+        // The list ends with its last packet
+        if (offset < length || offset - length >= self->alignment) self->wellFormed = false;
+        self->lists.push_back(packets);
+        self->sizes.push_back(length);
+    }
+
+    std::vector<uint8_t> AllBytes() const
+    {
+        std::vector<uint8_t> out;
+        for (const auto &l : lists)
+            for (const auto &p : l) out.insert(out.end(), p.data.begin(), p.data.end());
+        return out;
+    }
+};
+
+struct Transfer {
+    uint8_t *bytes;
+    uint32_t length;
+    MIDIPacketListBuilder *list;
+};
+
+} // namespace
+
+TEST(PacketListBuilderLaysOutPacketsLikeCoreMIDI)
+{
+    for (uint32_t alignment : { 1u, 4u }) {
+        ListSink sink;
+        sink.alignment = alignment;
+        MIDIPacketListBuilderConfig config;
+        config.packetAlignment = alignment;
+        MIDIPacketListBuilder builder(nullptr, ListSink::Deliver, &sink, config);
+
+        const uint8_t on[]    = { 0x90, 0x3C, 0x64 };
+        const uint8_t cc[]    = { 0xB0, 0x07, 0x40 };
+        const uint8_t tick    = 0xF8;
+        const uint8_t sysEx[] = { 0xF0, 0x41, 0x10 };
+        const uint8_t cont[]  = { 0x00, 0x00, 0x64 };
+        const uint8_t end[]   = { 0x12, 0xF7 };
+        builder.Reserve(8, 20);
+        builder.Add(1000, on, 3);
+        builder.Add(1000, cc, 3);       // Same time: joins the note
+        builder.Add(2000, &tick, 1);
+        builder.Add(2000, sysEx, 3);    // SysEx never joins
+        builder.Add(2000, cont, 3);
+        builder.Add(2000, end, 2);
+        builder.Add(2000, &tick, 1);    // Nor does anything after it
+        CHECK_EQ(builder.NumPackets(), 6u);
+        builder.Flush();
+        builder.Flush();                // Nothing left
+
+        REQUIRE(sink.lists.size() == 1);
+        CHECK(sink.wellFormed);
+        const std::vector<Packet> &p = sink.lists[0];
+        REQUIRE(p.size() == 6);
+        CHECK_EQ(p[0].timeStamp, 1000u);
+        CHECK_EQ(p[0].data.size(), 6u);
+        CHECK_EQ(p[0].data[3], 0xB0);
+        CHECK_EQ(p[1].timeStamp, 2000u);
+        CHECK_EQ(p[1].data.size(), 1u);
+        CHECK_EQ(p[2].data[0], 0xF0);
+        CHECK_EQ(p[3].data[0], 0x00);
+        CHECK_EQ(p[4].data.size(), 2u);
+        CHECK_EQ(p[5].data[0], 0xF8);
+
+        // 4 + (10 + 6) + (10 + 1) + (10 + 3) * 2 + (10 + 2) + (10 + 1), plus padding on ARM
+        uint32_t expected = alignment == 1 ? 80u : 4 + 16 + 12 + 16 + 16 + 12 + 11;
+        CHECK_EQ(sink.sizes[0], expected);
+        CHECK_EQ(builder.GetStats().lists, 1u);
+        CHECK_EQ(builder.GetStats().splits, 0u);
+    }
+}
+
+TEST(PacketListBuilderSplitsOnlyAtPacketBoundaries)
+{
+    ListSink sink;
+    MIDIPacketListBuilderConfig config;
+    config.maxListBytes = 256;
+    MIDIPacketListBuilder builder(nullptr, ListSink::Deliver, &sink, config);
+
+    // 100 notes at distinct times: 13 bytes each, so 19 per 256-byte list
+    std::vector<uint8_t> sent;
+    for (uint32_t i = 0; i < 100; i++) {
+        const uint8_t on[] = { 0x90, (uint8_t)i, 0x40 };
+        builder.Add(i, on, 3);
+        sent.insert(sent.end(), on, on + 3);
+    }
+    // A SysEx longer than a whole list continues packet by packet
+    std::vector<uint8_t> dump(1000, 0x11);
+    dump.front() = 0xF0;
+    dump.back() = 0xF7;
+    builder.Add(500, dump.data(), (uint32_t)dump.size());
+    sent.insert(sent.end(), dump.begin(), dump.end());
+    builder.Flush();
+
+    CHECK(sink.wellFormed);
+    CHECK(sink.AllBytes() == sent);
+    for (uint32_t size : sink.sizes) CHECK(size <= 256);
+    uint32_t notesFirstList = (uint32_t)sink.lists[0].size();
+    CHECK_EQ(notesFirstList, (256u - 4) / 13);
+    // Each continuation packet fills a list on its own
+    CHECK_EQ(sink.lists.back().back().data.back(), 0xF7);
+    CHECK_EQ(sink.lists.back().back().timeStamp, 500u);
+    CHECK_EQ(builder.GetStats().lists, (uint64_t)sink.lists.size());
+    CHECK_EQ(builder.GetStats().splits + 1, (uint64_t)sink.lists.size());
+
+    // The default limit only splits a packet at the UInt16 length
+    ListSink big;
+    MIDIPacketListBuilder unlimited(nullptr, ListSink::Deliver, &big);
+    std::vector<uint8_t> bank(100000, 0x22);
+    bank.front() = 0xF0;
+    bank.back() = 0xF7;
+    unlimited.Add(7, bank.data(), (uint32_t)bank.size());
+    unlimited.Flush();
+    CHECK(big.wellFormed);
+    REQUIRE(big.lists.size() == 2);
+    CHECK_EQ(big.lists[0].size(), 1u);
+    CHECK_EQ(big.lists[0][0].data.size(),
+             kMIDIPacketListMaxBytes - kMIDIPacketListHeaderBytes - kMIDIPacketHeaderBytes);
+    CHECK(big.AllBytes() == bank);
+}
+
+TEST(PacketListBuilderDeliversATransferInOneListFromThePool)
+{
+    BufferPool pool;
+    pool.Reserve(BufferPoolConfig());
+    ListSink sink;
+    MIDIPacketListBuilder builder(&pool, ListSink::Deliver, &sink);
+
+    // A full 512-byte transfer of notes and clock on cable 0
+    uint8_t transfer[512];
+    uint32_t length = 0;
+    for (uint32_t i = 0; length + 4 <= sizeof(transfer); i++) {
+        const uint8_t on[] = { 0x90, (uint8_t)(i & 0x7F), 0x40 };
+        const uint8_t tick = 0xF8;
+        length += i % 4 == 3 ? USBMIDIBuildBulkOut(&tick, 1, 0, transfer + length, 4)
+                             : USBMIDIBuildBulkOut(on, 3, 0, transfer + length, 4);
+    }
+
+    Transfer t = { transfer, length, &builder };
+    auto parse = [](uint8_t, const uint8_t *midiBytes, uint8_t byteCount, void *ctx) {
+        auto *t = static_cast<Transfer *>(ctx);
+        uint32_t index = (uint32_t)(midiBytes - 1 - t->bytes) / 4;
+        t->list->Add(1000 + index, midiBytes, byteCount);
+    };
+
+    builder.Reserve(length / 4, length / 4 * 3);
+    USBMIDIParseBulkIn(transfer, length, parse, &t);
+    builder.Flush();
+    CHECK(sink.wellFormed);
+    REQUIRE(sink.lists.size() == 1);
+    CHECK_EQ(sink.lists[0].size(), (size_t)(length / 4));
+
+    // Steady state, delivering to a sink that only counts
+    uint64_t lists = 0;
+    MIDIPacketListBuilder counted(&pool, [](const uint8_t *, uint32_t, void *ctx) {
+        (*static_cast<uint64_t *>(ctx))++;
+    }, &lists);
+    t.list = &counted;
+    uint64_t before = TestAllocationCount();
+    for (int i = 0; i < 100; i++) {
+        counted.Reserve(length / 4, length / 4 * 3);
+        USBMIDIParseBulkIn(transfer, length, parse, &t);
+        counted.Flush();
+    }
+    uint64_t allocations = TestAllocationCount() - before;
+
+    printf("    %u-byte transfer: %u events in one %u-byte list (was one list per event), "
+           "%llu heap allocations over 100 transfers\n",
+           length, length / 4, sink.sizes[0], (unsigned long long)allocations);
+    CHECK_EQ(lists, 100u);
+    CHECK_EQ(counted.GetStats().packets, 100u * (length / 4));
+    CHECK_EQ(counted.GetStats().grows, 0u);
+    CHECK_EQ(allocations, 0u);
+    CHECK_EQ(pool.GetStats().fallbacks, 0u);
+    CHECK_EQ(pool.GetStats().inUse, 0u);
+}
@@ -0,0 +1,83 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "MIDIRouter.h"
+#include "SimulatedUSBDevice.h"
+#include <vector>
+
+TEST(RouterForwardsMatchingEvents)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice module(&clock);
+    MIDITransmitter moduleOut(&module, &clock);
+
+    MIDIRouter router;
+    MIDIRoute route;
+    route.source = 7;            // keyboard
+    route.sourceCable = 1;
+    route.target = &moduleOut;
+    route.targetCable = 0;
+    route.channelMask = 1u << 0 | 1u << 9;
+    router.SetRoutes({ route });
+    CHECK_EQ(router.RouteCount(), 1u);
+
+    const uint8_t noteCh1[] = { 0x90, 0x3C, 0x64 };
+    const uint8_t noteCh2[] = { 0x91, 0x3C, 0x64 };
+    const uint8_t drums[]   = { 0x99, 0x24, 0x7F };
+    const uint8_t clock8[]  = { 0xF8 };
+    const uint8_t sysex[]   = { 0xF0, 0x41, 0x10 };
+    CHECK_EQ(router.Route(7, 1, noteCh1, 3), 1u);
+    CHECK_EQ(router.Route(7, 1, noteCh2, 3), 0u);    // channel filtered
+    CHECK_EQ(router.Route(7, 1, drums, 3), 1u);
+    CHECK_EQ(router.Route(7, 1, clock8, 1), 0u);     // status filtered
+    CHECK_EQ(router.Route(7, 1, sysex, 3), 0u);
+    CHECK_EQ(router.Route(7, 0, noteCh1, 3), 0u);    // other cable: no route
+    CHECK_EQ(router.Route(8, 1, noteCh1, 3), 0u);    // other device
+
+    moduleOut.Pump();
+    std::vector<uint8_t> expected = { 0x90, 0x3C, 0x64, 0x99, 0x24, 0x7F };
+    CHECK(module.CableBytes(0) == expected);
+
+    MIDIRouterStats stats = router.GetStats();
+    CHECK_EQ(stats.forwarded, 2u);
+    CHECK_EQ(stats.filtered, 3u);
+}
+
+TEST(RouterFansOutAndPassesSysExFragments)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice a(&clock), b(&clock);
+    MIDITransmitter outA(&a, &clock), outB(&b, &clock);
+
+    MIDIRoute toA;
+    toA.source = 1;
+    toA.target = &outA;
+    toA.targetCable = 3;
+    toA.statusMask = kMIDIClass_ChannelVoice | kMIDIClass_SysEx | kMIDIClass_RealTime;
+    MIDIRoute toB = toA;
+    toB.target = &outB;
+    toB.targetCable = 0;
+    toB.statusMask = kMIDIClass_NoteOn | kMIDIClass_NoteOff;
+
+    MIDIRouter router;
+    router.SetRoutes({ toB, toA });
+
+    // A SysEx arrives as 3-byte USB-MIDI fragments; continuations start with data
+    const uint8_t frag1[] = { 0xF0, 0x41, 0x10 };
+    const uint8_t frag2[] = { 0x42, 0x12, 0x40 };
+    const uint8_t frag3[] = { 0x00, 0xF7 };
+    const uint8_t note[]  = { 0x80, 0x3C, 0x00 };
+    CHECK_EQ(router.Route(1, 0, frag1, 3), 1u);
+    CHECK_EQ(router.Route(1, 0, frag2, 3), 1u);
+    CHECK_EQ(router.Route(1, 0, frag3, 2), 1u);
+    CHECK_EQ(router.Route(1, 0, note, 3), 2u);
+
+    outA.Pump();
+    outB.Pump();
+    std::vector<uint8_t> expectedA = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0xF7, 0x80, 0x3C, 0x00 };
+    CHECK(a.CableBytes(3) == expectedA);
+    std::vector<uint8_t> expectedB = { 0x80, 0x3C, 0x00 };
+    CHECK(b.CableBytes(0) == expectedB);
+
+    router.SetRoutes({});
+    CHECK_EQ(router.Route(1, 0, note, 3), 0u);
+}
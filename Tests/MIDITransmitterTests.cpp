@@ -0,0 +1,534 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "SimulatedUSBDevice.h"
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> MakeSysEx(uint32_t length)
+{
+    std::vector<uint8_t> sysex(length, 0x11);
+    sysex.front() = 0xF0;
+    sysex.back() = 0xF7;
+    return sysex;
+}
+
+} // namespace
+
+TEST(TransmitterSendsChannelMessagesInOrder)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    // Running status in one packet is expanded into separate messages.
+    const uint8_t packet[] = { 0x90, 0x3C, 0x64, 0x3E, 0x64, 0xC0, 0x05 };
+    CHECK(tx.Enqueue(1, packet, sizeof(packet)));
+    CHECK_EQ(tx.PendingMessages(1), 3u);
+    CHECK_EQ(tx.Pump(), 0u);
+
+    std::vector<uint8_t> expected = { 0x90, 0x3C, 0x64, 0x90, 0x3E, 0x64, 0xC0, 0x05 };
+    CHECK(device.CableBytes(1) == expected);
+    CHECK_EQ(device.TransferCount(), 1u);
+    CHECK_EQ(tx.PendingMessages(-1), 0u);
+}
+
+TEST(TransmitterPacesLargeSysEx)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    std::vector<uint8_t> sysex = MakeSysEx(1000);
+    CHECK(tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size()));
+
+    uint64_t due = tx.Pump();
+    CHECK_EQ(device.TransferCount(), 1u);
+    CHECK_EQ(due, clock.NowNanos() + kDefaultSysExChunkGapNs);
+
+    // Nothing more goes out before the gap has elapsed ...
+    clock.Advance(kDefaultSysExChunkGapNs / 2);
+    tx.Pump();
+    CHECK_EQ(device.TransferCount(), 1u);
+
+    // ... while other cables keep flowing.
+    const uint8_t note[] = { 0x90, 0x40, 0x40 };
+    tx.Enqueue(1, note, sizeof(note));
+    tx.Pump();
+    CHECK_EQ(device.TransferCount(), 2u);
+
+    for (int i = 0; i < 3; i++) {
+        clock.Advance(kDefaultSysExChunkGapNs);
+        tx.Pump();
+    }
+    CHECK_EQ(device.TransferCount(), 5u);
+    CHECK(device.CableBytes(0) == sysex);
+    CHECK_EQ(tx.Pump(), 0u);
+}
+
+TEST(TransmitterSysExContinuationPackets)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    // CoreMIDI may split one SysEx across packets; the continuation starts with data.
+    std::vector<uint8_t> sysex = MakeSysEx(100);
+    tx.Enqueue(0, sysex.data(), 60);
+    tx.Enqueue(0, sysex.data() + 60, 40);
+
+    // Packets that together fit in one chunk go out without a gap
+    CHECK_EQ(tx.Pump(), 0u);
+    CHECK_EQ(device.TransferCount(), 1u);
+    CHECK(device.CableBytes(0) == sysex);
+
+    // Small fragments (e.g. forwarded thru traffic) are gathered into
+    // chunks, and the gap applies per chunk rather than per fragment
+    std::vector<uint8_t> big = MakeSysEx(kDefaultSysExChunkSize * 2);
+    for (size_t off = 0; off < big.size(); off += 3)
+        tx.Enqueue(0, big.data() + off, (uint32_t)std::min<size_t>(3, big.size() - off));
+    uint64_t due = tx.Pump();
+    CHECK(due != 0);
+    CHECK_EQ(device.TransferCount(), 2u);
+    while (due) {
+        clock.Set(due);
+        due = tx.Pump();
+    }
+    CHECK_EQ(device.TransferCount(), 3u);
+    std::vector<uint8_t> all = sysex;
+    all.insert(all.end(), big.begin(), big.end());
+    CHECK(device.CableBytes(0) == all);
+}
+
+TEST(TransmitterRealTimeInsideSysExPacket)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    // The real-time byte may not split a 3-byte SysEx packet, so it goes
+    // out ahead of the SysEx bytes that surround it.
+    const uint8_t packet[] = { 0xF0, 0x41, 0xF8, 0x10, 0x42, 0xF7 };
+    tx.Enqueue(0, packet, sizeof(packet));
+    CHECK_EQ(tx.Pump(), 0u);
+
+    std::vector<uint8_t> expected = { 0xF8, 0xF0, 0x41, 0x10, 0x42, 0xF7 };
+    CHECK(device.CableBytes(0) == expected);
+}
+
+TEST(TransmitterFlushAbortsSysExAndReleasesNotes)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    const uint8_t notes[] = { 0x90, 0x3C, 0x64, 0x91, 0x40, 0x64 };
+    tx.Enqueue(0, notes, sizeof(notes));
+    std::vector<uint8_t> sysex = MakeSysEx(4096);
+    tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size());
+    tx.Enqueue(0, notes, 3);   // queued behind the SysEx
+    tx.Pump();
+
+    uint64_t before = device.TransferCount();
+    tx.Flush(-1);
+    CHECK_EQ(tx.PendingMessages(-1), 0u);
+    CHECK_EQ(device.TransferCount(), before + 1);
+
+    auto events = device.Events();
+    REQUIRE(events.size() >= 3);
+    // F7 terminator, then one Note Off per held note
+    auto &term = events[events.size() - 3];
+    CHECK_EQ(term.length, 1);
+    CHECK_EQ(term.bytes[0], 0xF7);
+    CHECK_EQ(events[events.size() - 2].bytes[0], 0x80);
+    CHECK_EQ(events[events.size() - 1].bytes[0], 0x81);
+
+    MIDITransmitterStats stats = tx.GetStats();
+    CHECK_EQ(stats.sysExAborted, 1u);
+    CHECK_EQ(stats.notesReleased, 2u);
+    CHECK_EQ(stats.messagesFlushed, 2u);
+
+    // Pacing no longer holds anything back.
+    clock.Advance(kDefaultSysExChunkGapNs);
+    CHECK_EQ(tx.Pump(), 0u);
+    CHECK_EQ(device.TransferCount(), before + 1);
+}
+
+TEST(TransmitterFlushSingleCable)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    std::vector<uint8_t> sysex = MakeSysEx(1000);
+    tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size());
+    tx.Enqueue(1, sysex.data(), (uint32_t)sysex.size());
+    tx.Pump();
+
+    tx.Flush(1);
+    CHECK_EQ(tx.PendingMessages(1), 0u);
+    CHECK_EQ(tx.PendingMessages(0), 1u);
+}
+
+TEST(TransmitterQueueLimitDrops)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+    MIDITransmitterConfig config;
+    config.maxQueuedBytes = 8;
+    tx.SetConfig(config);
+
+    const uint8_t note[] = { 0x90, 0x3C, 0x64 };
+    CHECK(tx.Enqueue(0, note, 3));
+    CHECK(tx.Enqueue(0, note, 3));
+    CHECK(!tx.Enqueue(0, note, 3));
+    CHECK_EQ(tx.GetStats().messagesDropped, 1u);
+}
+
+TEST(TransmitterCoalescesControllersInPlace)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+    MIDITransmitterConfig config;
+    config.coalesceCables = 1u << 2;
+    tx.SetConfig(config);
+
+    const uint8_t first[] = {
+        0xB0, 0x07, 0x10,   // volume
+        0x90, 0x3C, 0x64,   // note on
+        0xE0, 0x00, 0x20,   // pitch bend
+        0xB0, 0x40, 0x7F,   // sustain: a switch, kept in order
+        0xD0, 0x30,         // channel pressure
+    };
+    const uint8_t second[] = {
+        0xB0, 0x07, 0x20, 0xE0, 0x00, 0x30, 0xB0, 0x40, 0x00, 0xD0, 0x40,
+        0xB1, 0x07, 0x55,   // other channel: own entry
+    };
+    const uint8_t third[] = { 0xB0, 0x07, 0x30, 0xE0, 0x7F, 0x7F, 0xD0, 0x50 };
+    tx.Enqueue(2, first, sizeof(first));
+    tx.Enqueue(2, second, sizeof(second));
+    tx.Enqueue(2, third, sizeof(third));
+    CHECK_EQ(tx.GetStats().messagesCoalesced, 6u);
+    CHECK_EQ(tx.PendingMessages(2), 7u);
+
+    // The same traffic on a cable without coalescing stays intact
+    tx.Enqueue(3, first, sizeof(first));
+    tx.Enqueue(3, second, sizeof(second));
+    CHECK_EQ(tx.PendingMessages(3), 10u);
+
+    tx.Pump();
+    std::vector<uint8_t> expected = {
+        0xB0, 0x07, 0x30, 0x90, 0x3C, 0x64, 0xE0, 0x7F, 0x7F, 0xB0, 0x40, 0x7F,
+        0xD0, 0x50, 0xB0, 0x40, 0x00, 0xB1, 0x07, 0x55,
+    };
+    CHECK(device.CableBytes(2) == expected);
+
+    // Once sent, the next value queues normally again
+    tx.Enqueue(2, third, 3);
+    CHECK_EQ(tx.PendingMessages(2), 1u);
+    CHECK_EQ(tx.GetStats().messagesCoalesced, 6u);
+}
+
+TEST(TransmitterFlushSilencesDeviceAtOnce)
+{
+    // A 64 KB bulk dump being paced out on cable 0, and notes hanging on
+    // cable 1 with controller updates queued behind them.
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    const uint8_t chord[] = { 0x90, 0x3C, 0x64, 0x90, 0x40, 0x64, 0x90, 0x43, 0x64 };
+    tx.Enqueue(1, chord, sizeof(chord));
+    std::vector<uint8_t> sysex = MakeSysEx(65536);
+    tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size());
+    tx.Pump();
+    for (int i = 0; i < 3; i++) {
+        clock.Advance(kDefaultSysExChunkGapNs);
+        tx.Pump();
+    }
+    for (int i = 0; i < 200; i++) {
+        const uint8_t cc[] = { 0xB1, 0x07, (uint8_t)(i & 0x7F) };
+        tx.Enqueue(1, cc, sizeof(cc));
+    }
+    REQUIRE(tx.PendingMessages(0) > 0);
+
+    clock.Advance(1000);
+    uint64_t flushTime = clock.NowNanos();
+    size_t before = device.Events().size();
+    tx.Flush(-1);
+    CHECK_EQ(tx.PendingMessages(-1), 0u);
+
+    // The flush goes out in one go, before anything else: the SysEx
+    // terminator on cable 0, then a Note Off for each held note on cable 1.
+    std::vector<SimulatedUSBDevice::ReceivedEvent> events = device.Events();
+    REQUIRE(events.size() == before + 4);
+    CHECK_EQ(events[before].cable, 0);
+    CHECK_EQ(events[before].bytes[0], 0xF7);
+    for (size_t i = before; i < events.size(); i++) {
+        CHECK_EQ(events[i].hostTime, flushTime);
+        if (i > before) {
+            CHECK_EQ(events[i].cable, 1);
+            CHECK_EQ(events[i].bytes[0] & 0xF0, 0x80);
+        }
+    }
+
+    // Nothing queued before the flush reaches the device afterwards.
+    clock.Advance(10 * kDefaultSysExChunkGapNs);
+    CHECK_EQ(tx.Pump(), 0u);
+    CHECK_EQ(device.Events().size(), events.size());
+
+    std::vector<uint8_t> cable0 = device.CableBytes(0);
+    CHECK_EQ(cable0.back(), 0xF7);
+    CHECK(cable0.size() < sysex.size());
+
+    MIDINoteTracker onDevice;
+    std::vector<uint8_t> cable1 = device.CableBytes(1);
+    onDevice.Observe(1, cable1.data(), (uint32_t)cable1.size());
+    CHECK_EQ(onDevice.HeldCount(1), 0u);
+}
+
+namespace {
+
+// Bulk OUT that takes SubmitTransfer and completes only when told to
+class ManualAsyncPipe : public USBMIDIOutputPipe {
+public:
+    bool WriteTransfer(const uint8_t *, uint32_t) override { return false; }
+    bool CanSubmitTransfers() const override { return true; }
+    bool SubmitTransfer(const uint8_t *data, uint32_t length, uint64_t tag) override
+    {
+        tags.push_back(tag);
+        bytes.push_back(std::vector<uint8_t>(data, data + length));
+        buffers.push_back(data);
+        return true;
+    }
+    std::vector<uint64_t> tags;
+    std::vector<std::vector<uint8_t>> bytes;
+    std::vector<const uint8_t *> buffers;   // Read by the "controller" until completion
+};
+
+// Four cables of notes, 12000 events
+std::vector<uint8_t> MakeNoteStream(uint8_t cable)
+{
+    std::vector<uint8_t> notes;
+    for (uint32_t i = 0; i < 1000; i++) {
+        notes.insert(notes.end(), { (uint8_t)(0x90 | cable), (uint8_t)(i & 0x7F), 0x40 });
+        notes.insert(notes.end(), { (uint8_t)(0x80 | cable), (uint8_t)(i & 0x7F), 0x40 });
+        notes.insert(notes.end(), { (uint8_t)(0xB0 | cable), 0x10, (uint8_t)(i & 0x7F) });
+    }
+    return notes;
+}
+
+uint64_t SendNotes(uint32_t writesInFlight, bool *intact, MIDITransmitterStats *stats)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+    device.SetAsyncWrites(&tx, 1000000, 40000000);   // 1 ms completions, high-speed bus
+    MIDITransmitterConfig config;
+    config.maxTransferSize = 1024;
+    config.maxWritesInFlight = writesInFlight;
+    tx.SetConfig(config);
+
+    std::vector<uint8_t> streams[4];
+    for (uint8_t c = 0; c < 4; c++) {
+        streams[c] = MakeNoteStream(c);
+        for (size_t off = 0; off < streams[c].size(); off += 300)
+            tx.Enqueue(c, streams[c].data() + off, 300);
+    }
+    uint64_t start = clock.NowNanos();
+    PumpUntilIdle(tx, device, clock);
+
+    *intact = true;
+    for (uint8_t c = 0; c < 4; c++)
+        *intact &= device.CableBytes(c) == streams[c];
+    *stats = tx.GetStats();
+    return device.LastTransferTime() - start;
+}
+
+} // namespace
+
+TEST(TransmitterPipelinesWritesInOrder)
+{
+    bool syncIntact, asyncIntact;
+    MIDITransmitterStats syncStats, asyncStats;
+    uint64_t syncNs = SendNotes(1, &syncIntact, &syncStats);
+    uint64_t asyncNs = SendNotes(8, &asyncIntact, &asyncStats);
+
+    printf("    36 KB of notes, 1 ms completions: %.1f ms one write at a time, "
+           "%.1f ms with up to 8 in flight (window %u, peak %u in flight)\n",
+           syncNs / 1e6, asyncNs / 1e6, asyncStats.writeWindow, asyncStats.peakWritesInFlight);
+    CHECK(syncIntact);
+    CHECK(asyncIntact);
+    CHECK_EQ(syncStats.peakWritesInFlight, 1u);
+    CHECK_EQ(asyncStats.writesInFlight, 0u);
+    CHECK_EQ(asyncStats.peakWritesInFlight, 8u);
+    CHECK(asyncNs * 4 < syncNs);
+}
+
+TEST(TransmitterPipelinedSysExWaitsForChunkCompletion)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+    const uint64_t kCompletionNs = 1000000;
+    device.SetAsyncWrites(&tx, kCompletionNs, 40000000);
+    MIDITransmitterConfig config;
+    config.maxWritesInFlight = 8;
+    tx.SetConfig(config);
+
+    // A paced dump on cable 0 while notes stream on cable 1
+    std::vector<uint8_t> sysex = MakeSysEx(1000);
+    std::vector<uint8_t> notes = MakeNoteStream(1);
+    tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size());
+    for (size_t off = 0; off < notes.size(); off += 300)
+        tx.Enqueue(1, notes.data() + off, 300);
+    PumpUntilIdle(tx, device, clock);
+
+    CHECK(device.CableBytes(0) == sysex);
+    CHECK(device.CableBytes(1) == notes);
+
+    // Each chunk reaches the device no sooner than the gap after the previous
+    // one's completion (it arrived kCompletionNs before that)
+    std::vector<uint64_t> chunkStarts;
+    uint64_t last = 0;
+    for (auto &e : device.Events()) {
+        if (e.cable != 0 || e.hostTime == last) continue;
+        chunkStarts.push_back(e.hostTime);
+        last = e.hostTime;
+    }
+    REQUIRE(chunkStarts.size() == 4);
+    for (size_t i = 1; i < chunkStarts.size(); i++)
+        CHECK(chunkStarts[i] - chunkStarts[i - 1] >= kCompletionNs + kDefaultSysExChunkGapNs);
+    CHECK(tx.GetStats().peakWritesInFlight > 1);
+}
+
+TEST(TransmitterRetiresOutOfOrderCompletionsInOrder)
+{
+    FakeHostClock clock;
+    ManualAsyncPipe pipe;
+    MIDITransmitter tx(&pipe, &clock);
+    MIDITransmitterConfig config;
+    config.maxWritesInFlight = 4;
+    config.sysExChunkSize = 30;
+    tx.SetConfig(config);
+
+    // A paced chunk, then notes: only the chunk goes before the window grows
+    std::vector<uint8_t> sysex = MakeSysEx(100);
+    tx.Enqueue(0, sysex.data(), (uint32_t)sysex.size());
+    CHECK_EQ(tx.Pump(), 0u);
+    REQUIRE(pipe.tags.size() == 1);
+    CHECK_EQ(tx.GetStats().writesInFlight, 1u);
+
+    const uint8_t note[] = { 0x91, 0x40, 0x40 };
+    tx.Enqueue(1, note, 3);
+    tx.Pump();
+    CHECK_EQ(pipe.tags.size(), 1u);   // Window of one, still in flight
+
+    // Complete it; the gap now runs from here and the note goes out
+    clock.Advance(500000);
+    tx.OnWriteCompleted(pipe.tags[0], true);
+    uint64_t due = tx.Pump();
+    REQUIRE(pipe.tags.size() == 2);
+    CHECK_EQ(due, clock.NowNanos() + kDefaultSysExChunkGapNs);
+
+    // Two writes in flight complete in reverse order
+    clock.Set(due);
+    tx.Enqueue(1, note, 3);
+    CHECK(tx.Pump() == 0u);
+    REQUIRE(pipe.tags.size() == 3);
+    tx.OnWriteCompleted(pipe.tags[2], true);
+    CHECK_EQ(tx.GetStats().writesInFlight, 2u);   // Retires behind the older one
+    tx.OnWriteCompleted(pipe.tags[1], true);
+    CHECK_EQ(tx.GetStats().writesInFlight, 0u);
+    CHECK_EQ(tx.GetStats().writesOutOfOrder, 1u);
+
+    // Unknown and repeated tags are ignored; abandoned writes are forgotten
+    tx.OnWriteCompleted(pipe.tags[1], true);
+    tx.OnWriteCompleted(999, false);
+    CHECK_EQ(tx.GetStats().writeErrors, 0u);
+    tx.Pump();
+    tx.AbandonWrites();
+    CHECK_EQ(tx.GetStats().writesInFlight, 0u);
+}
+
+TEST(TransmitterKeepsSlotsOfWritesInFlightAcrossResizes)
+{
+    FakeHostClock clock;
+    ManualAsyncPipe pipe;
+    MIDITransmitter tx(&pipe, &clock);
+    MIDITransmitterConfig config;
+    config.maxWritesInFlight = 4;
+    tx.SetConfig(config);
+
+    const uint8_t note[] = { 0x90, 0x40, 0x40 };
+    tx.Enqueue(0, note, 3);
+    tx.Pump();
+    REQUIRE(pipe.tags.size() == 1);
+
+    // Resized twice while the write is in flight: the memory it was
+    // submitted from is neither reused nor freed
+    config.maxWritesInFlight = 2;
+    tx.SetConfig(config);
+    config.maxWritesInFlight = 3;
+    tx.SetConfig(config);
+    CHECK(std::vector<uint8_t>(pipe.buffers[0], pipe.buffers[0] + pipe.bytes[0].size()) == pipe.bytes[0]);
+
+    tx.OnWriteCompleted(pipe.tags[0], true);
+    CHECK_EQ(tx.GetStats().writesInFlight, 0u);
+    tx.Enqueue(0, note, 3);
+    tx.Pump();
+    REQUIRE(pipe.tags.size() == 2);
+    CHECK(pipe.bytes[1] == pipe.bytes[0]);
+    tx.OnWriteCompleted(pipe.tags[1], true);
+}
+
+TEST(TransmitterKeepsSlotsOfWritesInFlightAcrossSameSizeRelayouts)
+{
+    FakeHostClock clock;
+    ManualAsyncPipe pipe;
+    MIDITransmitter tx(&pipe, &clock);
+    MIDITransmitterConfig config;
+    config.maxWritesInFlight = 2;
+    config.maxTransferSize = 1024;
+    tx.SetConfig(config);
+
+    // A note left waiting behind the first write grows the window to two
+    const uint8_t note[] = { 0x90, 0x40, 0x40 };
+    tx.Enqueue(0, note, 3);
+    tx.Pump();
+    tx.Enqueue(0, note, 3);
+    tx.Pump();
+    REQUIRE(pipe.tags.size() == 1);
+    tx.OnWriteCompleted(pipe.tags[0], true);
+
+    // Writes 2 to 4 complete; write 5 stays in flight in the second slot,
+    // 1024 bytes in
+    tx.Pump();
+    tx.OnWriteCompleted(pipe.tags[1], true);
+    for (uint8_t key = 0x43; key <= 0x45; key++) {
+        const uint8_t keyed[] = { 0x90, key, 0x40 };
+        tx.Enqueue(0, keyed, 3);
+        tx.Pump();
+        if (key < 0x45) tx.OnWriteCompleted(pipe.tags.back(), true);
+    }
+    REQUIRE(pipe.tags.size() == 5);
+    CHECK_EQ(tx.GetStats().writesInFlight, 1u);
+
+    // Same total size, but the third of four 512-byte slots now starts
+    // where write 5 is still being read from
+    config.maxWritesInFlight = 4;
+    config.maxTransferSize = 512;
+    tx.SetConfig(config);
+    const uint8_t other[] = { 0x90, 0x46, 0x40 };
+    tx.Enqueue(0, other, 3);
+    tx.Pump();
+    REQUIRE(pipe.tags.size() == 6);
+    CHECK(std::vector<uint8_t>(pipe.buffers[4], pipe.buffers[4] + pipe.bytes[4].size()) == pipe.bytes[4]);
+
+    tx.OnWriteCompleted(pipe.tags[4], true);
+    tx.OnWriteCompleted(pipe.tags[5], true);
+    CHECK_EQ(tx.GetStats().writesInFlight, 0u);
+}
@@ -0,0 +1,132 @@
+#include "TestHarness.h"
+#include "FakeMIDISetup.h"
+#include "PersistentDeviceIndex.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace {
+
+const uint32_t kIntegra7 = 0x0582u << 16 | 0x015B;
+const uint32_t kFA06     = 0x0582u << 16 | 0x0174;
+
+bool Contains(const std::vector<uint32_t> &refs, uint32_t ref)
+{
+    return std::find(refs.begin(), refs.end(), ref) != refs.end();
+}
+
+} // namespace
+
+TEST(IndexMatchesByLocationThenVendorProduct)
+{
+    FakeMIDISetup setup;
+    uint32_t stale    = setup.AddDevice(0x14100000, kIntegra7);   // Port it no longer uses
+    uint32_t atPort   = setup.AddDevice(0x14200000, kIntegra7);
+    uint32_t noLoc    = setup.AddDevice(-1, kFA06);
+    uint32_t zeroLoc  = setup.AddDevice(0, kFA06);
+    uint32_t bare     = setup.AddDevice(-1, -1);
+
+    PersistentDeviceIndex index;
+    index.Load(setup);
+    CHECK_EQ(index.Size(), 5u);
+
+    // Location wins over VID/PID
+    CHECK_EQ(index.Claim(0x14200000, kIntegra7), atPort);
+    // A second INTEGRA-7 at a new port: entries with another location never
+    // match by VID/PID
+    CHECK_EQ(index.Claim(0x14300000, kIntegra7), 0u);
+    // Two FA-06 without a stored location take one entry each
+    uint32_t first = index.Claim(0x14400000, kFA06);
+    uint32_t second = index.Claim(0x14500000, kFA06);
+    CHECK(first == noLoc && second == zeroLoc);
+    CHECK_EQ(index.Claim(0x14600000, kFA06), 0u);
+
+    std::vector<uint32_t> orphans = index.Unclaimed();
+    CHECK_EQ(orphans.size(), 2u);
+    CHECK(Contains(orphans, stale) && Contains(orphans, bare));
+    for (uint32_t ref : orphans) index.Remove(ref);
+    CHECK_EQ(index.Size(), 3u);
+    CHECK(index.Unclaimed().empty());
+}
+
+TEST(IndexReadsEachEntryOnce)
+{
+    // 16 present devices, a database with 200 stale entries besides theirs
+    FakeMIDISetup setup;
+    for (uint32_t i = 0; i < 200; i++)
+        setup.AddDevice(0x20000000 + i, kIntegra7);
+    std::vector<uint32_t> present;
+    for (uint32_t i = 0; i < 16; i++)
+        present.push_back(setup.AddDevice(0x14000000 + i, i % 2 ? kIntegra7 : kFA06));
+
+    PersistentDeviceIndex index;
+    index.Load(setup);
+    uint64_t loadReads = setup.reads;
+    CHECK_EQ(loadReads, 2u * 216);
+
+    for (uint32_t i = 0; i < 16; i++) {
+        uint32_t vp = i % 2 ? kIntegra7 : kFA06;
+        uint32_t ref = index.Claim(0x14000000 + i, vp);
+        CHECK_EQ(ref, present[i]);
+        index.Stamp(setup, ref, 0x14000000 + i, vp);
+    }
+    // Matching and restamping unchanged properties cost no further IPC
+    CHECK_EQ(setup.reads, loadReads);
+    CHECK_EQ(setup.writes, 0u);
+    CHECK_EQ(index.Unclaimed().size(), 200u);
+
+    // The nested scan this replaces: every device reads entries' location
+    // until it finds its own
+    uint64_t nestedReads = 0;
+    for (uint32_t i = 0; i < 16; i++) nestedReads += 200 + i + 1;
+    printf("    reconcile 16 devices / 216 entries: %llu property reads (nested scan: %llu)\n",
+           (unsigned long long)setup.reads, (unsigned long long)nestedReads);
+}
+
+TEST(IndexServesHotplugAfterStartup)
+{
+    FakeMIDISetup setup;
+    uint32_t known = setup.AddDevice(0x14100000, kIntegra7);
+    PersistentDeviceIndex index;
+    index.Load(setup);
+    CHECK_EQ(index.Claim(0x14100000, kIntegra7), known);
+    uint64_t reads = setup.reads;
+
+    // Hotplug of a device never seen: no match, the driver creates an entry
+    // and stamps it
+    CHECK_EQ(index.Claim(0x14200000, kFA06), 0u);
+    uint32_t created = setup.AddDevice(-1, -1);
+    index.Stamp(setup, created, 0x14200000, kFA06);
+    CHECK_EQ(setup.writes, 2u);
+    CHECK_EQ(index.Size(), 2u);
+    CHECK(index.Unclaimed().empty());
+
+    // Moved to another port: found by VID/PID only once its location is
+    // cleared, and the stamp follows it
+    PersistentDeviceIndex next;
+    setup.SetInteger(created, PersistentDeviceKey::Location, 0);
+    next.Load(setup);
+    CHECK_EQ(next.Claim(0x14300000, kFA06), created);
+    next.Stamp(setup, created, 0x14300000, kFA06);
+    int32_t location = 0;
+    CHECK(setup.GetInteger(created, PersistentDeviceKey::Location, location));
+    CHECK_EQ((uint32_t)location, 0x14300000u);
+    CHECK(setup.reads > reads);
+}
+
+TEST(IndexReleasedEntryMatchesAgain)
+{
+    FakeMIDISetup setup;
+    uint32_t known = setup.AddDevice(0x14100000, kIntegra7);
+    PersistentDeviceIndex index;
+    index.Load(setup);
+    CHECK_EQ(index.Claim(0x14100000, kIntegra7), known);
+    CHECK_EQ(index.Claim(0x14100000, kIntegra7), 0u);
+
+    // Its device was dropped from the registry; the entry stays in the
+    // setup and the unit finds it when it is plugged in again
+    index.Release(known);
+    CHECK(index.Unclaimed().size() == 1 && index.Unclaimed()[0] == known);
+    CHECK_EQ(index.Claim(0x14100000, kIntegra7), known);
+    index.Release(0);
+    CHECK_EQ(index.Size(), 1u);
+}
@@ -0,0 +1,185 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "PortStatistics.h"
+#include "SimulatedStatsSource.h"
+#include "SimulatedUSBDevice.h"
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+PortStatsSample MakeSample(uint64_t id, uint64_t timeNs, uint64_t rxBytes, uint64_t txBytes)
+{
+    PortStatsSample s;
+    s.id = id;
+    s.device = "Roland INTEGRA-7";
+    s.port = "INTEGRA-7";
+    s.timeNs = timeNs;
+    s.rx.bytes = rxBytes;
+    s.rx.messages = rxBytes / 3;
+    s.tx.bytes = txBytes;
+    s.tx.messages = txBytes / 3;
+    return s;
+}
+
+} // namespace
+
+TEST(TrafficCountsSysExOnceHoweverSplit)
+{
+    MIDITrafficCounters c;
+    SharedMIDITrafficCounters shared;
+    const uint8_t head[] = { 0xF0, 0x41, 0x10 };
+    const uint8_t body[] = { 0x00, 0x00, 0x64 };
+    const uint8_t tail[] = { 0x12, 0xF7 };
+    const uint8_t end[]  = { 0xF7 };
+    const uint8_t note[] = { 0x90, 60, 100 };
+    const uint8_t tick[] = { 0xF8 };
+    CountMIDITraffic(c, head, 3);
+    CountMIDITraffic(c, tick, 1);   // Real-time inside the SysEx
+    CountMIDITraffic(c, body, 3);
+    CountMIDITraffic(c, tail, 2);
+    CountMIDITraffic(c, head, 3);
+    CountMIDITraffic(c, end, 1);
+    CountMIDITraffic(c, note, 3);
+    CHECK_EQ(c.messages, 4u);       // Two SysEx, the clock and the note
+    CHECK_EQ(c.bytes, 16u);
+    CHECK_EQ(c.sysExBytes, 12u);
+
+    // The driver's inbound counters count the same way
+    const uint8_t *events[] = { head, tick, body, tail, head, end, note };
+    const uint32_t lengths[] = { 3, 1, 3, 2, 3, 1, 3 };
+    for (size_t i = 0; i < 7; i++)
+        CountMIDITraffic(shared, events[i], lengths[i]);
+    MIDITrafficCounters loaded = shared.Load();
+    CHECK_EQ(loaded.messages, c.messages);
+    CHECK_EQ(loaded.bytes, c.bytes);
+    CHECK_EQ(loaded.sysExBytes, c.sysExBytes);
+}
+
+TEST(TransmitterCountsTrafficPerCable)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+
+    const uint8_t note[] = { 0x90, 60, 100 };
+    std::vector<uint8_t> dump(600, 0x11);
+    dump.front() = 0xF0;
+    dump.back() = 0xF7;
+    for (int i = 0; i < 5; i++) tx.Enqueue(0, note, 3);
+    tx.Enqueue(1, dump.data(), (uint32_t)dump.size());
+    const uint8_t tick = 0xF8;
+    tx.Enqueue(1, &tick, 1);
+    PumpUntilIdle(tx, device, clock);
+
+    MIDICableStats c0 = tx.GetCableStats(0), c1 = tx.GetCableStats(1);
+    CHECK_EQ(c0.sent.messages, 5u);
+    CHECK_EQ(c0.sent.bytes, 15u);
+    CHECK_EQ(c0.sent.sysExBytes, 0u);
+    CHECK_EQ(c1.sent.messages, 2u);
+    CHECK_EQ(c1.sent.bytes, 601u);
+    CHECK_EQ(c1.sent.sysExBytes, 600u);
+
+    MIDITransmitterStats s = tx.GetStats();
+    CHECK_EQ(s.midiBytesSent, c0.sent.bytes + c1.sent.bytes);
+    // 600 bytes in 256-byte chunks: two gaps served before the last chunk
+    CHECK_EQ(s.pacingWaitNs, 2 * kDefaultSysExChunkGapNs);
+}
+
+TEST(MonitorRatesBetweenPublishedSamples)
+{
+    PortStatsMonitor monitor;
+    monitor.Update({ MakeSample(1, 1000000000, 300, 0), MakeSample(2, 1000000000, 0, 0) });
+    REQUIRE(monitor.Ports().size() == 2);
+    CHECK_EQ(monitor.Ports()[0].rates.seconds, 0.0);
+
+    // Half a second later: 150 bytes in, 3000 out
+    PortStatsSample a = MakeSample(1, 1500000000, 450, 3000);
+    a.pacingWaitNs = 100000000;
+    a.writeErrors = 2;
+    monitor.Update({ a, MakeSample(2, 1500000000, 0, 0) });
+    const PortStatsRates &r = monitor.Ports()[0].rates;
+    CHECK_EQ(r.seconds, 0.5);
+    CHECK_EQ(r.rxBytes, 300.0);
+    CHECK_EQ(r.rxMessages, 100.0);
+    CHECK_EQ(r.txBytes, 6000.0);
+    CHECK_EQ(r.pacingWait, 0.2);
+    CHECK_EQ(r.writeErrors, 2u);
+
+    // Polled again before the driver republished: the rate stands
+    monitor.Update({ a, MakeSample(2, 1500000000, 0, 0) });
+    CHECK_EQ(monitor.Ports()[0].rates.rxBytes, 300.0);
+
+    // Reopened device: counters restart, and so do the rates. A port that
+    // went away is dropped.
+    monitor.Update({ MakeSample(1, 2000000000, 30, 0) });
+    REQUIRE(monitor.Ports().size() == 1);
+    CHECK_EQ(monitor.Ports()[0].rates.seconds, 0.0);
+    monitor.Update({ MakeSample(1, 3000000000, 90, 0) });
+    CHECK_EQ(monitor.Ports()[0].rates.rxBytes, 60.0);
+}
+
+TEST(MonitorFormatsJSONAndTable)
+{
+    PortStatsMonitor monitor;
+    PortStatsSample s = MakeSample(7, 1000000000, 0, 0);
+    s.port = "Part \"A\"\\1";
+    s.latencySamples = 12;
+    s.latencyP50Us = 1500;
+    monitor.Update({ s });
+    s.timeNs = 2000000000;
+    s.tx.bytes = 512;
+    monitor.Update({ s });
+
+    std::string json = monitor.FormatJSON(2500000000);
+    printf("    %s\n", json.c_str());
+    CHECK(json.find("{\"time_us\": 2500000, \"ports\": [{\"id\": 7, ") == 0);
+    CHECK(json.find("\"port\": \"Part \\\"A\\\"\\\\1\"") != std::string::npos);
+    CHECK(json.find("\"bytes_per_sec\": 512.0") != std::string::npos);
+    CHECK(json.find("\"round_trip_us\": {\"samples\": 12, \"p50\": 1500.0") != std::string::npos);
+    CHECK(json.find('\n') == std::string::npos);
+    CHECK(json.substr(json.size() - 3) == "}]}");
+
+    std::string table = monitor.FormatTable();
+    CHECK(table.find("PORT") == 0);
+    CHECK(table.find("1.50/0.00/0.00") != std::string::npos);
+}
+
+TEST(SimulatedSourceReportsLiveRates)
+{
+    FakeHostClock clock;
+    SimulatedTrafficOptions options;
+    options.faultIntervalNs = 2000000000;
+    SimulatedStatsSource source(&clock, options);
+    REQUIRE(source.AddDevice(0x0003));    // SC-8850: six ports, two of them DIN
+    REQUIRE(source.AddDevice(0x015B));    // INTEGRA-7: high speed, pipelined writes
+    CHECK(!source.AddDevice(0xFFFF));
+
+    PortStatsMonitor monitor;
+    std::vector<PortStatsSample> samples;
+    for (int tick = 0; tick < 100; tick++) {   // 10 s at 10 Hz
+        clock.Advance(100000000);
+        REQUIRE(source.Read(samples));
+        monitor.Update(samples);
+    }
+    REQUIRE(monitor.Ports().size() == 7);
+    printf("%s", monitor.FormatTable().c_str());
+
+    for (const PortStatsView &v : monitor.Ports()) {
+        const PortStatsSample &s = v.sample;
+        CHECK_EQ(s.timeNs, clock.NowNanos());
+        CHECK_EQ(v.rates.seconds, 0.1);
+        // 8 note pairs, 40 controllers, probes and a 4 KB dump every 5 s
+        CHECK(s.tx.messages > 500 && s.tx.messages < 700);
+        CHECK(s.tx.sysExBytes >= options.dumpBytes);
+        CHECK(s.rx.messages > 80);
+        CHECK(s.latencySamples >= 5);
+        CHECK(s.latencyP50Us > 1500 && s.latencyP50Us < 60000);
+        CHECK(s.readErrors >= 4 && s.writeErrors >= 4);
+    }
+    // The device clock arrives on each device's first port
+    CHECK(monitor.Ports()[0].sample.rx.messages > 400);
+    CHECK(monitor.Ports()[1].sample.rx.messages < 200);
+    CHECK(monitor.Ports()[0].sample.pacingWaitNs > 0);
+}
@@ -0,0 +1,160 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "RateShaper.h"
+#include "SimulatedUSBDevice.h"
+#include <vector>
+
+static constexpr uint64_t kNsPerDINByte = 1000000000ull / 3125;   // 320 us
+
+TEST(ShaperBurstThenWireRate)
+{
+    RateShaper shaper;
+    CHECK(!shaper.Enabled());
+    shaper.Configure(3125, 30);
+    CHECK(shaper.Enabled());
+
+    uint64_t now = 1000000000;
+    CHECK_EQ(shaper.Available(now), 30u);
+    shaper.Consume(now, 30);
+    CHECK_EQ(shaper.Available(now), 0u);
+
+    // Three bytes come back every 960 us
+    CHECK_EQ(shaper.DueTime(3), now + 3 * kNsPerDINByte);
+    CHECK_EQ(shaper.Available(now + 3 * kNsPerDINByte - 1), 2u);
+    CHECK_EQ(shaper.Available(now + 3 * kNsPerDINByte), 3u);
+
+    // Idle time refills only up to the burst
+    CHECK_EQ(shaper.Available(now + 1000000000), 30u);
+}
+
+TEST(ShaperOverdrawDelaysLaterTraffic)
+{
+    RateShaper shaper;
+    shaper.Configure(3125, 3);
+    uint64_t now = 5000000;
+    shaper.Consume(now, 3);
+    shaper.Consume(now, 1);          // real-time byte on an empty budget
+    CHECK_EQ(shaper.Available(now + 3 * kNsPerDINByte), 2u);
+    CHECK_EQ(shaper.DueTime(3), now + 4 * kNsPerDINByte);
+}
+
+namespace {
+
+struct ShapedRig {
+    FakeHostClock clock;
+    SimulatedUSBDevice device{&clock};
+    MIDITransmitter tx{&device, &clock};
+
+    ShapedRig()
+    {
+        MIDITransmitterConfig config;
+        config.cableBytesPerSecond[1] = 3125;
+        tx.SetConfig(config);
+    }
+
+    // Pump until idle, jumping the fake clock to each due time
+    void Drain()
+    {
+        for (;;) {
+            uint64_t due = tx.Pump();
+            if (due == 0) break;
+            if (due > clock.NowNanos()) clock.Set(due);
+        }
+    }
+};
+
+// Bytes delivered on a cable up to (and including) a host time
+uint32_t BytesBy(const std::vector<SimulatedUSBDevice::ReceivedEvent> &events,
+                 uint8_t cable, uint64_t hostTime)
+{
+    uint32_t n = 0;
+    for (auto &e : events)
+        if (e.cable == cable && e.hostTime <= hostTime) n += e.length;
+    return n;
+}
+
+} // namespace
+
+TEST(ShapedCableHoldsToDINRate)
+{
+    ShapedRig rig;
+    uint64_t start = rig.clock.NowNanos();
+
+    std::vector<uint8_t> notes;
+    for (uint8_t i = 0; i < 100; i++) {
+        const uint8_t on[] = { 0x90, i, 0x40 };
+        notes.insert(notes.end(), on, on + 3);
+    }
+    CHECK(rig.tx.Enqueue(1, notes.data(), (uint32_t)notes.size()));
+    CHECK(rig.tx.Enqueue(0, notes.data(), 30));
+
+    rig.tx.Pump();
+    // The USB-only cable goes out at once; the DIN cable only its burst
+    CHECK_EQ(rig.device.CableBytes(0).size(), 30u);
+    CHECK_EQ(rig.device.CableBytes(1).size(), (size_t)kDefaultShaperBurstBytes / 3 * 3);
+
+    MIDICableStats depth = rig.tx.GetCableStats(1);
+    CHECK_EQ(depth.pendingBytes, 300u - kDefaultShaperBurstBytes / 3 * 3);
+    CHECK_EQ(depth.peakPendingBytes, 300u);
+
+    rig.Drain();
+    CHECK(rig.device.CableBytes(1) == notes);
+
+    // Never ahead of burst + elapsed wire time
+    auto events = rig.device.Events();
+    for (auto &e : events) {
+        if (e.cable != 1) continue;
+        uint64_t allowance = kDefaultShaperBurstBytes + (e.hostTime - start) / kNsPerDINByte;
+        CHECK(BytesBy(events, 1, e.hostTime) <= allowance);
+    }
+    uint64_t elapsed = rig.clock.NowNanos() - start;
+    uint64_t wire = (300 - kDefaultShaperBurstBytes) * kNsPerDINByte;
+    CHECK(elapsed >= wire - 3 * kNsPerDINByte && elapsed <= wire + 3 * kNsPerDINByte);
+    CHECK(rig.tx.GetCableStats(1).shaperHolds > 0);
+    CHECK_EQ(rig.tx.GetCableStats(1).pendingBytes, 0u);
+}
+
+TEST(ShapedCableRealTimeGoesFirst)
+{
+    ShapedRig rig;
+    std::vector<uint8_t> notes(90);
+    for (size_t i = 0; i < notes.size(); i += 3) {
+        notes[i] = 0x90;
+        notes[i + 1] = (uint8_t)i;
+        notes[i + 2] = 0x40;
+    }
+    rig.tx.Enqueue(1, notes.data(), (uint32_t)notes.size());
+    rig.tx.Pump();
+    size_t before = rig.device.Events().size();
+
+    // A clock tick arriving behind a backlog is not delayed by it
+    const uint8_t tick = 0xF8;
+    rig.tx.Enqueue(1, &tick, 1);
+    rig.tx.Pump();
+    auto events = rig.device.Events();
+    REQUIRE(events.size() == before + 1);
+    CHECK_EQ(events.back().bytes[0], 0xF8);
+    CHECK_EQ(events.back().hostTime, rig.clock.NowNanos());
+
+    rig.Drain();
+    CHECK_EQ(rig.device.CableBytes(1).size(), notes.size() + 1);
+}
+
+TEST(ShapedCableSysExSkipsChunkGap)
+{
+    ShapedRig rig;
+    std::vector<uint8_t> sysex(1000, 0x22);
+    sysex.front() = 0xF0;
+    sysex.back() = 0xF7;
+    uint64_t start = rig.clock.NowNanos();
+    rig.tx.Enqueue(1, sysex.data(), (uint32_t)sysex.size());
+    rig.Drain();
+
+    CHECK(rig.device.CableBytes(1) == sysex);
+    // Paced at wire speed (about 310 ms), not 4 chunks x 20 ms plus wire time
+    uint64_t elapsed = rig.clock.NowNanos() - start;
+    uint64_t wire = (1000 - kDefaultShaperBurstBytes) * kNsPerDINByte;
+    CHECK(elapsed <= wire + 3 * kNsPerDINByte);
+    CHECK(elapsed + 32 * kNsPerDINByte >= wire);
+}
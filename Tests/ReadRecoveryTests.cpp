@@ -0,0 +1,248 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "ReadRecovery.h"
+#include "SimulatedUSBDevice.h"
+#include <vector>
+
+namespace {
+
+const uint64_t kMs = 1000000;
+
+struct LoopResult {
+    uint64_t reads    = 0;
+    uint64_t logLines = 0;
+    uint64_t bytes    = 0;
+};
+
+// One outstanding bulk IN read, carried out the way RolandUSBDevice does:
+// every attempt takes a 125 us microframe, decisions act on the simulated
+// device, a reopen costs 50 ms. naive = the old loop (log, resubmit at once).
+LoopResult RunReadLoop(SimulatedUSBDevice &dev, ReadRecovery &recovery, FakeHostClock &clock,
+                       uint64_t durationNs, bool naive = false)
+{
+    LoopResult r;
+    uint64_t end = clock.NowNanos() + durationNs;
+    uint8_t buffer[64];
+    while (clock.NowNanos() < end) {
+        uint32_t length = 0;
+        USBReadStatus status = dev.ReadTransfer(buffer, sizeof(buffer), &length);
+        clock.Advance(125000);
+        r.reads++;
+        r.bytes += length;
+
+        if (naive) {
+            if (status != USBReadStatus::Success) r.logLines++;
+            continue;
+        }
+
+        ReadRecoveryDecision d = recovery.OnResult(status, clock.NowNanos());
+        if (d.log) r.logLines++;
+        switch (d.action) {
+        case ReadRecoveryAction::Resubmit:
+            clock.Advance(d.delayNs);
+            break;
+        case ReadRecoveryAction::ClearStall:
+            dev.ClearInPipeStall();
+            clock.Advance(d.delayNs);
+            break;
+        case ReadRecoveryAction::Reopen:
+            dev.ResetPort();
+            clock.Advance(50 * kMs);
+            recovery.OnReopened();
+            break;
+        case ReadRecoveryAction::Stop:
+            return r;
+        }
+    }
+    return r;
+}
+
+} // namespace
+
+TEST(ReadRecoveryBacksOffThenEscalates)
+{
+    ReadRecovery recovery;
+    uint64_t now = 1;
+
+    // First failure resubmits at once, then 1, 2, 4 ... ms
+    std::vector<uint64_t> delays;
+    ReadRecoveryDecision d;
+    for (int i = 0; i < 8; i++) {
+        d = recovery.OnResult(USBReadStatus::Transient, now);
+        CHECK(d.action == ReadRecoveryAction::Resubmit);
+        delays.push_back(d.delayNs / kMs);
+    }
+    std::vector<uint64_t> expected = { 0, 1, 2, 4, 8, 16, 32, 64 };
+    CHECK(delays == expected);
+    CHECK(recovery.GetState() == ReadRecoveryState::BackingOff);
+
+    // Ninth in a row: reopen; other slots completing meanwhile go idle
+    d = recovery.OnResult(USBReadStatus::Transient, now);
+    CHECK(d.action == ReadRecoveryAction::Reopen);
+    CHECK(d.log);
+    CHECK(recovery.GetState() == ReadRecoveryState::Reopening);
+    CHECK(recovery.OnResult(USBReadStatus::Transient, now).action == ReadRecoveryAction::Stop);
+    recovery.OnReopened();
+
+    // A good read clears everything
+    d = recovery.OnResult(USBReadStatus::Success, now);
+    CHECK(d.action == ReadRecoveryAction::Resubmit);
+    CHECK(recovery.GetState() == ReadRecoveryState::Healthy);
+    CHECK_EQ(recovery.ConsecutiveFailures(), 0u);
+
+    // Aborts (StopIO) are not errors
+    CHECK(recovery.OnResult(USBReadStatus::Aborted, now).action == ReadRecoveryAction::Stop);
+    CHECK(recovery.GetState() == ReadRecoveryState::Healthy);
+
+    // Gone: stop without retrying
+    d = recovery.OnResult(USBReadStatus::DeviceGone, now);
+    CHECK(d.action == ReadRecoveryAction::Stop);
+    CHECK(recovery.GetState() == ReadRecoveryState::Failed);
+    recovery.Reset();
+    CHECK(recovery.GetState() == ReadRecoveryState::Healthy);
+
+    ReadRecoveryStats s = recovery.GetStats();
+    CHECK_EQ(s.errors, 10u);
+    CHECK_EQ(s.transients, 9u);
+    CHECK_EQ(s.backoffs, 7u);
+    CHECK_EQ(s.reopens, 1u);
+    CHECK_EQ(s.recoveries, 1u);
+}
+
+TEST(ReadRecoveryClearsStalledPipe)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice dev(&clock);
+    ReadRecovery recovery;
+
+    const uint8_t note[] = { 0x09, 0x90, 0x3C, 0x64, 0x08, 0x80, 0x3C, 0x00 };
+    dev.QueueInbound(note, sizeof(note));
+    dev.StallInPipe();
+
+    // The old loop never clears the halt: every read fails
+    ReadRecovery unused;
+    LoopResult naive = RunReadLoop(dev, unused, clock, 10 * kMs, true);
+    CHECK_EQ(naive.bytes, 0u);
+
+    LoopResult r = RunReadLoop(dev, recovery, clock, 10 * kMs);
+    CHECK_EQ(r.bytes, sizeof(note));
+    CHECK_EQ(dev.StallClears(), 1u);
+    ReadRecoveryStats s = recovery.GetStats();
+    CHECK_EQ(s.stalls, 1u);
+    CHECK_EQ(s.stallClears, 1u);
+    CHECK_EQ(s.recoveries, 1u);
+    CHECK_EQ(s.reopens, 0u);
+    CHECK(recovery.GetState() == ReadRecoveryState::Healthy);
+}
+
+TEST(ReadRecoveryReopensBabblingEndpoint)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice dev(&clock);
+    ReadRecovery recovery;
+
+    dev.SetBabbling(true);   // Cured by a port reset
+    LoopResult r = RunReadLoop(dev, recovery, clock, 1000 * kMs);
+    CHECK_EQ(dev.PortResets(), 1u);
+    ReadRecoveryStats s = recovery.GetStats();
+    CHECK_EQ(s.transients, 9u);
+    CHECK_EQ(s.reopens, 1u);
+    CHECK_EQ(s.recoveries, 1u);
+    CHECK(recovery.GetState() == ReadRecoveryState::Healthy);
+    CHECK(r.logLines <= 3);
+}
+
+TEST(ReadRecoveryGivesUpOnHopelessEndpoint)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice dev(&clock), naiveDev(&clock);
+
+    naiveDev.SetBabbling(true, true);
+    ReadRecovery unused;
+    LoopResult naive = RunReadLoop(naiveDev, unused, clock, 1000 * kMs, true);
+
+    dev.SetBabbling(true, true);
+    ReadRecovery recovery;
+    uint64_t start = clock.NowNanos();
+    LoopResult r = RunReadLoop(dev, recovery, clock, 10000 * kMs);
+    double busyMs = (double)(clock.NowNanos() - start) / 1e6;
+
+    CHECK(recovery.GetState() == ReadRecoveryState::Failed);
+    ReadRecoveryStats s = recovery.GetStats();
+    CHECK_EQ(s.reopens, 3u);
+    CHECK_EQ(s.giveUps, 1u);
+    CHECK_EQ(dev.PortResets(), 3u);
+    CHECK_EQ(r.reads, 36u);   // 4 rounds of 9 failures
+    CHECK(r.logLines < 12);
+    CHECK(naive.reads > 7000);
+    printf("    babbling endpoint: old loop %llu reads / %llu log lines per second;"
+           " now %llu reads, %llu log lines, idle after %.0f ms\n",
+           (unsigned long long)naive.reads, (unsigned long long)naive.logLines,
+           (unsigned long long)r.reads, (unsigned long long)r.logLines, busyMs);
+}
+
+TEST(ReadRecoveryRetriesFailedReopen)
+{
+    ReadRecovery recovery;
+    uint64_t now = 1;
+
+    ReadRecoveryDecision d;
+    for (int i = 0; i < 9; i++)
+        d = recovery.OnResult(USBReadStatus::Transient, now);
+    REQUIRE(d.action == ReadRecoveryAction::Reopen);
+    recovery.OnReopened();
+
+    // The device doesn't open again: retry after 100 ms, then 200 ms ...
+    d = recovery.OnReopenFailed(now);
+    CHECK(d.action == ReadRecoveryAction::Reopen);
+    CHECK_EQ(d.delayNs, 100 * kMs);
+    CHECK(d.log);
+    CHECK(recovery.GetState() == ReadRecoveryState::Reopening);
+    recovery.OnReopened();
+    d = recovery.OnReopenFailed(now);
+    CHECK(d.action == ReadRecoveryAction::Reopen);
+    CHECK_EQ(d.delayNs, 200 * kMs);
+    recovery.OnReopened();
+
+    // ... and gives up once the reopens are used up
+    d = recovery.OnReopenFailed(now);
+    CHECK(d.action == ReadRecoveryAction::Stop);
+    CHECK(recovery.GetState() == ReadRecoveryState::Failed);
+    CHECK(recovery.OnReopenFailed(now).action == ReadRecoveryAction::Stop);
+    ReadRecoveryStats s = recovery.GetStats();
+    CHECK_EQ(s.reopens, 3u);
+    CHECK_EQ(s.giveUps, 1u);
+
+    // A retry that opens the device resumes normal recovery
+    recovery.Reset();
+    for (int i = 0; i < 9; i++)
+        recovery.OnResult(USBReadStatus::Transient, now);
+    recovery.OnReopened();
+    CHECK(recovery.OnReopenFailed(now).action == ReadRecoveryAction::Reopen);
+    recovery.OnReopened();
+    CHECK(recovery.OnResult(USBReadStatus::Success, now).action == ReadRecoveryAction::Resubmit);
+    CHECK(recovery.GetState() == ReadRecoveryState::Healthy);
+}
+
+TEST(ReadRecoveryRateLimitsIntermittentErrors)
+{
+    FakeHostClock clock;
+    ReadRecovery recovery;
+
+    // An error on every other read for two seconds
+    uint64_t logLines = 0, suppressed = 0;
+    for (int i = 0; i < 8000; i++) {
+        USBReadStatus status = (i & 1) ? USBReadStatus::Transient : USBReadStatus::Success;
+        ReadRecoveryDecision d = recovery.OnResult(status, clock.NowNanos());
+        CHECK(d.action == ReadRecoveryAction::Resubmit);
+        CHECK_EQ(d.delayNs, 0u);
+        if (d.log) {
+            logLines++;
+            suppressed += d.suppressedLogs;
+        }
+        clock.Advance(250000);
+    }
+    CHECK(logLines <= 3);
+    CHECK_EQ(recovery.GetStats().errors, 4000u);
+    CHECK(suppressed + recovery.GetStats().logsSuppressed >= 7000);
+}
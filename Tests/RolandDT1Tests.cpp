@@ -0,0 +1,185 @@
+#include "TestHarness.h"
+#include "EditorSession.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "RolandDT1.h"
+#include "SimulatedUSBDevice.h"
+#include <string.h>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> ShortMessages(const std::vector<uint8_t> &stream)
+{
+    std::vector<uint8_t> out;
+    bool inSysEx = false;
+    for (uint8_t b : stream) {
+        if (b == 0xF0) inSysEx = true;
+        if (!inSysEx) out.push_back(b);
+        if (b == 0xF7) inSysEx = false;
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(RolandDT1ParseAndChecksum)
+{
+    // GS reset
+    const uint8_t gsReset[] = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7 };
+    RolandDT1 dt1;
+    REQUIRE(ParseRolandDT1(gsReset, sizeof(gsReset), dt1));
+    CHECK_EQ(dt1.address, (0x40u << 14) | 0x7Fu);
+    CHECK_EQ(dt1.dataLength, 1u);
+    CHECK_EQ(dt1.data[0], 0x00);
+
+    uint8_t corrupt[sizeof(gsReset)];
+    memcpy(corrupt, gsReset, sizeof(gsReset));
+    corrupt[8] = 0x01;
+    CHECK(!ParseRolandDT1(corrupt, sizeof(corrupt), dt1));
+
+    // RQ1 and unknown models are not DT1 writes
+    const uint8_t rq1[] = { 0xF0, 0x41, 0x10, 0x00, 0x00, 0x64, 0x11, 0x19, 0x00, 0x00, 0x00,
+                            0x00, 0x00, 0x00, 0x10, 0x57, 0xF7 };
+    CHECK(!ParseRolandDT1(rq1, sizeof(rq1), dt1));
+    const uint8_t unknown[] = { 0xF0, 0x41, 0x10, 0x00, 0x7E, 0x12, 0x00, 0x00, 0x00, 0x00, 0x01, 0x7F, 0xF7 };
+    CHECK(!ParseRolandDT1(unknown, sizeof(unknown), dt1));
+
+    // Build round-trips, including the 4-byte JD-Xi model ID
+    const uint8_t jdxi[] = { 0xF0, 0x41, 0x10, 0x00, 0x00, 0x00, 0x0E };
+    RolandDT1 header;
+    header.format = FindRolandSysExFormat(jdxi, sizeof(jdxi));
+    REQUIRE(header.format != nullptr);
+    CHECK_EQ(header.format->modelIDLength, 4u);
+    header.deviceID = 0x10;
+    const uint8_t data[] = { 0x01, 0x02, 0x03 };
+    std::vector<uint8_t> built;
+    BuildRolandDT1(header, 0x18u << 21 | 0x7Fu, data, 3, built);
+    REQUIRE(ParseRolandDT1(built.data(), (uint32_t)built.size(), dt1));
+    CHECK_EQ(dt1.address, 0x18u << 21 | 0x7Fu);
+    CHECK_EQ(dt1.dataLength, 3u);
+}
+
+TEST(RolandDT1MergeRules)
+{
+    const uint32_t base = 0x19u << 21 | 0x20u << 14;
+    const uint8_t a[] = { 1, 2, 3 };
+    const uint8_t b[] = { 7, 8 };
+    std::vector<uint8_t> queued = MakeEditorDT1(base + 0x10, a, 3);
+    RolandDT1 incoming;
+
+    // Directly following: appended
+    std::vector<uint8_t> next = MakeEditorDT1(base + 0x13, b, 2);
+    REQUIRE(ParseRolandDT1(next.data(), (uint32_t)next.size(), incoming));
+    CHECK(MergeRolandDT1(queued, incoming, 128));
+    CHECK(queued == MakeEditorDT1(base + 0x10, std::vector<uint8_t>({ 1, 2, 3, 7, 8 }).data(), 5));
+
+    // Overlapping: newer bytes win
+    next = MakeEditorDT1(base + 0x11, b, 2);
+    REQUIRE(ParseRolandDT1(next.data(), (uint32_t)next.size(), incoming));
+    CHECK(MergeRolandDT1(queued, incoming, 128));
+    CHECK(queued == MakeEditorDT1(base + 0x10, std::vector<uint8_t>({ 1, 7, 8, 7, 8 }).data(), 5));
+
+    // A gap, an earlier address or another page is left alone
+    for (uint32_t address : { base + 0x16, base + 0x0F, base + 0x7F, base + 0x80 }) {
+        next = MakeEditorDT1(address, b, 2);
+        REQUIRE(ParseRolandDT1(next.data(), (uint32_t)next.size(), incoming));
+        CHECK(!MergeRolandDT1(queued, incoming, 128));
+    }
+
+    // Size limit
+    next = MakeEditorDT1(base + 0x15, b, 2);
+    REQUIRE(ParseRolandDT1(next.data(), (uint32_t)next.size(), incoming));
+    CHECK(!MergeRolandDT1(queued, incoming, 6));
+    CHECK(MergeRolandDT1(queued, incoming, 7));
+
+    // Another device ID
+    next[2] = 0x11;
+    REQUIRE(ParseRolandDT1(next.data(), (uint32_t)next.size(), incoming));
+    CHECK(!MergeRolandDT1(queued, incoming, 128));
+}
+
+TEST(TransmitterMergesDT1WithinWindow)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    MIDITransmitter tx(&device, &clock);
+    MIDITransmitterConfig config;
+    config.mergeDT1Cables = 1u << 0;
+    tx.SetConfig(config);
+
+    const uint32_t base = 0x19u << 21;
+    for (uint8_t i = 0; i < 4; i++) {
+        std::vector<uint8_t> dt1 = MakeEditorDT1(base + i, &i, 1);
+        tx.Enqueue(0, dt1.data(), (uint32_t)dt1.size());
+    }
+    CHECK_EQ(tx.GetStats().dt1Merged, 3u);
+
+    // Held for the window, then sent as one write
+    uint64_t due = tx.Pump();
+    CHECK_EQ(device.TransferCount(), 0u);
+    CHECK_EQ(due, clock.NowNanos() + kDefaultDT1MergeWindowNs);
+    clock.Set(due);
+    CHECK_EQ(tx.Pump(), 0u);
+    const uint8_t all[] = { 0, 1, 2, 3 };
+    CHECK(device.CableBytes(0) == MakeEditorDT1(base, all, 4));
+    device.Clear();
+
+    // Anything queued behind a DT1 releases it and ends the merge
+    uint8_t v = 5;
+    std::vector<uint8_t> first = MakeEditorDT1(base, &v, 1);
+    std::vector<uint8_t> second = MakeEditorDT1(base + 1, &v, 1);
+    const uint8_t note[] = { 0x90, 0x40, 0x40 };
+    tx.Enqueue(0, first.data(), (uint32_t)first.size());
+    tx.Enqueue(0, note, sizeof(note));
+    tx.Enqueue(0, second.data(), (uint32_t)second.size());
+    CHECK_EQ(tx.GetStats().dt1Merged, 3u);
+    tx.Pump();
+    std::vector<uint8_t> expected = first;
+    expected.insert(expected.end(), note, note + 3);
+    CHECK(device.CableBytes(0) == expected);
+    clock.Advance(kDefaultDT1MergeWindowNs);
+    tx.Pump();
+    expected.insert(expected.end(), second.begin(), second.end());
+    CHECK(device.CableBytes(0) == expected);
+
+    // Cables without the option are untouched
+    tx.Enqueue(1, first.data(), (uint32_t)first.size());
+    tx.Enqueue(1, second.data(), (uint32_t)second.size());
+    CHECK_EQ(tx.GetStats().dt1Merged, 3u);
+    CHECK_EQ(tx.PendingMessages(1), 2u);
+}
+
+TEST(TransmitterDT1MergeKeepsEditorState)
+{
+    EditorSessionOptions options;
+    options.knobDrags = 10;
+    options.toneRestores = 3;
+    options.auditionChance = 0.5;
+    auto session = MakeEditorSession(options);
+
+    std::vector<uint8_t> wire[2];
+    uint64_t transfers[2];
+    for (int merge = 0; merge < 2; merge++) {
+        FakeHostClock clock;
+        SimulatedUSBDevice device(&clock);
+        MIDITransmitter tx(&device, &clock);
+        MIDITransmitterConfig config;
+        config.mergeDT1Cables = merge ? 1u : 0u;
+        tx.SetConfig(config);
+        ReplayEditorSession(session, 0, tx, clock);
+        wire[merge] = device.CableBytes(0);
+        transfers[merge] = device.TransferCount();
+    }
+
+    uint32_t messages[2];
+    auto plain = ApplyEditorDT1s(wire[0], &messages[0]);
+    auto merged = ApplyEditorDT1s(wire[1], &messages[1]);
+    CHECK(plain == merged);
+    CHECK(ShortMessages(wire[0]) == ShortMessages(wire[1]));
+    CHECK(wire[1].size() * 2 < wire[0].size());
+    CHECK(transfers[1] * 2 < transfers[0]);
+    printf("    editor session: %u -> %u DT1, %zu -> %zu bytes, %llu -> %llu transfers\n",
+           messages[0], messages[1], wire[0].size(), wire[1].size(),
+           (unsigned long long)transfers[0], (unsigned long long)transfers[1]);
+}
@@ -0,0 +1,133 @@
+#include "TestHarness.h"
+#include "RolandDeviceTable.h"
+#include "MIDITransmitter.h"
+#include <string.h>
+
+TEST(DeviceTableEveryProfileValid)
+{
+    for (size_t i = 0; i < kNumSupportedDevices; i++) {
+        const RolandDeviceInfo &info = kSupportedDevices[i];
+        const char *reason = nullptr;
+        bool valid = RolandPerfProfileIsValid(info.profile, &reason);
+        if (!valid)
+            printf("    %s: invalid %s\n", info.name, reason ? reason : "?");
+        CHECK(valid);
+    }
+}
+
+TEST(DeviceTableEntriesConsistent)
+{
+    for (size_t i = 0; i < kNumSupportedDevices; i++) {
+        const RolandDeviceInfo &info = kSupportedDevices[i];
+        CHECK(info.numPorts >= 1 && info.numPorts <= kMaxPortsPerDevice);
+        const RolandDeviceInfo *found = FindRolandDevice(info.productID);
+        REQUIRE(found != nullptr);
+        CHECK(strcmp(found->name, info.name) == 0);   // product IDs are unique
+
+        uint32_t cablesSeen = 0;
+        for (uint8_t p = 0; p < info.numPorts; p++) {
+            const RolandPortInfo &port = info.ports[p];
+            CHECK(port.name != nullptr);
+            CHECK(port.cable < kUSBMIDINumCables);
+            CHECK((cablesSeen & (1u << port.cable)) == 0);
+            cablesSeen |= 1u << port.cable;
+            CHECK(port.dinBytesPerSecond == 0 || port.dinBytesPerSecond == kDINBytesPerSecond);
+        }
+    }
+    CHECK(FindRolandDevice(0xFFFF) == nullptr);
+}
+
+TEST(DeviceTableDefaultProfileMatchesTransmitter)
+{
+    // The full-speed profile is the tuning every device used before profiles existed.
+    CHECK_EQ(kProfileFullSpeed.sysExChunkSize, kDefaultSysExChunkSize);
+    CHECK_EQ((uint64_t)kProfileFullSpeed.sysExChunkGapUs * 1000, kDefaultSysExChunkGapNs);
+    CHECK_EQ(kProfileFullSpeed.maxTxTransferSize, kDefaultMaxTransferSize);
+}
+
+TEST(DeviceTableProfileOverrides)
+{
+    RolandPerfProfile profile = kProfileFullSpeed;
+
+    CHECK(RolandPerfProfileSetValue(profile, "SysExChunkGapUs", 5000));
+    CHECK_EQ(profile.sysExChunkGapUs, 5000u);
+    CHECK(RolandPerfProfileSetValue(profile, "MinSysExChunkGapUs", 0));   // fixed pacing
+    CHECK_EQ(profile.minSysExChunkGapUs, 0u);
+    CHECK(RolandPerfProfileSetValue(profile, "ReadQueueDepth", 4));
+    CHECK_EQ(profile.readQueueDepth, 4);
+    CHECK(RolandPerfProfileSetValue(profile, "ReadBufferSize", 512));
+    CHECK_EQ(profile.readBufferSize, 512);
+    CHECK(RolandPerfProfileSetValue(profile, "WriteQueueDepth", 4));
+    CHECK_EQ(profile.writeQueueDepth, 4);
+    CHECK(RolandPerfProfileSetValue(profile, "LazyOpen", 1));
+    CHECK(RolandPerfProfileSetValue(profile, "IdleCloseS", 60));
+    CHECK_EQ(profile.idleCloseS, 60u);
+
+    // Rejected values leave the profile untouched
+    const RolandPerfProfile before = profile;
+    CHECK(!RolandPerfProfileSetValue(profile, "SysExChunkSize", 4096));   // does not fit a transfer
+    CHECK(!RolandPerfProfileSetValue(profile, "SysExChunkSize", 0));
+    CHECK(!RolandPerfProfileSetValue(profile, "ReadQueueDepth", 0));
+    CHECK(!RolandPerfProfileSetValue(profile, "ReadQueueDepth", 300));
+    CHECK(!RolandPerfProfileSetValue(profile, "ReadBufferSize", 100));     // not a packet multiple
+    CHECK(!RolandPerfProfileSetValue(profile, "WriteQueueDepth", 0));
+    CHECK(!RolandPerfProfileSetValue(profile, "WriteQueueDepth", kMaxWriteQueueDepth + 1));
+    CHECK(!RolandPerfProfileSetValue(profile, "LazyOpen", 2));
+    CHECK(!RolandPerfProfileSetValue(profile, "IdleCloseS", kMaxIdleCloseS + 1));
+    CHECK(!RolandPerfProfileSetValue(profile, "MaxTxTransferSize", 64));   // smaller than a chunk
+    CHECK(!RolandPerfProfileSetValue(profile, "SysExChunkGapUs", -1));
+    CHECK(!RolandPerfProfileSetValue(profile, "MinSysExChunkGapUs", 600000));
+    CHECK(!RolandPerfProfileSetValue(profile, "Bogus", 1));
+    CHECK(!RolandPerfProfileSetValue(profile, nullptr, 1));
+    CHECK_EQ(profile.sysExChunkSize, before.sysExChunkSize);
+    CHECK_EQ(profile.sysExChunkGapUs, before.sysExChunkGapUs);
+    CHECK_EQ(profile.minSysExChunkGapUs, before.minSysExChunkGapUs);
+    CHECK_EQ(profile.readQueueDepth, before.readQueueDepth);
+    CHECK_EQ(profile.readBufferSize, before.readBufferSize);
+    CHECK_EQ(profile.maxTxTransferSize, before.maxTxTransferSize);
+
+    // Growing the transfer first makes room for a bigger chunk
+    CHECK(RolandPerfProfileSetValue(profile, "MaxTxTransferSize", 2048));
+    CHECK(RolandPerfProfileSetValue(profile, "SysExChunkSize", 1024));
+
+    // I/O thread policy: computation <= constraint <= period, 0 = normal priority
+    CHECK(RolandPerfProfileSetValue(profile, "IOThreadComputationUs", 0));
+    CHECK(RolandPerfProfileSetValue(profile, "IOThreadPeriodUs", 2000));
+    CHECK(RolandPerfProfileSetValue(profile, "IOThreadConstraintUs", 2000));
+    CHECK(RolandPerfProfileSetValue(profile, "IOThreadComputationUs", 800));
+    CHECK(!RolandPerfProfileSetValue(profile, "IOThreadComputationUs", 3000));
+    CHECK(!RolandPerfProfileSetValue(profile, "IOThreadConstraintUs", 4000));   // beyond the period
+    CHECK(!RolandPerfProfileSetValue(profile, "IOThreadConstraintUs", 500));    // below the computation
+    CHECK(RolandPerfProfileSetValue(profile, "IOThreadPeriodUs", 0));           // aperiodic
+    CHECK(!RolandPerfProfileSetValue(profile, "IOThreadConstraintUs", kMaxIOConstraintUs + 1));
+    CHECK_EQ(profile.ioComputationUs, 800u);
+    CHECK_EQ(profile.ioConstraintUs, 2000u);
+}
+
+TEST(DeviceTableCombinedProfileOverrides)
+{
+    // One at a time, the bigger chunk is rejected before the transfer grows ...
+    RolandPerfProfile profile = kProfileFullSpeed;
+    CHECK(!RolandPerfProfileSetValue(profile, "SysExChunkSize", 1024));
+
+    // ... but assigned together the combined profile is valid
+    CHECK(RolandPerfProfileAssignValue(profile, "SysExChunkSize", 1024));
+    CHECK(RolandPerfProfileAssignValue(profile, "MaxTxTransferSize", 2048));
+    CHECK(RolandPerfProfileIsValid(profile));
+    CHECK_EQ(profile.sysExChunkSize, 1024);
+    CHECK_EQ(profile.maxTxTransferSize, 2048);
+
+    // A combination that is still inconsistent is reported as a whole
+    RolandPerfProfile bad = kProfileFullSpeed;
+    CHECK(RolandPerfProfileAssignValue(bad, "SysExChunkSize", 1024));
+    CHECK(RolandPerfProfileAssignValue(bad, "ReadQueueDepth", 2));
+    const char *reason = nullptr;
+    CHECK(!RolandPerfProfileIsValid(bad, &reason));
+    CHECK(reason && strcmp(reason, "SysExChunkSize") == 0);
+
+    // Unknown keys and values that don't fit the field are refused outright
+    CHECK(!RolandPerfProfileAssignValue(bad, "Bogus", 1));
+    CHECK(!RolandPerfProfileAssignValue(bad, "ReadQueueDepth", 300));
+    CHECK(!RolandPerfProfileAssignValue(bad, "SysExChunkGapUs", -1));
+    CHECK_EQ(bad.readQueueDepth, 2);
+}
@@ -0,0 +1,191 @@
+#include "TestHarness.h"
+#include "EditorSession.h"
+#include "FakeHostClock.h"
+#include "RolandParameterMirror.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const uint32_t kToneBase = 0x19u << 21 | 0x20u << 14;   // 19 20 00 00
+
+std::vector<uint8_t> MakeRQ1(uint32_t address, uint32_t size, uint8_t deviceID = kEditorSessionDeviceID)
+{
+    std::vector<uint8_t> msg = { 0xF0, kRolandManufacturerID, deviceID,
+                                 kEditorSessionModel[0], kEditorSessionModel[1], kEditorSessionModel[2],
+                                 kRolandCommandRQ1 };
+    uint8_t field[8];
+    RolandEncodeAddress(address, 4, field);
+    RolandEncodeAddress(size, 4, field + 4);
+    msg.insert(msg.end(), field, field + 8);
+    msg.push_back(RolandChecksum(field, 8));
+    msg.push_back(0xF7);
+    return msg;
+}
+
+// Deliver a message the way the read path does: one USB-MIDI packet's
+// worth (up to 3 bytes) at a time
+void Receive(RolandParameterMirror &mirror, const std::vector<uint8_t> &msg)
+{
+    for (size_t i = 0; i < msg.size(); i += 3)
+        mirror.ObserveInbound(0, msg.data() + i, (uint32_t)std::min<size_t>(3, msg.size() - i));
+}
+
+std::vector<uint8_t> Bytes(uint32_t count, uint8_t first)
+{
+    std::vector<uint8_t> v(count);
+    for (uint32_t i = 0; i < count; i++) v[i] = (uint8_t)((first + i) & 0x7F);
+    return v;
+}
+
+} // namespace
+
+TEST(MirrorAnswersFullyCachedRQ1)
+{
+    FakeHostClock clock;
+    RolandParameterMirror mirror(&clock);
+
+    // A 200-byte reply spanning two pages, as sent by the device
+    std::vector<uint8_t> data = Bytes(200, 0);
+    Receive(mirror, MakeEditorDT1(kToneBase, data.data(), 128));
+    Receive(mirror, MakeEditorDT1(kToneBase + 128, data.data() + 128, 72));
+
+    std::vector<uint8_t> rq1 = MakeRQ1(kToneBase + 0x70, 0x20);
+    std::vector<uint8_t> reply;
+    REQUIRE(mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply));
+
+    // Split at the page boundary like the device's own reply
+    std::vector<uint8_t> expected = MakeEditorDT1(kToneBase + 0x70, data.data() + 0x70, 0x10);
+    std::vector<uint8_t> second = MakeEditorDT1(kToneBase + 0x80, data.data() + 0x80, 0x10);
+    expected.insert(expected.end(), second.begin(), second.end());
+    CHECK(reply == expected);
+
+    // Any byte missing: the request goes to the device
+    reply.clear();
+    rq1 = MakeRQ1(kToneBase + 0xB0, 0x20);
+    CHECK(!mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply));
+    CHECK(reply.empty());
+    rq1 = MakeRQ1(kToneBase, 4, 0x11);
+    CHECK(!mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply));
+    rq1 = MakeRQ1(kToneBase, 4, 0x7F);
+    CHECK(!mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply));
+
+    RolandParameterMirrorStats s = mirror.GetStats();
+    CHECK_EQ(s.hits, 1u);
+    CHECK_EQ(s.misses, 3u);
+    CHECK_EQ(s.answeredBytes, 0x20u);
+    CHECK_EQ(s.pages, 2u);
+}
+
+TEST(MirrorFollowsEditsInBothDirections)
+{
+    FakeHostClock clock;
+    RolandParameterMirror mirror(&clock);
+    std::vector<uint8_t> data = Bytes(16, 0x10);
+    Receive(mirror, MakeEditorDT1(kToneBase, data.data(), 16));
+
+    // A write from the editor, split over two MIDIPackets
+    uint8_t v = 0x55;
+    std::vector<uint8_t> write = MakeEditorDT1(kToneBase + 3, &v, 1);
+    mirror.ObserveOutbound(0, write.data(), 5);
+    mirror.ObserveOutbound(0, write.data() + 5, (uint32_t)write.size() - 5);
+
+    // A front-panel edit the device transmits
+    uint8_t w = 0x22;
+    Receive(mirror, MakeEditorDT1(kToneBase + 7, &w, 1));
+
+    data[3] = v;
+    data[7] = w;
+    std::vector<uint8_t> rq1 = MakeRQ1(kToneBase, 16), reply;
+    REQUIRE(mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply));
+    CHECK(reply == MakeEditorDT1(kToneBase, data.data(), 16));
+
+    // A corrupted DT1 from the device is an update we missed
+    std::vector<uint8_t> corrupt = MakeEditorDT1(kToneBase + 2, &w, 1);
+    corrupt[corrupt.size() - 2] ^= 1;
+    Receive(mirror, corrupt);
+    reply.clear();
+    CHECK(!mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply));
+    CHECK_EQ(mirror.GetStats().invalidations, 1u);
+}
+
+TEST(MirrorInvalidatesOnPatchChangesAndSetupWrites)
+{
+    FakeHostClock clock;
+    RolandParameterMirror mirror(&clock);
+    std::vector<uint8_t> data = Bytes(8, 0);
+    std::vector<uint8_t> rq1 = MakeRQ1(kToneBase, 8), reply;
+    auto cached = [&] {
+        reply.clear();
+        return mirror.AnswerRQ1(rq1.data(), (uint32_t)rq1.size(), reply);
+    };
+
+    // Program change from the front panel
+    Receive(mirror, MakeEditorDT1(kToneBase, data.data(), 8));
+    REQUIRE(cached());
+    const uint8_t programChange[] = { 0xC0, 0x05 };
+    mirror.ObserveInbound(0, programChange, 2);
+    CHECK(!cached());
+
+    // Bank select sent by a client
+    Receive(mirror, MakeEditorDT1(kToneBase, data.data(), 8));
+    const uint8_t volume[] = { 0xB0, 0x07, 0x64 }, bank[] = { 0xB0, 0x00, 0x57 };
+    mirror.ObserveOutbound(0, volume, 3);
+    CHECK(cached());
+    mirror.ObserveOutbound(0, bank, 3);
+    CHECK(!cached());
+
+    // A write to the studio set area (18 ..) may load new tones (19 ..);
+    // writes under the same top address byte keep them
+    Receive(mirror, MakeEditorDT1(kToneBase, data.data(), 8));
+    uint8_t v = 3;
+    std::vector<uint8_t> sameArea = MakeEditorDT1(kToneBase + 0x4000, &v, 1);
+    mirror.ObserveOutbound(0, sameArea.data(), (uint32_t)sameArea.size());
+    CHECK(cached());
+    std::vector<uint8_t> setup = MakeEditorDT1(0x18u << 21 | 4, &v, 1);
+    mirror.ObserveOutbound(0, setup.data(), (uint32_t)setup.size());
+    CHECK(!cached());
+    CHECK_EQ(mirror.GetStats().pages, 1u);   // The write itself
+
+    // Untransmitted edits: pages expire
+    RolandParameterMirrorConfig config;
+    config.maxAgeNs = 1000000000;
+    mirror.SetConfig(config);
+    Receive(mirror, MakeEditorDT1(kToneBase, data.data(), 8));
+    clock.Advance(config.maxAgeNs - 1);
+    CHECK(cached());
+    clock.Advance(1);
+    CHECK(!cached());
+    CHECK_EQ(mirror.GetStats().expired, 1u);
+}
+
+TEST(MirrorStaysWithinMemoryCap)
+{
+    FakeHostClock clock;
+    RolandParameterMirror mirror(&clock);
+    RolandParameterMirrorConfig config;
+    config.maxBytes = 16 * 1024;
+    mirror.SetConfig(config);
+
+    // Fill 4x the cap, page by page, re-reading page 0 as editors poll
+    std::vector<uint8_t> data = Bytes(128, 1);
+    std::vector<uint8_t> poll = MakeRQ1(kToneBase, 128), reply;
+    uint32_t pagesWritten = 0;
+    while (pagesWritten * 128 < 4 * config.maxBytes) {
+        Receive(mirror, MakeEditorDT1(kToneBase + pagesWritten * 128, data.data(), 128));
+        pagesWritten++;
+        CHECK(mirror.AnswerRQ1(poll.data(), (uint32_t)poll.size(), reply));
+        CHECK(mirror.CachedBytes() <= config.maxBytes);
+    }
+
+    RolandParameterMirrorStats s = mirror.GetStats();
+    CHECK(s.evictions > 0);
+    CHECK_EQ(s.pages + s.evictions, pagesWritten);
+    CHECK_EQ(s.hits, pagesWritten);   // The polled page is never the one evicted
+
+    // The oldest unpolled pages went first
+    std::vector<uint8_t> old = MakeRQ1(kToneBase + 128, 128);
+    CHECK(!mirror.AnswerRQ1(old.data(), (uint32_t)old.size(), reply));
+    std::vector<uint8_t> recent = MakeRQ1(kToneBase + (pagesWritten - 1) * 128, 128);
+    CHECK(mirror.AnswerRQ1(recent.data(), (uint32_t)recent.size(), reply));
+}
@@ -0,0 +1,127 @@
+#include "TestHarness.h"
+#include "FakeHostClock.h"
+#include "MIDITransmitter.h"
+#include "SimulatedUSBDevice.h"
+#include "SysExPacer.h"
+#include <vector>
+
+namespace {
+
+struct PacingRun {
+    uint64_t elapsedNs;
+    uint64_t stallNs;
+    uint64_t gapNs;
+    bool     intact;
+};
+
+// Send a bulk dump through a transmitter into a device that drains its
+// receive buffer at a fixed rate, advancing a fake clock as the pump asks.
+PacingRun RunDump(uint32_t capacity, uint32_t drainRate, uint64_t minGapNs, uint32_t dumpBytes)
+{
+    FakeHostClock clock;
+    SimulatedUSBDevice device(&clock);
+    device.SetReceiveBuffer(capacity, drainRate, &clock);
+    MIDITransmitter tx(&device, &clock);
+
+    MIDITransmitterConfig config;
+    config.minSysExChunkGapNs = minGapNs;
+    tx.SetConfig(config);
+
+    // Bulk dump made of 4 KB messages, each paced in chunks
+    std::vector<uint8_t> dump;
+    while (dump.size() < dumpBytes) {
+        dump.push_back(0xF0);
+        dump.insert(dump.end(), 4094, 0x55);
+        dump.push_back(0xF7);
+    }
+
+    uint64_t start = clock.NowNanos();
+    CHECK(tx.Enqueue(0, dump.data(), (uint32_t)dump.size()));
+    while (tx.PendingMessages(-1) > 0) {
+        uint64_t due = tx.Pump();
+        if (due > clock.NowNanos()) clock.Set(due);
+    }
+
+    PacingRun run;
+    run.elapsedNs = clock.NowNanos() - start;
+    run.stallNs = device.StallNanos();
+    run.gapNs = tx.SysExGapNs();
+    run.intact = device.CableBytes(0) == dump;
+    return run;
+}
+
+} // namespace
+
+TEST(PacerShrinksWhileWritesStayFast)
+{
+    SysExPacer pacer(20000000);
+    for (int i = 0; i < 200; i++)
+        pacer.OnChunkCompleted(125000, false);
+    CHECK_EQ(pacer.GapNs(), SysExPacerConfig().minGapNs);
+    CHECK_EQ(pacer.GetStats().stalls, 0u);
+    CHECK_EQ(pacer.GetStats().baselineNs, 125000u);
+}
+
+TEST(PacerBacksOffOnStallAndFailure)
+{
+    SysExPacer pacer(10000000);
+    pacer.OnChunkCompleted(125000, false);
+    uint64_t before = pacer.GapNs();
+    pacer.OnChunkCompleted(30000000, false);   // NAKed for 30 ms
+    CHECK_EQ(pacer.GapNs(), before * 2);
+
+    // Holds for a couple of clean chunks before shrinking again
+    pacer.OnChunkCompleted(125000, false);
+    pacer.OnChunkCompleted(125000, false);
+    CHECK_EQ(pacer.GapNs(), before * 2);
+    pacer.OnChunkCompleted(125000, false);
+    CHECK(pacer.GapNs() < before * 2);
+
+    pacer.OnChunkCompleted(125000, true);
+    CHECK_EQ(pacer.GetStats().stalls, 2u);
+
+    for (int i = 0; i < 100; i++)
+        pacer.OnChunkCompleted(900000000, false);
+    CHECK_EQ(pacer.GapNs(), kMaxSysExPacingGapNs);
+}
+
+TEST(PacerResetClampsToBounds)
+{
+    SysExPacerConfig config;
+    config.minGapNs = 5000000;
+    SysExPacer pacer(1000, config);
+    CHECK_EQ(pacer.GapNs(), 5000000u);
+    pacer.Reset(kMaxSysExPacingGapNs * 4);
+    CHECK_EQ(pacer.GapNs(), kMaxSysExPacingGapNs);
+}
+
+TEST(AdaptivePacingFastDeviceBeatsFixedGap)
+{
+    // High-speed synth: large buffer, drains ~200 KB/s
+    PacingRun fixed = RunDump(4096, 200000, 0, 32768);
+    PacingRun adaptive = RunDump(4096, 200000, 1000000, 32768);
+    printf("    fast device: fixed %.0f ms, adaptive %.0f ms (gap %.1f ms)\n",
+           fixed.elapsedNs / 1e6, adaptive.elapsedNs / 1e6, adaptive.gapNs / 1e6);
+    CHECK(fixed.intact);
+    CHECK(adaptive.intact);
+    CHECK(adaptive.elapsedNs * 5 < fixed.elapsedNs);
+}
+
+TEST(AdaptivePacingSlowDeviceAvoidsStalls)
+{
+    // Sound Canvas-class module: small buffer, drains at DIN speed
+    PacingRun fixed = RunDump(512, 3125, 0, 16384);
+    PacingRun adaptive = RunDump(512, 3125, 1000000, 16384);
+    printf("    slow device: fixed %.0f ms (stalled %.0f), adaptive %.0f ms (stalled %.0f, gap %.1f ms)\n",
+           fixed.elapsedNs / 1e6, fixed.stallNs / 1e6,
+           adaptive.elapsedNs / 1e6, adaptive.stallNs / 1e6, adaptive.gapNs / 1e6);
+    CHECK(fixed.intact);
+    CHECK(adaptive.intact);
+
+    // The fixed 20 ms gap keeps the pipe NAKed most of the time; the learned
+    // gap spends far less time blocked and does not lose throughput doing so.
+    CHECK(adaptive.stallNs * 4 < fixed.stallNs);
+    CHECK(adaptive.elapsedNs < fixed.elapsedNs * 3 / 2);
+    // Settles near the time one 256-byte chunk takes to drain (82 ms)
+    CHECK(adaptive.gapNs > 40000000u);
+}
@@ -0,0 +1,45 @@
+#ifndef TestHarness_h
+#define TestHarness_h
+
+// Minimal self-registering test harness for the portable driver core.
+// Built with the host compiler by `make test`; no external dependencies.
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef void (*TestFunction)();
+
+struct TestRegistrar {
+    TestRegistrar(const char *name, TestFunction fn);
+};
+
+/// Records a failed check for the currently running test.
+void TestFail(const char *file, int line, const char *expr);
+
+/// Heap blocks currently allocated through operator new (leak and growth checks).
+int64_t TestLiveAllocations();
+/// Calls to operator new so far (steady-state allocation checks).
+uint64_t TestAllocationCount();
+
+#define TEST(name)                                              \
+    static void name();                                         \
+    static TestRegistrar name##_registrar(#name, name);         \
+    static void name()
+
+#define CHECK(expr)                                             \
+    do {                                                        \
+        if (!(expr)) TestFail(__FILE__, __LINE__, #expr);       \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                          \
+    do {                                                        \
+        if (!((a) == (b))) TestFail(__FILE__, __LINE__, #a " == " #b); \
+    } while (0)
+
+// Aborts the current test on failure (for preconditions that later checks rely on).
+#define REQUIRE(expr)                                           \
+    do {                                                        \
+        if (!(expr)) { TestFail(__FILE__, __LINE__, #expr); return; } \
+    } while (0)
+
+#endif /* TestHarness_h */
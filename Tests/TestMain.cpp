@@ -0,0 +1,94 @@
+#include "TestHarness.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------- Allocation counting ----------
+
+static std::atomic<int64_t> sLiveAllocations{0};
+static std::atomic<uint64_t> sAllocations{0};
+
+void *operator new(size_t size)
+{
+    if (void *p = malloc(size ? size : 1)) {
+        sLiveAllocations.fetch_add(1, std::memory_order_relaxed);
+        sAllocations.fetch_add(1, std::memory_order_relaxed);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+static void Release(void *p)
+{
+    if (!p) return;
+    sLiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    free(p);
+}
+
+void operator delete(void *p) noexcept { Release(p); }
+void operator delete[](void *p) noexcept { Release(p); }
+void operator delete(void *p, size_t) noexcept { Release(p); }
+void operator delete[](void *p, size_t) noexcept { Release(p); }
+
+int64_t TestLiveAllocations()
+{
+    return sLiveAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t TestAllocationCount()
+{
+    return sAllocations.load(std::memory_order_relaxed);
+}
+
+// ---------- Registry ----------
+
+struct TestEntry {
+    const char  *name;
+    TestFunction fn;
+};
+
+static constexpr int kMaxTests = 1024;
+static TestEntry sTests[kMaxTests];
+static int sNumTests = 0;
+static int sCurrentFailures = 0;
+
+TestRegistrar::TestRegistrar(const char *name, TestFunction fn)
+{
+    if (sNumTests < kMaxTests)
+        sTests[sNumTests++] = { name, fn };
+}
+
+void TestFail(const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "    %s:%d: CHECK failed: %s\n", file, line, expr);
+    sCurrentFailures++;
+}
+
+int main(int argc, char **argv)
+{
+    // Optional argument: only run tests whose name contains this substring.
+    const char *filter = (argc > 1) ? argv[1] : nullptr;
+
+    int run = 0, failed = 0;
+    for (int t = 0; t < sNumTests; t++) {
+        if (filter && !strstr(sTests[t].name, filter)) continue;
+        sCurrentFailures = 0;
+        sTests[t].fn();
+        run++;
+        if (sCurrentFailures) {
+            failed++;
+            fprintf(stderr, "FAIL %s\n", sTests[t].name);
+        } else {
+            printf("ok   %s\n", sTests[t].name);
+        }
+    }
+
+    printf("%d test(s), %d failed\n", run, failed);
+    return failed ? 1 : 0;
+}
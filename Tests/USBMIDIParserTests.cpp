@@ -0,0 +1,225 @@
+#include "TestHarness.h"
+#include "USBMIDIParser.h"
+#include <string.h>
+#include <vector>
+
+namespace {
+
+struct ParsedEvent {
+    uint8_t cable;
+    std::vector<uint8_t> bytes;
+};
+
+void CollectEvent(uint8_t cable, const uint8_t *midiBytes, uint8_t byteCount, void *context)
+{
+    auto *events = static_cast<std::vector<ParsedEvent> *>(context);
+    events->push_back({ cable, std::vector<uint8_t>(midiBytes, midiBytes + byteCount) });
+}
+
+} // namespace
+
+TEST(ParserCinByteCounts)
+{
+    CHECK_EQ(USBMIDICinToMIDIByteCount(kCIN_Misc), 0);
+    CHECK_EQ(USBMIDICinToMIDIByteCount(kCIN_NoteOn), 3);
+    CHECK_EQ(USBMIDICinToMIDIByteCount(kCIN_ProgramChange), 2);
+    CHECK_EQ(USBMIDICinToMIDIByteCount(kCIN_SysExEnd1Byte), 1);
+    CHECK_EQ(USBMIDICinToMIDIByteCount(kCIN_SingleByte), 1);
+}
+
+TEST(ParserStatusToCin)
+{
+    CHECK_EQ(MIDIStatusToCin(0x90), kCIN_NoteOn);
+    CHECK_EQ(MIDIStatusToCin(0xB5), kCIN_ControlChange);
+    CHECK_EQ(MIDIStatusToCin(0xF0), kCIN_SysExStart);
+    CHECK_EQ(MIDIStatusToCin(0xF8), kCIN_SingleByte);
+    CHECK_EQ(MIDIStatusToCin(0x40), kCIN_Misc);
+}
+
+TEST(ParserBulkInRoutesByCable)
+{
+    const uint8_t data[] = {
+        0x09, 0x90, 0x3C, 0x64,   // cable 0 note on
+        0x5C, 0xC3, 0x05, 0x00,   // cable 5 program change
+        0x00, 0x00, 0x00, 0x00,   // padding (CIN 0)
+        0x1F, 0xF8, 0x00, 0x00,   // cable 1 clock
+    };
+    std::vector<ParsedEvent> events;
+    USBMIDIParseBulkIn(data, sizeof(data), CollectEvent, &events);
+
+    REQUIRE(events.size() == 3);
+    CHECK_EQ(events[0].cable, 0);
+    CHECK(events[0].bytes == std::vector<uint8_t>({ 0x90, 0x3C, 0x64 }));
+    CHECK_EQ(events[1].cable, 5);
+    CHECK(events[1].bytes == std::vector<uint8_t>({ 0xC3, 0x05 }));
+    CHECK_EQ(events[2].cable, 1);
+    CHECK(events[2].bytes == std::vector<uint8_t>({ 0xF8 }));
+}
+
+TEST(ParserBulkInIgnoresTrailingPartialPacket)
+{
+    const uint8_t data[] = { 0x09, 0x90, 0x3C, 0x64, 0x09, 0x90 };
+    std::vector<ParsedEvent> events;
+    USBMIDIParseBulkIn(data, sizeof(data), CollectEvent, &events);
+    CHECK_EQ(events.size(), 1u);
+}
+
+TEST(BuildBulkOutChannelMessages)
+{
+    const uint8_t midi[] = { 0x90, 0x3C, 0x64, 0xC0, 0x07, 0xF8 };
+    uint8_t out[64];
+    uint32_t n = USBMIDIBuildBulkOut(midi, sizeof(midi), 2, out, sizeof(out));
+
+    REQUIRE(n == 12);
+    const uint8_t expected[] = {
+        0x29, 0x90, 0x3C, 0x64,
+        0x2C, 0xC0, 0x07, 0x00,
+        0x2F, 0xF8, 0x00, 0x00,
+    };
+    CHECK(memcmp(out, expected, sizeof(expected)) == 0);
+}
+
+TEST(BuildBulkOutShortSysEx)
+{
+    const uint8_t midi[] = { 0xF0, 0x41, 0x10, 0x42, 0xF7 };
+    uint8_t out[64];
+    uint32_t n = USBMIDIBuildBulkOut(midi, sizeof(midi), 0, out, sizeof(out));
+
+    REQUIRE(n == 8);
+    const uint8_t expected[] = {
+        0x04, 0xF0, 0x41, 0x10,
+        0x06, 0x42, 0xF7, 0x00,
+    };
+    CHECK(memcmp(out, expected, sizeof(expected)) == 0);
+}
+
+TEST(BuildBulkOutStopsWhenBufferFull)
+{
+    const uint8_t midi[] = { 0x90, 0x3C, 0x64, 0x80, 0x3C, 0x00 };
+    uint8_t out[4];
+    CHECK_EQ(USBMIDIBuildBulkOut(midi, sizeof(midi), 0, out, sizeof(out)), 4u);
+}
+
+TEST(SysExChunkRoundTrip)
+{
+    // 1000-byte SysEx split into 256-byte chunks must reassemble exactly.
+    std::vector<uint8_t> sysex(1000);
+    sysex[0] = 0xF0;
+    for (size_t i = 1; i + 1 < sysex.size(); i++) sysex[i] = (uint8_t)(i & 0x7F);
+    sysex.back() = 0xF7;
+
+    std::vector<uint8_t> reassembled;
+    uint32_t offset = 0;
+    int chunks = 0;
+    bool end = false;
+    while (offset < sysex.size()) {
+        uint8_t usb[512];
+        uint32_t n = USBMIDIBuildSysExChunk(sysex.data(), (uint32_t)sysex.size(), &offset,
+                                            3, 256, usb, sizeof(usb), &end);
+        REQUIRE(n > 0 && n % 4 == 0);
+        chunks++;
+        std::vector<ParsedEvent> events;
+        USBMIDIParseBulkIn(usb, n, CollectEvent, &events);
+        for (auto &e : events) {
+            CHECK_EQ(e.cable, 3);
+            reassembled.insert(reassembled.end(), e.bytes.begin(), e.bytes.end());
+        }
+    }
+
+    CHECK(end);
+    CHECK_EQ(chunks, 4);
+    CHECK(reassembled == sysex);
+}
+
+TEST(SysExChunkRespectsOutBufferSize)
+{
+    std::vector<uint8_t> sysex(600, 0x11);
+    sysex[0] = 0xF0;
+    sysex.back() = 0xF7;
+
+    uint8_t usb[64];
+    uint32_t offset = 0;
+    bool end = true;
+    uint32_t n = USBMIDIBuildSysExChunk(sysex.data(), (uint32_t)sysex.size(), &offset,
+                                        0, 256, usb, sizeof(usb), &end);
+    CHECK_EQ(n, 64u);
+    CHECK_EQ(offset, 48u);
+    CHECK(!end);
+}
+
+TEST(StatusClassFromPacket)
+{
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_NoteOn, 0x91), (uint32_t)kMIDIClass_NoteOn);
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_SysExStart, 0x12), (uint32_t)kMIDIClass_SysEx);
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_SysExEnd1Byte, 0xF7), (uint32_t)kMIDIClass_SysEx);
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_SysExEnd1Byte, 0xF6), (uint32_t)kMIDIClass_TuneRequest);
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_SingleByte, 0xFE), (uint32_t)kMIDIClass_ActiveSensing);
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_SystemCommon2Byte, 0xF1), (uint32_t)kMIDIClass_TimeCode);
+    CHECK_EQ(USBMIDIPacketStatusClass(kCIN_SingleByte, 0x42), (uint32_t)kMIDIClass_None);
+}
+
+TEST(FilterDropsActiveSensingPerCable)
+{
+    const uint8_t data[] = {
+        0x0F, 0xFE, 0x00, 0x00,   // cable 0 active sensing (dropped)
+        0x1F, 0xFE, 0x00, 0x00,   // cable 1 active sensing (kept, no filter)
+        0x09, 0x90, 0x3C, 0x64,   // cable 0 note on (kept)
+    };
+    USBMIDIInputFilter filters[kUSBMIDINumCables];
+    filters[0].dropMask = kMIDIClass_ActiveSensing;
+
+    std::vector<ParsedEvent> events;
+    USBMIDIParseBulkInFiltered(data, sizeof(data), filters, CollectEvent, &events);
+
+    REQUIRE(events.size() == 2);
+    CHECK_EQ(events[0].cable, 1);
+    CHECK_EQ(events[1].bytes[0], 0x90);
+    CHECK_EQ(filters[0].filteredEvents, 1u);
+    CHECK_EQ(filters[0].filteredActiveSensing, 1u);
+    CHECK_EQ(filters[1].filteredEvents, 0u);
+}
+
+TEST(FilterThinsClockAlignedToStart)
+{
+    USBMIDIInputFilter filters[kUSBMIDINumCables];
+    filters[0].clockDivisor = 4;
+    filters[0].clockPhase = 3;   // mid-beat before Start arrives
+
+    std::vector<uint8_t> data = { 0x0F, 0xFA, 0x00, 0x00 };  // Start
+    for (int i = 0; i < 12; i++)
+        data.insert(data.end(), { 0x0F, 0xF8, 0x00, 0x00 });
+
+    std::vector<ParsedEvent> events;
+    USBMIDIParseBulkInFiltered(data.data(), (uint32_t)data.size(), filters, CollectEvent, &events);
+
+    // Start + clocks 0, 4, 8
+    CHECK_EQ(events.size(), 4u);
+    CHECK_EQ(filters[0].filteredClock, 9u);
+    CHECK_EQ(filters[0].filteredEvents, 9u);
+}
+
+TEST(FilterDropsSysExContinuations)
+{
+    const uint8_t sysex[] = { 0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7 };
+    uint8_t usb[64];
+    uint32_t n = USBMIDIBuildBulkOut(sysex, sizeof(sysex), 0, usb, sizeof(usb));
+    usb[n + 0] = 0x0B; usb[n + 1] = 0xB0; usb[n + 2] = 0x07; usb[n + 3] = 0x64;
+
+    USBMIDIInputFilter filters[kUSBMIDINumCables];
+    filters[0].dropMask = kMIDIClass_SysEx;
+
+    std::vector<ParsedEvent> events;
+    USBMIDIParseBulkInFiltered(usb, n + 4, filters, CollectEvent, &events);
+
+    REQUIRE(events.size() == 1);
+    CHECK_EQ(events[0].bytes[0], 0xB0);
+    CHECK_EQ(filters[0].filteredEvents, 4u);
+}
+
+TEST(FilterNullPassesEverything)
+{
+    const uint8_t data[] = { 0x0F, 0xFE, 0x00, 0x00, 0x0F, 0xF8, 0x00, 0x00 };
+    std::vector<ParsedEvent> events;
+    USBMIDIParseBulkInFiltered(data, sizeof(data), nullptr, CollectEvent, &events);
+    CHECK_EQ(events.size(), 2u);
+}
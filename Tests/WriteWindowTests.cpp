@@ -0,0 +1,56 @@
+#include "TestHarness.h"
+#include "WriteWindow.h"
+
+TEST(WriteWindowGrowsWhileLatencyIsRoundTrip)
+{
+    WriteWindowConfig config;
+    config.maxDepth = 8;
+    WriteWindow window(config);
+    CHECK_EQ(window.Depth(), 1u);
+
+    // 1 ms completions that do not get slower with more in flight
+    for (int i = 0; i < 100; i++)
+        window.OnCompleted(1000000, false, true);
+    CHECK_EQ(window.Depth(), 8u);
+    CHECK_EQ(window.GetStats().peakDepth, 8u);
+
+    // Nothing waiting for a slot: no reason to grow
+    WriteWindow idle(config);
+    for (int i = 0; i < 100; i++)
+        idle.OnCompleted(1000000, false, false);
+    CHECK_EQ(idle.Depth(), 1u);
+}
+
+TEST(WriteWindowShrinksWhenWritesQueue)
+{
+    WriteWindowConfig config;
+    config.maxDepth = 8;
+    WriteWindow window(config);
+    for (int i = 0; i < 100; i++)
+        window.OnCompleted(200000, false, true);
+    CHECK_EQ(window.Depth(), 8u);
+
+    // The device starts NAKing: every write now waits 3 ms behind the others
+    for (int i = 0; i < 200; i++)
+        window.OnCompleted(200000 + (uint64_t)window.Depth() * 3000000, false, true);
+    CHECK_EQ(window.Depth(), 1u);
+    CHECK(window.GetStats().shrinks >= 7);
+    CHECK_EQ(window.GetStats().baseNs, 200000u);
+}
+
+TEST(WriteWindowHalvesOnFailure)
+{
+    WriteWindowConfig config;
+    config.maxDepth = 8;
+    WriteWindow window(config);
+    for (int i = 0; i < 100; i++)
+        window.OnCompleted(500000, false, true);
+    window.OnCompleted(0, true, true);
+    CHECK_EQ(window.Depth(), 4u);
+    window.OnCompleted(0, true, true);
+    CHECK_EQ(window.Depth(), 2u);
+    CHECK_EQ(window.GetStats().failures, 2u);
+
+    window.Reset();
+    CHECK_EQ(window.Depth(), 1u);
+}
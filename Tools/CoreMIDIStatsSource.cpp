@@ -0,0 +1,147 @@
+#include "CoreMIDIStatsSource.h"
+#include <algorithm>
+#include <string>
+
+// As published by RolandUSBDevice (see RolandUSBDevice.h)
+#define kRolandDriverOwner            CFSTR("se.cutup.MultiRolandDriver")
+#define kRolandPortStatsProperty      CFSTR("Roland-PortStats")
+#define kRolandIOStatsProperty        CFSTR("Roland-IOStats")
+#define kRolandRxRecoveryProperty     CFSTR("Roland-RxRecovery")
+#define kRolandLatencyProperty        CFSTR("Roland-Latency")
+#define kRolandStatsIntervalProperty  CFSTR("Roland-StatsIntervalMs")
+
+static double DictionaryNumber(CFDictionaryRef dict, CFStringRef key)
+{
+    if (!dict) return 0;
+    CFTypeRef value = CFDictionaryGetValue(dict, key);
+    if (!value || CFGetTypeID(value) != CFNumberGetTypeID()) return 0;
+    double number = 0;
+    CFNumberGetValue((CFNumberRef)value, kCFNumberDoubleType, &number);
+    return number;
+}
+
+static uint64_t DictionaryCounter(CFDictionaryRef dict, CFStringRef key)
+{
+    if (!dict) return 0;
+    CFTypeRef value = CFDictionaryGetValue(dict, key);
+    if (!value || CFGetTypeID(value) != CFNumberGetTypeID()) return 0;
+    SInt64 number = 0;
+    CFNumberGetValue((CFNumberRef)value, kCFNumberSInt64Type, &number);
+    return number > 0 ? (uint64_t)number : 0;
+}
+
+static CFDictionaryRef CopyDictionary(MIDIObjectRef object, CFStringRef property)
+{
+    CFDictionaryRef dict = nullptr;
+    if (MIDIObjectGetDictionaryProperty(object, property, &dict) != noErr) return nullptr;
+    return dict;
+}
+
+static std::string ObjectName(MIDIObjectRef object)
+{
+    CFStringRef name = nullptr;
+    if (MIDIObjectGetStringProperty(object, kMIDIPropertyName, &name) != noErr || !name)
+        return std::string();
+    char buffer[128] = {};
+    CFStringGetCString(name, buffer, sizeof(buffer), kCFStringEncodingUTF8);
+    CFRelease(name);
+    return buffer;
+}
+
+static bool OwnedByDriver(MIDIDeviceRef device)
+{
+    CFStringRef owner = nullptr;
+    if (MIDIObjectGetStringProperty(device, kMIDIPropertyDriverOwner, &owner) != noErr || !owner)
+        return false;
+    bool ours = CFStringCompare(owner, kRolandDriverOwner, 0) == kCFCompareEqualTo;
+    CFRelease(owner);
+    return ours;
+}
+
+CoreMIDIStatsSource::CoreMIDIStatsSource(uint32_t intervalMs)
+    : intervalMs((SInt32)intervalMs)
+{
+    if (MIDIClientCreate(CFSTR("RolandStat"), nullptr, nullptr, &client) != noErr)
+        client = 0;
+}
+
+CoreMIDIStatsSource::~CoreMIDIStatsSource()
+{
+    // Back to the driver's once a second
+    for (MIDIDeviceRef device : requested)
+        MIDIObjectRemoveProperty(device, kRolandStatsIntervalProperty);
+    if (client) MIDIClientDispose(client);
+}
+
+bool CoreMIDIStatsSource::Read(std::vector<PortStatsSample> &samples)
+{
+    samples.clear();
+    if (!client) return false;
+
+    ItemCount numDevices = MIDIGetNumberOfDevices();
+    for (ItemCount d = 0; d < numDevices; d++) {
+        MIDIDeviceRef device = MIDIGetDevice(d);
+        if (!device || !OwnedByDriver(device)) continue;
+        SInt32 offline = 0;
+        if (MIDIObjectGetIntegerProperty(device, kMIDIPropertyOffline, &offline) == noErr && offline)
+            continue;
+
+        SInt32 current = 0;
+        if (MIDIObjectGetIntegerProperty(device, kRolandStatsIntervalProperty, &current) != noErr
+            || current != intervalMs) {
+            MIDIObjectSetIntegerProperty(device, kRolandStatsIntervalProperty, intervalMs);
+            if (std::find(requested.begin(), requested.end(), device) == requested.end())
+                requested.push_back(device);
+        }
+
+        CFDictionaryRef io = CopyDictionary(device, kRolandIOStatsProperty);
+        CFDictionaryRef recovery = CopyDictionary(device, kRolandRxRecoveryProperty);
+        std::string deviceName = ObjectName(device);
+
+        ItemCount numEntities = MIDIDeviceGetNumberOfEntities(device);
+        for (ItemCount e = 0; e < numEntities; e++) {
+            MIDIEntityRef entity = MIDIDeviceGetEntity(device, e);
+            CFDictionaryRef port = CopyDictionary(entity, kRolandPortStatsProperty);
+            if (!port) continue;   // Not started yet
+            CFDictionaryRef latency = CopyDictionary(entity, kRolandLatencyProperty);
+
+            PortStatsSample s;
+            SInt32 uniqueID = 0;
+            MIDIObjectGetIntegerProperty(entity, kMIDIPropertyUniqueID, &uniqueID);
+            s.id     = (uint32_t)uniqueID;
+            s.device = deviceName;
+            s.port   = ObjectName(entity);
+            s.timeNs = DictionaryCounter(port, CFSTR("TimeUs")) * 1000;
+            s.rx.messages    = DictionaryCounter(port, CFSTR("RxMessages"));
+            s.rx.bytes       = DictionaryCounter(port, CFSTR("RxBytes"));
+            s.rx.sysExBytes  = DictionaryCounter(port, CFSTR("RxSysExBytes"));
+            s.tx.messages    = DictionaryCounter(port, CFSTR("TxMessages"));
+            s.tx.bytes       = DictionaryCounter(port, CFSTR("TxBytes"));
+            s.tx.sysExBytes  = DictionaryCounter(port, CFSTR("TxSysExBytes"));
+            s.txQueueBytes   = (uint32_t)DictionaryCounter(port, CFSTR("TxQueueBytes"));
+            s.txQueuePeak    = (uint32_t)DictionaryCounter(port, CFSTR("TxQueuePeak"));
+            s.shaperHolds    = DictionaryCounter(port, CFSTR("ShaperHolds"));
+
+            s.readErrors     = DictionaryCounter(io, CFSTR("ReadErrors"));
+            if (!io) s.readErrors = DictionaryCounter(recovery, CFSTR("Errors"));
+            s.writeErrors    = DictionaryCounter(io, CFSTR("WriteErrors"));
+            s.pacingWaitNs   = DictionaryCounter(io, CFSTR("PacingWaitUs")) * 1000;
+            s.sysExGapNs     = DictionaryCounter(io, CFSTR("SysExGapUs")) * 1000;
+            s.writeWindow    = (uint32_t)DictionaryCounter(io, CFSTR("WriteWindow"));
+            s.writesInFlight = (uint32_t)DictionaryCounter(io, CFSTR("WritesInFlight"));
+            s.writeLatencyNs = DictionaryCounter(io, CFSTR("WriteLatencyUs")) * 1000;
+
+            s.latencySamples = (uint32_t)DictionaryCounter(latency, CFSTR("Samples"));
+            s.latencyP50Us   = DictionaryNumber(latency, CFSTR("P50Us"));
+            s.latencyP95Us   = DictionaryNumber(latency, CFSTR("P95Us"));
+            s.latencyP99Us   = DictionaryNumber(latency, CFSTR("P99Us"));
+            samples.push_back(std::move(s));
+
+            CFRelease(port);
+            if (latency) CFRelease(latency);
+        }
+        if (io) CFRelease(io);
+        if (recovery) CFRelease(recovery);
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef CoreMIDIStatsSource_h
+#define CoreMIDIStatsSource_h
+
+#include <CoreMIDI/CoreMIDI.h>
+#include <vector>
+#include "PortStatistics.h"
+
+/// Reads the counters the driver publishes on its devices and entities
+/// (Roland-PortStats, Roland-IOStats, Roland-RxRecovery, Roland-Latency).
+///
+/// Asks every online device to publish at the viewer's interval through
+/// Roland-StatsIntervalMs, renewing the request if another viewer removed
+/// it, and removes it again when destroyed. Property changes reach this
+/// process through the client's run loop, which the caller keeps running.
+class CoreMIDIStatsSource : public PortStatsSource {
+public:
+    explicit CoreMIDIStatsSource(uint32_t intervalMs);
+    ~CoreMIDIStatsSource() override;
+
+    CoreMIDIStatsSource(const CoreMIDIStatsSource &) = delete;
+    CoreMIDIStatsSource &operator=(const CoreMIDIStatsSource &) = delete;
+
+    /// False if no MIDI client could be created.
+    bool Valid() const { return client != 0; }
+
+    bool Read(std::vector<PortStatsSample> &samples) override;
+
+private:
+    MIDIClientRef client = 0;
+    SInt32        intervalMs;
+    std::vector<MIDIDeviceRef> requested;
+};
+
+#endif /* CoreMIDIStatsSource_h */